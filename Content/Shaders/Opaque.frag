@@ -2,6 +2,7 @@
 in vec3 vWorldPos;
 in vec3 vNormal;
 in vec2 vTexCoord;
+in float vLight;
 out vec4 FragColor;
 
 uniform int uUseDiffuseTexture;
@@ -12,9 +13,10 @@ uniform sampler2D uDiffuseTexture;
 
 void main() {
     if (uUseDiffuseTexture == 1) {
-        FragColor = texture(uTest, vTexCoord);
+        vec4 texel = texture(uTest, vTexCoord);
+        FragColor = vec4(texel.rgb * vLight, texel.a);
         return;
     }
     //FragColor = uDiffuseColor;
-    FragColor = vec4(1.0);
+    FragColor = vec4(vec3(vLight), 1.0);
 }
\ No newline at end of file
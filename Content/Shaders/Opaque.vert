@@ -2,10 +2,12 @@
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in float aLight;
 
 out vec3 vWorldPos;
 out vec3 vNormal;
 out vec2 vTexCoord;
+out float vLight;
 
 uniform mat4 uModelMatrix;
 uniform mat4 uViewMatrix;
@@ -16,5 +18,6 @@ void main() {
     vWorldPos = worldPos.xyz;
     vNormal = normalize(mat3(uModelMatrix) * aNormal);
     vTexCoord = aTexCoord;
+    vLight = aLight;
     gl_Position = uProjectionMatrix * uViewMatrix * worldPos;
 }
\ No newline at end of file
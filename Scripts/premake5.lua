@@ -121,4 +121,81 @@ project "HARM"
             "copy \"$(SolutionDir)ThirdParty\\SDL3-3.2.8\\lib\\x64\\SDL3.dll\" \"$(SolutionDir)Content\\\""
         }
     
-    dependson { "Game" }
\ No newline at end of file
+    dependson { "Game" }
+
+project "Headless"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    systemversion "latest"
+
+    location "../Intermediate/ProjectFiles"
+
+    files {
+        "../Source/Headless/**.h",
+        "../Source/Headless/**.cpp"
+    }
+
+    includedirs {
+        "../Source",
+    }
+
+    links {
+        "Engine"
+    }
+
+    filter "toolset:msc*"
+        rtti "Off"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
+
+    dependson { "Game" }
+
+project "MapCompiler"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    systemversion "latest"
+
+    location "../Intermediate/ProjectFiles"
+
+    files {
+        "../Source/Tools/MapCompiler/**.h",
+        "../Source/Tools/MapCompiler/**.cpp"
+    }
+
+    includedirs {
+        "../Source",
+    }
+
+    links {
+        "Engine"
+    }
+
+    filter "toolset:msc*"
+        rtti "Off"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
+
+project "Benchmark"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    systemversion "latest"
+
+    location "../Intermediate/ProjectFiles"
+
+    files {
+        "../Source/Tools/Benchmark/**.h",
+        "../Source/Tools/Benchmark/**.cpp"
+    }
+
+    includedirs {
+        "../Source",
+    }
+
+    links {
+        "Engine"
+    }
+
+    filter "toolset:msc*"
+        rtti "Off"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
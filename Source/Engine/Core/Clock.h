@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+#include <chrono>
+
+namespace Hx {
+
+    // Monotonic wall clock for profiling and fixed timesteps, independent of SDL
+    inline f64 GetTimeSeconds() {
+        using Clock = std::chrono::steady_clock;
+        return std::chrono::duration<f64>(Clock::now().time_since_epoch()).count();
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+namespace Hx {
+
+    constexpr u64 Fnv1a64Offset = 0xcbf29ce484222325ull;
+    constexpr u64 Fnv1a64Prime  = 0x100000001b3ull;
+
+    inline u64 HashBytes(const void* Data, usize Size, u64 Seed = Fnv1a64Offset) {
+        const u8* Bytes = static_cast<const u8*>(Data);
+        u64 Hash = Seed;
+        for (usize i = 0; i < Size; ++i) {
+            Hash ^= Bytes[i];
+            Hash *= Fnv1a64Prime;
+        }
+        return Hash;
+    }
+
+    inline u64 HashString(const char* String) {
+        u64 Hash = Fnv1a64Offset;
+        for (const char* C = String; *C; ++C) {
+            Hash ^= static_cast<u8>(*C);
+            Hash *= Fnv1a64Prime;
+        }
+        return Hash;
+    }
+
+    // CRC-32 (IEEE 802.3, reflected), as used by zip and png
+    struct Crc32Table {
+        u32 entries[256];
+
+        constexpr Crc32Table() : entries() {
+            for (u32 i = 0; i < 256; ++i) {
+                u32 Crc = i;
+                for (u32 Bit = 0; Bit < 8; ++Bit) {
+                    Crc = (Crc & 1) ? (Crc >> 1) ^ 0xEDB88320u : (Crc >> 1);
+                }
+                entries[i] = Crc;
+            }
+        }
+    };
+
+    inline constexpr Crc32Table Crc32Lookup = {};
+
+    // Pass the previous result as Crc to checksum data in several pieces
+    inline u32 Crc32(const void* Data, usize Size, u32 Crc = 0) {
+        const u8* Bytes = static_cast<const u8*>(Data);
+        Crc = ~Crc;
+        for (usize i = 0; i < Size; ++i) {
+            Crc = Crc32Lookup.entries[(Crc ^ Bytes[i]) & 0xFF] ^ (Crc >> 8);
+        }
+        return ~Crc;
+    }
+
+}
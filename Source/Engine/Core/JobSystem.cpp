@@ -0,0 +1,113 @@
+#include "Engine/Core/JobSystem.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Hx {
+
+    struct Job {
+        JobFn fn;
+        void* data;
+        JobCounter* counter;
+    };
+
+    struct JobSystemImpl {
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<Job> queue;
+        bool quit = false;
+    };
+
+    static void RunJob(const Job& job) {
+        job.fn(job.data);
+        job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    static void WorkerMain(JobSystemImpl* impl) {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(impl->mutex);
+                impl->wake.wait(lock, [impl] { return impl->quit || !impl->queue.empty(); });
+                if (impl->quit && impl->queue.empty()) {
+                    return;
+                }
+
+                job = impl->queue.front();
+                impl->queue.pop_front();
+            }
+
+            RunJob(job);
+        }
+    }
+
+    JobSystem::JobSystem(u32 workerCount) {
+        Impl = new JobSystemImpl();
+
+        if (workerCount == 0) {
+            u32 hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        Impl->workers.reserve(workerCount);
+        for (u32 i = 0; i < workerCount; ++i) {
+            Impl->workers.emplace_back(WorkerMain, Impl);
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->quit = true;
+        }
+        Impl->wake.notify_all();
+
+        for (std::thread& worker : Impl->workers) {
+            worker.join();
+        }
+
+        delete Impl;
+    }
+
+    void JobSystem::Submit(JobCounter& counter, JobFn fn, void* data) {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->queue.push_back(Job{ fn, data, &counter });
+        }
+        Impl->wake.notify_one();
+    }
+
+    bool JobSystem::RunOneJob() {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            if (Impl->queue.empty()) {
+                return false;
+            }
+
+            job = Impl->queue.front();
+            Impl->queue.pop_front();
+        }
+
+        RunJob(job);
+        return true;
+    }
+
+    void JobSystem::Wait(JobCounter& counter) {
+        while (counter.pending.load(std::memory_order_acquire) > 0) {
+            if (!RunOneJob()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    u32 JobSystem::GetThreadCount() const {
+        return static_cast<u32>(Impl->workers.size()) + 1;
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+namespace Hx {
+
+    using JobFn = void (*)(void* Data);
+
+    // Tracks a group of submitted jobs; Wait returns once all of them ran
+    struct JobCounter {
+        std::atomic<u32> pending{ 0 };
+    };
+
+    // Fixed pool of worker threads pulling from one shared queue. Waiting
+    // threads run queued jobs themselves, so jobs may submit and wait on
+    // nested jobs (fork/join recursion) without starving the pool.
+    class JobSystem {
+    public:
+        // Zero picks one worker per hardware thread, minus the calling thread
+        explicit JobSystem(u32 workerCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void Submit(JobCounter& counter, JobFn fn, void* data);
+        void Wait(JobCounter& counter);
+
+        // Calls fn(begin, end) over [0, count) in chunks of at least grain items
+        template <typename Fn>
+        void ParallelFor(usize count, usize grain, Fn&& fn);
+
+        // Worker threads plus the thread calling Wait
+        u32 GetThreadCount() const;
+
+    private:
+        bool RunOneJob();
+
+        struct JobSystemImpl* Impl;
+    };
+
+    template <typename Fn>
+    void JobSystem::ParallelFor(usize count, usize grain, Fn&& fn) {
+        if (count == 0) return;
+        if (grain == 0) grain = 1;
+
+        // A few chunks per thread keeps everyone busy when chunk costs are uneven
+        usize maxChunks = static_cast<usize>(GetThreadCount()) * 4;
+        usize chunkCount = (count + grain - 1) / grain;
+        if (chunkCount > maxChunks) chunkCount = maxChunks;
+        usize chunkSize = (count + chunkCount - 1) / chunkCount;
+
+        if (chunkCount <= 1) {
+            fn(static_cast<usize>(0), count);
+            return;
+        }
+
+        struct Chunk {
+            std::remove_reference_t<Fn>* fn;
+            usize begin;
+            usize end;
+        };
+
+        std::vector<Chunk> chunks;
+        chunks.reserve(chunkCount);
+        for (usize begin = 0; begin < count; begin += chunkSize) {
+            usize end = begin + chunkSize < count ? begin + chunkSize : count;
+            chunks.push_back(Chunk{ &fn, begin, end });
+        }
+
+        JobCounter counter;
+        for (usize i = 1; i < chunks.size(); ++i) {
+            Submit(counter, [](void* data) {
+                Chunk* chunk = static_cast<Chunk*>(data);
+                (*chunk->fn)(chunk->begin, chunk->end);
+            }, &chunks[i]);
+        }
+
+        fn(chunks[0].begin, chunks[0].end);
+        Wait(counter);
+    }
+
+}
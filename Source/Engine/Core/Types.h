@@ -11,6 +11,7 @@ using u64 = std::uint64_t;
 using s8  = std::int8_t;
 using s16 = std::int16_t;
 using s32 = std::int32_t;
+using s64 = std::int64_t;
 
 using f32 = float;
 using f64 = double;
@@ -1,15 +1,33 @@
 #pragma once
 #include "Engine/Core/Types.h"
+#include "Engine/Core/JobSystem.h"
 #include "Engine/IO/FileSystem.h"
+#include "Engine/IO/FileCache.h"
+#include "Engine/IO/AsyncFileWriter.h"
+#include "Engine/IO/FileWatcher.h"
 #include "Engine/Memory/ArenaAllocator.h"
 #include "Engine/Math/Math.h"
 
 namespace Hx {
 
+    struct Level;
+
     struct Context {
         ArenaAllocator* mainArena;
         ArenaAllocator* transientArena;
+        JobSystem* jobSystem;
         FileSystem* fileSystem;
+        FileCache* fileCache;
+        AsyncFileWriter* fileWriter;
+        FileWatcher* fileWatcher;
+
+        // Null until a level is loaded. The host swaps it between ticks, so it
+        // is read fresh every tick rather than kept.
+        const Level* level;
+
+        // Which of the host's game instances this is, zero when it runs just one.
+        // Lets instances differ from each other and still repeat from run to run.
+        u32 instanceIndex;
     };
 
 }
\ No newline at end of file
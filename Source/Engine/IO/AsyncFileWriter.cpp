@@ -0,0 +1,213 @@
+#include "Engine/IO/AsyncFileWriter.h"
+#include "Engine/IO/FileSystem.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Hx {
+
+    struct AsyncWriteRequest {
+        char filename[MaxAsyncWritePath];
+        void* data;
+        usize size;
+        AsyncWriteMode mode;
+        AsyncWriteReleaseFn release;
+        void* userData;
+    };
+
+    struct AsyncFileWriterImpl {
+        FileSystem* fileSystem;
+        std::thread worker;
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+
+        std::vector<AsyncWriteRequest> queue;
+        bool busy = false;
+        bool quit = false;
+
+        AsyncWriteStats stats = {};
+    };
+
+    static void ReleaseRequest(const AsyncWriteRequest& request, bool success) {
+        if (request.release) {
+            request.release(request.data, request.size, success, request.userData);
+        } else {
+            free(request.data);
+        }
+    }
+
+    static bool IsSupersededInBatch(const std::vector<AsyncWriteRequest>& batch, usize index) {
+        const AsyncWriteRequest& request = batch[index];
+        if (request.mode == AsyncWriteMode::Append) {
+            return false;
+        }
+
+        // A later whole-file write to the same path makes this one pointless
+        for (usize i = index + 1; i < batch.size(); ++i) {
+            if (batch[i].mode != AsyncWriteMode::Append && strcmp(batch[i].filename, request.filename) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool WriteWholeFile(FileSystem* fileSystem, const AsyncWriteRequest& request) {
+        char tempFilename[MaxAsyncWritePath + 4];
+        const char* target = request.filename;
+        if (request.mode == AsyncWriteMode::AtomicReplace) {
+            snprintf(tempFilename, sizeof(tempFilename), "%s.tmp", request.filename);
+            target = tempFilename;
+        }
+
+        FileHandle* file = fileSystem->OpenFileWrite(target);
+        if (!file) return false;
+
+        bool result = file->Write(request.data, request.size);
+        if (result && request.mode == AsyncWriteMode::AtomicReplace) {
+            result = file->Flush();
+        }
+        fileSystem->CloseFile(file);
+
+        if (request.mode == AsyncWriteMode::AtomicReplace) {
+            result = result && fileSystem->RenameFile(tempFilename, request.filename);
+        }
+
+        return result;
+    }
+
+    static void ProcessBatch(AsyncFileWriterImpl* impl, std::vector<AsyncWriteRequest>& batch) {
+        u64 written = 0;
+        u64 superseded = 0;
+        u64 failed = 0;
+        u64 bytes = 0;
+
+        usize i = 0;
+        while (i < batch.size()) {
+            const AsyncWriteRequest& request = batch[i];
+
+            if (IsSupersededInBatch(batch, i)) {
+                ReleaseRequest(request, true);
+                superseded++;
+                i++;
+                continue;
+            }
+
+            if (request.mode != AsyncWriteMode::Append) {
+                bool result = WriteWholeFile(impl->fileSystem, request);
+                ReleaseRequest(request, result);
+                if (result) { written++; bytes += request.size; } else { failed++; }
+                i++;
+                continue;
+            }
+
+            // Gather the run of appends to this file behind a single open
+            usize runEnd = i + 1;
+            while (runEnd < batch.size() && batch[runEnd].mode == AsyncWriteMode::Append &&
+                   strcmp(batch[runEnd].filename, request.filename) == 0) {
+                runEnd++;
+            }
+
+            FileHandle* file = impl->fileSystem->OpenFileAppend(request.filename);
+            for (usize r = i; r < runEnd; ++r) {
+                bool result = file && file->Write(batch[r].data, batch[r].size);
+                ReleaseRequest(batch[r], result);
+                if (result) { written++; bytes += batch[r].size; } else { failed++; }
+            }
+            impl->fileSystem->CloseFile(file);
+
+            i = runEnd;
+        }
+
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stats.requestsWritten += written;
+        impl->stats.requestsSuperseded += superseded;
+        impl->stats.requestsFailed += failed;
+        impl->stats.bytesWritten += bytes;
+    }
+
+    static void WorkerMain(AsyncFileWriterImpl* impl) {
+        std::vector<AsyncWriteRequest> batch;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(impl->mutex);
+                impl->busy = false;
+                impl->idle.notify_all();
+
+                impl->wake.wait(lock, [impl] { return impl->quit || !impl->queue.empty(); });
+                if (impl->queue.empty() && impl->quit) {
+                    return;
+                }
+
+                batch.swap(impl->queue);
+                impl->busy = true;
+            }
+
+            ProcessBatch(impl, batch);
+            batch.clear();
+        }
+    }
+
+    AsyncFileWriter::AsyncFileWriter(FileSystem* inFileSystem) {
+        Impl = new AsyncFileWriterImpl();
+        Impl->fileSystem = inFileSystem;
+        Impl->worker = std::thread(WorkerMain, Impl);
+    }
+
+    AsyncFileWriter::~AsyncFileWriter() {
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->quit = true;
+        }
+        Impl->wake.notify_one();
+        Impl->worker.join();
+        delete Impl;
+    }
+
+    void AsyncFileWriter::Write(const AsyncWriteDesc& desc) {
+        AsyncWriteRequest request;
+        snprintf(request.filename, MaxAsyncWritePath, "%s", desc.filename);
+        request.data = desc.data;
+        request.size = desc.size;
+        request.mode = desc.mode;
+        request.release = desc.release;
+        request.userData = desc.userData;
+
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->queue.push_back(request);
+            Impl->stats.requestsQueued++;
+        }
+        Impl->wake.notify_one();
+    }
+
+    void AsyncFileWriter::WriteCopy(const char* filename, const void* data, usize size, AsyncWriteMode mode) {
+        void* copy = malloc(size);
+        memcpy(copy, data, size);
+
+        AsyncWriteDesc desc = {};
+        desc.filename = filename;
+        desc.data = copy;
+        desc.size = size;
+        desc.mode = mode;
+        Write(desc);
+    }
+
+    void AsyncFileWriter::Flush() {
+        std::unique_lock<std::mutex> lock(Impl->mutex);
+        Impl->idle.wait(lock, [this] { return Impl->queue.empty() && !Impl->busy; });
+    }
+
+    AsyncWriteStats AsyncFileWriter::GetStats() const {
+        std::lock_guard<std::mutex> lock(Impl->mutex);
+        return Impl->stats;
+    }
+
+}
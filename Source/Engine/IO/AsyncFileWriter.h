@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+namespace Hx {
+
+    class FileSystem;
+
+    constexpr usize MaxAsyncWritePath = 260;
+
+    enum class AsyncWriteMode : u8 {
+        Overwrite,
+        Append,
+        // Writes to "<filename>.tmp", flushes and renames over the target, so
+        // readers either see the old file or the complete new one
+        AtomicReplace
+    };
+
+    // Called on the writer thread once the buffer is no longer needed. When no
+    // release function is given the buffer is handed to free().
+    using AsyncWriteReleaseFn = void (*)(void* Data, usize Size, bool Success, void* UserData);
+
+    struct AsyncWriteDesc {
+        const char* filename;
+        void* data;
+        usize size;
+        AsyncWriteMode mode;
+        AsyncWriteReleaseFn release;
+        void* userData;
+    };
+
+    struct AsyncWriteStats {
+        u64 requestsQueued;
+        u64 requestsWritten;
+        u64 requestsSuperseded;
+        u64 requestsFailed;
+        u64 bytesWritten;
+    };
+
+    // Write-behind queue serviced by a single background thread. Queued
+    // overwrites of a path that is written again later in the same batch are
+    // dropped, and runs of appends to one file share a single open.
+    class AsyncFileWriter {
+    public:
+        explicit AsyncFileWriter(FileSystem* inFileSystem);
+        ~AsyncFileWriter();
+
+        AsyncFileWriter(const AsyncFileWriter&) = delete;
+        AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+        // Takes ownership of desc.data until its release function runs
+        void Write(const AsyncWriteDesc& desc);
+
+        // Copies data into a heap buffer first, for callers that do not own theirs
+        void WriteCopy(const char* filename, const void* data, usize size, AsyncWriteMode mode);
+
+        // Blocks until everything queued so far is on disk
+        void Flush();
+
+        AsyncWriteStats GetStats() const;
+
+    private:
+        struct AsyncFileWriterImpl* Impl;
+    };
+
+}
@@ -0,0 +1,244 @@
+#include "Engine/IO/FileCache.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Core/Hash.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Hx {
+
+    // Twice the file count and a power of two, so probe sequences stay short
+    constexpr usize FilePathTableSize = MaxCachedFiles * 2;
+    constexpr usize FilePathTableMask = FilePathTableSize - 1;
+
+    struct FilePathEntry {
+        u64 pathHash; // 0 marks an empty slot
+        u64 modifiedTime;
+        FileBlob* blob;
+        char path[MaxCachedFilePath];
+    };
+
+    struct FileCacheImpl {
+        FileSystem* fileSystem;
+        usize budgetInBytes;
+        u64 tick = 0;
+
+        FilePathEntry paths[FilePathTableSize] = {};
+        usize pathCount = 0;
+
+        // A blob with null data is a free slot
+        FileBlob blobs[MaxCachedFiles] = {};
+
+        FileCacheStats stats = {};
+    };
+
+    static FilePathEntry* FindPathEntry(FileCacheImpl* impl, const char* filename, u64 pathHash) {
+        usize index = static_cast<usize>(pathHash) & FilePathTableMask;
+        for (;;) {
+            FilePathEntry& entry = impl->paths[index];
+
+            if (entry.pathHash == 0) {
+                if (impl->pathCount >= MaxCachedFiles) {
+                    return nullptr;
+                }
+
+                entry.pathHash = pathHash;
+                entry.modifiedTime = 0;
+                entry.blob = nullptr;
+                snprintf(entry.path, MaxCachedFilePath, "%s", filename);
+                impl->pathCount++;
+                return &entry;
+            }
+
+            if (entry.pathHash == pathHash && strcmp(entry.path, filename) == 0) {
+                return &entry;
+            }
+
+            index = (index + 1) & FilePathTableMask;
+        }
+    }
+
+    static void FreeBlob(FileCacheImpl* impl, FileBlob* blob) {
+        impl->stats.bytesCached -= blob->size;
+        free(const_cast<char*>(blob->data));
+        *blob = {};
+    }
+
+    static void EvictBlob(FileCacheImpl* impl, FileBlob* blob) {
+        for (usize i = 0; i < FilePathTableSize; ++i) {
+            if (impl->paths[i].blob == blob) {
+                impl->paths[i].blob = nullptr;
+            }
+        }
+
+        FreeBlob(impl, blob);
+        impl->stats.evictions++;
+    }
+
+    static FileBlob* FindLeastRecentlyUsed(FileCacheImpl* impl) {
+        FileBlob* oldest = nullptr;
+        for (usize i = 0; i < MaxCachedFiles; ++i) {
+            FileBlob* blob = &impl->blobs[i];
+            if (!blob->data || blob->refCount > 0) continue;
+            if (!oldest || blob->lastUsed < oldest->lastUsed) {
+                oldest = blob;
+            }
+        }
+        return oldest;
+    }
+
+    static void TrimToBudget(FileCacheImpl* impl) {
+        while (impl->stats.bytesCached > impl->budgetInBytes) {
+            FileBlob* victim = FindLeastRecentlyUsed(impl);
+            if (!victim) break;
+            EvictBlob(impl, victim);
+        }
+    }
+
+    static FileBlob* FindBlob(FileCacheImpl* impl, u64 contentHash, const char* data, usize size) {
+        for (usize i = 0; i < MaxCachedFiles; ++i) {
+            FileBlob* blob = &impl->blobs[i];
+            if (blob->data && blob->contentHash == contentHash && blob->size == size && memcmp(blob->data, data, size) == 0) {
+                return blob;
+            }
+        }
+        return nullptr;
+    }
+
+    static FileBlob* AllocBlob(FileCacheImpl* impl) {
+        for (usize i = 0; i < MaxCachedFiles; ++i) {
+            if (!impl->blobs[i].data) {
+                return &impl->blobs[i];
+            }
+        }
+
+        FileBlob* victim = FindLeastRecentlyUsed(impl);
+        if (!victim) {
+            return nullptr;
+        }
+
+        EvictBlob(impl, victim);
+        return victim;
+    }
+
+    static char* ReadWholeFile(FileSystem* fileSystem, const char* filename, usize& outSize) {
+        FileHandle* handle = fileSystem->OpenFileRead(filename, FileAccessHint::Sequential);
+        if (!handle) return nullptr;
+
+        usize size = handle->GetSize();
+        char* data = static_cast<char*>(malloc(size + 1));
+
+        if (!handle->Read(data, size)) {
+            free(data);
+            fileSystem->CloseFile(handle);
+            return nullptr;
+        }
+
+        data[size] = '\0';
+        fileSystem->CloseFile(handle);
+
+        outSize = size;
+        return data;
+    }
+
+    FileCache::FileCache(FileSystem* inFileSystem, usize inBudgetInBytes) {
+        Impl = new FileCacheImpl();
+        Impl->fileSystem = inFileSystem;
+        Impl->budgetInBytes = inBudgetInBytes;
+    }
+
+    FileCache::~FileCache() {
+        for (usize i = 0; i < MaxCachedFiles; ++i) {
+            if (Impl->blobs[i].data) {
+                FreeBlob(Impl, &Impl->blobs[i]);
+            }
+        }
+        delete Impl;
+    }
+
+    const FileBlob* FileCache::Acquire(const char* filename) {
+        u64 pathHash = HashString(filename);
+        if (pathHash == 0) pathHash = 1;
+
+        u64 modifiedTime = Impl->fileSystem->GetModifiedTime(filename);
+
+        FilePathEntry* entry = FindPathEntry(Impl, filename, pathHash);
+        if (entry && entry->blob && entry->modifiedTime == modifiedTime) {
+            Impl->stats.hits++;
+            entry->blob->refCount++;
+            entry->blob->lastUsed = ++Impl->tick;
+            return entry->blob;
+        }
+
+        Impl->stats.misses++;
+
+        usize size = 0;
+        char* data = ReadWholeFile(Impl->fileSystem, filename, size);
+        if (!data) {
+            return nullptr;
+        }
+
+        u64 contentHash = HashBytes(data, size);
+
+        FileBlob* blob = FindBlob(Impl, contentHash, data, size);
+        if (blob) {
+            free(data);
+        } else {
+            blob = AllocBlob(Impl);
+            if (!blob) {
+                // TODO: Replace with engine logging system
+                printf("FileCache: no free blob for %s, every cached file is still referenced\n", filename);
+                free(data);
+                return nullptr;
+            }
+
+            blob->data = data;
+            blob->size = size;
+            blob->contentHash = contentHash;
+            blob->refCount = 0;
+            blob->pathCount = 0;
+            Impl->stats.bytesCached += size;
+        }
+
+        if (entry && entry->blob != blob) {
+            FileBlob* previous = entry->blob;
+            if (previous && --previous->pathCount == 0 && previous->refCount == 0) {
+                // Stale contents nobody is looking at any more
+                FreeBlob(Impl, previous);
+            }
+
+            entry->blob = blob;
+            blob->pathCount++;
+        }
+
+        if (entry) {
+            entry->modifiedTime = modifiedTime;
+        }
+
+        blob->refCount++;
+        blob->lastUsed = ++Impl->tick;
+
+        TrimToBudget(Impl);
+
+        return blob;
+    }
+
+    void FileCache::Release(const FileBlob* inBlob) {
+        if (!inBlob) return;
+
+        FileBlob* blob = const_cast<FileBlob*>(inBlob);
+        if (--blob->refCount > 0) return;
+
+        if (blob->pathCount == 0) {
+            FreeBlob(Impl, blob);
+        } else {
+            TrimToBudget(Impl);
+        }
+    }
+
+    const FileCacheStats& FileCache::GetStats() const {
+        return Impl->stats;
+    }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+namespace Hx {
+
+    class FileSystem;
+
+    constexpr usize MaxCachedFiles     = 256;
+    constexpr usize MaxCachedFilePath  = 260;
+
+    // A shared, immutable file buffer. The data is always null terminated so
+    // text sources can be handed straight to APIs expecting C strings.
+    struct FileBlob {
+        const char* data;
+        usize size;
+        u64 contentHash;
+
+        u32 refCount;
+        u32 pathCount;
+        u64 lastUsed;
+    };
+
+    struct FileCacheStats {
+        u64 hits;
+        u64 misses;
+        u64 evictions;
+        usize bytesCached;
+    };
+
+    // Caches file contents keyed by path and modification time. Identical
+    // contents loaded through different paths share one blob. Blobs nobody
+    // holds a reference to are evicted least recently used first once the
+    // cache grows past its byte budget. Not thread safe.
+    class FileCache {
+    public:
+        FileCache(FileSystem* inFileSystem, usize inBudgetInBytes);
+        ~FileCache();
+
+        FileCache(const FileCache&) = delete;
+        FileCache& operator=(const FileCache&) = delete;
+
+        // Returns a referenced blob, or nullptr if the file cannot be read.
+        // Every successful Acquire must be paired with a Release.
+        const FileBlob* Acquire(const char* filename);
+        void Release(const FileBlob* blob);
+
+        const FileCacheStats& GetStats() const;
+
+    private:
+        struct FileCacheImpl* Impl;
+    };
+
+}
@@ -11,12 +11,48 @@ namespace Hx {
         End
     };
 
+    // Per-handle access pattern hint, applied when the file is opened. To keep
+    // a file's data out of the OS cache, open it with FileBufferMode::Direct.
+    enum class FileAccessHint : u8 {
+        Normal,
+        Sequential,
+        Random
+    };
+
+    enum class FileBufferMode : u8 {
+        Buffered,
+        // Bypasses the OS page cache. Offsets, sizes and destination buffers must
+        // be multiples of DirectIOAlignment; use AllocDirectBuffer for the latter.
+        // A read that runs into the end of the file succeeds with a short tail.
+        Direct
+    };
+
+    constexpr usize DirectIOAlignment = 4096;
+
+    constexpr usize AlignDirectSize(usize Size) {
+        return (Size + DirectIOAlignment - 1) & ~(DirectIOAlignment - 1);
+    }
+
+    // A single piece of a scatter/gather read. Ranges that are adjacent in the
+    // file are coalesced into one read, so pass them sorted by offset. A range
+    // the file ends before fails the read, except on Direct handles when its
+    // run is contiguous in memory too: that one gets the same short tail as
+    // ReadAt. Runs of scattered destinations go through a staging buffer and
+    // always need every byte.
+    struct FileReadRange {
+        usize Offset;
+        usize Length;
+        void* Dst;
+    };
+
     class FileHandle {
     public:
         virtual bool Read(void* Dst, usize BytesToRead) = 0;
         virtual bool ReadAt(void* Dst, usize BytesToRead, usize Offset) = 0;
+        virtual bool ReadV(const FileReadRange* Ranges, usize RangeCount) = 0;
 
         virtual bool Write(const void* Src, usize BytesToWrite) = 0;
+        virtual bool Flush() = 0;
 
         virtual void Seek(usize Position, FileSeek SeekMode) = 0;
         virtual usize Tell() const = 0;
@@ -26,12 +62,24 @@ namespace Hx {
 
     class FileSystem {
     public:
-        FileHandle* OpenFileRead(const char* Filename);
+        FileHandle* OpenFileRead(const char* Filename, FileAccessHint Hint = FileAccessHint::Normal, FileBufferMode Mode = FileBufferMode::Buffered);
         FileHandle* OpenFileWrite(const char* Filename);
+        FileHandle* OpenFileAppend(const char* Filename);
         void CloseFile(FileHandle* File);
 
         bool IsOpen(FileHandle* File) const;
+
+        // Page aligned memory suitable for FileBufferMode::Direct reads
+        void* AllocDirectBuffer(usize SizeInBytes);
+        void FreeDirectBuffer(void* Buffer);
+
         bool FileExists(const char* Filename);
+
+        // Replaces To if it exists. Both paths must be on the same volume for the swap to be atomic.
+        bool RenameFile(const char* From, const char* To);
+
+        // Opaque, monotonically increasing write timestamp. Returns 0 if the file does not exist.
+        u64 GetModifiedTime(const char* Filename);
     };
 
 }
\ No newline at end of file
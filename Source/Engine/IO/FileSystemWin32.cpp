@@ -1,30 +1,47 @@
 #include "Engine/IO/FileSystem.h"
 #include <Windows.h>
+#include <cstring>
 
 namespace Hx {
 
+    // File-adjacent ranges whose destinations are not contiguous are read
+    // through a staging buffer of this size and scattered with memcpy.
+    constexpr usize ReadVStagingSize = 64 * 1024;
+
     class FileHandleWin32 final : public FileHandle {
     public:
-        FileHandleWin32(HANDLE handle);
+        FileHandleWin32(HANDLE handle, bool direct = false);
 
         bool Read(void* Dst, usize BytesToRead);
         bool ReadAt(void* Dst, usize BytesToRead, usize Offset);
+        bool ReadV(const FileReadRange* Ranges, usize RangeCount);
         bool Write(const void* Src, usize BytesToWrite);
+        bool Flush();
         void Seek(usize Position, FileSeek SeekMode);
         usize Tell() const;
         usize GetSize() const;
 
         HANDLE Handle;
+        bool Direct;
+
+    private:
+        bool ReadFileAt(void* Dst, usize BytesToRead, usize Offset, DWORD* OutBytesRead = nullptr);
+        bool IsCompleteRead(usize BytesToRead, DWORD BytesRead, usize EndOffset) const;
     };
 
-    FileHandleWin32::FileHandleWin32(HANDLE InHandle) : Handle(InHandle) {
+    FileHandleWin32::FileHandleWin32(HANDLE InHandle, bool InDirect) : Handle(InHandle), Direct(InDirect) {
 
     }
 
+    bool FileHandleWin32::IsCompleteRead(usize BytesToRead, DWORD BytesRead, usize EndOffset) const {
+        // Unbuffered reads are sized in whole sectors, so the last one in a file comes back short
+        return BytesRead == BytesToRead || (Direct && EndOffset == GetSize());
+    }
+
     bool FileHandleWin32::Read(void* Dst, usize BytesToRead) {
         DWORD BytesRead;
         bool Result = ReadFile(Handle, Dst, static_cast<DWORD>(BytesToRead), &BytesRead, nullptr);
-        return Result && BytesRead == BytesToRead;
+        return Result && IsCompleteRead(BytesToRead, BytesRead, Tell());
     }
 
     bool FileHandleWin32::ReadAt(void* Dst, usize BytesToRead, usize Offset) {
@@ -35,7 +52,71 @@ namespace Hx {
 
         DWORD BytesRead;
         bool Result = ReadFile(Handle, Dst, static_cast<DWORD>(BytesToRead), &BytesRead, nullptr);
-        return Result && BytesRead == BytesToRead;
+        return Result && IsCompleteRead(BytesToRead, BytesRead, Offset + BytesRead);
+    }
+
+    bool FileHandleWin32::ReadFileAt(void* Dst, usize BytesToRead, usize Offset, DWORD* OutBytesRead) {
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = static_cast<DWORD>(static_cast<u64>(Offset) & 0xFFFFFFFF);
+        Overlapped.OffsetHigh = static_cast<DWORD>(static_cast<u64>(Offset) >> 32);
+
+        DWORD BytesRead = 0;
+        bool Result = ReadFile(Handle, Dst, static_cast<DWORD>(BytesToRead), &BytesRead, &Overlapped);
+        if (OutBytesRead) {
+            *OutBytesRead = BytesRead;
+        }
+        return Result && IsCompleteRead(BytesToRead, BytesRead, Offset + BytesRead);
+    }
+
+    bool FileHandleWin32::ReadV(const FileReadRange* Ranges, usize RangeCount) {
+        // Aligned so coalesced runs also work on unbuffered handles
+        alignas(DirectIOAlignment) u8 Staging[ReadVStagingSize];
+
+        usize First = 0;
+        while (First < RangeCount) {
+            // Grow the run while the next range starts where the previous one ends in the file
+            usize Last = First + 1;
+            usize RunLength = Ranges[First].Length;
+            bool DstContiguous = true;
+
+            while (Last < RangeCount) {
+                const FileReadRange& Prev = Ranges[Last - 1];
+                const FileReadRange& Next = Ranges[Last];
+                if (Next.Offset != Prev.Offset + Prev.Length) {
+                    break;
+                }
+
+                bool NextDstContiguous = DstContiguous && static_cast<u8*>(Prev.Dst) + Prev.Length == Next.Dst;
+                if (!NextDstContiguous && RunLength + Next.Length > ReadVStagingSize) {
+                    break;
+                }
+
+                DstContiguous = NextDstContiguous;
+                RunLength += Next.Length;
+                ++Last;
+            }
+
+            // Direct reads into the caller's buffer may come back short at the
+            // end of the file, the same as ReadAt. A staged run cannot, since
+            // its ranges would be scattered from bytes that were never read.
+            DWORD BytesRead = 0;
+            void* RunDst = DstContiguous ? Ranges[First].Dst : Staging;
+            if (!ReadFileAt(RunDst, RunLength, Ranges[First].Offset, &BytesRead) || (!DstContiguous && BytesRead < RunLength)) {
+                return false;
+            }
+
+            if (!DstContiguous) {
+                usize Cursor = 0;
+                for (usize i = First; i < Last; ++i) {
+                    std::memcpy(Ranges[i].Dst, Staging + Cursor, Ranges[i].Length);
+                    Cursor += Ranges[i].Length;
+                }
+            }
+
+            First = Last;
+        }
+
+        return true;
     }
 
     bool FileHandleWin32::Write(const void* Src, usize BytesToWrite) {
@@ -44,6 +125,10 @@ namespace Hx {
         return Result && BytesWritten == BytesToWrite;
     }
 
+    bool FileHandleWin32::Flush() {
+        return FlushFileBuffers(Handle);
+    }
+
     void FileHandleWin32::Seek(usize Position, FileSeek SeekMode) {
         DWORD MoveMethod = FILE_BEGIN;
         switch (SeekMode) {
@@ -72,12 +157,26 @@ namespace Hx {
         return static_cast<usize>(Size.QuadPart);
     }
 
-    FileHandle* FileSystem::OpenFileRead(const char* Filename) {
-        HANDLE Handle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    static DWORD GetAccessHintFlags(FileAccessHint Hint) {
+        switch (Hint) {
+            case FileAccessHint::Sequential: return FILE_FLAG_SEQUENTIAL_SCAN;
+            case FileAccessHint::Random: return FILE_FLAG_RANDOM_ACCESS;
+            default: return 0;
+        }
+    }
+
+    FileHandle* FileSystem::OpenFileRead(const char* Filename, FileAccessHint Hint, FileBufferMode Mode) {
+        DWORD Flags = FILE_ATTRIBUTE_NORMAL | GetAccessHintFlags(Hint);
+        if (Mode == FileBufferMode::Direct) {
+            Flags |= FILE_FLAG_NO_BUFFERING;
+        }
+
+        // Sharing delete lets a writer rename a new version over the file while it is being read
+        HANDLE Handle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, Flags, nullptr);
         if (Handle == INVALID_HANDLE_VALUE) {
             return nullptr;
         }
-        return new FileHandleWin32(Handle);
+        return new FileHandleWin32(Handle, Mode == FileBufferMode::Direct);
     }
 
     FileHandle* FileSystem::OpenFileWrite(const char* Filename) {
@@ -88,6 +187,16 @@ namespace Hx {
         return new FileHandleWin32(Handle);
     }
 
+    FileHandle* FileSystem::OpenFileAppend(const char* Filename) {
+        HANDLE Handle = CreateFileA(Filename, GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (Handle == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+
+        SetFilePointer(Handle, 0, nullptr, FILE_END);
+        return new FileHandleWin32(Handle);
+    }
+
     void FileSystem::CloseFile(FileHandle* File) {
         if (File) {
             FileHandleWin32* WinFile = static_cast<FileHandleWin32*>(File);
@@ -100,9 +209,32 @@ namespace Hx {
         return File != nullptr;
     }
 
+    void* FileSystem::AllocDirectBuffer(usize SizeInBytes) {
+        // VirtualAlloc hands out whole pages, which satisfies the sector alignment of unbuffered IO
+        return VirtualAlloc(nullptr, AlignDirectSize(SizeInBytes), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+
+    void FileSystem::FreeDirectBuffer(void* Buffer) {
+        if (Buffer) {
+            VirtualFree(Buffer, 0, MEM_RELEASE);
+        }
+    }
+
     bool FileSystem::FileExists(const char* Filename) {
         DWORD Attributes = GetFileAttributesA(Filename);
         return (Attributes != INVALID_FILE_ATTRIBUTES && !(Attributes & FILE_ATTRIBUTE_DIRECTORY));
     }
 
+    bool FileSystem::RenameFile(const char* From, const char* To) {
+        return MoveFileExA(From, To, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    }
+
+    u64 FileSystem::GetModifiedTime(const char* Filename) {
+        WIN32_FILE_ATTRIBUTE_DATA Data;
+        if (!GetFileAttributesExA(Filename, GetFileExInfoStandard, &Data)) {
+            return 0;
+        }
+        return (static_cast<u64>(Data.ftLastWriteTime.dwHighDateTime) << 32) | Data.ftLastWriteTime.dwLowDateTime;
+    }
+
 }
\ No newline at end of file
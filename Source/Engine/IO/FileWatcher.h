@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+namespace Hx {
+
+    constexpr usize MaxWatchedDirectories = 8;
+    constexpr usize MaxFileSubscriptions  = 64;
+    constexpr usize MaxPendingFileChanges = 64;
+    constexpr usize MaxWatchPathLength    = 260;
+
+    // Editors tend to save a file in several bursts (truncate, write, rename),
+    // so a change is only reported once the file has been quiet for this long.
+    constexpr u64 FileChangeCoalesceMs = 100;
+
+    using FileChangedFn = void (*)(const char* Filename, void* UserData);
+
+    class FileWatcher {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // Starts watching a directory and everything below it. Paths reported to
+        // subscribers are relative to the working directory, e.g. "Shaders/Opaque.vert".
+        bool WatchDirectory(const char* Directory);
+
+        // Callback is invoked on the thread calling Poll whenever Filename changes.
+        bool Subscribe(const char* Filename, FileChangedFn Callback, void* UserData);
+
+        // Drains pending OS notifications and dispatches coalesced changes.
+        // Call once per frame from the main thread.
+        void Poll();
+
+    private:
+        struct FileWatcherImpl* Impl;
+    };
+
+}
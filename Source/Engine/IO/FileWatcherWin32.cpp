@@ -0,0 +1,186 @@
+#include "Engine/IO/FileWatcher.h"
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace Hx {
+
+    constexpr usize WatchBufferSize = 16 * 1024;
+
+    struct WatchedDirectory {
+        HANDLE directory;
+        OVERLAPPED overlapped;
+        char path[MaxWatchPathLength];
+        alignas(DWORD) u8 buffer[WatchBufferSize];
+    };
+
+    struct FileSubscription {
+        char filename[MaxWatchPathLength];
+        FileChangedFn callback;
+        void* userData;
+    };
+
+    struct PendingFileChange {
+        char filename[MaxWatchPathLength];
+        u64 lastEventTime;
+    };
+
+    struct FileWatcherImpl {
+        WatchedDirectory directories[MaxWatchedDirectories];
+        usize directoryCount = 0;
+
+        FileSubscription subscriptions[MaxFileSubscriptions];
+        usize subscriptionCount = 0;
+
+        PendingFileChange pending[MaxPendingFileChanges];
+        usize pendingCount = 0;
+    };
+
+    static bool IssueDirectoryRead(WatchedDirectory& Dir) {
+        ResetEvent(Dir.overlapped.hEvent);
+        return ReadDirectoryChangesW(Dir.directory, Dir.buffer, static_cast<DWORD>(WatchBufferSize), TRUE,
+                                     FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+                                     nullptr, &Dir.overlapped, nullptr);
+    }
+
+    static void QueueChange(FileWatcherImpl* Impl, const char* Filename, u64 Now) {
+        for (usize i = 0; i < Impl->pendingCount; ++i) {
+            if (strcmp(Impl->pending[i].filename, Filename) == 0) {
+                Impl->pending[i].lastEventTime = Now;
+                return;
+            }
+        }
+
+        if (Impl->pendingCount >= MaxPendingFileChanges) {
+            // TODO: Replace with engine logging system
+            printf("FileWatcher: dropping change to %s, too many pending changes\n", Filename);
+            return;
+        }
+
+        PendingFileChange& Change = Impl->pending[Impl->pendingCount++];
+        snprintf(Change.filename, MaxWatchPathLength, "%s", Filename);
+        Change.lastEventTime = Now;
+    }
+
+    static void DrainDirectory(FileWatcherImpl* Impl, WatchedDirectory& Dir, u64 Now) {
+        if (WaitForSingleObject(Dir.overlapped.hEvent, 0) != WAIT_OBJECT_0) {
+            return;
+        }
+
+        DWORD BytesTransferred = 0;
+        if (GetOverlappedResult(Dir.directory, &Dir.overlapped, &BytesTransferred, FALSE) && BytesTransferred > 0) {
+            const u8* Cursor = Dir.buffer;
+            for (;;) {
+                const FILE_NOTIFY_INFORMATION* Info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(Cursor);
+
+                if (Info->Action == FILE_ACTION_ADDED ||
+                    Info->Action == FILE_ACTION_MODIFIED ||
+                    Info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                    char Name[MaxWatchPathLength];
+                    int NameLength = WideCharToMultiByte(CP_UTF8, 0, Info->FileName,
+                                                         static_cast<int>(Info->FileNameLength / sizeof(WCHAR)),
+                                                         Name, static_cast<int>(MaxWatchPathLength - 1), nullptr, nullptr);
+                    Name[NameLength] = '\0';
+
+                    char Filename[MaxWatchPathLength];
+                    snprintf(Filename, MaxWatchPathLength, "%s/%s", Dir.path, Name);
+                    for (char* C = Filename; *C; ++C) {
+                        if (*C == '\\') *C = '/';
+                    }
+
+                    QueueChange(Impl, Filename, Now);
+                }
+
+                if (Info->NextEntryOffset == 0) break;
+                Cursor += Info->NextEntryOffset;
+            }
+        }
+
+        // A zero byte result means the notification buffer overflowed; the events
+        // are lost but the watch itself stays valid, so just re-arm it.
+        IssueDirectoryRead(Dir);
+    }
+
+    FileWatcher::FileWatcher() {
+        Impl = new FileWatcherImpl();
+    }
+
+    FileWatcher::~FileWatcher() {
+        for (usize i = 0; i < Impl->directoryCount; ++i) {
+            WatchedDirectory& Dir = Impl->directories[i];
+            CancelIoEx(Dir.directory, &Dir.overlapped);
+            CloseHandle(Dir.directory);
+            CloseHandle(Dir.overlapped.hEvent);
+        }
+        delete Impl;
+    }
+
+    bool FileWatcher::WatchDirectory(const char* Directory) {
+        if (Impl->directoryCount >= MaxWatchedDirectories) {
+            return false;
+        }
+
+        HANDLE Handle = CreateFileA(Directory, FILE_LIST_DIRECTORY,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (Handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        WatchedDirectory& Dir = Impl->directories[Impl->directoryCount];
+        Dir.directory = Handle;
+        Dir.overlapped = {};
+        Dir.overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        snprintf(Dir.path, MaxWatchPathLength, "%s", Directory);
+
+        if (!IssueDirectoryRead(Dir)) {
+            CloseHandle(Dir.overlapped.hEvent);
+            CloseHandle(Handle);
+            return false;
+        }
+
+        Impl->directoryCount++;
+        return true;
+    }
+
+    bool FileWatcher::Subscribe(const char* Filename, FileChangedFn Callback, void* UserData) {
+        if (Impl->subscriptionCount >= MaxFileSubscriptions) {
+            return false;
+        }
+
+        FileSubscription& Sub = Impl->subscriptions[Impl->subscriptionCount++];
+        snprintf(Sub.filename, MaxWatchPathLength, "%s", Filename);
+        Sub.callback = Callback;
+        Sub.userData = UserData;
+        return true;
+    }
+
+    void FileWatcher::Poll() {
+        u64 Now = GetTickCount64();
+
+        for (usize i = 0; i < Impl->directoryCount; ++i) {
+            DrainDirectory(Impl, Impl->directories[i], Now);
+        }
+
+        usize i = 0;
+        while (i < Impl->pendingCount) {
+            PendingFileChange& Change = Impl->pending[i];
+            if (Now - Change.lastEventTime < FileChangeCoalesceMs) {
+                ++i;
+                continue;
+            }
+
+            for (usize s = 0; s < Impl->subscriptionCount; ++s) {
+                const FileSubscription& Sub = Impl->subscriptions[s];
+                if (strcmp(Sub.filename, Change.filename) == 0) {
+                    Sub.callback(Sub.filename, Sub.userData);
+                }
+            }
+
+            // Swap-remove, the order of pending changes does not matter
+            Impl->pending[i] = Impl->pending[--Impl->pendingCount];
+        }
+    }
+
+}
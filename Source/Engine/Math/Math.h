@@ -4,5 +4,6 @@
 #include "Engine/Math/Vector3.h"
 #include "Engine/Math/Vector4.h"
 #include "Engine/Math/Matrix4.h"
+#include "Engine/Math/Quaternion.h"
 
 #include "Engine/Math/MathUtils.h"
\ No newline at end of file
@@ -18,6 +18,10 @@ namespace Hx {
         return rad * (180.0f / Pi32);
     }
 
+    inline f32 Sqrt(f32 value) {
+        return sqrtf(value);
+    }
+
     inline f32 Sin(f32 value) {
         return sinf(value);
     }
@@ -20,6 +20,20 @@ namespace Hx {
         }
     };
 
+    // Column major, so the result applies b first and then a
+    inline Matrix4 Multiply(const Matrix4& a, const Matrix4& b) {
+        Matrix4 result;
+        for (u32 column = 0; column < 4; ++column) {
+            for (u32 row = 0; row < 4; ++row) {
+                result.m[column * 4 + row] = a.m[row] * b.m[column * 4] +
+                                             a.m[4 + row] * b.m[column * 4 + 1] +
+                                             a.m[8 + row] * b.m[column * 4 + 2] +
+                                             a.m[12 + row] * b.m[column * 4 + 3];
+            }
+        }
+        return result;
+    }
+
     inline Matrix4 Perspective(f32 Fov, f32 Aspect, f32 Near, f32 Far) {
         Matrix4 result = {};
         f32 tanHalfFov = tanf(Fov / 2.0f);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Matrix4.h"
+#include "Engine/Math/Vector3.h"
+
+#include <cmath>
+
+namespace Hx {
+
+    struct Quaternion {
+        f32 x;
+        f32 y;
+        f32 z;
+        f32 w;
+
+        static inline Quaternion Identity() {
+            return Quaternion{ 0.0f, 0.0f, 0.0f, 1.0f };
+        }
+    };
+
+    // Angle in radians around a unit axis
+    inline Quaternion FromAxisAngle(const Vector3& Axis, f32 Angle) {
+        f32 s = sinf(Angle * 0.5f);
+        return Quaternion{ Axis.x * s, Axis.y * s, Axis.z * s, cosf(Angle * 0.5f) };
+    }
+
+    // Applies b first and then a
+    inline Quaternion Multiply(const Quaternion& a, const Quaternion& b) {
+        return Quaternion{
+            a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+        };
+    }
+
+    inline Quaternion Normalize(const Quaternion& Q) {
+        f32 len = sqrtf(Q.x * Q.x + Q.y * Q.y + Q.z * Q.z + Q.w * Q.w);
+        if (len > 0.0f) {
+            return Quaternion{ Q.x / len, Q.y / len, Q.z / len, Q.w / len };
+        }
+        return Quaternion::Identity();
+    }
+
+    // Scale, then rotate, then translate
+    inline Matrix4 ComposeTransform(const Vector3& Translation, const Quaternion& Rotation, const Vector3& Scaling) {
+        f32 xx = Rotation.x * Rotation.x;
+        f32 yy = Rotation.y * Rotation.y;
+        f32 zz = Rotation.z * Rotation.z;
+        f32 xy = Rotation.x * Rotation.y;
+        f32 xz = Rotation.x * Rotation.z;
+        f32 yz = Rotation.y * Rotation.z;
+        f32 wx = Rotation.w * Rotation.x;
+        f32 wy = Rotation.w * Rotation.y;
+        f32 wz = Rotation.w * Rotation.z;
+
+        Matrix4 result;
+        result.m[0] = (1.0f - 2.0f * (yy + zz)) * Scaling.x;
+        result.m[1] = 2.0f * (xy + wz) * Scaling.x;
+        result.m[2] = 2.0f * (xz - wy) * Scaling.x;
+        result.m[3] = 0.0f;
+        result.m[4] = 2.0f * (xy - wz) * Scaling.y;
+        result.m[5] = (1.0f - 2.0f * (xx + zz)) * Scaling.y;
+        result.m[6] = 2.0f * (yz + wx) * Scaling.y;
+        result.m[7] = 0.0f;
+        result.m[8] = 2.0f * (xz + wy) * Scaling.z;
+        result.m[9] = 2.0f * (yz - wx) * Scaling.z;
+        result.m[10] = (1.0f - 2.0f * (xx + yy)) * Scaling.z;
+        result.m[11] = 0.0f;
+        result.m[12] = Translation.x;
+        result.m[13] = Translation.y;
+        result.m[14] = Translation.z;
+        result.m[15] = 1.0f;
+        return result;
+    }
+
+}
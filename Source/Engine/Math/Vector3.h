@@ -16,7 +16,7 @@ namespace Hx {
 
         Vector3(f32 scalar) : x(scalar), y(scalar), z(scalar) {}
 
-        Vector3(const Vector3& V) : x(V.x), y(V.y), z(V.z) {}
+        Vector3(const Vector3& V) = default;
 
         bool operator==(const Vector3& V) const {
             bool Result = (x == V.x) && (y == V.y) && (z == V.z);
@@ -73,4 +73,20 @@ namespace Hx {
         arena.current = arena.begin;
         arena.base.stats.BytesInUse = 0;
     }
+
+    // A point in an arena to roll back to, freeing everything allocated since
+    struct ArenaMarker {
+        void* current;
+        u64   bytesInUse;
+    };
+
+    inline ArenaMarker GetArenaMarker(const ArenaAllocator& arena) {
+        return ArenaMarker{ arena.current, arena.base.stats.BytesInUse };
+    }
+
+    inline void RestoreArena(ArenaAllocator& arena, const ArenaMarker& marker) {
+        assert(marker.current >= arena.begin && marker.current <= arena.current);
+        arena.current = marker.current;
+        arena.base.stats.BytesInUse = marker.bytesInUse;
+    }
 }
\ No newline at end of file
@@ -26,6 +26,7 @@ namespace Hx {
         // Program methods
         ProgramHandle CreateProgram(const ProgramDesc& desc);
         void DestroyProgram(ProgramHandle Program);
+        bool ReloadProgram(ProgramHandle Program, const ProgramDesc& desc);
         void BindProgram(ProgramHandle Program);
         void SetUniformInt(ProgramHandle Program, const char* Name, int Value);
         void SetUniformFloat(ProgramHandle Program, const char* Name, float Value);
@@ -212,34 +212,57 @@ namespace Hx {
         });
     }
 
+    static GLuint LinkProgram(RenderDeviceImpl* Impl, const ProgramDesc& desc) {
+        GLShader* VertexShader = Impl->shaders.TryGet(desc.vertexShader);
+        GLShader* FragmentShader = Impl->shaders.TryGet(desc.fragmentShader);
+
+        if (!VertexShader || !FragmentShader) {
+            return 0;
+        }
+
+        GLuint GlProgram = glCreateProgram();
+        glAttachShader(GlProgram, VertexShader->id);
+        glAttachShader(GlProgram, FragmentShader->id);
+        glLinkProgram(GlProgram);
+
+        GLint Success;
+        glGetProgramiv(GlProgram, GL_LINK_STATUS, &Success);
+        if (!Success) {
+            char InfoLog[512];
+            glGetProgramInfoLog(GlProgram, 512, nullptr, InfoLog);
+            // TODO: Replace with engine logging system
+            printf("Program linking failed: %s\n", InfoLog);
+            glDeleteProgram(GlProgram);
+            return 0;
+        }
+
+        return GlProgram;
+    }
+
     ProgramHandle RenderDevice::CreateProgram(const ProgramDesc& desc) {
         return Impl->programs.Create([&](GLProgram& program) {
-            GLShader* VertexShader = Impl->shaders.TryGet(desc.vertexShader);
-            GLShader* FragmentShader = Impl->shaders.TryGet(desc.fragmentShader);
+            program.id = LinkProgram(Impl, desc);
+        });
+    }
 
-            if (!VertexShader || !FragmentShader) {
-                program.id = 0;
-                return;
-            }
+    bool RenderDevice::ReloadProgram(ProgramHandle Program, const ProgramDesc& desc) {
+        GLProgram* P = Impl->programs.TryGet(Program);
+        if (!P) return false;
 
-            GLuint GlProgram = glCreateProgram();
-            glAttachShader(GlProgram, VertexShader->id);
-            glAttachShader(GlProgram, FragmentShader->id);
-            glLinkProgram(GlProgram);
+        // Keep the old program alive if the new one fails to link, so a typo
+        // while iterating on a shader does not take the whole material down
+        GLuint NewId = LinkProgram(Impl, desc);
+        if (NewId == 0) return false;
 
-            GLint Success;
-            glGetProgramiv(GlProgram, GL_LINK_STATUS, &Success);
-            if (!Success) {
-                char InfoLog[512];
-                glGetProgramInfoLog(GlProgram, 512, nullptr, InfoLog);
-                // TODO: Replace with engine logging system
-                printf("Program linking failed: %s\n", InfoLog);
-                glDeleteProgram(GlProgram);
-                program.id = 0;
-                return;
+        if (P->id != 0) {
+            if (Impl->currentProgram == P->id) {
+                Impl->currentProgram = 0;
             }
-            program.id = GlProgram;
-        });
+            glDeleteProgram(P->id);
+        }
+
+        P->id = NewId;
+        return true;
     }
 
     void RenderDevice::DestroyProgram(ProgramHandle Program) {
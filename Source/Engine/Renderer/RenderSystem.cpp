@@ -1,6 +1,9 @@
 #include "Engine/Renderer/RenderSystem.h"
 #include "Engine/Core/ResourceTable.h"
-#include "Engine/IO/FileSystem.h"
+#include "Engine/IO/FileCache.h"
+#include "Engine/IO/FileWatcher.h"
+
+#include <cstring>
 
 namespace Hx {
 
@@ -24,6 +27,15 @@ namespace Hx {
     };
 
     constexpr usize MaxDrawCommands = 1024;
+    constexpr usize MaxShaderPrograms = 16;
+
+    // Remembers which files a program was built from so it can be rebuilt in place
+    struct ShaderProgramSource {
+        Hx::ProgramHandle program;
+        const char* vertexShaderPath;
+        const char* fragmentShaderPath;
+        const char* debugName;
+    };
 
     struct DrawCommand {
         MaterialHandle material;
@@ -33,11 +45,12 @@ namespace Hx {
         Hx::Matrix4 transform;
         u32 indexCount;
         u32 indexOffset;
-        u32 vertexOffset;
+        s32 vertexOffset;
     };
     
     struct RenderSystemImpl {
         Hx::RenderDevice* device;
+        Hx::FileCache* fileCache;
 
         ResourceTable<MeshTag, MeshRecord> meshTable;
         ResourceTable<StaticMeshTag, StaticMeshRecord> staticMeshTable;
@@ -45,6 +58,8 @@ namespace Hx {
 
         DrawCommand drawCommands[MaxDrawCommands];
         usize drawCommandCount = 0;
+        // Only the first flush of a frame clears, later ones draw on top of it
+        bool frameCleared = false;
 
         Hx::Matrix4 currentViewMatrix;
         Hx::Matrix4 currentProjectionMatrix;
@@ -56,52 +71,68 @@ namespace Hx {
         Hx::ProgramHandle opaqueShaderProgram;
         Hx::ProgramHandle transparentShaderProgram;
         Hx::ProgramHandle unlitShaderProgram;
-    };
-
-    inline static Hx::ShaderHandle LoadShaderFromFile(Hx::RenderDevice* device, const char* filename, Hx::ShaderStage stage) {
-        Hx::FileSystem fileSystem;
-
-        Hx::FileHandle* handle = fileSystem.OpenFileRead(filename);
-        if (!handle) return Hx::ShaderHandle{};
 
-        usize fileSize = handle->GetSize();
-        char* buffer = new char[fileSize + 1]{};
+        ShaderProgramSource shaderSources[MaxShaderPrograms];
+        usize shaderSourceCount = 0;
+    };
 
-        handle->Read(buffer, fileSize);
+    inline static Hx::ShaderHandle LoadShaderFromFile(Hx::RenderDevice* device, Hx::FileCache* fileCache, const char* filename, Hx::ShaderStage stage) {
+        const Hx::FileBlob* source = fileCache->Acquire(filename);
+        if (!source) return Hx::ShaderHandle{};
 
         Hx::ShaderDesc shaderDesc = {};
         shaderDesc.stage = stage;
-        shaderDesc.source = buffer;
+        shaderDesc.source = source->data;
         shaderDesc.debugName = filename;
 
         Hx::ShaderHandle shader = device->CreateShader(shaderDesc);
 
-        fileSystem.CloseFile(handle);
+        fileCache->Release(source);
 
         return shader;
     }
 
-    inline static Hx::ProgramHandle CreateShaderProgram(Hx::RenderDevice* device, const char* vertexShaderPath, const char* fragmentShaderPath, const char* debugName) {
-        Hx::ShaderHandle vertexShader = LoadShaderFromFile(device, vertexShaderPath, Hx::ShaderStage::Vertex);
+    inline static bool LoadProgramDesc(RenderSystemImpl* impl, const char* vertexShaderPath, const char* fragmentShaderPath, const char* debugName, Hx::ProgramDesc& outDesc) {
+        Hx::RenderDevice* device = impl->device;
+
+        Hx::ShaderHandle vertexShader = LoadShaderFromFile(device, impl->fileCache, vertexShaderPath, Hx::ShaderStage::Vertex);
         if (!vertexShader) {
-            return Hx::ProgramHandle{};
+            return false;
         }
 
-        Hx::ShaderHandle fragmentShader = LoadShaderFromFile(device, fragmentShaderPath, Hx::ShaderStage::Fragment);
+        Hx::ShaderHandle fragmentShader = LoadShaderFromFile(device, impl->fileCache, fragmentShaderPath, Hx::ShaderStage::Fragment);
         if (!fragmentShader) {
             device->DestroyShader(vertexShader);
-            return Hx::ProgramHandle{};
+            return false;
         }
 
-        Hx::ProgramDesc programDesc = {};
-        programDesc.vertexShader = vertexShader;
-        programDesc.fragmentShader = fragmentShader;
-        programDesc.debugName = debugName;
+        outDesc = {};
+        outDesc.vertexShader = vertexShader;
+        outDesc.fragmentShader = fragmentShader;
+        outDesc.debugName = debugName;
+        return true;
+    }
+
+    inline static Hx::ProgramHandle CreateShaderProgram(RenderSystemImpl* impl, const char* vertexShaderPath, const char* fragmentShaderPath, const char* debugName) {
+        Hx::RenderDevice* device = impl->device;
+
+        Hx::ProgramDesc programDesc;
+        if (!LoadProgramDesc(impl, vertexShaderPath, fragmentShaderPath, debugName, programDesc)) {
+            return Hx::ProgramHandle{};
+        }
 
         Hx::ProgramHandle program = device->CreateProgram(programDesc);
 
-        device->DestroyShader(vertexShader);
-        device->DestroyShader(fragmentShader);
+        device->DestroyShader(programDesc.vertexShader);
+        device->DestroyShader(programDesc.fragmentShader);
+
+        if (program && impl->shaderSourceCount < MaxShaderPrograms) {
+            ShaderProgramSource& source = impl->shaderSources[impl->shaderSourceCount++];
+            source.program = program;
+            source.vertexShaderPath = vertexShaderPath;
+            source.fragmentShaderPath = fragmentShaderPath;
+            source.debugName = debugName;
+        }
 
         return program;
     }
@@ -112,12 +143,13 @@ namespace Hx {
         switch (type) {
             case MaterialType::Opaque:
             case MaterialType::Transparent: {
-                vertexLayoutDesc.attributeCount = 3;
+                vertexLayoutDesc.attributeCount = 4;
                 vertexLayoutDesc.attributes[0] = { 0, 0, Hx::VertexAttribFormat::Float3, 0 };   // Position
                 vertexLayoutDesc.attributes[1] = { 1, 0, Hx::VertexAttribFormat::Float3, 12 };  // Normal
                 vertexLayoutDesc.attributes[2] = { 2, 0, Hx::VertexAttribFormat::Float2, 24 };  // TexCoord
+                vertexLayoutDesc.attributes[3] = { 3, 0, Hx::VertexAttribFormat::Float, 32 };   // Light
                 vertexLayoutDesc.bindingCount = 1;
-                vertexLayoutDesc.bindings[0] = { 32, 0 }; // Stride, Divisor
+                vertexLayoutDesc.bindings[0] = { 36, 0 }; // Stride, Divisor
             } break;
             case MaterialType::Unlit: {
                 vertexLayoutDesc.attributeCount = 2;
@@ -136,13 +168,14 @@ namespace Hx {
         return pipeline;
     }
 
-    RenderSystem::RenderSystem(Hx::RenderDevice* inDevice) {
+    RenderSystem::RenderSystem(Hx::RenderDevice* inDevice, Hx::FileCache* inFileCache) {
         Impl = new RenderSystemImpl();
         Impl->device = inDevice;
+        Impl->fileCache = inFileCache;
 
-        Impl->opaqueShaderProgram = CreateShaderProgram(Impl->device, "Shaders/Opaque.vert", "Shaders/Opaque.frag", "OpaqueShaderProgram");
-        Impl->transparentShaderProgram = CreateShaderProgram(Impl->device, "Shaders/Transparent.vert", "Shaders/Transparent.frag", "TransparentShaderProgram");
-        Impl->unlitShaderProgram = CreateShaderProgram(Impl->device, "Shaders/Unlit.vert", "Shaders/Unlit.frag", "UnlitShaderProgram");
+        Impl->opaqueShaderProgram = CreateShaderProgram(Impl, "Shaders/Opaque.vert", "Shaders/Opaque.frag", "OpaqueShaderProgram");
+        Impl->transparentShaderProgram = CreateShaderProgram(Impl, "Shaders/Transparent.vert", "Shaders/Transparent.frag", "TransparentShaderProgram");
+        Impl->unlitShaderProgram = CreateShaderProgram(Impl, "Shaders/Unlit.vert", "Shaders/Unlit.frag", "UnlitShaderProgram");
         
         Impl->opaquePipeline = CreatePipeline(Impl->device, Impl->opaqueShaderProgram, MaterialType::Opaque);
         Impl->transparentPipeline = CreatePipeline(Impl->device, Impl->transparentShaderProgram, MaterialType::Transparent);
@@ -153,9 +186,42 @@ namespace Hx {
 
     }
 
+    void RenderSystem::WatchShaderSources(Hx::FileWatcher* watcher) {
+        auto onShaderChanged = [](const char* filename, void* userData) {
+            static_cast<RenderSystem*>(userData)->ReloadShader(filename);
+        };
+
+        for (usize i = 0; i < Impl->shaderSourceCount; ++i) {
+            const ShaderProgramSource& source = Impl->shaderSources[i];
+            watcher->Subscribe(source.vertexShaderPath, onShaderChanged, this);
+            watcher->Subscribe(source.fragmentShaderPath, onShaderChanged, this);
+        }
+    }
+
+    void RenderSystem::ReloadShader(const char* filename) {
+        for (usize i = 0; i < Impl->shaderSourceCount; ++i) {
+            const ShaderProgramSource& source = Impl->shaderSources[i];
+            if (strcmp(source.vertexShaderPath, filename) != 0 && strcmp(source.fragmentShaderPath, filename) != 0) {
+                continue;
+            }
+
+            Hx::ProgramDesc programDesc;
+            if (!LoadProgramDesc(Impl, source.vertexShaderPath, source.fragmentShaderPath, source.debugName, programDesc)) {
+                continue;
+            }
+
+            // Relinks into the existing handle, so materials and pipelines pick up the new program as is
+            Impl->device->ReloadProgram(source.program, programDesc);
+
+            Impl->device->DestroyShader(programDesc.vertexShader);
+            Impl->device->DestroyShader(programDesc.fragmentShader);
+        }
+    }
+
     void RenderSystem::BeginFrame(const Hx::Matrix4& viewMatrix, const Hx::Matrix4& projectionMatrix) {
         Impl->currentViewMatrix = viewMatrix;
         Impl->currentProjectionMatrix = projectionMatrix;
+        Impl->frameCleared = false;
     }
 
     void RenderSystem::EndFrame() {
@@ -184,6 +250,40 @@ namespace Hx {
         });
     }
 
+    MeshHandle RenderSystem::CreateDynamicMesh(usize vertexCapacity, usize indexCapacity) {
+        return Impl->meshTable.Create([&](MeshRecord& mesh) {
+            Hx::BufferDesc vertexBufferDesc;
+            vertexBufferDesc.type = Hx::BufferType::Vertex;
+            vertexBufferDesc.usage = Hx::BufferUsage::Dynamic;
+            vertexBufferDesc.sizeInBytes = vertexCapacity * sizeof(Vertex);
+            vertexBufferDesc.initialData = nullptr;
+
+            Hx::BufferDesc indexBufferDesc;
+            indexBufferDesc.type = Hx::BufferType::Index;
+            indexBufferDesc.usage = Hx::BufferUsage::Dynamic;
+            indexBufferDesc.sizeInBytes = indexCapacity * sizeof(u32);
+            indexBufferDesc.initialData = nullptr;
+
+            mesh.vertexBuffer = Impl->device->CreateBuffer(vertexBufferDesc);
+            mesh.indexBuffer = Impl->device->CreateBuffer(indexBufferDesc);
+            mesh.indexCount = indexCapacity;
+        });
+    }
+
+    void RenderSystem::UpdateMeshVertices(MeshHandle mesh, const Vertex* vertices, usize vertexCount, usize firstVertex) {
+        const MeshRecord* meshRecord = Impl->meshTable.TryGet(mesh);
+        if (!meshRecord || vertexCount == 0) return;
+
+        Impl->device->UpdateBuffer(meshRecord->vertexBuffer, vertices, vertexCount * sizeof(Vertex), firstVertex * sizeof(Vertex));
+    }
+
+    void RenderSystem::UpdateMeshIndices(MeshHandle mesh, const u32* indices, usize indexCount, usize firstIndex) {
+        const MeshRecord* meshRecord = Impl->meshTable.TryGet(mesh);
+        if (!meshRecord || indexCount == 0) return;
+
+        Impl->device->UpdateBuffer(meshRecord->indexBuffer, indices, indexCount * sizeof(u32), firstIndex * sizeof(u32));
+    }
+
     void RenderSystem::DestroyMesh(MeshHandle mesh) {
         Impl->meshTable.Destroy(mesh, [&](MeshRecord& meshRecord) {
             Impl->device->DestroyBuffer(meshRecord.vertexBuffer);
@@ -223,31 +323,44 @@ namespace Hx {
     }
     
     void RenderSystem::Submit(MeshHandle mesh, MaterialHandle material, const Hx::Matrix4& transform) {
+        const MeshRecord* meshRecord = Impl->meshTable.TryGet(mesh);
+        if (!meshRecord) return;
+
+        Submit(mesh, material, transform, 0, static_cast<u32>(meshRecord->indexCount));
+    }
+
+    void RenderSystem::Submit(MeshHandle mesh, MaterialHandle material, const Hx::Matrix4& transform, u32 firstIndex, u32 indexCount,
+                              s32 baseVertex) {
+        const MeshRecord* meshRecord = Impl->meshTable.TryGet(mesh);
+        const MaterialRecord* materialRecord = Impl->materialTable.TryGet(material);
+        if (!meshRecord || !materialRecord || indexCount == 0) return;
+
         if (Impl->drawCommandCount >= MaxDrawCommands) {
             FlushDrawCommands();
         }
 
         DrawCommand& cmd = Impl->drawCommands[Impl->drawCommandCount++];
         cmd.material = material;
-        cmd.pipeline = Impl->materialTable.TryGet(material)->pipeline;
-        cmd.vertexBuffer = Impl->meshTable.TryGet(mesh)->vertexBuffer;
-        cmd.indexBuffer = Impl->meshTable.TryGet(mesh)->indexBuffer;
+        cmd.pipeline = materialRecord->pipeline;
+        cmd.vertexBuffer = meshRecord->vertexBuffer;
+        cmd.indexBuffer = meshRecord->indexBuffer;
         cmd.transform = transform;
-        cmd.indexCount = static_cast<u32>(Impl->meshTable.TryGet(mesh)->indexCount);
-        cmd.indexOffset = 0;
-        cmd.vertexOffset = 0;
+        cmd.indexCount = indexCount;
+        cmd.indexOffset = firstIndex;
+        cmd.vertexOffset = baseVertex;
     }
 
     void RenderSystem::FlushDrawCommands() {
         Hx::RenderDevice* device = Impl->device;
 
         Hx::RenderPassDesc opaquePassDesc = {};
-        opaquePassDesc.clearColor = true;
-        opaquePassDesc.clearDepth = true;
+        opaquePassDesc.clearColor = !Impl->frameCleared;
+        opaquePassDesc.clearDepth = !Impl->frameCleared;
         opaquePassDesc.clearColorValue = Hx::Vector4(0.1f, 0.1f, 0.1f, 1.0f);
         opaquePassDesc.clearDepthValue = 1.0f;
 
         device->BeginRenderPass(opaquePassDesc);
+        Impl->frameCleared = true;
 
         for (usize i = 0; i < Impl->drawCommandCount; ++i) {
             const DrawCommand& cmd = Impl->drawCommands[i];
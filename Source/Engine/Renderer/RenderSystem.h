@@ -9,6 +9,9 @@
 
 namespace Hx {
 
+    class FileCache;
+    class FileWatcher;
+
     struct MeshTag {};
     struct StaticMeshTag {};
     struct MaterialTag {};
@@ -27,23 +30,35 @@ namespace Hx {
         Hx::Vector3 position;
         Hx::Vector3 normal;
         Hx::Vector2 texCoord;
+        f32 light = 1.0f; // Baked brightness, 1 for unlit geometry
     };
 
     class RenderSystem {
     public:
-        RenderSystem(Hx::RenderDevice* inDevice);
+        RenderSystem(Hx::RenderDevice* inDevice, Hx::FileCache* inFileCache);
         ~RenderSystem();
 
+        // Subscribes every loaded shader source so edits are picked up without a restart
+        void WatchShaderSources(Hx::FileWatcher* watcher);
+        void ReloadShader(const char* filename);
+
         void BeginFrame(const Hx::Matrix4& viewMatrix, const Hx::Matrix4& projectionMatrix);
         void EndFrame();
 
         MeshHandle CreateMesh(const Vertex* vertices, usize vertexCount, const u32* indices, usize indexCount);
+        // Uninitialised buffers meant to be filled piecewise with UpdateMesh*
+        MeshHandle CreateDynamicMesh(usize vertexCapacity, usize indexCapacity);
+        void UpdateMeshVertices(MeshHandle mesh, const Vertex* vertices, usize vertexCount, usize firstVertex);
+        void UpdateMeshIndices(MeshHandle mesh, const u32* indices, usize indexCount, usize firstIndex);
         void DestroyMesh(MeshHandle mesh);
 
         MaterialHandle CreateMaterial(MaterialType type);
         void DestroyMaterial(MaterialHandle material);
 
         void Submit(MeshHandle mesh, MaterialHandle material, const Hx::Matrix4& transform);
+        // Draws indexCount indices of the mesh starting at firstIndex, each offset by baseVertex
+        void Submit(MeshHandle mesh, MaterialHandle material, const Hx::Matrix4& transform, u32 firstIndex, u32 indexCount,
+                    s32 baseVertex = 0);
 
     private:
         
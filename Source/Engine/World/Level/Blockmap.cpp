@@ -0,0 +1,133 @@
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <cmath>
+
+namespace Hx {
+
+    // Segments are tested against slightly grown cells so lines along a cell border land in both cells
+    constexpr f32 BlockmapCellPadding = 0.01f;
+
+    static bool SegmentTouchesBox(f32 ax, f32 ay, f32 bx, f32 by, f32 minX, f32 minY, f32 maxX, f32 maxY) {
+        // The segment's bounds already overlap the box, so only the segment's own axis can separate them
+        f32 nx = ay - by;
+        f32 ny = bx - ax;
+        f32 d = nx * ax + ny * ay;
+
+        f32 c0 = nx * minX + ny * minY - d;
+        f32 c1 = nx * maxX + ny * minY - d;
+        f32 c2 = nx * minX + ny * maxY - d;
+        f32 c3 = nx * maxX + ny * maxY - d;
+
+        bool anyFront = c0 >= 0.0f || c1 >= 0.0f || c2 >= 0.0f || c3 >= 0.0f;
+        bool anyBack = c0 <= 0.0f || c1 <= 0.0f || c2 <= 0.0f || c3 <= 0.0f;
+        return anyFront && anyBack;
+    }
+
+    BlockmapCellRange GetBlockmapCells(const Blockmap& blockmap, f32 minX, f32 minY, f32 maxX, f32 maxY) {
+        BlockmapCellRange range;
+        range.minX = static_cast<s32>(std::floor((minX - blockmap.originX) * blockmap.inverseCellSize));
+        range.minY = static_cast<s32>(std::floor((minY - blockmap.originY) * blockmap.inverseCellSize));
+        range.maxX = static_cast<s32>(std::floor((maxX - blockmap.originX) * blockmap.inverseCellSize));
+        range.maxY = static_cast<s32>(std::floor((maxY - blockmap.originY) * blockmap.inverseCellSize));
+
+        if (range.minX < 0) range.minX = 0;
+        if (range.minY < 0) range.minY = 0;
+        if (range.maxX >= static_cast<s32>(blockmap.width)) range.maxX = static_cast<s32>(blockmap.width) - 1;
+        if (range.maxY >= static_cast<s32>(blockmap.height)) range.maxY = static_cast<s32>(blockmap.height) - 1;
+        return range;
+    }
+
+    bool BuildBlockmap(Blockmap& blockmap, const MapData& map, Hx::ArenaAllocator& arena, f32 cellSize) {
+        blockmap = {};
+        if (map.lineSegmentCount == 0 || cellSize <= 0.0f) {
+            return false;
+        }
+
+        s32 minX = map.lineSegments[0].v1[0];
+        s32 minY = map.lineSegments[0].v1[1];
+        s32 maxX = minX;
+        s32 maxY = minY;
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            const s32* vertices[2] = { seg.v1, seg.v2 };
+            for (const s32* v : vertices) {
+                minX = v[0] < minX ? v[0] : minX;
+                minY = v[1] < minY ? v[1] : minY;
+                maxX = v[0] > maxX ? v[0] : maxX;
+                maxY = v[1] > maxY ? v[1] : maxY;
+            }
+        }
+
+        blockmap.originX = static_cast<f32>(minX);
+        blockmap.originY = static_cast<f32>(minY);
+        blockmap.cellSize = cellSize;
+        blockmap.inverseCellSize = 1.0f / cellSize;
+        blockmap.width = static_cast<u32>((maxX - minX) / cellSize) + 1;
+        blockmap.height = static_cast<u32>((maxY - minY) / cellSize) + 1;
+
+        usize cellCount = static_cast<usize>(blockmap.width) * blockmap.height;
+        blockmap.cellStart = Hx::AllocArray<u32>(&arena.base, cellCount + 1, Hx::AllocFlags::ZeroInit);
+        if (!blockmap.cellStart) return false;
+
+        // Count per cell, then fill through a running cursor per cell
+        auto forEachCell = [&](const MapLineSegment& seg, auto&& fn) {
+            f32 ax = static_cast<f32>(seg.v1[0]);
+            f32 ay = static_cast<f32>(seg.v1[1]);
+            f32 bx = static_cast<f32>(seg.v2[0]);
+            f32 by = static_cast<f32>(seg.v2[1]);
+
+            BlockmapCellRange range = GetBlockmapCells(blockmap,
+                (ax < bx ? ax : bx) - BlockmapCellPadding, (ay < by ? ay : by) - BlockmapCellPadding,
+                (ax > bx ? ax : bx) + BlockmapCellPadding, (ay > by ? ay : by) + BlockmapCellPadding);
+
+            for (s32 y = range.minY; y <= range.maxY; ++y) {
+                for (s32 x = range.minX; x <= range.maxX; ++x) {
+                    f32 cellMinX = blockmap.originX + x * cellSize - BlockmapCellPadding;
+                    f32 cellMinY = blockmap.originY + y * cellSize - BlockmapCellPadding;
+                    f32 cellMaxX = cellMinX + cellSize + BlockmapCellPadding * 2.0f;
+                    f32 cellMaxY = cellMinY + cellSize + BlockmapCellPadding * 2.0f;
+
+                    if (SegmentTouchesBox(ax, ay, bx, by, cellMinX, cellMinY, cellMaxX, cellMaxY)) {
+                        fn(static_cast<u32>(y) * blockmap.width + static_cast<u32>(x));
+                    }
+                }
+            }
+        };
+
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            forEachCell(map.lineSegments[i], [&](u32 cell) { ++blockmap.cellStart[cell + 1]; });
+        }
+
+        for (usize c = 0; c < cellCount; ++c) {
+            blockmap.cellStart[c + 1] += blockmap.cellStart[c];
+        }
+
+        blockmap.lineCount = blockmap.cellStart[cellCount];
+        blockmap.lines = Hx::AllocArray<BlockmapLine>(&arena.base, blockmap.lineCount);
+        u32* cursor = Hx::AllocArray<u32>(&arena.base, cellCount);
+        if (!blockmap.lines || !cursor) return false;
+
+        for (usize c = 0; c < cellCount; ++c) {
+            cursor[c] = blockmap.cellStart[c];
+        }
+
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+
+            BlockmapLine line;
+            line.ax = static_cast<f32>(seg.v1[0]);
+            line.ay = static_cast<f32>(seg.v1[1]);
+            line.bx = static_cast<f32>(seg.v2[0]);
+            line.by = static_cast<f32>(seg.v2[1]);
+            line.frontSector = seg.frontSector;
+            line.backSector = seg.backSector;
+            line.lineSeg = static_cast<u32>(i);
+
+            forEachCell(seg, [&](u32 cell) { blockmap.lines[cursor[cell]++] = line; });
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+}
+
+namespace Hx {
+
+    // A line segment as collision needs it. Cells store copies of these, so a
+    // query reads one contiguous run per cell instead of chasing indices.
+    struct BlockmapLine {
+        f32 ax;
+        f32 ay;
+        f32 bx;
+        f32 by;
+        s32 frontSector;
+        s32 backSector;
+        u32 lineSeg;
+    };
+
+    // Uniform grid over the map's line segments. The lines touching cell
+    // (x, y) are lines[cellStart[c] .. cellStart[c + 1]], c = y * width + x.
+    struct Blockmap {
+        f32 originX;
+        f32 originY;
+        f32 cellSize;
+        f32 inverseCellSize;
+        u32 width;
+        u32 height;
+
+        u32* cellStart;
+        BlockmapLine* lines;
+        usize lineCount;
+    };
+
+    constexpr f32 DefaultBlockmapCellSize = 128.0f;
+
+    bool BuildBlockmap(Blockmap& blockmap, const MapData& map, Hx::ArenaAllocator& arena, f32 cellSize = DefaultBlockmapCellSize);
+
+    // Cell range overlapping a box, clamped to the grid. Empty when maxX < minX.
+    struct BlockmapCellRange {
+        s32 minX;
+        s32 minY;
+        s32 maxX;
+        s32 maxY;
+    };
+
+    BlockmapCellRange GetBlockmapCells(const Blockmap& blockmap, f32 minX, f32 minY, f32 maxX, f32 maxY);
+
+    inline const BlockmapLine* GetCellLines(const Blockmap& blockmap, s32 x, s32 y, u32& outCount) {
+        u32 cell = static_cast<u32>(y) * blockmap.width + static_cast<u32>(x);
+        outCount = blockmap.cellStart[cell + 1] - blockmap.cellStart[cell];
+        return blockmap.lines + blockmap.cellStart[cell];
+    }
+
+}
@@ -0,0 +1,218 @@
+#include "Engine/World/Level/Collision.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Core/JobSystem.h"
+
+#include <cmath>
+
+namespace Hx {
+
+    constexpr u32 MaxSlideIterations = 4;
+    // Bodies stop this far short of a wall, so the next sweep never starts inside it
+    constexpr f32 CollisionSkin = 0.01f;
+    constexpr usize MoveBatchGrain = 64;
+
+    struct SweepHit {
+        f32 t;
+        Vector2 normal;
+    };
+
+    static inline f32 Dot(Vector2 a, Vector2 b) {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    static bool IsLineBlocking(const MapData& map, const BlockmapLine& line, const CollisionBody& body) {
+        if (line.backSector < 0) {
+            return true;
+        }
+
+        // Front sectors are on the left of the segment, the far side is the one the body is not on
+        f32 side = (line.bx - line.ax) * (body.position.y - line.ay) - (line.by - line.ay) * (body.position.x - line.ax);
+        s32 farSector = side >= 0.0f ? line.backSector : line.frontSector;
+
+        const MapSector& sector = map.sectors[farSector];
+        f32 floor = static_cast<f32>(sector.floorHeight);
+        f32 ceiling = static_cast<f32>(sector.ceilingHeight);
+        f32 feet = floor > body.z ? floor : body.z;
+
+        return floor > body.z + body.stepHeight || ceiling - feet < body.height;
+    }
+
+    // Earliest time of impact of a circle at p moving by d against a point
+    static void SweepPoint(Vector2 p, Vector2 d, f32 radius, f32 qx, f32 qy, SweepHit& hit) {
+        Vector2 m = { p.x - qx, p.y - qy };
+        f32 b = Dot(m, d);
+        f32 c = Dot(m, m) - radius * radius;
+        if (b >= 0.0f) return; // Moving away
+
+        if (c <= 0.0f) {
+            // Already touching, only the motion into the point is taken away
+            f32 length = Hx::Sqrt(Dot(m, m));
+            if (length > 0.0f) {
+                hit.t = 0.0f;
+                hit.normal = Vector2{ m.x / length, m.y / length };
+            }
+            return;
+        }
+
+        f32 a = Dot(d, d);
+        f32 discriminant = b * b - a * c;
+        if (discriminant < 0.0f) return;
+
+        f32 t = (-b - Hx::Sqrt(discriminant)) / a;
+        if (t >= 0.0f && t < hit.t) {
+            hit.t = t;
+            hit.normal = Vector2{ (p.x + d.x * t - qx) / radius, (p.y + d.y * t - qy) / radius };
+        }
+    }
+
+    static void SweepLine(Vector2 p, Vector2 d, f32 radius, const BlockmapLine& line, SweepHit& hit) {
+        f32 ex = line.bx - line.ax;
+        f32 ey = line.by - line.ay;
+        f32 lengthSquared = ex * ex + ey * ey;
+
+        if (lengthSquared > 0.0f) {
+            f32 length = Hx::Sqrt(lengthSquared);
+            Vector2 normal = { -ey / length, ex / length };
+            f32 distance = (p.x - line.ax) * normal.x + (p.y - line.ay) * normal.y;
+            if (distance < 0.0f) {
+                normal = Vector2{ -normal.x, -normal.y };
+                distance = -distance;
+            }
+
+            f32 approach = -Dot(d, normal);
+            if (approach > 0.0f) {
+                f32 t = distance > radius ? (distance - radius) / approach : 0.0f;
+                if (t < hit.t) {
+                    // Only a hit on the segment itself counts here, the ends are handled as points
+                    f32 cx = p.x + d.x * t - line.ax;
+                    f32 cy = p.y + d.y * t - line.ay;
+                    f32 s = (cx * ex + cy * ey) / lengthSquared;
+                    if (s >= 0.0f && s <= 1.0f) {
+                        hit.t = t;
+                        hit.normal = normal;
+                    }
+                }
+            }
+        }
+
+        SweepPoint(p, d, radius, line.ax, line.ay, hit);
+        SweepPoint(p, d, radius, line.bx, line.by, hit);
+    }
+
+    static void FindFloorAndCeiling(const MapData& map, const Blockmap& blockmap, const CollisionBody& body, MoveResult& result) {
+        result.sector = FindSector(map, body.position);
+        result.floorHeight = -1e30f;
+        result.ceilingHeight = 1e30f;
+
+        auto addSector = [&](s32 index) {
+            if (index < 0) return;
+            const MapSector& sector = map.sectors[index];
+            f32 floor = static_cast<f32>(sector.floorHeight);
+            f32 ceiling = static_cast<f32>(sector.ceilingHeight);
+            result.floorHeight = floor > result.floorHeight ? floor : result.floorHeight;
+            result.ceilingHeight = ceiling < result.ceilingHeight ? ceiling : result.ceilingHeight;
+        };
+
+        addSector(result.sector);
+
+        // The circle also stands on every sector whose border it overlaps
+        f32 r = body.radius;
+        BlockmapCellRange range = GetBlockmapCells(blockmap, body.position.x - r, body.position.y - r, body.position.x + r, body.position.y + r);
+        for (s32 y = range.minY; y <= range.maxY; ++y) {
+            for (s32 x = range.minX; x <= range.maxX; ++x) {
+                u32 count;
+                const BlockmapLine* lines = GetCellLines(blockmap, x, y, count);
+                for (u32 i = 0; i < count; ++i) {
+                    const BlockmapLine& line = lines[i];
+                    if (line.backSector < 0) continue;
+
+                    f32 ex = line.bx - line.ax;
+                    f32 ey = line.by - line.ay;
+                    f32 lengthSquared = ex * ex + ey * ey;
+                    f32 s = lengthSquared > 0.0f ? ((body.position.x - line.ax) * ex + (body.position.y - line.ay) * ey) / lengthSquared : 0.0f;
+                    s = s < 0.0f ? 0.0f : (s > 1.0f ? 1.0f : s);
+                    f32 dx = body.position.x - (line.ax + ex * s);
+                    f32 dy = body.position.y - (line.ay + ey * s);
+
+                    if (dx * dx + dy * dy < r * r) {
+                        addSector(line.frontSector);
+                        addSector(line.backSector);
+                    }
+                }
+            }
+        }
+    }
+
+    MoveResult MoveAndSlide(const MapData& map, const Blockmap& blockmap, const CollisionBody& body, Vector2 delta) {
+        MoveResult result = {};
+        CollisionBody current = body;
+
+        for (u32 iteration = 0; iteration < MaxSlideIterations; ++iteration) {
+            f32 moveLength = Hx::Sqrt(Dot(delta, delta));
+            if (moveLength < 1e-6f) break;
+
+            Vector2 p = current.position;
+            f32 r = current.radius;
+            Vector2 end = { p.x + delta.x, p.y + delta.y };
+
+            SweepHit hit = { 1.0f, Vector2{ 0.0f, 0.0f } };
+
+            // A line spanning several cells is tested once per cell, which costs a little but finds the same hit
+            BlockmapCellRange range = GetBlockmapCells(blockmap,
+                (p.x < end.x ? p.x : end.x) - r, (p.y < end.y ? p.y : end.y) - r,
+                (p.x > end.x ? p.x : end.x) + r, (p.y > end.y ? p.y : end.y) + r);
+
+            for (s32 y = range.minY; y <= range.maxY; ++y) {
+                for (s32 x = range.minX; x <= range.maxX; ++x) {
+                    u32 count;
+                    const BlockmapLine* lines = GetCellLines(blockmap, x, y, count);
+                    for (u32 i = 0; i < count; ++i) {
+                        if (IsLineBlocking(map, lines[i], current)) {
+                            SweepLine(p, delta, r, lines[i], hit);
+                        }
+                    }
+                }
+            }
+
+            if (hit.t >= 1.0f) {
+                current.position = end;
+                break;
+            }
+
+            // Stop just short of the wall, then slide the rest of the way along it
+            f32 travel = hit.t - CollisionSkin / moveLength;
+            travel = travel > 0.0f ? travel : 0.0f;
+            current.position = Vector2{ p.x + delta.x * travel, p.y + delta.y * travel };
+
+            Vector2 remaining = { delta.x * (1.0f - travel), delta.y * (1.0f - travel) };
+            f32 into = Dot(remaining, hit.normal);
+            if (into < 0.0f) {
+                remaining = Vector2{ remaining.x - hit.normal.x * into, remaining.y - hit.normal.y * into };
+            }
+
+            delta = remaining;
+            result.hitCount++;
+            result.hitNormal = hit.normal;
+        }
+
+        result.position = current.position;
+        FindFloorAndCeiling(map, blockmap, current, result);
+        return result;
+    }
+
+    void MoveBodies(const MapData& map, const Blockmap& blockmap, const MoveRequest* requests, MoveResult* outResults,
+                    usize count, Hx::JobSystem* jobs) {
+        auto moveRange = [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                outResults[i] = MoveAndSlide(map, blockmap, requests[i].body, requests[i].delta);
+            }
+        };
+
+        if (jobs) {
+            jobs->ParallelFor(count, MoveBatchGrain, moveRange);
+        } else {
+            moveRange(0, count);
+        }
+    }
+
+}
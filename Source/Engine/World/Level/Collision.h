@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    class JobSystem;
+}
+
+namespace Hx {
+
+    // An upright cylinder in map space: a circle on the map plane plus a height range
+    struct CollisionBody {
+        Vector2 position;
+        f32 z;          // Feet
+        f32 radius;
+        f32 height;
+        f32 stepHeight; // Tallest ledge the body walks up without being stopped
+    };
+
+    struct MoveResult {
+        Vector2 position;
+        f32 floorHeight;   // Highest floor under the circle at the end of the move
+        f32 ceilingHeight; // Lowest ceiling over it
+        s32 sector;        // FindSector at the centre: one bordering the map outside it, -1 in unclaimed subsectors
+        u32 hitCount;
+        Vector2 hitNormal; // Of the last wall hit, zero if nothing was hit
+    };
+
+    // Sweeps the circle along delta and slides along whatever stops it. A line
+    // stops the body when it is one-sided, or when the sector behind it has a
+    // floor more than stepHeight above the body's feet or too little room
+    // between floor and ceiling. Vertical motion is up to the caller, using
+    // the returned floor and ceiling.
+    MoveResult MoveAndSlide(const MapData& map, const Blockmap& blockmap, const CollisionBody& body, Vector2 delta);
+
+    struct MoveRequest {
+        CollisionBody body;
+        Vector2 delta;
+    };
+
+    // Moves many independent bodies, spread over the job system when one is given
+    void MoveBodies(const MapData& map, const Blockmap& blockmap, const MoveRequest* requests, MoveResult* outResults,
+                    usize count, Hx::JobSystem* jobs);
+
+}
@@ -0,0 +1,316 @@
+#include "Engine/World/Level/LevelManager.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace Hx {
+
+    struct LevelSlot {
+        void* memory;
+        usize memorySize;
+        ArenaAllocator arena;
+        Level level;
+    };
+
+    struct LevelRequest {
+        char filename[MaxLevelPath];
+        bool hasOrigin;
+        Vector2 origin;
+    };
+
+    struct LevelManagerImpl {
+        Hx::FileSystem* fileSystem;
+        Hx::RenderSystem* renderSystem;
+        Hx::JobSystem* jobs;
+        LevelManagerSettings settings;
+
+        // The current level lives in one slot, the next one is built in the other
+        LevelSlot slots[2];
+        s32 current = -1;
+
+        LevelLoadState state = LevelLoadState::Idle;
+        LevelRequest active = {};
+        LevelRequest queued = {};
+        bool hasQueued = false;
+        f64 requestTime = 0.0;
+        f64 streamStartTime = 0.0;
+
+        std::thread loader;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool loadRequested = false;
+        bool loadFinished = false;
+        bool loadSucceeded = false;
+        bool quit = false;
+
+        LevelManagerStats stats = {};
+    };
+
+    static inline u32 GetSpareSlot(const LevelManagerImpl* impl) {
+        return impl->current == 0 ? 1 : 0;
+    }
+
+    static bool BuildLevel(LevelManagerImpl* impl, LevelSlot& slot, const char* filename) {
+        Level& level = slot.level;
+        level = {};
+        snprintf(level.filename, sizeof(level.filename), "%s", filename);
+
+        level.map = Hx::LoadMapFromFile(filename, *impl->fileSystem, slot.arena);
+        if (!level.map) return false;
+
+        if (level.map->subsectorCount > 0) {
+            level.spawnPosition = Hx::GetSubsectorCenter(*level.map, 0);
+        }
+
+        void* streamerMemory = Hx::Alloc(&slot.arena.base, sizeof(WorldStreamer), alignof(WorldStreamer));
+        if (!streamerMemory) return false;
+        level.streamer = new (streamerMemory) WorldStreamer(*level.map, impl->renderSystem, impl->jobs, slot.arena,
+                                                            impl->settings.streaming);
+
+        level.hasBlockmap = Hx::BuildBlockmap(level.blockmap, *level.map, slot.arena);
+        Hx::InitMapVisibility(level.visibility, *level.map, slot.arena);
+        level.hasPortalVisibility = Hx::InitPortalVisibility(level.portalVisibility, *level.map, slot.arena);
+        level.hasNavGraph = Hx::BuildNavGraph(level.navGraph, *level.map, slot.arena);
+        level.hasAdjacency = Hx::BuildSectorAdjacency(level.adjacency, *level.map, slot.arena);
+        return true;
+    }
+
+    // Only the streamer lives outside the arena, the rest goes with the reset
+    static void DestroyLevel(LevelSlot& slot) {
+        Level& level = slot.level;
+        if (level.streamer) {
+            level.streamer->~WorldStreamer();
+        }
+
+        level = {};
+        Hx::ResetArena(slot.arena);
+    }
+
+    // With no fixed arena size, gives the slot a block sized from the map file.
+    // A block at least that large is kept, unless it is four times too large.
+    static bool SizeLevelArena(LevelManagerImpl* impl, LevelSlot& slot, const char* filename) {
+        const LevelManagerSettings& settings = impl->settings;
+        if (settings.arenaSize > 0) return slot.memory != nullptr;
+
+        Hx::FileHandle* file = impl->fileSystem->OpenFileRead(filename);
+        if (!file) return false;
+        u64 fileSize = file->GetSize();
+        impl->fileSystem->CloseFile(file);
+
+        usize size = static_cast<usize>(fileSize) * settings.arenaBytesPerMapByte + settings.arenaSlack;
+        if (slot.memory && slot.memorySize >= size && slot.memorySize / 4 <= size) return true;
+
+        free(slot.memory);
+        slot.memory = malloc(size);
+        slot.memorySize = slot.memory ? size : 0;
+        Hx::InitArena(slot.arena, slot.memory, slot.memorySize);
+        if (!slot.memory) {
+            // TODO: Replace with engine logging system
+            printf("Failed to allocate a %zu byte level arena for %s\n", size, filename);
+            return false;
+        }
+        return true;
+    }
+
+    static void LoaderMain(LevelManagerImpl* impl) {
+        std::unique_lock<std::mutex> lock(impl->mutex);
+        for (;;) {
+            impl->wake.wait(lock, [impl] { return impl->quit || impl->loadRequested; });
+            if (impl->quit) return;
+
+            impl->loadRequested = false;
+            LevelSlot& slot = impl->slots[GetSpareSlot(impl)];
+            LevelRequest request = impl->active;
+
+            lock.unlock();
+            bool succeeded = SizeLevelArena(impl, slot, request.filename) && BuildLevel(impl, slot, request.filename);
+            lock.lock();
+
+            impl->loadSucceeded = succeeded;
+            impl->loadFinished = true;
+            impl->done.notify_all();
+        }
+    }
+
+    static void StartLoad(LevelManagerImpl* impl, const LevelRequest& request) {
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            impl->active = request;
+            impl->loadRequested = true;
+        }
+        impl->wake.notify_one();
+
+        impl->state = LevelLoadState::Loading;
+        impl->requestTime = Hx::GetTimeSeconds();
+    }
+
+    static bool SwapLevels(LevelManagerImpl* impl) {
+        f64 start = Hx::GetTimeSeconds();
+        impl->stats.lastStreamSeconds = start - impl->streamStartTime;
+
+        s32 previous = impl->current;
+        impl->current = static_cast<s32>(GetSpareSlot(impl));
+        if (previous >= 0) {
+            DestroyLevel(impl->slots[previous]);
+        }
+
+        impl->state = LevelLoadState::Idle;
+        impl->stats.swapCount++;
+        impl->stats.currentArenaBytes = impl->slots[impl->current].arena.base.stats.BytesInUse;
+        impl->stats.lastSwapSeconds = Hx::GetTimeSeconds() - start;
+        return true;
+    }
+
+    LevelManager::LevelManager(Hx::FileSystem& inFileSystem, Hx::RenderSystem& inRenderSystem, Hx::JobSystem* inJobs,
+                               const LevelManagerSettings& inSettings) {
+        Impl = new LevelManagerImpl();
+        Impl->fileSystem = &inFileSystem;
+        Impl->renderSystem = &inRenderSystem;
+        Impl->jobs = inJobs;
+        Impl->settings = inSettings;
+
+        for (LevelSlot& slot : Impl->slots) {
+            slot.memory = nullptr;
+            slot.memorySize = 0;
+            if (Impl->settings.arenaSize > 0) {
+                slot.memory = malloc(Impl->settings.arenaSize);
+                if (!slot.memory) {
+                    // TODO: Replace with engine logging system
+                    printf("Failed to allocate a %zu byte level arena\n", Impl->settings.arenaSize);
+                }
+                slot.memorySize = slot.memory ? Impl->settings.arenaSize : 0;
+            }
+            Hx::InitArena(slot.arena, slot.memory, slot.memorySize);
+        }
+
+        Impl->loader = std::thread(LoaderMain, Impl);
+    }
+
+    LevelManager::~LevelManager() {
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->quit = true;
+        }
+        Impl->wake.notify_all();
+        Impl->loader.join();
+
+        for (LevelSlot& slot : Impl->slots) {
+            DestroyLevel(slot);
+            free(slot.memory);
+        }
+
+        delete Impl;
+    }
+
+    void LevelManager::RequestLevel(const char* filename, const Vector2* streamOrigin) {
+        LevelRequest request = {};
+        snprintf(request.filename, sizeof(request.filename), "%s", filename);
+        request.hasOrigin = streamOrigin != nullptr;
+        request.origin = streamOrigin ? *streamOrigin : Vector2{ 0.0f, 0.0f };
+
+        switch (Impl->state) {
+            case LevelLoadState::Idle:
+                StartLoad(Impl, request);
+                break;
+            case LevelLoadState::Loading:
+                // The loader cannot be interrupted, the request goes next
+                Impl->queued = request;
+                Impl->hasQueued = true;
+                break;
+            case LevelLoadState::Streaming:
+                DestroyLevel(Impl->slots[GetSpareSlot(Impl)]);
+                StartLoad(Impl, request);
+                break;
+        }
+    }
+
+    bool LevelManager::Update() {
+        if (Impl->state == LevelLoadState::Loading) {
+            bool succeeded = false;
+            {
+                std::lock_guard<std::mutex> lock(Impl->mutex);
+                if (!Impl->loadFinished) return false;
+
+                Impl->loadFinished = false;
+                succeeded = Impl->loadSucceeded;
+            }
+
+            Impl->stats.lastLoadSeconds = Hx::GetTimeSeconds() - Impl->requestTime;
+            LevelSlot& spare = Impl->slots[GetSpareSlot(Impl)];
+
+            if (Impl->hasQueued) {
+                DestroyLevel(spare);
+                Impl->hasQueued = false;
+                StartLoad(Impl, Impl->queued);
+                return false;
+            }
+
+            if (!succeeded) {
+                // TODO: Replace with engine logging system
+                printf("Failed to load %s, keeping the current level\n", Impl->active.filename);
+                DestroyLevel(spare);
+                Impl->stats.failedCount++;
+                Impl->state = LevelLoadState::Idle;
+                return false;
+            }
+
+            Impl->state = LevelLoadState::Streaming;
+            Impl->streamStartTime = Hx::GetTimeSeconds();
+        }
+
+        if (Impl->state == LevelLoadState::Streaming) {
+            Level& next = Impl->slots[GetSpareSlot(Impl)].level;
+            next.streamer->Update(Impl->active.hasOrigin ? Impl->active.origin : next.spawnPosition);
+
+            // Loads finishing within the Update can leave nothing in flight
+            // while the pending cap still holds clusters in range back. Only
+            // when neither is left is everything in range resident, or as much
+            // of it as fits the budget.
+            WorldStreamingStats streamStats = next.streamer->GetStats();
+            if (streamStats.pendingClusterCount == 0 && streamStats.waitingClusterCount == 0) {
+                return SwapLevels(Impl);
+            }
+        }
+
+        return false;
+    }
+
+    bool LevelManager::FinishPending() {
+        while (Impl->state != LevelLoadState::Idle) {
+            if (Impl->state == LevelLoadState::Loading) {
+                std::unique_lock<std::mutex> lock(Impl->mutex);
+                Impl->done.wait(lock, [this] { return Impl->loadFinished; });
+            } else {
+                Level& next = Impl->slots[GetSpareSlot(Impl)].level;
+                next.streamer->FinishPending();
+            }
+
+            if (Update()) return true;
+        }
+
+        return false;
+    }
+
+    Level* LevelManager::GetCurrentLevel() const {
+        return Impl->current >= 0 ? &Impl->slots[Impl->current].level : nullptr;
+    }
+
+    LevelLoadState LevelManager::GetLoadState() const {
+        return Impl->state;
+    }
+
+    const LevelManagerStats& LevelManager::GetStats() const {
+        return Impl->stats;
+    }
+
+}
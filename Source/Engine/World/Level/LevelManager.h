@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/Memory/Allocator.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/MapData.h"
+#include "Engine/World/Level/MapVisibility.h"
+#include "Engine/World/Level/Navigation.h"
+#include "Engine/World/Level/PortalVisibility.h"
+#include "Engine/World/Level/SectorAdjacency.h"
+#include "Engine/World/Level/WorldStreaming.h"
+
+namespace Hx {
+    class FileSystem;
+    class JobSystem;
+    class RenderSystem;
+}
+
+namespace Hx {
+
+    constexpr usize MaxLevelPath = 260;
+
+    // Everything built from one map, all of it living in the level's own arena
+    struct Level {
+        MapData* map;
+        WorldStreamer* streamer;
+        Blockmap blockmap;
+        bool hasBlockmap;
+        MapVisibility visibility;
+        PortalVisibility portalVisibility;
+        bool hasPortalVisibility;
+        NavGraph navGraph;
+        bool hasNavGraph;
+        SectorAdjacency adjacency;
+        bool hasAdjacency;
+
+        // Centre of the first subsector, a safe place to put the player
+        Vector2 spawnPosition;
+        char filename[MaxLevelPath];
+    };
+
+    struct LevelManagerSettings {
+        WorldStreamingSettings streaming;
+        // Each of the two level arenas; a map and everything built from it must
+        // fit in one. Zero sizes the spare arena for every load from the map
+        // file instead, arenaBytesPerMapByte times its size plus arenaSlack,
+        // so map size is bounded by memory rather than by a fixed block.
+        usize arenaSize = 0;
+        u32 arenaBytesPerMapByte = 8;
+        usize arenaSlack = Hx::Megabytes(1);
+    };
+
+    enum class LevelLoadState : u8 {
+        Idle,
+        Loading,   // Reading the map and building its lookup structures on the loader thread
+        Streaming, // Uploading the clusters around the stream origin a frame at a time
+    };
+
+    struct LevelManagerStats {
+        u32 swapCount;
+        u32 failedCount;
+        f64 lastLoadSeconds;   // Loader thread, from request until the level was built
+        f64 lastStreamSeconds; // Then until the clusters around the stream origin were resident
+        f64 lastSwapSeconds;   // Main thread time spent swapping and freeing the old level
+        usize currentArenaBytes;
+    };
+
+    // Owns the current level and prepares the next one without stalling the
+    // frame. A request is loaded whole and built on a loader thread into the
+    // spare of two arenas, then its world geometry is streamed in around the stream
+    // origin under the usual per frame upload cap while the current level
+    // keeps running. Once that is resident, Update swaps the two at the start
+    // of a frame and throws the old level away by resetting its arena.
+    //
+    // Level pointers stay valid until the Update that replaces them. All calls
+    // come from the render thread.
+    class LevelManager {
+    public:
+        LevelManager(Hx::FileSystem& inFileSystem, Hx::RenderSystem& inRenderSystem, Hx::JobSystem* inJobs,
+                     const LevelManagerSettings& inSettings);
+        ~LevelManager();
+
+        LevelManager(const LevelManager&) = delete;
+        LevelManager& operator=(const LevelManager&) = delete;
+
+        // Streams around streamOrigin when given, otherwise around the new
+        // level's spawn position. A newer request replaces one in flight.
+        void RequestLevel(const char* filename, const Vector2* streamOrigin = nullptr);
+
+        // Call at the start of a frame. Returns true when the current level was replaced.
+        bool Update();
+
+        // Blocks until the requested level is current, for the first load where there is nothing to show meanwhile
+        bool FinishPending();
+
+        // Null before the first level arrives
+        Level* GetCurrentLevel() const;
+        LevelLoadState GetLoadState() const;
+        const LevelManagerStats& GetStats() const;
+
+    private:
+        struct LevelManagerImpl* Impl;
+    };
+
+}
@@ -1,38 +1,283 @@
 #include "MapData.h"
 #include "Engine/Memory/ArenaAllocator.h"
 #include "Engine/IO/FileSystem.h"
+#include "Engine/Core/Hash.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace Hx {
 
+    constexpr usize LegacyMapLumpCount = 4;
+
     template <typename T>
-    inline void ReadLumpData(Hx::FileHandle* file, const LumpHeader& lump, T*& outData, usize& outCount, Hx::ArenaAllocator& arena) {
+    inline Hx::FileReadRange AllocLumpData(const LumpHeader& lump, T*& outData, usize& outCount, Hx::ArenaAllocator& arena) {
         outCount = lump.length / sizeof(T);
         outData = Hx::AllocArray<T>(&arena.base, outCount);
-        file->ReadAt(outData, lump.length, lump.offset);
+        return Hx::FileReadRange{ lump.offset, outCount * sizeof(T), outData };
+    }
+
+    template <typename T>
+    inline bool BindLumpData(u8* image, usize imageSize, const MapHeaderV2& header, MapLumpType type, T*& outData, usize& outCount) {
+        const MapLumpEntry& lump = header.lumps[static_cast<u32>(type)];
+
+        if (lump.elementSize != sizeof(T)) return false;
+        if (lump.offset % MapLumpAlignment != 0) return false;
+        if (static_cast<u64>(lump.count) * sizeof(T) != lump.length) return false;
+        if (static_cast<u64>(lump.offset) + lump.length > imageSize) return false;
+
+        outCount = lump.count;
+        outData = reinterpret_cast<T*>(image + lump.offset);
+        return true;
+    }
+
+    template <typename T>
+    inline bool BindOptionalLumpData(u8* image, usize imageSize, const MapHeaderV2& header, MapLumpType type, T*& outData, usize& outCount) {
+        outData = nullptr;
+        outCount = 0;
+
+        if (static_cast<u32>(type) >= header.lumpCount || header.lumps[static_cast<u32>(type)].count == 0) {
+            return true;
+        }
+
+        return BindLumpData(image, imageSize, header, type, outData, outCount);
+    }
+
+    // Every index stored in the lumps must land inside its target lump, so the
+    // rest of the engine can follow them without range checks
+    static bool ValidateMapReferences(const MapData& map) {
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            if (seg.frontSector < 0 || static_cast<usize>(seg.frontSector) >= map.sectorCount) return false;
+            if (seg.backSector < -1 || seg.backSector >= static_cast<s64>(map.sectorCount)) return false;
+        }
+
+        for (usize i = 0; i < map.edgeCount; ++i) {
+            if (map.edges[i].lineSeg >= map.lineSegmentCount) return false;
+        }
+
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            const MapSubsector& subsector = map.subsectors[i];
+            if (static_cast<u64>(subsector.firstEdge) + subsector.edgeCount > map.edgeCount) return false;
+        }
+
+        for (usize i = 0; i < map.sectorCount; ++i) {
+            const MapSector& sector = map.sectors[i];
+            if (static_cast<u64>(sector.firstGroup) + sector.groupCount > map.subsectorCount) return false;
+        }
+
+        for (usize i = 0; i < map.nodeCount; ++i) {
+            for (u32 child : map.nodes[i].children) {
+                if (child & MapNodeLeafBit) {
+                    if ((child & ~MapNodeLeafBit) >= map.subsectorCount) return false;
+                } else if (child <= i || child >= map.nodeCount) {
+                    // Children always come after their parent, which also rules out cycles
+                    return false;
+                }
+            }
+        }
+
+        if (map.visOffsetCount != 0 && map.visOffsetCount != map.subsectorCount) return false;
+        for (usize i = 0; i < map.visOffsetCount; ++i) {
+            u32 offset = map.visOffsets[i];
+            if (offset != MapVisNone && offset >= map.visDataSize) return false;
+        }
+
+        if (map.edgeLightCount != 0 && map.edgeLightCount != map.edgeCount) return false;
+
+        return true;
+    }
+
+    // Fills in the lookup tables that are cheaper to rebuild than to store
+    static bool BuildDerivedData(MapData& map, Hx::ArenaAllocator& arena) {
+        map.subsectorSectors = Hx::AllocArray<s32>(&arena.base, map.subsectorCount);
+        if (!map.subsectorSectors && map.subsectorCount > 0) {
+            return false;
+        }
+
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            map.subsectorSectors[i] = -1;
+        }
+
+        for (usize i = 0; i < map.sectorCount; ++i) {
+            const MapSector& sector = map.sectors[i];
+            for (u32 g = 0; g < sector.groupCount; ++g) {
+                map.subsectorSectors[sector.firstGroup + g] = static_cast<s32>(i);
+            }
+        }
+
+        return true;
+    }
+
+    static MapData* LoadLegacyMap(Hx::FileHandle* file, Hx::ArenaAllocator& arena) {
+        MapHeader header;
+        if (!file->ReadAt(&header, sizeof(MapHeader), 0)) {
+            return nullptr;
+        }
+
+        const LumpHeader* lumps[LegacyMapLumpCount] = { &header.sectorsLump, &header.subSectorsLump, &header.lineSegsLump, &header.edgesLump };
+        for (usize i = 0; i < LegacyMapLumpCount; ++i) {
+            if (static_cast<u64>(lumps[i]->offset) + lumps[i]->length > file->GetSize()) {
+                return nullptr;
+            }
+        }
+
+        MapData* map = Hx::AllocOne<MapData>(&arena.base, Hx::AllocFlags::ZeroInit);
+        if (!map) {
+            return nullptr;
+        }
+
+        Hx::FileReadRange ranges[LegacyMapLumpCount] = {
+            AllocLumpData(header.lineSegsLump, map->lineSegments, map->lineSegmentCount, arena),
+            AllocLumpData(header.edgesLump, map->edges, map->edgeCount, arena),
+            AllocLumpData(header.subSectorsLump, map->subsectors, map->subsectorCount, arena),
+            AllocLumpData(header.sectorsLump, map->sectors, map->sectorCount, arena)
+        };
+
+        // Lumps are usually stored back to back, so sorting lets ReadV fetch them in one go
+        std::sort(ranges, ranges + LegacyMapLumpCount, [](const Hx::FileReadRange& a, const Hx::FileReadRange& b) {
+            return a.Offset < b.Offset;
+        });
+
+        for (const Hx::FileReadRange& range : ranges) {
+            if (!range.Dst && range.Length > 0) return nullptr;
+        }
+
+        if (!file->ReadV(ranges, LegacyMapLumpCount) || !ValidateMapReferences(*map) || !BuildDerivedData(*map, arena)) {
+            return nullptr;
+        }
+
+        return map;
     }
 
-    MapData* LoadMapFromFile(const char* filename, Hx::FileSystem& fileSystem, Hx::ArenaAllocator& transientArena) {
-        Hx::FileHandle* file = fileSystem.OpenFileRead(filename);
+    // Reads the whole file into the arena in one go and points the lumps into
+    // that copy, so the file is closed again before the level starts
+    static MapData* LoadMapImage(Hx::FileHandle* file, Hx::ArenaAllocator& arena) {
+        usize size = file->GetSize();
+        if (size < sizeof(MapHeaderV2)) {
+            return nullptr;
+        }
+
+        u8* image = static_cast<u8*>(Hx::Alloc(&arena.base, size, MapLumpAlignment));
+        if (!image || !file->ReadAt(image, size, 0)) {
+            return nullptr;
+        }
+
+        const MapHeaderV2& header = *reinterpret_cast<const MapHeaderV2*>(image);
+        bool valid = header.version == MapFormatVersion && header.lumpCount <= MaxMapLumps &&
+                     header.lumpCount >= MapRequiredLumpCount &&
+                     Hx::Crc32(image + sizeof(MapHeaderV2), size - sizeof(MapHeaderV2)) == header.crc;
+
+        MapData candidate = {};
+        valid = valid &&
+            BindLumpData(image, size, header, MapLumpType::LineSegments, candidate.lineSegments, candidate.lineSegmentCount) &&
+            BindLumpData(image, size, header, MapLumpType::Edges, candidate.edges, candidate.edgeCount) &&
+            BindLumpData(image, size, header, MapLumpType::Subsectors, candidate.subsectors, candidate.subsectorCount) &&
+            BindLumpData(image, size, header, MapLumpType::Sectors, candidate.sectors, candidate.sectorCount) &&
+            BindOptionalLumpData(image, size, header, MapLumpType::Nodes, candidate.nodes, candidate.nodeCount) &&
+            BindOptionalLumpData(image, size, header, MapLumpType::VisOffsets, candidate.visOffsets, candidate.visOffsetCount) &&
+            BindOptionalLumpData(image, size, header, MapLumpType::VisData, candidate.visData, candidate.visDataSize) &&
+            BindOptionalLumpData(image, size, header, MapLumpType::EdgeLights, candidate.edgeLights, candidate.edgeLightCount) &&
+            ValidateMapReferences(candidate);
+        if (!valid) {
+            return nullptr;
+        }
+
+        MapData* map = Hx::AllocOne<MapData>(&arena.base);
+        if (!map) {
+            return nullptr;
+        }
+
+        *map = candidate;
+        return BuildDerivedData(*map, arena) ? map : nullptr;
+    }
+
+    MapData* LoadMapFromFile(const char* filename, Hx::FileSystem& fileSystem, Hx::ArenaAllocator& arena) {
+        Hx::FileHandle* file = fileSystem.OpenFileRead(filename, Hx::FileAccessHint::Sequential);
         if (!file) {
             return nullptr;
         }
 
-        MapHeader header;
-        if (!file->Read(&header, sizeof(MapHeader))) {
+        char identifier[4];
+        if (!file->ReadAt(identifier, sizeof(identifier), 0)) {
             fileSystem.CloseFile(file);
             return nullptr;
         }
 
-        MapData* map = Hx::AllocOne<MapData>(&transientArena.base, Hx::AllocFlags::ZeroInit);
-
-        ReadLumpData(file, header.lineSegsLump, map->lineSegments, map->lineSegmentCount, transientArena);
-        ReadLumpData(file, header.edgesLump, map->edges, map->edgeCount, transientArena);
-        ReadLumpData(file, header.subSectorsLump, map->subsectors, map->subsectorCount, transientArena);
-        ReadLumpData(file, header.sectorsLump, map->sectors, map->sectorCount, transientArena);
+        // A failed load gives back whatever it took, so the arena's other contents are untouched
+        Hx::ArenaMarker marker = Hx::GetArenaMarker(arena);
 
+        bool isImage = memcmp(identifier, MapIdentifier, sizeof(identifier)) == 0;
+        MapData* map = isImage ? LoadMapImage(file, arena) : LoadLegacyMap(file, arena);
         fileSystem.CloseFile(file);
 
+        if (!map) {
+            Hx::RestoreArena(arena, marker);
+        }
         return map;
     }
 
-}
\ No newline at end of file
+    struct MapLumpSource {
+        MapLumpType type;
+        const void* data;
+        usize count;
+        usize elementSize;
+    };
+
+    bool WriteMapToFile(const char* filename, const MapData& map, Hx::FileSystem& fileSystem) {
+        const MapLumpSource sources[] = {
+            { MapLumpType::Sectors, map.sectors, map.sectorCount, sizeof(MapSector) },
+            { MapLumpType::Subsectors, map.subsectors, map.subsectorCount, sizeof(MapSubsector) },
+            { MapLumpType::LineSegments, map.lineSegments, map.lineSegmentCount, sizeof(MapLineSegment) },
+            { MapLumpType::Edges, map.edges, map.edgeCount, sizeof(MapEdge) },
+            { MapLumpType::Nodes, map.nodes, map.nodeCount, sizeof(MapNode) },
+            { MapLumpType::VisOffsets, map.visOffsets, map.visOffsetCount, sizeof(u32) },
+            { MapLumpType::VisData, map.visData, map.visDataSize, sizeof(u8) },
+            { MapLumpType::EdgeLights, map.edgeLights, map.edgeLightCount, sizeof(MapEdgeLight) },
+        };
+
+        static const u8 padding[MapLumpAlignment] = {};
+
+        MapHeaderV2 header = {};
+        memcpy(header.identifier, MapIdentifier, sizeof(header.identifier));
+        header.version = MapFormatVersion;
+        header.lumpCount = static_cast<u32>(MapLumpType::Count);
+
+        // Lay the lumps out back to back after the header and checksum them in file order
+        usize offset = sizeof(MapHeaderV2);
+        u32 crc = 0;
+        for (const MapLumpSource& source : sources) {
+            usize alignedOffset = (offset + MapLumpAlignment - 1) & ~(MapLumpAlignment - 1);
+            crc = Hx::Crc32(padding, alignedOffset - offset, crc);
+
+            MapLumpEntry& lump = header.lumps[static_cast<u32>(source.type)];
+            lump.offset = static_cast<u32>(alignedOffset);
+            lump.length = static_cast<u32>(source.count * source.elementSize);
+            lump.count = static_cast<u32>(source.count);
+            lump.elementSize = static_cast<u32>(source.elementSize);
+
+            crc = Hx::Crc32(source.data, lump.length, crc);
+            offset = alignedOffset + lump.length;
+        }
+        header.crc = crc;
+
+        Hx::FileHandle* file = fileSystem.OpenFileWrite(filename);
+        if (!file) {
+            return false;
+        }
+
+        bool result = file->Write(&header, sizeof(header));
+
+        offset = sizeof(MapHeaderV2);
+        for (const MapLumpSource& source : sources) {
+            const MapLumpEntry& lump = header.lumps[static_cast<u32>(source.type)];
+            result = result && file->Write(padding, lump.offset - offset);
+            result = result && (lump.length == 0 || file->Write(source.data, lump.length));
+            offset = lump.offset + lump.length;
+        }
+
+        fileSystem.CloseFile(file);
+        return result;
+    }
+
+}
@@ -1,10 +1,7 @@
 #pragma once
 
 #include "Engine/Core/Handle.h"
-
-namespace Hx {
-    class FileSystem;
-}
+#include "Engine/IO/FileSystem.h"
 
 namespace Hx {
     struct ArenaAllocator;
@@ -17,6 +14,7 @@ namespace Hx {
         u32 length;
     };
 
+    // Version 1 layout, still accepted by LoadMapFromFile
     struct MapHeader {
         char identifier[4];
         LumpHeader sectorsLump;
@@ -25,6 +23,44 @@ namespace Hx {
         LumpHeader edgesLump;
     };
 
+    constexpr char MapIdentifier[4] = { 'H', 'M', 'A', 'P' };
+    constexpr u32 MapFormatVersion = 2;
+    constexpr usize MapLumpAlignment = 16;
+    constexpr usize MaxMapLumps = 16;
+
+    enum class MapLumpType : u32 {
+        Sectors,
+        Subsectors,
+        LineSegments,
+        Edges,
+        // Optional lumps produced by the map compiler
+        Nodes,
+        VisOffsets,
+        VisData,
+        EdgeLights,
+        Count
+    };
+
+    // Lumps every map must have; anything after these may be missing or empty
+    constexpr u32 MapRequiredLumpCount = static_cast<u32>(MapLumpType::Nodes);
+
+    struct MapLumpEntry {
+        u32 offset;      // From the start of the file, a multiple of MapLumpAlignment
+        u32 length;      // Always count * elementSize
+        u32 count;
+        u32 elementSize; // Lets the loader reject files built against a different struct layout
+    };
+
+    // Version 2 layout. Lumps are aligned so the file can be used in place
+    // once read into memory in one piece, and unused lump slots have a count of zero.
+    struct MapHeaderV2 {
+        char identifier[4];
+        u32 version;
+        u32 lumpCount;
+        u32 crc; // CRC-32 of every byte following the header
+        MapLumpEntry lumps[MaxMapLumps];
+    };
+
     struct MapLineSegment {
         s32 v1[2];
         s32 v2[2];
@@ -49,6 +85,39 @@ namespace Hx {
         s32 ceilingHeight;
     };
 
+    // Child references with this bit set are leaves and hold a subsector index
+    constexpr u32 MapNodeLeafBit = 0x80000000u;
+
+    // BSP node over the map plane, the root is node 0. A point p lies in front
+    // of the partition when plane[0] * p.x + plane[1] * p.y >= plane[2].
+    struct MapNode {
+        f32 plane[3];
+        u32 children[2]; // Front, back
+    };
+
+    // Potentially visible sets are stored per subsector as one bit per subsector,
+    // run length encoded: a zero byte is followed by how many zero bytes it stands
+    // for. Subsectors whose offset is MapVisNone see everything.
+    constexpr u32 MapVisNone = 0xFFFFFFFFu;
+
+    inline usize GetVisRowSize(usize subsectorCount) {
+        return (subsectorCount + 7) / 8;
+    }
+
+    // Light baked by the map compiler at the corners the world mesh puts on an
+    // edge, 255 being full brightness. Walls are lit between wallBottom at the
+    // sector's floor and wallTop at its ceiling, so steps and moving sectors
+    // take the light in between.
+    struct MapEdgeLight {
+        u8 floor;         // At the edge's start point
+        u8 ceiling;
+        u8 wallBottom[2]; // At the edge's start and end
+        u8 wallTop[2];
+    };
+
+    // Turns a stored light into the 0 to 1 brightness shaders multiply by
+    constexpr f32 MapLightScale = 1.0f / 255.0f;
+
     struct MapData {
         MapLineSegment* lineSegments;
         usize lineSegmentCount;
@@ -61,8 +130,32 @@ namespace Hx {
 
         MapSector* sectors;
         usize sectorCount;
+
+        // Empty when the map has not been through the map compiler
+        MapNode* nodes;
+        usize nodeCount;
+
+        // Empty when the map compiler skipped the vis pass, otherwise one offset per subsector
+        u32* visOffsets;
+        usize visOffsetCount;
+        u8* visData;
+        usize visDataSize;
+
+        // Empty when the map compiler skipped the light pass, otherwise one per edge
+        MapEdgeLight* edgeLights;
+        usize edgeLightCount;
+
+        // Derived at load time, one entry per subsector, -1 if no sector claims it
+        s32* subsectorSectors;
     };
 
-    MapData* LoadMapFromFile(const char* filename, Hx::FileSystem& fileSystem, Hx::ArenaAllocator& transientArena);
+    // Everything the map needs is allocated from arena and lives until the
+    // arena is reset, so give each map an arena of its own rather than one
+    // shared with other systems. A failed load leaves the arena as it was.
+    // The file is closed before returning, so it can be rebuilt while loaded.
+    MapData* LoadMapFromFile(const char* filename, Hx::FileSystem& fileSystem, Hx::ArenaAllocator& arena);
 
-}
\ No newline at end of file
+    // Writes the map in the current (version 2) format
+    bool WriteMapToFile(const char* filename, const MapData& map, Hx::FileSystem& fileSystem);
+
+}
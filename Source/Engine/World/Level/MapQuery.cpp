@@ -0,0 +1,168 @@
+#include "Engine/World/Level/MapQuery.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define HX_MAP_QUERY_SSE 1
+#endif
+
+namespace Hx {
+
+    static bool IsInsideSubsector(const MapData& map, const MapSubsector& subsector, Vector2 point) {
+        for (u32 e = 0; e < subsector.edgeCount; ++e) {
+            const MapEdge& edge = map.edges[subsector.firstEdge + e];
+            const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+            const s32* start = edge.reversed ? seg.v2 : seg.v1;
+            const s32* end = edge.reversed ? seg.v1 : seg.v2;
+
+            // Subsectors wind counter clockwise, so the inside is to the left of every edge
+            f32 cross = static_cast<f32>(end[0] - start[0]) * (point.y - static_cast<f32>(start[1])) -
+                        static_cast<f32>(end[1] - start[1]) * (point.x - static_cast<f32>(start[0]));
+            if (cross < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Vector2 GetSubsectorCenter(const MapData& map, u32 subsector) {
+        const MapSubsector& group = map.subsectors[subsector];
+        Vector2 center = { 0.0f, 0.0f };
+        if (group.edgeCount == 0) return center;
+
+        for (u32 e = 0; e < group.edgeCount; ++e) {
+            const MapEdge& edge = map.edges[group.firstEdge + e];
+            const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+            const s32* start = edge.reversed ? seg.v2 : seg.v1;
+            center.x += static_cast<f32>(start[0]);
+            center.y += static_cast<f32>(start[1]);
+        }
+
+        center.x /= static_cast<f32>(group.edgeCount);
+        center.y /= static_cast<f32>(group.edgeCount);
+        return center;
+    }
+
+    // Points no subsector contains get the one whose centre is nearest, which
+    // borders the map on the side the point is on like a BSP walk would
+    static u32 FindSubsectorLinear(const MapData& map, Vector2 point) {
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            if (IsInsideSubsector(map, map.subsectors[i], point)) {
+                return static_cast<u32>(i);
+            }
+        }
+
+        u32 nearest = 0;
+        f32 nearestDistance = 0.0f;
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            Vector2 center = GetSubsectorCenter(map, static_cast<u32>(i));
+            f32 dx = center.x - point.x;
+            f32 dy = center.y - point.y;
+            f32 distance = dx * dx + dy * dy;
+            if (i == 0 || distance < nearestDistance) {
+                nearest = static_cast<u32>(i);
+                nearestDistance = distance;
+            }
+        }
+        return nearest;
+    }
+
+    static inline u32 WalkNodes(const MapData& map, Vector2 point) {
+        u32 child = 0;
+        do {
+            const MapNode& node = map.nodes[child];
+            bool front = node.plane[0] * point.x + node.plane[1] * point.y >= node.plane[2];
+            child = node.children[front ? 0 : 1];
+        } while (!(child & MapNodeLeafBit));
+
+        return child & ~MapNodeLeafBit;
+    }
+
+    u32 FindSubsector(const MapData& map, Vector2 point) {
+        if (map.nodeCount == 0) {
+            return FindSubsectorLinear(map, point);
+        }
+        return WalkNodes(map, point);
+    }
+
+    s32 FindSector(const MapData& map, Vector2 point) {
+        if (map.subsectorCount == 0) {
+            return -1;
+        }
+        return map.subsectorSectors[FindSubsector(map, point)];
+    }
+
+    void FindSubsectors(const MapData& map, const Vector2* points, usize count, u32* outSubsectors) {
+        if (map.nodeCount == 0) {
+            for (usize i = 0; i < count; ++i) {
+                outSubsectors[i] = FindSubsectorLinear(map, points[i]);
+            }
+            return;
+        }
+
+        usize i = 0;
+
+#if HX_MAP_QUERY_SSE
+        for (; i + 4 <= count; i += 4) {
+            __m128 px = _mm_setr_ps(points[i].x, points[i + 1].x, points[i + 2].x, points[i + 3].x);
+            __m128 py = _mm_setr_ps(points[i].y, points[i + 1].y, points[i + 2].y, points[i + 3].y);
+
+            u32 current[4] = { 0, 0, 0, 0 };
+            u32 activeMask = 0xF;
+
+            while (activeMask) {
+                // Lanes that already reached a leaf test against a zero plane and are ignored below
+                alignas(16) f32 nx[4] = {};
+                alignas(16) f32 ny[4] = {};
+                alignas(16) f32 d[4] = {};
+                for (u32 lane = 0; lane < 4; ++lane) {
+                    if (activeMask & (1u << lane)) {
+                        const MapNode& node = map.nodes[current[lane]];
+                        nx[lane] = node.plane[0];
+                        ny[lane] = node.plane[1];
+                        d[lane] = node.plane[2];
+                    }
+                }
+
+                __m128 dist = _mm_add_ps(_mm_mul_ps(px, _mm_load_ps(nx)), _mm_mul_ps(py, _mm_load_ps(ny)));
+                u32 frontMask = static_cast<u32>(_mm_movemask_ps(_mm_cmpge_ps(dist, _mm_load_ps(d))));
+
+                for (u32 lane = 0; lane < 4; ++lane) {
+                    if (!(activeMask & (1u << lane))) continue;
+
+                    u32 child = map.nodes[current[lane]].children[(frontMask & (1u << lane)) ? 0 : 1];
+                    current[lane] = child;
+                    if (child & MapNodeLeafBit) {
+                        activeMask &= ~(1u << lane);
+                    }
+                }
+            }
+
+            for (u32 lane = 0; lane < 4; ++lane) {
+                outSubsectors[i + lane] = current[lane] & ~MapNodeLeafBit;
+            }
+        }
+#endif
+
+        for (; i < count; ++i) {
+            outSubsectors[i] = WalkNodes(map, points[i]);
+        }
+    }
+
+    void FindSectors(const MapData& map, const Vector2* points, usize count, s32* outSectors) {
+        if (map.subsectorCount == 0) {
+            for (usize i = 0; i < count; ++i) {
+                outSectors[i] = -1;
+            }
+            return;
+        }
+
+        // Reuse the output as scratch for the subsector indices, both are 32 bits wide
+        u32* subsectors = reinterpret_cast<u32*>(outSectors);
+        FindSubsectors(map, points, count, subsectors);
+
+        for (usize i = 0; i < count; ++i) {
+            outSectors[i] = map.subsectorSectors[subsectors[i]];
+        }
+    }
+
+}
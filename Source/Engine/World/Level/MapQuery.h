@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+
+    // Map space is the 2D plane the level was authored in. World space is
+    // y-up, with map x along world x and map y along world -z.
+    inline Vector2 WorldToMap(const Vector3& position) {
+        return Vector2{ position.x, -position.z };
+    }
+
+    inline Vector3 MapToWorld(const Vector2& position, f32 height) {
+        return Vector3(position.x, height, -position.y);
+    }
+
+    // Average of the subsector's corners, always inside it since subsectors are convex
+    Vector2 GetSubsectorCenter(const MapData& map, u32 subsector);
+
+    // Walks the BSP in O(depth). Points outside the playable area resolve to
+    // some subsector bordering it. Maps without a node lump fall back to a
+    // linear scan over the subsectors, which takes the subsector with the
+    // nearest centre for points outside; run them through the map compiler.
+    u32 FindSubsector(const MapData& map, Vector2 point);
+    // The sector of that subsector, -1 when no sector claims it or the map has no subsectors
+    s32 FindSector(const MapData& map, Vector2 point);
+
+    // Locates many points per call, testing four points against their
+    // current partitions at once
+    void FindSubsectors(const MapData& map, const Vector2* points, usize count, u32* outSubsectors);
+    void FindSectors(const MapData& map, const Vector2* points, usize count, s32* outSectors);
+
+}
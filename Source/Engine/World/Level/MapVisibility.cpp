@@ -0,0 +1,103 @@
+#include "Engine/World/Level/MapVisibility.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <cstring>
+
+namespace Hx {
+
+    constexpr u32 NoCachedSubsector = 0xFFFFFFFFu;
+
+    bool InitMapVisibility(MapVisibility& visibility, const MapData& map, Hx::ArenaAllocator& arena) {
+        visibility = {};
+        visibility.map = &map;
+        visibility.cachedSubsector = NoCachedSubsector;
+
+        if (map.visOffsetCount == 0) {
+            return true;
+        }
+
+        visibility.subsectorBits = Hx::AllocArray<u8>(&arena.base, GetVisRowSize(map.subsectorCount));
+        visibility.sectorBits = Hx::AllocArray<u8>(&arena.base, GetVisRowSize(map.sectorCount));
+        return visibility.subsectorBits && (visibility.sectorBits || map.sectorCount == 0);
+    }
+
+    // Marks the sectors of the subsectors set in one byte of a row
+    static inline void AddVisibleSectors(const MapData& map, usize byteIndex, u8 value, u8* sectorBits) {
+        for (u32 bit = 0; bit < 8; ++bit) {
+            if (!(value & (1u << bit))) continue;
+
+            usize subsector = byteIndex * 8 + bit;
+            if (subsector >= map.subsectorCount) break;
+
+            s32 sector = map.subsectorSectors[subsector];
+            if (sector >= 0) {
+                sectorBits[sector >> 3] |= static_cast<u8>(1u << (sector & 7));
+            }
+        }
+    }
+
+    // Expands a row, filling in the sectors it touches along the way when
+    // sectorBits is given. Zero runs are skipped over, so the cost follows the
+    // compressed size and what is visible rather than the subsector count.
+    static bool DecodeVisRow(const MapData& map, u32 subsector, u8* outBits, u8* sectorBits) {
+        usize rowSize = GetVisRowSize(map.subsectorCount);
+        u32 offset = map.visOffsets[subsector];
+
+        if (sectorBits) {
+            memset(sectorBits, offset == MapVisNone ? 0xFF : 0, GetVisRowSize(map.sectorCount));
+        }
+
+        if (offset == MapVisNone) {
+            memset(outBits, 0xFF, rowSize);
+            return true;
+        }
+
+        const u8* in = map.visData + offset;
+        const u8* inEnd = map.visData + map.visDataSize;
+        usize written = 0;
+
+        while (written < rowSize) {
+            if (in >= inEnd) return false;
+
+            if (*in) {
+                if (sectorBits) AddVisibleSectors(map, written, *in, sectorBits);
+                outBits[written++] = *in++;
+                continue;
+            }
+
+            if (in + 1 >= inEnd) return false;
+            usize run = in[1];
+            in += 2;
+
+            if (run > rowSize - written) return false;
+            memset(outBits + written, 0, run);
+            written += run;
+        }
+
+        return true;
+    }
+
+    bool DecompressVisRow(const MapData& map, u32 subsector, u8* outBits) {
+        return DecodeVisRow(map, subsector, outBits, nullptr);
+    }
+
+    VisibleSet GetVisibleSet(MapVisibility& visibility, u32 subsector) {
+        const MapData& map = *visibility.map;
+        if (map.visOffsetCount == 0 || subsector >= map.subsectorCount) {
+            return VisibleSet{};
+        }
+
+        if (visibility.cachedSubsector != subsector) {
+            if (!DecodeVisRow(map, subsector, visibility.subsectorBits, visibility.sectorBits)) {
+                // Validation only covers the offsets, treat a broken row as seeing everything
+                memset(visibility.subsectorBits, 0xFF, GetVisRowSize(map.subsectorCount));
+                memset(visibility.sectorBits, 0xFF, GetVisRowSize(map.sectorCount));
+            }
+
+            visibility.cachedSubsector = subsector;
+        }
+
+        return VisibleSet{ visibility.subsectorBits, visibility.sectorBits };
+    }
+
+}
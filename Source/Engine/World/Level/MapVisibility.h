@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+}
+
+namespace Hx {
+
+    // Decompressed visibility of one subsector, as bitsets over subsectors and sectors
+    struct VisibleSet {
+        const u8* subsectors;
+        const u8* sectors;
+    };
+
+    inline bool IsVisible(const u8* bits, usize index) {
+        return (bits[index >> 3] & (1u << (index & 7))) != 0;
+    }
+
+    // Holds the set for the subsector the viewer was last in. The viewer only
+    // changes subsector every so often, so most frames get the set as is.
+    struct MapVisibility {
+        const MapData* map;
+        u8* subsectorBits;
+        u8* sectorBits;
+        u32 cachedSubsector;
+    };
+
+    bool InitMapVisibility(MapVisibility& visibility, const MapData& map, Hx::ArenaAllocator& arena);
+
+    // Returns null sets when the map has no vis data, meaning everything is visible
+    VisibleSet GetVisibleSet(MapVisibility& visibility, u32 subsector);
+
+    // Expands one run length encoded row, returns false if it runs off the data
+    bool DecompressVisRow(const MapData& map, u32 subsector, u8* outBits);
+
+}
@@ -0,0 +1,640 @@
+#include "Engine/World/Level/Navigation.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace Hx {
+
+    constexpr u32 NavNone = 0xFFFFFFFFu;
+    constexpr usize PathBatchGrain = 16;
+
+    // Queries are located in the BSP as one run of start and goal points
+    static_assert(sizeof(PathQuery) == sizeof(Vector2) * 2, "PathQuery must be two packed points");
+
+    static inline f32 Distance(Vector2 a, Vector2 b) {
+        f32 dx = b.x - a.x;
+        f32 dy = b.y - a.y;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    bool BuildNavGraph(NavGraph& graph, const MapData& map, Hx::ArenaAllocator& arena) {
+        graph = {};
+        if (map.subsectorCount == 0) {
+            return false;
+        }
+
+        // A line segment referenced by edges of two subsectors is the opening between them
+        u32* segOwner = Hx::AllocArray<u32>(&arena.base, map.lineSegmentCount);
+        u32* edgeOwner = Hx::AllocArray<u32>(&arena.base, map.edgeCount);
+        graph.nodeCount = static_cast<u32>(map.subsectorCount);
+        graph.nodeCenters = Hx::AllocArray<Vector2>(&arena.base, graph.nodeCount);
+        graph.linkStart = Hx::AllocArray<u32>(&arena.base, graph.nodeCount + 1, Hx::AllocFlags::ZeroInit);
+        if (!segOwner || !edgeOwner || !graph.nodeCenters || !graph.linkStart) return false;
+
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            segOwner[i] = NavNone;
+        }
+
+        for (u32 s = 0; s < graph.nodeCount; ++s) {
+            graph.nodeCenters[s] = Hx::GetSubsectorCenter(map, s);
+
+            const MapSubsector& group = map.subsectors[s];
+            for (u32 e = 0; e < group.edgeCount; ++e) {
+                edgeOwner[group.firstEdge + e] = s;
+            }
+        }
+
+        // For each edge, the edge on the far side of its segment or NavNone
+        u32* partner = Hx::AllocArray<u32>(&arena.base, map.edgeCount);
+        if (!partner) return false;
+
+        for (usize e = 0; e < map.edgeCount; ++e) {
+            partner[e] = NavNone;
+            u32 seg = map.edges[e].lineSeg;
+            if (map.lineSegments[seg].backSector < 0) continue;
+
+            u32 first = segOwner[seg];
+            if (first == NavNone) {
+                segOwner[seg] = static_cast<u32>(e);
+            } else if (edgeOwner[first] != edgeOwner[e]) {
+                partner[first] = static_cast<u32>(e);
+                partner[e] = first;
+                ++graph.linkStart[edgeOwner[first] + 1];
+                ++graph.linkStart[edgeOwner[e] + 1];
+            }
+        }
+
+        for (u32 s = 0; s < graph.nodeCount; ++s) {
+            graph.linkStart[s + 1] += graph.linkStart[s];
+        }
+
+        graph.linkCount = graph.linkStart[graph.nodeCount];
+        graph.linkTargets = Hx::AllocArray<u32>(&arena.base, graph.linkCount);
+        graph.linkCosts = Hx::AllocArray<f32>(&arena.base, graph.linkCount);
+        graph.linkWidths = Hx::AllocArray<f32>(&arena.base, graph.linkCount);
+        graph.linkPortals = Hx::AllocArray<NavPortal>(&arena.base, graph.linkCount);
+        if (!graph.linkTargets || !graph.linkCosts || !graph.linkWidths || !graph.linkPortals) return false;
+
+        // Edges run counter-clockwise, so leaving across one its end is on the left
+        u32 link = 0;
+        for (u32 s = 0; s < graph.nodeCount; ++s) {
+            const MapSubsector& group = map.subsectors[s];
+            for (u32 e = group.firstEdge; e < group.firstEdge + group.edgeCount; ++e) {
+                if (partner[e] == NavNone) continue;
+
+                const MapEdge& edge = map.edges[e];
+                const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+                const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                const s32* end = edge.reversed ? seg.v1 : seg.v2;
+
+                NavPortal portal;
+                portal.left = Vector2{ static_cast<f32>(end[0]), static_cast<f32>(end[1]) };
+                portal.right = Vector2{ static_cast<f32>(start[0]), static_cast<f32>(start[1]) };
+
+                u32 target = edgeOwner[partner[e]];
+                Vector2 mid = { (portal.left.x + portal.right.x) * 0.5f, (portal.left.y + portal.right.y) * 0.5f };
+
+                graph.linkTargets[link] = target;
+                graph.linkCosts[link] = Distance(graph.nodeCenters[s], mid) + Distance(mid, graph.nodeCenters[target]);
+                graph.linkWidths[link] = Distance(portal.left, portal.right);
+                graph.linkPortals[link] = portal;
+                ++link;
+            }
+        }
+
+        return true;
+    }
+
+    struct PathHeapEntry {
+        f32 estimate;
+        u32 node;
+    };
+
+    // One per job chunk in flight. Searches reset the node arrays by bumping
+    // the stamp, and write their corridors and points to the end of the
+    // scratch's output, which stays put until the batch is merged.
+    struct PathScratch {
+        u32 stamp = 0;
+        std::vector<u32> openStamp;
+        std::vector<u32> closedStamp;
+        std::vector<f32> cost;
+        std::vector<u32> parentNode;
+        std::vector<u32> parentLink;
+        std::vector<PathHeapEntry> heap;
+
+        std::vector<u32> corridors;
+        std::vector<Vector2> points;
+        std::vector<NavPortal> portals;
+        u64 nodesExpanded = 0;
+    };
+
+    struct PathWork {
+        u32 scratch;
+        u32 firstLink;   // Into the scratch's corridors, for the cache
+        u32 linkCount;
+        u32 firstPoint;  // Into the scratch's points until the merge
+        bool insert;     // Searched, so the corridor goes into the cache
+    };
+
+    struct PathCacheSlot {
+        u64 key;
+        u32 generation;  // Zero never matches
+        u32 firstLink;
+        u32 linkCount;
+        PathStatus status;
+    };
+
+    struct PathfindingServiceImpl {
+        Hx::JobSystem* jobs;
+        PathfindingSettings settings;
+        const MapData* map = nullptr;
+        const NavGraph* graph = nullptr;
+
+        std::vector<PathQuery> queries;
+        std::vector<PathResult> results;
+        std::vector<PathWork> work;
+        std::vector<u32> nodes;
+        std::vector<Vector2> points;
+
+        std::mutex scratchMutex;
+        std::vector<PathScratch*> scratches;
+        std::vector<u32> freeScratches;
+
+        std::vector<PathCacheSlot> cacheSlots;
+        std::vector<u32> cacheLinks;
+        u32 cacheGeneration = 1;
+
+        PathfindingStats stats = {};
+    };
+
+    static u32 AcquireScratch(PathfindingServiceImpl* impl, PathScratch*& outScratch) {
+        std::lock_guard<std::mutex> lock(impl->scratchMutex);
+        if (impl->freeScratches.empty()) {
+            impl->freeScratches.push_back(static_cast<u32>(impl->scratches.size()));
+            impl->scratches.push_back(new PathScratch());
+        }
+
+        u32 index = impl->freeScratches.back();
+        impl->freeScratches.pop_back();
+        outScratch = impl->scratches[index];
+        return index;
+    }
+
+    static void ReleaseScratch(PathfindingServiceImpl* impl, u32 index) {
+        std::lock_guard<std::mutex> lock(impl->scratchMutex);
+        impl->freeScratches.push_back(index);
+    }
+
+    static inline u64 GetCacheKey(u32 startNode, u32 goalNode) {
+        return (static_cast<u64>(startNode) << 32) | goalNode;
+    }
+
+    // Two way set associative: a key may sit in either slot of its pair
+    static inline u32 GetCacheSet(const PathfindingServiceImpl* impl, u64 key) {
+        u64 hash = key * 0x9E3779B97F4A7C15ull;
+        return static_cast<u32>(hash >> 32) & static_cast<u32>(impl->cacheSlots.size() - 2);
+    }
+
+    static const PathCacheSlot* FindCachedCorridor(const PathfindingServiceImpl* impl, u64 key) {
+        u32 set = GetCacheSet(impl, key);
+        for (u32 way = 0; way < 2; ++way) {
+            const PathCacheSlot& slot = impl->cacheSlots[set + way];
+            if (slot.generation == impl->cacheGeneration && slot.key == key) return &slot;
+        }
+        return nullptr;
+    }
+
+    static bool IsLinkPassable(const PathfindingServiceImpl* impl, u32 fromNode, u32 link) {
+        const MapData& map = *impl->map;
+        const NavGraph& graph = *impl->graph;
+        const PathfindingSettings& settings = impl->settings;
+
+        s32 fromSector = map.subsectorSectors[fromNode];
+        s32 toSector = map.subsectorSectors[graph.linkTargets[link]];
+        if (fromSector < 0 || toSector < 0) return false;
+
+        const MapSector& from = map.sectors[fromSector];
+        const MapSector& to = map.sectors[toSector];
+        if (static_cast<f32>(to.floorHeight - from.floorHeight) > settings.stepHeight) return false;
+
+        s32 floor = from.floorHeight > to.floorHeight ? from.floorHeight : to.floorHeight;
+        s32 ceiling = from.ceilingHeight < to.ceilingHeight ? from.ceilingHeight : to.ceilingHeight;
+        if (static_cast<f32>(ceiling - floor) < settings.agentHeight) return false;
+
+        return graph.linkWidths[link] >= settings.agentRadius * 2.0f;
+    }
+
+    static void PushHeap(std::vector<PathHeapEntry>& heap, PathHeapEntry entry) {
+        heap.push_back(entry);
+        usize i = heap.size() - 1;
+        while (i > 0) {
+            usize parent = (i - 1) / 2;
+            if (heap[parent].estimate <= entry.estimate) break;
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i] = entry;
+    }
+
+    static PathHeapEntry PopHeap(std::vector<PathHeapEntry>& heap) {
+        PathHeapEntry top = heap[0];
+        PathHeapEntry last = heap.back();
+        heap.pop_back();
+
+        usize count = heap.size();
+        usize i = 0;
+        while (count > 0) {
+            usize child = i * 2 + 1;
+            if (child >= count) break;
+            if (child + 1 < count && heap[child + 1].estimate < heap[child].estimate) ++child;
+            if (last.estimate <= heap[child].estimate) break;
+            heap[i] = heap[child];
+            i = child;
+        }
+        if (count > 0) heap[i] = last;
+        return top;
+    }
+
+    // A* over subsector centres, appending the links from start to goal to the scratch's corridors
+    static PathStatus SearchCorridor(const PathfindingServiceImpl* impl, PathScratch& scratch, u32 startNode,
+                                     u32 goalNode, u32& outLinkCount) {
+        const NavGraph& graph = *impl->graph;
+        outLinkCount = 0;
+
+        if (scratch.openStamp.size() != graph.nodeCount) {
+            scratch.openStamp.assign(graph.nodeCount, 0);
+            scratch.closedStamp.assign(graph.nodeCount, 0);
+            scratch.cost.resize(graph.nodeCount);
+            scratch.parentNode.resize(graph.nodeCount);
+            scratch.parentLink.resize(graph.nodeCount);
+            scratch.stamp = 0;
+        }
+
+        if (++scratch.stamp == 0) {
+            std::fill(scratch.openStamp.begin(), scratch.openStamp.end(), 0);
+            std::fill(scratch.closedStamp.begin(), scratch.closedStamp.end(), 0);
+            scratch.stamp = 1;
+        }
+
+        u32 stamp = scratch.stamp;
+        Vector2 goalCenter = graph.nodeCenters[goalNode];
+
+        scratch.heap.clear();
+        scratch.openStamp[startNode] = stamp;
+        scratch.cost[startNode] = 0.0f;
+        scratch.parentLink[startNode] = NavNone;
+        PushHeap(scratch.heap, PathHeapEntry{ Distance(graph.nodeCenters[startNode], goalCenter), startNode });
+
+        u32 expanded = 0;
+        bool found = false;
+        while (!scratch.heap.empty()) {
+            u32 node = PopHeap(scratch.heap).node;
+            if (scratch.closedStamp[node] == stamp) continue;
+            scratch.closedStamp[node] = stamp;
+
+            if (node == goalNode) {
+                found = true;
+                break;
+            }
+
+            if (++expanded > impl->settings.maxSearchNodes) {
+                scratch.nodesExpanded += expanded;
+                return PathStatus::SearchLimit;
+            }
+
+            f32 nodeCost = scratch.cost[node];
+            for (u32 link = graph.linkStart[node]; link < graph.linkStart[node + 1]; ++link) {
+                u32 target = graph.linkTargets[link];
+                if (scratch.closedStamp[target] == stamp) continue;
+                if (!IsLinkPassable(impl, node, link)) continue;
+
+                f32 cost = nodeCost + graph.linkCosts[link];
+                if (scratch.openStamp[target] == stamp && cost >= scratch.cost[target]) continue;
+
+                scratch.openStamp[target] = stamp;
+                scratch.cost[target] = cost;
+                scratch.parentNode[target] = node;
+                scratch.parentLink[target] = link;
+                PushHeap(scratch.heap, PathHeapEntry{ cost + Distance(graph.nodeCenters[target], goalCenter), target });
+            }
+        }
+
+        scratch.nodesExpanded += expanded;
+        if (!found) return PathStatus::NoPath;
+
+        // Walk the parents back from the goal, then flip the run into start to goal order
+        usize first = scratch.corridors.size();
+        u32 node = goalNode;
+        while (scratch.parentLink[node] != NavNone) {
+            scratch.corridors.push_back(scratch.parentLink[node]);
+            node = scratch.parentNode[node];
+        }
+
+        std::reverse(scratch.corridors.begin() + static_cast<std::ptrdiff_t>(first), scratch.corridors.end());
+        outLinkCount = static_cast<u32>(scratch.corridors.size() - first);
+        return PathStatus::Found;
+    }
+
+    static inline f32 Cross(Vector2 a, Vector2 b, Vector2 c) {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    static inline bool IsSamePoint(Vector2 a, Vector2 b) {
+        f32 dx = b.x - a.x;
+        f32 dy = b.y - a.y;
+        return dx * dx + dy * dy < 1e-6f;
+    }
+
+    // Pulls the corridor taut with the simple stupid funnel algorithm. Each
+    // portal is pulled in by the agent radius at both ends first, so corners
+    // are rounded off at that distance instead of scraped.
+    static u32 PullString(const PathfindingServiceImpl* impl, PathScratch& scratch, Vector2 start, Vector2 goal,
+                          const u32* links, u32 linkCount, f32& outLength) {
+        const NavGraph& graph = *impl->graph;
+        f32 radius = impl->settings.agentRadius;
+
+        scratch.portals.clear();
+        for (u32 i = 0; i < linkCount; ++i) {
+            NavPortal portal = graph.linkPortals[links[i]];
+            f32 width = graph.linkWidths[links[i]];
+            if (width > radius * 2.0f) {
+                f32 t = radius / width;
+                Vector2 along = { (portal.right.x - portal.left.x) * t, (portal.right.y - portal.left.y) * t };
+                portal.left = Vector2{ portal.left.x + along.x, portal.left.y + along.y };
+                portal.right = Vector2{ portal.right.x - along.x, portal.right.y - along.y };
+            } else {
+                Vector2 mid = { (portal.left.x + portal.right.x) * 0.5f, (portal.left.y + portal.right.y) * 0.5f };
+                portal.left = mid;
+                portal.right = mid;
+            }
+            scratch.portals.push_back(portal);
+        }
+        scratch.portals.push_back(NavPortal{ goal, goal });
+
+        usize first = scratch.points.size();
+        scratch.points.push_back(start);
+
+        Vector2 apex = start;
+        Vector2 left = start;
+        Vector2 right = start;
+        usize apexIndex = 0;
+        usize leftIndex = 0;
+        usize rightIndex = 0;
+
+        usize portalCount = scratch.portals.size();
+        for (usize i = 0; i < portalCount; ++i) {
+            Vector2 portalLeft = scratch.portals[i].left;
+            Vector2 portalRight = scratch.portals[i].right;
+
+            // Narrow the right side, unless that crosses the left, which then becomes a corner
+            if (Cross(apex, right, portalRight) >= 0.0f) {
+                if (IsSamePoint(apex, right) || Cross(apex, left, portalRight) < 0.0f) {
+                    right = portalRight;
+                    rightIndex = i;
+                } else {
+                    apex = left;
+                    apexIndex = leftIndex;
+                    if (!IsSamePoint(apex, scratch.points.back())) scratch.points.push_back(apex);
+                    left = apex;
+                    right = apex;
+                    leftIndex = apexIndex;
+                    rightIndex = apexIndex;
+                    i = apexIndex;
+                    continue;
+                }
+            }
+
+            if (Cross(apex, left, portalLeft) <= 0.0f) {
+                if (IsSamePoint(apex, left) || Cross(apex, right, portalLeft) > 0.0f) {
+                    left = portalLeft;
+                    leftIndex = i;
+                } else {
+                    apex = right;
+                    apexIndex = rightIndex;
+                    if (!IsSamePoint(apex, scratch.points.back())) scratch.points.push_back(apex);
+                    left = apex;
+                    right = apex;
+                    leftIndex = apexIndex;
+                    rightIndex = apexIndex;
+                    i = apexIndex;
+                    continue;
+                }
+            }
+        }
+
+        if (!IsSamePoint(goal, scratch.points.back()) || scratch.points.size() - first == 1) {
+            scratch.points.push_back(goal);
+        }
+
+        outLength = 0.0f;
+        for (usize p = first + 1; p < scratch.points.size(); ++p) {
+            outLength += Distance(scratch.points[p - 1], scratch.points[p]);
+        }
+
+        return static_cast<u32>(scratch.points.size() - first);
+    }
+
+    static void ExecuteRange(PathfindingServiceImpl* impl, usize begin, usize end) {
+        PathScratch* scratchPointer = nullptr;
+        u32 scratchIndex = AcquireScratch(impl, scratchPointer);
+        PathScratch& scratch = *scratchPointer;
+
+        Hx::FindSubsectors(*impl->map, reinterpret_cast<const Vector2*>(impl->queries.data() + begin),
+                           (end - begin) * 2, impl->nodes.data() + begin * 2);
+
+        for (usize i = begin; i < end; ++i) {
+            const PathQuery& query = impl->queries[i];
+            PathResult& result = impl->results[i];
+            PathWork& work = impl->work[i];
+            result = PathResult{ PathStatus::OutsideMap, false, 0, 0, 0.0f };
+            work = PathWork{ scratchIndex, 0, 0, 0, false };
+
+            u32 startNode = impl->nodes[i * 2];
+            u32 goalNode = impl->nodes[i * 2 + 1];
+            if (impl->map->subsectorSectors[startNode] < 0 || impl->map->subsectorSectors[goalNode] < 0) continue;
+
+            // The cache is only written between batches, so every chunk can read it
+            u64 key = GetCacheKey(startNode, goalNode);
+            const PathCacheSlot* slot = FindCachedCorridor(impl, key);
+            const u32* links = nullptr;
+
+            if (slot) {
+                result.status = slot->status;
+                result.cached = true;
+                work.linkCount = slot->linkCount;
+                links = impl->cacheLinks.data() + slot->firstLink;
+            } else {
+                work.firstLink = static_cast<u32>(scratch.corridors.size());
+                result.status = SearchCorridor(impl, scratch, startNode, goalNode, work.linkCount);
+                work.insert = result.status != PathStatus::SearchLimit;
+                links = scratch.corridors.data() + work.firstLink;
+            }
+
+            if (result.status != PathStatus::Found) continue;
+
+            work.firstPoint = static_cast<u32>(scratch.points.size());
+            result.pointCount = PullString(impl, scratch, query.start, query.goal, links, work.linkCount, result.length);
+        }
+
+        ReleaseScratch(impl, scratchIndex);
+    }
+
+    static void ResetCache(PathfindingServiceImpl* impl) {
+        impl->cacheLinks.clear();
+        impl->cacheGeneration++;
+        if (impl->cacheGeneration == 0) {
+            std::fill(impl->cacheSlots.begin(), impl->cacheSlots.end(), PathCacheSlot{});
+            impl->cacheGeneration = 1;
+        }
+    }
+
+    static void InsertCorridor(PathfindingServiceImpl* impl, u64 key, PathStatus status, const u32* links,
+                               u32 linkCount) {
+        // Full storage starts the cache over rather than tracking holes
+        if (impl->cacheLinks.size() + linkCount > impl->settings.cacheLinkCapacity) {
+            if (linkCount > impl->settings.cacheLinkCapacity) return;
+            ResetCache(impl);
+        }
+
+        // Fill a stale way first, otherwise the second way makes room by taking the first's place
+        PathCacheSlot* ways = impl->cacheSlots.data() + GetCacheSet(impl, key);
+        if (ways[0].generation == impl->cacheGeneration && ways[0].key != key) {
+            if (ways[1].generation != impl->cacheGeneration || ways[1].key == key) {
+                ++ways;
+            } else {
+                ways[1] = ways[0];
+            }
+        }
+
+        PathCacheSlot& slot = ways[0];
+        slot.key = key;
+        slot.generation = impl->cacheGeneration;
+        slot.firstLink = static_cast<u32>(impl->cacheLinks.size());
+        slot.linkCount = linkCount;
+        slot.status = status;
+        impl->cacheLinks.insert(impl->cacheLinks.end(), links, links + linkCount);
+    }
+
+    PathfindingService::PathfindingService(Hx::JobSystem* inJobs, const PathfindingSettings& inSettings)
+        : Impl(new PathfindingServiceImpl) {
+        Impl->jobs = inJobs;
+        Impl->settings = inSettings;
+
+        u32 slots = 2;
+        while (slots < Impl->settings.cacheSlots) slots <<= 1;
+        Impl->cacheSlots.resize(slots, PathCacheSlot{});
+        Impl->cacheLinks.reserve(Impl->settings.cacheLinkCapacity);
+    }
+
+    PathfindingService::~PathfindingService() {
+        for (PathScratch* scratch : Impl->scratches) {
+            delete scratch;
+        }
+        delete Impl;
+    }
+
+    void PathfindingService::SetLevel(const MapData* map, const NavGraph* graph) {
+        Impl->map = map;
+        Impl->graph = graph;
+        InvalidateCache();
+        Clear();
+    }
+
+    u32 PathfindingService::Submit(const PathQuery& query) {
+        Impl->queries.push_back(query);
+        return static_cast<u32>(Impl->queries.size() - 1);
+    }
+
+    void PathfindingService::Execute() {
+        f64 startTime = Hx::GetTimeSeconds();
+        usize count = Impl->queries.size();
+        Impl->results.resize(count);
+        Impl->points.clear();
+        Impl->stats = {};
+        Impl->stats.queryCount = static_cast<u32>(count);
+
+        if (!Impl->map || !Impl->graph || Impl->graph->nodeCount == 0) {
+            for (usize i = 0; i < count; ++i) {
+                Impl->results[i] = PathResult{ PathStatus::OutsideMap, false, 0, 0, 0.0f };
+            }
+            return;
+        }
+
+        Impl->work.resize(count);
+        Impl->nodes.resize(count * 2);
+        for (PathScratch* scratch : Impl->scratches) {
+            scratch->corridors.clear();
+            scratch->points.clear();
+            scratch->nodesExpanded = 0;
+        }
+
+        auto executeRange = [this](usize begin, usize end) { ExecuteRange(Impl, begin, end); };
+        if (Impl->jobs) {
+            Impl->jobs->ParallelFor(count, PathBatchGrain, executeRange);
+        } else {
+            executeRange(0, count);
+        }
+
+        // Gather the points in submission order and cache what was searched
+        for (usize i = 0; i < count; ++i) {
+            PathResult& result = Impl->results[i];
+            const PathWork& work = Impl->work[i];
+            const PathScratch& scratch = *Impl->scratches[work.scratch];
+
+            if (result.cached) {
+                Impl->stats.cacheHits++;
+            } else if (result.status != PathStatus::OutsideMap) {
+                Impl->stats.searchCount++;
+            }
+
+            if (work.insert) {
+                u64 key = GetCacheKey(Impl->nodes[i * 2], Impl->nodes[i * 2 + 1]);
+                InsertCorridor(Impl, key, result.status, scratch.corridors.data() + work.firstLink, work.linkCount);
+            }
+
+            if (result.pointCount > 0) {
+                const Vector2* points = scratch.points.data() + work.firstPoint;
+                result.firstPoint = static_cast<u32>(Impl->points.size());
+                Impl->points.insert(Impl->points.end(), points, points + result.pointCount);
+            }
+        }
+
+        for (const PathScratch* scratch : Impl->scratches) {
+            Impl->stats.nodesExpanded += scratch->nodesExpanded;
+        }
+        Impl->stats.executeSeconds = Hx::GetTimeSeconds() - startTime;
+    }
+
+    void PathfindingService::Clear() {
+        Impl->queries.clear();
+        Impl->results.clear();
+        Impl->points.clear();
+    }
+
+    const PathResult& PathfindingService::GetResult(u32 ticket) const {
+        return Impl->results[ticket];
+    }
+
+    const Vector2* PathfindingService::GetPathPoints() const {
+        return Impl->points.data();
+    }
+
+    usize PathfindingService::GetQueryCount() const {
+        return Impl->queries.size();
+    }
+
+    void PathfindingService::InvalidateCache() {
+        ResetCache(Impl);
+    }
+
+    const PathfindingStats& PathfindingService::GetStats() const {
+        return Impl->stats;
+    }
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+    class JobSystem;
+}
+
+namespace Hx {
+
+    // The opening between two neighbouring subsectors, with left and right as
+    // seen walking from the link's node into its target
+    struct NavPortal {
+        Vector2 left;
+        Vector2 right;
+    };
+
+    // Every subsector is a node, and two subsectors sharing a line segment are
+    // linked both ways. The links of node n are [linkStart[n], linkStart[n + 1]).
+    // Nothing about heights is baked in; whether a link can be walked is decided
+    // per search from the sectors' current heights, so doors and lifts count.
+    struct NavGraph {
+        u32 nodeCount;
+        Vector2* nodeCenters;
+
+        u32* linkStart;
+        u32* linkTargets;
+        f32* linkCosts;       // Centre to portal midpoint to centre
+        f32* linkWidths;
+        NavPortal* linkPortals;
+        usize linkCount;
+    };
+
+    bool BuildNavGraph(NavGraph& graph, const MapData& map, Hx::ArenaAllocator& arena);
+
+    struct PathfindingSettings {
+        // Tallest step up an agent can take, drops of any height are allowed
+        f32 stepHeight = 24.0f;
+        // Openings lower than this, or narrower than twice the radius, are impassable
+        f32 agentHeight = 56.0f;
+        f32 agentRadius = 16.0f;
+        // A search that expands more nodes than this gives up
+        u32 maxSearchNodes = 1u << 16;
+        // Slots in the corridor cache, rounded up to a power of two, and how many links all cached corridors may hold
+        u32 cacheSlots = 1u << 12;
+        u32 cacheLinkCapacity = 1u << 18;
+    };
+
+    struct PathQuery {
+        Vector2 start;
+        Vector2 goal;
+    };
+
+    enum class PathStatus : u8 {
+        Found,
+        NoPath,
+        OutsideMap,  // Start or goal is in a subsector without a sector
+        SearchLimit  // Gave up after maxSearchNodes
+    };
+
+    struct PathResult {
+        PathStatus status;
+        bool cached;     // The corridor came from the cache
+        u32 firstPoint;  // Into GetPathPoints, from start to goal
+        u32 pointCount;
+        f32 length;
+    };
+
+    struct PathfindingStats {
+        u32 queryCount;   // In the last Execute
+        u32 cacheHits;
+        u32 searchCount;
+        u64 nodesExpanded;
+        f64 executeSeconds;
+    };
+
+    // Collects path requests over a frame and answers them as one batch. Each
+    // query is located in the BSP, its corridor of subsectors is looked up in
+    // the cache or found with A* over the nav graph, and the corridor is pulled
+    // taut with a funnel pass, kept agentRadius away from its corners. Queries
+    // are spread over the job system. Corridors are cached by start and goal
+    // subsector; call InvalidateCache after heights change. Tickets index this
+    // batch's results and are invalidated by Clear.
+    class PathfindingService {
+    public:
+        explicit PathfindingService(Hx::JobSystem* inJobs, const PathfindingSettings& inSettings = {});
+        ~PathfindingService();
+
+        PathfindingService(const PathfindingService&) = delete;
+        PathfindingService& operator=(const PathfindingService&) = delete;
+
+        // Both must outlive the service or the next SetLevel call
+        void SetLevel(const MapData* map, const NavGraph* graph);
+
+        u32 Submit(const PathQuery& query);
+        void Execute();
+        void Clear();
+
+        const PathResult& GetResult(u32 ticket) const;
+        const Vector2* GetPathPoints() const;
+        usize GetQueryCount() const;
+
+        void InvalidateCache();
+        const PathfindingStats& GetStats() const;
+
+    private:
+        struct PathfindingServiceImpl* Impl;
+    };
+
+}
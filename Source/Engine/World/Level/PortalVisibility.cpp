@@ -0,0 +1,282 @@
+#include "Engine/World/Level/PortalVisibility.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <cstring>
+
+namespace Hx {
+
+    // Views wider than this go around in several quarter turns
+    constexpr u32 FullViewPassCount = 4;
+    constexpr f32 FullViewTanHalfFov = 1.0001f;
+
+    // Re-entering a sector is only worth it when the view reaches past what was already walked.
+    // Sectors keep a single interval, so reaching one through several portals walks their union.
+    constexpr f32 IntervalEpsilon = 1e-5f;
+
+    PortalView MakePortalView(const Vector3& position, const Vector3& forward, f32 verticalFovRadians,
+                              f32 aspectRatio, f32 nearDistance) {
+        PortalView view = {};
+        view.position = WorldToMap(position);
+        view.nearDistance = nearDistance;
+
+        Vector2 flatForward = WorldToMap(forward);
+        f32 flatLength = Hx::Sqrt(flatForward.x * flatForward.x + flatForward.y * flatForward.y);
+
+        f32 tanHalfY = Hx::Tan(verticalFovRadians * 0.5f);
+        f32 tanHalfX = tanHalfY * aspectRatio;
+
+        // A direction at screen offset (u, v) spreads u sideways over cos(pitch) - v * sin(pitch) ahead
+        f32 cosPitch = flatLength;
+        f32 sinPitch = Hx::Abs(forward.y);
+        f32 ahead = cosPitch - tanHalfY * sinPitch;
+
+        if (flatLength < 1e-4f || ahead <= 1e-3f) {
+            view.forward = Vector2{ 1.0f, 0.0f };
+            view.tanHalfFov = 0.0f;
+            return view;
+        }
+
+        view.forward = Vector2{ flatForward.x / flatLength, flatForward.y / flatLength };
+        view.tanHalfFov = tanHalfX / ahead;
+        return view;
+    }
+
+    bool InitPortalVisibility(PortalVisibility& visibility, const MapData& map, Hx::ArenaAllocator& arena) {
+        visibility = {};
+        visibility.map = &map;
+
+        Allocator* allocator = &arena.base;
+        visibility.portalStart = Hx::AllocArray<u32>(allocator, map.sectorCount + 1, Hx::AllocFlags::ZeroInit);
+        if (!visibility.portalStart) return false;
+
+        // Count first, then fill, so each sector's portals end up contiguous
+        for (int pass = 0; pass < 2; ++pass) {
+            usize count = 0;
+            for (usize s = 0; s < map.sectorCount; ++s) {
+                const MapSector& sector = map.sectors[s];
+                if (pass == 1 && visibility.portalStart[s] != count) return false;
+
+                for (u32 g = 0; g < sector.groupCount; ++g) {
+                    const MapSubsector& subsector = map.subsectors[sector.firstGroup + g];
+                    for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                        const MapEdge& edge = map.edges[subsector.firstEdge + e];
+                        const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+                        if (seg.backSector < 0) continue;
+
+                        // Segments inside a sector do not lead anywhere new
+                        s32 other = edge.reversed ? seg.frontSector : seg.backSector;
+                        if (other == static_cast<s32>(s)) continue;
+
+                        if (pass == 1) {
+                            const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                            const s32* end = edge.reversed ? seg.v1 : seg.v2;
+
+                            SectorPortal& portal = visibility.portals[count];
+                            portal.a = Vector2{ static_cast<f32>(start[0]), static_cast<f32>(start[1]) };
+                            portal.b = Vector2{ static_cast<f32>(end[0]), static_cast<f32>(end[1]) };
+                            portal.sector = static_cast<u32>(other);
+                        }
+                        ++count;
+                    }
+                }
+
+                if (pass == 0) visibility.portalStart[s + 1] = static_cast<u32>(count);
+            }
+
+            if (pass == 0) {
+                visibility.portalCount = count;
+                visibility.portals = Hx::AllocArray<SectorPortal>(allocator, count);
+                if (count > 0 && !visibility.portals) return false;
+            }
+        }
+
+        // A sector is queued at most once at a time
+        visibility.queueCapacity = map.sectorCount + 1;
+
+        visibility.visibleBits = Hx::AllocArray<u8>(allocator, (map.sectorCount + 7) / 8, Hx::AllocFlags::ZeroInit);
+        visibility.visibleSectors = Hx::AllocArray<u32>(allocator, map.sectorCount);
+        visibility.intervalMin = Hx::AllocArray<f32>(allocator, map.sectorCount);
+        visibility.intervalMax = Hx::AllocArray<f32>(allocator, map.sectorCount);
+        visibility.intervalStamp = Hx::AllocArray<u32>(allocator, map.sectorCount, Hx::AllocFlags::ZeroInit);
+        visibility.queue = Hx::AllocArray<u32>(allocator, visibility.queueCapacity);
+        visibility.queued = Hx::AllocArray<u8>(allocator, map.sectorCount, Hx::AllocFlags::ZeroInit);
+
+        if (map.sectorCount == 0) return true;
+        return visibility.visibleBits && visibility.visibleSectors && visibility.intervalMin &&
+               visibility.intervalMax && visibility.intervalStamp &&
+               visibility.queue && visibility.queued;
+    }
+
+    static inline bool IsPortalOpen(const MapData& map, u32 from, u32 to) {
+        const MapSector& a = map.sectors[from];
+        const MapSector& b = map.sectors[to];
+        s32 floor = a.floorHeight > b.floorHeight ? a.floorHeight : b.floorHeight;
+        s32 ceiling = a.ceilingHeight < b.ceilingHeight ? a.ceilingHeight : b.ceilingHeight;
+        return ceiling > floor;
+    }
+
+    static inline void MarkVisible(PortalVisibility& visibility, u32 sector) {
+        u8 bit = static_cast<u8>(1u << (sector & 7));
+        if (!(visibility.visibleBits[sector >> 3] & bit)) {
+            visibility.visibleBits[sector >> 3] |= bit;
+            visibility.visibleSectors[visibility.visibleSectorCount++] = sector;
+        }
+    }
+
+    static void TraverseFrom(PortalVisibility& visibility, u32 startSector, const PortalView& view, Vector2 forward,
+                             f32 tanHalfFov, const u8* pvsSectors, PortalVisibilityStats& stats) {
+        const MapData& map = *visibility.map;
+        Vector2 right = { forward.y, -forward.x };
+
+        // Portals farther than the near distance have no point inside the wedge closer ahead than this
+        f32 clipAhead = view.nearDistance / Hx::Sqrt(1.0f + tanHalfFov * tanHalfFov);
+
+        // A new stamp invalidates every interval from the previous pass at once
+        u32 stamp = ++visibility.stamp;
+        if (stamp == 0) {
+            memset(visibility.intervalStamp, 0, map.sectorCount * sizeof(u32));
+            stamp = visibility.stamp = 1;
+        }
+
+        visibility.intervalStamp[startSector] = stamp;
+        visibility.intervalMin[startSector] = -tanHalfFov;
+        visibility.intervalMax[startSector] = tanHalfFov;
+
+        // Breadth first, so a sector reached through several portals tends to have
+        // all of them merged into its interval before it is walked
+        usize head = 0;
+        usize tail = 0;
+        visibility.queue[tail++] = startSector;
+        visibility.queued[startSector] = 1;
+
+        while (head != tail) {
+            u32 sector = visibility.queue[head];
+            head = head + 1 == visibility.queueCapacity ? 0 : head + 1;
+            visibility.queued[sector] = 0;
+            ++stats.sectorsVisited;
+
+            f32 entryMin = visibility.intervalMin[sector];
+            f32 entryMax = visibility.intervalMax[sector];
+
+            for (u32 p = visibility.portalStart[sector]; p < visibility.portalStart[sector + 1]; ++p) {
+                const SectorPortal& portal = visibility.portals[p];
+                ++stats.portalsVisited;
+
+                if (pvsSectors && !(pvsSectors[portal.sector >> 3] & (1u << (portal.sector & 7)))) continue;
+                if (!IsPortalOpen(map, sector, portal.sector)) continue;
+
+                Vector2 a = { portal.a.x - view.position.x, portal.a.y - view.position.y };
+                Vector2 b = { portal.b.x - view.position.x, portal.b.y - view.position.y };
+
+                // The sector is on the left of the portal, so the viewer has to be too
+                f32 ex = b.x - a.x;
+                f32 ey = b.y - a.y;
+                f32 lengthSquared = ex * ex + ey * ey;
+                if (lengthSquared <= 0.0f) continue;
+
+                f32 facing = ex * -a.y - ey * -a.x;
+
+                // Standing on the portal: it fills the view, so pass the current interval through
+                f32 t = -(a.x * ex + a.y * ey) / lengthSquared;
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                f32 closestX = a.x + ex * t;
+                f32 closestY = a.y + ey * t;
+                bool touching = closestX * closestX + closestY * closestY <= view.nearDistance * view.nearDistance;
+
+                f32 newMin = entryMin;
+                f32 newMax = entryMax;
+
+                if (!touching) {
+                    if (facing < 0.0f) continue;
+
+                    f32 aheadA = a.x * forward.x + a.y * forward.y;
+                    f32 aheadB = b.x * forward.x + b.y * forward.y;
+                    if (aheadA < clipAhead && aheadB < clipAhead) continue;
+
+                    // Cut the part behind the near line so both ends project in front
+                    if (aheadA < clipAhead) {
+                        f32 s = (clipAhead - aheadA) / (aheadB - aheadA);
+                        a = Vector2{ a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s };
+                        aheadA = clipAhead;
+                    } else if (aheadB < clipAhead) {
+                        f32 s = (clipAhead - aheadB) / (aheadA - aheadB);
+                        b = Vector2{ b.x + (a.x - b.x) * s, b.y + (a.y - b.y) * s };
+                        aheadB = clipAhead;
+                    }
+
+                    f32 projectedA = (a.x * right.x + a.y * right.y) / aheadA;
+                    f32 projectedB = (b.x * right.x + b.y * right.y) / aheadB;
+                    f32 portalMin = projectedA < projectedB ? projectedA : projectedB;
+                    f32 portalMax = projectedA < projectedB ? projectedB : projectedA;
+
+                    newMin = portalMin > entryMin ? portalMin : entryMin;
+                    newMax = portalMax < entryMax ? portalMax : entryMax;
+                    if (newMin >= newMax) continue;
+                }
+
+                ++stats.portalsPassed;
+
+                u32 next = portal.sector;
+                if (visibility.intervalStamp[next] == stamp) {
+                    f32& seenMin = visibility.intervalMin[next];
+                    f32& seenMax = visibility.intervalMax[next];
+                    if (newMin >= seenMin - IntervalEpsilon && newMax <= seenMax + IntervalEpsilon) continue;
+
+                    // Keep the union, a gap between two pieces could hide something neither reached
+                    seenMin = newMin < seenMin ? newMin : seenMin;
+                    seenMax = newMax > seenMax ? newMax : seenMax;
+                } else {
+                    visibility.intervalStamp[next] = stamp;
+                    visibility.intervalMin[next] = newMin;
+                    visibility.intervalMax[next] = newMax;
+                }
+
+                MarkVisible(visibility, next);
+
+                // Already waiting sectors just walk the wider interval when their turn comes
+                if (!visibility.queued[next]) {
+                    visibility.queued[next] = 1;
+                    visibility.queue[tail] = next;
+                    tail = tail + 1 == visibility.queueCapacity ? 0 : tail + 1;
+                }
+            }
+        }
+    }
+
+    void ComputePortalVisibility(PortalVisibility& visibility, const PortalView& view, const u8* pvsSectors,
+                                 PortalVisibilityStats* outStats) {
+        PortalVisibilityStats stats = {};
+
+        // Only the sectors marked last time need clearing
+        for (u32 i = 0; i < visibility.visibleSectorCount; ++i) {
+            u32 sector = visibility.visibleSectors[i];
+            visibility.visibleBits[sector >> 3] &= static_cast<u8>(~(1u << (sector & 7)));
+        }
+        visibility.visibleSectorCount = 0;
+
+        const MapData& map = *visibility.map;
+        s32 startSector = FindSector(map, view.position);
+
+        if (startSector >= 0) {
+            MarkVisible(visibility, static_cast<u32>(startSector));
+
+            if (view.tanHalfFov > 0.0f) {
+                TraverseFrom(visibility, static_cast<u32>(startSector), view, view.forward, view.tanHalfFov, pvsSectors, stats);
+            } else {
+                // Cover every direction with quarter turns, each its own pass since their intervals do not compare
+                Vector2 forward = view.forward;
+                for (u32 i = 0; i < FullViewPassCount; ++i) {
+                    TraverseFrom(visibility, static_cast<u32>(startSector), view, forward, FullViewTanHalfFov, pvsSectors, stats);
+                    forward = Vector2{ -forward.y, forward.x };
+                }
+            }
+        }
+
+        stats.visibleSectorCount = visibility.visibleSectorCount;
+        if (outStats) {
+            *outStats = stats;
+        }
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+}
+
+namespace Hx {
+
+    // The horizontal extent of a view, in map space
+    struct PortalView {
+        Vector2 position;
+        Vector2 forward;     // Unit length
+        f32 tanHalfFov;      // Zero or less means the view covers every direction
+        f32 nearDistance;
+    };
+
+    // Builds the horizontal wedge a camera's frustum covers. Pitching widens
+    // it, and once the frustum can see straight up or down it covers everything.
+    PortalView MakePortalView(const Vector3& position, const Vector3& forward, f32 verticalFovRadians,
+                              f32 aspectRatio, f32 nearDistance);
+
+    // A two-sided line segment seen from one of its sectors, which lies on the left of a -> b
+    struct SectorPortal {
+        Vector2 a;
+        Vector2 b;
+        u32 sector;
+    };
+
+    struct PortalVisibilityStats {
+        u32 portalsVisited;
+        u32 portalsPassed;
+        u32 sectorsVisited;
+        u32 visibleSectorCount;
+    };
+
+    struct PortalVisibility {
+        const MapData* map;
+
+        // Portals of sector i are portals[portalStart[i] .. portalStart[i + 1]]
+        SectorPortal* portals;
+        u32* portalStart;
+        usize portalCount;
+
+        // One bit per sector, and the same sectors as a list
+        u8* visibleBits;
+        u32* visibleSectors;
+        u32 visibleSectorCount;
+
+        // Per sector interval of the view that reaches it, valid while the stamp
+        // matches the pass. Intervals are positions on a line one unit ahead of
+        // the viewer (sideways / ahead), only meaningful inside the view wedge.
+        f32* intervalMin;
+        f32* intervalMax;
+        u32* intervalStamp;
+        u32 stamp;
+
+        u32* queue;
+        u8* queued;
+        usize queueCapacity;
+    };
+
+    bool InitPortalVisibility(PortalVisibility& visibility, const MapData& map, Hx::ArenaAllocator& arena);
+
+    // Walks from the sector containing the view through every open portal in
+    // front of it, narrowing the view to each portal it passes. Sector heights
+    // are read on every call, so doors and lifts open and close portals as
+    // they move. When pvsSectors is given, sectors outside it are never entered.
+    void ComputePortalVisibility(PortalVisibility& visibility, const PortalView& view, const u8* pvsSectors = nullptr,
+                                 PortalVisibilityStats* outStats = nullptr);
+
+}
@@ -0,0 +1,368 @@
+#include "Engine/World/Level/Raycast.h"
+#include "Engine/Core/JobSystem.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define HX_RAYCAST_SSE 1
+#endif
+
+namespace Hx {
+
+    constexpr usize RaycastBatchGrain = 256;
+    // Below this many rays a batch is cheaper to cast in submission order than to sort
+    constexpr usize RaycastSortThreshold = 4096;
+
+    // The kernel loads a line's endpoints as one four float row
+    static_assert(offsetof(BlockmapLine, ay) == offsetof(BlockmapLine, ax) + sizeof(f32) &&
+                  offsetof(BlockmapLine, bx) == offsetof(BlockmapLine, ax) + sizeof(f32) * 2 &&
+                  offsetof(BlockmapLine, by) == offsetof(BlockmapLine, ax) + sizeof(f32) * 3,
+                  "BlockmapLine endpoints must be contiguous");
+
+    struct RayState {
+        f32 ox;
+        f32 oy;
+        f32 dx;
+        f32 dy;
+        f32 oz;
+        f32 dz;
+
+        f32 bestT;
+        const BlockmapLine* bestLine;
+    };
+
+    static bool IsLineBlocking(const MapData& map, const BlockmapLine& line, const RayState& ray, f32 t) {
+        if (line.backSector < 0) {
+            return true;
+        }
+
+        const MapSector& front = map.sectors[line.frontSector];
+        const MapSector& back = map.sectors[line.backSector];
+        s32 floor = front.floorHeight > back.floorHeight ? front.floorHeight : back.floorHeight;
+        s32 ceiling = front.ceilingHeight < back.ceilingHeight ? front.ceilingHeight : back.ceilingHeight;
+
+        f32 z = ray.oz + ray.dz * t;
+        return z < static_cast<f32>(floor) || z > static_cast<f32>(ceiling);
+    }
+
+    static inline void TestLine(const MapData& map, const BlockmapLine& line, RayState& ray) {
+        f32 ex = line.bx - line.ax;
+        f32 ey = line.by - line.ay;
+        f32 fx = line.ax - ray.ox;
+        f32 fy = line.ay - ray.oy;
+
+        // Parallel lines divide by zero and fail every comparison below
+        f32 denominator = ray.dx * ey - ray.dy * ex;
+        f32 t = (fx * ey - fy * ex) / denominator;
+        f32 u = (fx * ray.dy - fy * ray.dx) / denominator;
+
+        if (t >= 0.0f && t < ray.bestT && u >= 0.0f && u <= 1.0f && IsLineBlocking(map, line, ray, t)) {
+            ray.bestT = t;
+            ray.bestLine = &line;
+        }
+    }
+
+    static void TestCell(const MapData& map, const BlockmapLine* lines, u32 count, RayState& ray) {
+        u32 i = 0;
+
+#if HX_RAYCAST_SSE
+        __m128 ox = _mm_set1_ps(ray.ox);
+        __m128 oy = _mm_set1_ps(ray.oy);
+        __m128 dx = _mm_set1_ps(ray.dx);
+        __m128 dy = _mm_set1_ps(ray.dy);
+        __m128 zero = _mm_setzero_ps();
+        __m128 signMask = _mm_set1_ps(-0.0f);
+
+        for (; i + 4 <= count; i += 4) {
+            // Four (ax, ay, bx, by) rows become one register per coordinate
+            __m128 ax = _mm_loadu_ps(&lines[i].ax);
+            __m128 ay = _mm_loadu_ps(&lines[i + 1].ax);
+            __m128 bx = _mm_loadu_ps(&lines[i + 2].ax);
+            __m128 by = _mm_loadu_ps(&lines[i + 3].ax);
+            _MM_TRANSPOSE4_PS(ax, ay, bx, by);
+
+            __m128 ex = _mm_sub_ps(bx, ax);
+            __m128 ey = _mm_sub_ps(by, ay);
+            __m128 fx = _mm_sub_ps(ax, ox);
+            __m128 fy = _mm_sub_ps(ay, oy);
+
+            __m128 denominator = _mm_sub_ps(_mm_mul_ps(dx, ey), _mm_mul_ps(dy, ex));
+            __m128 tNumerator = _mm_sub_ps(_mm_mul_ps(fx, ey), _mm_mul_ps(fy, ex));
+            __m128 uNumerator = _mm_sub_ps(_mm_mul_ps(fx, dy), _mm_mul_ps(fy, dx));
+
+            // Compare the numerators against the denominator instead of dividing:
+            // flipping all three to a positive denominator keeps the inequalities
+            __m128 sign = _mm_and_ps(denominator, signMask);
+            __m128 absDenominator = _mm_xor_ps(denominator, sign);
+            tNumerator = _mm_xor_ps(tNumerator, sign);
+            uNumerator = _mm_xor_ps(uNumerator, sign);
+
+            __m128 mask = _mm_and_ps(_mm_cmpgt_ps(absDenominator, zero), _mm_cmpge_ps(tNumerator, zero));
+            mask = _mm_and_ps(mask, _mm_cmplt_ps(tNumerator, _mm_mul_ps(absDenominator, _mm_set1_ps(ray.bestT))));
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(uNumerator, zero), _mm_cmple_ps(uNumerator, absDenominator)));
+
+            u32 crossed = static_cast<u32>(_mm_movemask_ps(mask));
+            if (!crossed) continue;
+
+            // Crossings are rare compared to lines tested, resolve them one at a time
+            alignas(16) f32 times[4];
+            _mm_store_ps(times, _mm_div_ps(tNumerator, absDenominator));
+            for (u32 lane = 0; lane < 4; ++lane) {
+                if (!(crossed & (1u << lane))) continue;
+
+                const BlockmapLine& line = lines[i + lane];
+                if (times[lane] < ray.bestT && IsLineBlocking(map, line, ray, times[lane])) {
+                    ray.bestT = times[lane];
+                    ray.bestLine = &line;
+                }
+            }
+        }
+#endif
+
+        for (; i < count; ++i) {
+            TestLine(map, lines[i], ray);
+        }
+    }
+
+    static void Traverse(const MapData& map, const Blockmap& blockmap, RayState& ray) {
+        // Clip the ray to the grid so the walk starts in a valid cell
+        f32 minX = blockmap.originX;
+        f32 minY = blockmap.originY;
+        f32 maxX = minX + blockmap.cellSize * static_cast<f32>(blockmap.width);
+        f32 maxY = minY + blockmap.cellSize * static_cast<f32>(blockmap.height);
+
+        f32 tEnter = 0.0f;
+        f32 tLeave = 1.0f;
+        const f32 bounds[2][3] = { { minX, maxX, ray.ox }, { minY, maxY, ray.oy } };
+        const f32 directions[2] = { ray.dx, ray.dy };
+        for (u32 axis = 0; axis < 2; ++axis) {
+            f32 d = directions[axis];
+            f32 o = bounds[axis][2];
+            if (d == 0.0f) {
+                if (o < bounds[axis][0] || o > bounds[axis][1]) return;
+                continue;
+            }
+
+            f32 t0 = (bounds[axis][0] - o) / d;
+            f32 t1 = (bounds[axis][1] - o) / d;
+            if (t0 > t1) {
+                f32 swap = t0;
+                t0 = t1;
+                t1 = swap;
+            }
+            tEnter = t0 > tEnter ? t0 : tEnter;
+            tLeave = t1 < tLeave ? t1 : tLeave;
+        }
+        if (tEnter > tLeave) return;
+
+        s32 width = static_cast<s32>(blockmap.width);
+        s32 height = static_cast<s32>(blockmap.height);
+        f32 startX = (ray.ox + ray.dx * tEnter - minX) * blockmap.inverseCellSize;
+        f32 startY = (ray.oy + ray.dy * tEnter - minY) * blockmap.inverseCellSize;
+        s32 x = static_cast<s32>(std::floor(startX));
+        s32 y = static_cast<s32>(std::floor(startY));
+        x = x < 0 ? 0 : (x >= width ? width - 1 : x);
+        y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+
+        // Parametric distance to the next vertical and horizontal cell border, and between borders
+        s32 stepX = ray.dx > 0.0f ? 1 : -1;
+        s32 stepY = ray.dy > 0.0f ? 1 : -1;
+        f32 tNextX = 2.0f;
+        f32 tNextY = 2.0f;
+        f32 tDeltaX = 2.0f;
+        f32 tDeltaY = 2.0f;
+        if (ray.dx != 0.0f) {
+            f32 border = minX + static_cast<f32>(x + (stepX > 0 ? 1 : 0)) * blockmap.cellSize;
+            tNextX = (border - ray.ox) / ray.dx;
+            tDeltaX = blockmap.cellSize / std::fabs(ray.dx);
+        }
+        if (ray.dy != 0.0f) {
+            f32 border = minY + static_cast<f32>(y + (stepY > 0 ? 1 : 0)) * blockmap.cellSize;
+            tNextY = (border - ray.oy) / ray.dy;
+            tDeltaY = blockmap.cellSize / std::fabs(ray.dy);
+        }
+
+        for (;;) {
+            u32 count;
+            const BlockmapLine* lines = GetCellLines(blockmap, x, y, count);
+            TestCell(map, lines, count, ray);
+
+            // A hit inside this cell is closer than anything in the cells further along
+            f32 tExit = tNextX < tNextY ? tNextX : tNextY;
+            if (ray.bestT <= tExit || tExit >= tLeave) break;
+
+            if (tNextX < tNextY) {
+                x += stepX;
+                tNextX += tDeltaX;
+                if (x < 0 || x >= width) break;
+            } else {
+                y += stepY;
+                tNextY += tDeltaY;
+                if (y < 0 || y >= height) break;
+            }
+        }
+    }
+
+    RayHit CastRay(const MapData& map, const Blockmap& blockmap, const RayQuery& query) {
+        RayState ray;
+        ray.ox = query.origin.x;
+        ray.oy = query.origin.y;
+        ray.dx = query.end.x - query.origin.x;
+        ray.dy = query.end.y - query.origin.y;
+        ray.oz = query.originZ;
+        ray.dz = query.endZ - query.originZ;
+        ray.bestT = 1.0f;
+        ray.bestLine = nullptr;
+
+        RayHit hit;
+        hit.fraction = 1.0f;
+        hit.lineSeg = -1;
+        hit.sector = -1;
+
+        if (blockmap.lineCount > 0) {
+            Traverse(map, blockmap, ray);
+        }
+
+        f32 length = Hx::Sqrt(ray.dx * ray.dx + ray.dy * ray.dy + ray.dz * ray.dz);
+        if (!ray.bestLine) {
+            hit.distance = length;
+            return hit;
+        }
+
+        const BlockmapLine& line = *ray.bestLine;
+        f32 side = (line.bx - line.ax) * (ray.oy - line.ay) - (line.by - line.ay) * (ray.ox - line.ax);
+
+        hit.fraction = ray.bestT;
+        hit.distance = length * ray.bestT;
+        hit.lineSeg = static_cast<s32>(line.lineSeg);
+        hit.sector = side < 0.0f && line.backSector >= 0 ? line.backSector : line.frontSector;
+        return hit;
+    }
+
+    // Orders rays by the blockmap cell they start in, so rays that walk the same
+    // cells run back to back and find the lines and sectors already in cache
+    static void SortByStartCell(const Blockmap& blockmap, const RayQuery* queries, usize count,
+                                std::vector<u32>& outOrder, std::vector<RayQuery>& outSorted) {
+        usize cellCount = static_cast<usize>(blockmap.width) * blockmap.height;
+        std::vector<u32> cellStart(cellCount + 1, 0);
+        std::vector<u32> cells(count);
+
+        s32 width = static_cast<s32>(blockmap.width);
+        s32 height = static_cast<s32>(blockmap.height);
+        for (usize i = 0; i < count; ++i) {
+            s32 x = static_cast<s32>(std::floor((queries[i].origin.x - blockmap.originX) * blockmap.inverseCellSize));
+            s32 y = static_cast<s32>(std::floor((queries[i].origin.y - blockmap.originY) * blockmap.inverseCellSize));
+            x = x < 0 ? 0 : (x >= width ? width - 1 : x);
+            y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+
+            cells[i] = static_cast<u32>(y * width + x);
+            ++cellStart[cells[i] + 1];
+        }
+
+        for (usize c = 0; c < cellCount; ++c) {
+            cellStart[c + 1] += cellStart[c];
+        }
+
+        outOrder.resize(count);
+        outSorted.resize(count);
+        for (usize i = 0; i < count; ++i) {
+            u32 slot = cellStart[cells[i]]++;
+            outOrder[slot] = static_cast<u32>(i);
+            outSorted[slot] = queries[i];
+        }
+    }
+
+    void CastRays(const MapData& map, const Blockmap& blockmap, const RayQuery* queries, RayHit* outHits,
+                  usize count, Hx::JobSystem* jobs) {
+        if (count < RaycastSortThreshold || blockmap.lineCount == 0) {
+            auto castRange = [&](usize begin, usize end) {
+                for (usize i = begin; i < end; ++i) {
+                    outHits[i] = CastRay(map, blockmap, queries[i]);
+                }
+            };
+
+            if (jobs) {
+                jobs->ParallelFor(count, RaycastBatchGrain, castRange);
+            } else {
+                castRange(0, count);
+            }
+            return;
+        }
+
+        std::vector<u32> order;
+        std::vector<RayQuery> sorted;
+        SortByStartCell(blockmap, queries, count, order, sorted);
+
+        auto castSortedRange = [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                outHits[order[i]] = CastRay(map, blockmap, sorted[i]);
+            }
+        };
+
+        if (jobs) {
+            jobs->ParallelFor(count, RaycastBatchGrain, castSortedRange);
+        } else {
+            castSortedRange(0, count);
+        }
+    }
+
+    struct RaycastServiceImpl {
+        Hx::JobSystem* jobs;
+        const MapData* map = nullptr;
+        const Blockmap* blockmap = nullptr;
+
+        std::vector<RayQuery> queries;
+        std::vector<RayHit> hits;
+    };
+
+    RaycastService::RaycastService(Hx::JobSystem* inJobs)
+        : Impl(new RaycastServiceImpl) {
+        Impl->jobs = inJobs;
+    }
+
+    RaycastService::~RaycastService() {
+        delete Impl;
+    }
+
+    void RaycastService::SetLevel(const MapData* map, const Blockmap* blockmap) {
+        Impl->map = map;
+        Impl->blockmap = blockmap;
+        Clear();
+    }
+
+    u32 RaycastService::Submit(const RayQuery& query) {
+        Impl->queries.push_back(query);
+        return static_cast<u32>(Impl->queries.size() - 1);
+    }
+
+    void RaycastService::Execute() {
+        usize count = Impl->queries.size();
+        Impl->hits.resize(count);
+
+        if (!Impl->map || !Impl->blockmap) {
+            for (usize i = 0; i < count; ++i) {
+                Impl->hits[i] = RayHit{ 1.0f, 0.0f, -1, -1 };
+            }
+            return;
+        }
+
+        CastRays(*Impl->map, *Impl->blockmap, Impl->queries.data(), Impl->hits.data(), count, Impl->jobs);
+    }
+
+    void RaycastService::Clear() {
+        Impl->queries.clear();
+        Impl->hits.clear();
+    }
+
+    const RayHit& RaycastService::GetHit(u32 ticket) const {
+        return Impl->hits[ticket];
+    }
+
+    usize RaycastService::GetQueryCount() const {
+        return Impl->queries.size();
+    }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    class JobSystem;
+}
+
+namespace Hx {
+
+    // A segment through the level in map space, with a height at each end.
+    // Hitscan casts from the muzzle to the end of its range, line of sight
+    // and occlusion checks cast from one eye or emitter to the other.
+    struct RayQuery {
+        Vector2 origin;
+        Vector2 end;
+        f32 originZ;
+        f32 endZ;
+    };
+
+    struct RayHit {
+        f32 fraction; // Along origin to end, 1 when nothing was hit
+        f32 distance; // From the origin in world units, including the height change
+        s32 lineSeg;  // -1 when nothing was hit
+        s32 sector;   // Sector on the origin's side of the hit line
+    };
+
+    // A line stops the ray when it is one-sided, or when the ray passes it
+    // below the higher of the two floors or above the lower of the two
+    // ceilings. Floors and ceilings inside a sector are not tested.
+    RayHit CastRay(const MapData& map, const Blockmap& blockmap, const RayQuery& query);
+
+    // Walks the blockmap cell by cell for each ray, testing four lines of a
+    // cell at a time. Batches are spread over the job system when one is given.
+    void CastRays(const MapData& map, const Blockmap& blockmap, const RayQuery* queries, RayHit* outHits,
+                  usize count, Hx::JobSystem* jobs);
+
+    inline bool HasLineOfSight(const MapData& map, const Blockmap& blockmap, const RayQuery& query) {
+        return CastRay(map, blockmap, query).lineSeg < 0;
+    }
+
+    // Collects the rays gameplay code issues over a frame and casts them as
+    // one batch. Tickets index this frame's results and are invalidated by Clear.
+    class RaycastService {
+    public:
+        explicit RaycastService(Hx::JobSystem* inJobs);
+        ~RaycastService();
+
+        RaycastService(const RaycastService&) = delete;
+        RaycastService& operator=(const RaycastService&) = delete;
+
+        // Both must outlive the service or the next SetLevel call
+        void SetLevel(const MapData* map, const Blockmap* blockmap);
+
+        u32 Submit(const RayQuery& query);
+        void Execute();
+        void Clear();
+
+        const RayHit& GetHit(u32 ticket) const;
+        usize GetQueryCount() const;
+
+    private:
+        struct RaycastServiceImpl* Impl;
+    };
+
+}
@@ -0,0 +1,154 @@
+#include "Engine/World/Level/SectorAdjacency.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <cstring>
+
+namespace Hx {
+
+    bool BuildSectorAdjacency(SectorAdjacency& adjacency, const MapData& map, Hx::ArenaAllocator& arena) {
+        adjacency = {};
+        if (map.sectorCount == 0) {
+            return false;
+        }
+
+        adjacency.sectorCount = static_cast<u32>(map.sectorCount);
+        adjacency.neighbourStart = Hx::AllocArray<u32>(&arena.base, map.sectorCount + 1, Hx::AllocFlags::ZeroInit);
+        if (!adjacency.neighbourStart) return false;
+
+        auto isLink = [&](const MapLineSegment& seg) {
+            return seg.backSector >= 0 && seg.frontSector >= 0 && seg.frontSector != seg.backSector;
+        };
+
+        // Count every two-sided segment on both sides, duplicates included, and fill through cursors
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            if (!isLink(seg)) continue;
+            ++adjacency.neighbourStart[seg.frontSector + 1];
+            ++adjacency.neighbourStart[seg.backSector + 1];
+        }
+
+        for (usize s = 0; s < map.sectorCount; ++s) {
+            adjacency.neighbourStart[s + 1] += adjacency.neighbourStart[s];
+        }
+
+        usize capacity = adjacency.neighbourStart[map.sectorCount];
+        adjacency.neighbours = Hx::AllocArray<u32>(&arena.base, capacity > 0 ? capacity : 1);
+        u32* cursor = Hx::AllocArray<u32>(&arena.base, map.sectorCount);
+        if (!adjacency.neighbours || !cursor) return false;
+
+        memcpy(cursor, adjacency.neighbourStart, sizeof(u32) * map.sectorCount);
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            if (!isLink(seg)) continue;
+            adjacency.neighbours[cursor[seg.frontSector]++] = static_cast<u32>(seg.backSector);
+            adjacency.neighbours[cursor[seg.backSector]++] = static_cast<u32>(seg.frontSector);
+        }
+
+        // Drop the repeats in place, remembering per neighbour which sector listed it last
+        u32* lastListedBy = cursor;
+        for (usize s = 0; s < map.sectorCount; ++s) {
+            lastListedBy[s] = 0xFFFFFFFFu;
+        }
+
+        u32 write = 0;
+        u32 readStart = 0;
+        for (u32 s = 0; s < adjacency.sectorCount; ++s) {
+            u32 readEnd = adjacency.neighbourStart[s + 1];
+            adjacency.neighbourStart[s] = write;
+
+            for (u32 read = readStart; read < readEnd; ++read) {
+                u32 neighbour = adjacency.neighbours[read];
+                if (lastListedBy[neighbour] == s) continue;
+                lastListedBy[neighbour] = s;
+                adjacency.neighbours[write++] = neighbour;
+            }
+            readStart = readEnd;
+        }
+
+        adjacency.neighbourStart[adjacency.sectorCount] = write;
+        adjacency.neighbourCount = write;
+        return true;
+    }
+
+    bool IsSectorOpeningClear(u32 from, u32 to, void* userData) {
+        const MapData& map = *static_cast<const MapData*>(userData);
+        const MapSector& a = map.sectors[from];
+        const MapSector& b = map.sectors[to];
+
+        s32 floor = a.floorHeight > b.floorHeight ? a.floorHeight : b.floorHeight;
+        s32 ceiling = a.ceilingHeight < b.ceilingHeight ? a.ceilingHeight : b.ceilingHeight;
+        return ceiling > floor;
+    }
+
+    bool InitSectorSearch(SectorSearch& search, const SectorAdjacency& adjacency, Hx::ArenaAllocator& arena) {
+        search = {};
+        search.adjacency = &adjacency;
+
+        usize count = adjacency.sectorCount;
+        search.reachedBits = Hx::AllocArray<u8>(&arena.base, (count + 7) / 8, Hx::AllocFlags::ZeroInit);
+        search.sectors = Hx::AllocArray<u32>(&arena.base, count);
+        search.depths = Hx::AllocArray<u32>(&arena.base, count);
+        return search.reachedBits && search.sectors && search.depths;
+    }
+
+    static void ResetSearch(SectorSearch& search) {
+        // Past an eighth of the map a straight clear is cheaper than one write per bit
+        usize totalBytes = (search.adjacency->sectorCount + 7) / 8;
+        if (search.sectorCount > totalBytes) {
+            memset(search.reachedBits, 0, totalBytes);
+        } else {
+            for (u32 i = 0; i < search.sectorCount; ++i) {
+                search.reachedBits[search.sectors[i] >> 3] = 0;
+            }
+        }
+        search.sectorCount = 0;
+    }
+
+    static inline void MarkReached(SectorSearch& search, u32 sector, u32 depth) {
+        search.reachedBits[sector >> 3] |= static_cast<u8>(1u << (sector & 7));
+        search.sectors[search.sectorCount] = sector;
+        search.depths[search.sectorCount] = depth;
+        search.sectorCount++;
+    }
+
+    // The result list doubles as the queue, everything before head has been expanded
+    static u32 RunSearch(SectorSearch& search, u32 start, u32 target, const SectorSearchLimits& limits) {
+        ResetSearch(search);
+
+        const SectorAdjacency& adjacency = *search.adjacency;
+        if (start >= adjacency.sectorCount || limits.maxSectors == 0) return 0;
+
+        MarkReached(search, start, 0);
+        if (start == target || limits.maxSectors == 1) return 1;
+
+        for (u32 head = 0; head < search.sectorCount; ++head) {
+            u32 sector = search.sectors[head];
+            u32 depth = search.depths[head];
+            if (depth >= limits.maxDepth) break;
+
+            u32 neighbourCount = 0;
+            const u32* neighbours = GetSectorNeighbours(adjacency, sector, neighbourCount);
+            for (u32 n = 0; n < neighbourCount; ++n) {
+                u32 neighbour = neighbours[n];
+                if (IsSectorReached(search, neighbour)) continue;
+                if (limits.canEnter && !limits.canEnter(sector, neighbour, limits.userData)) continue;
+
+                MarkReached(search, neighbour, depth + 1);
+                if (neighbour == target || search.sectorCount >= limits.maxSectors) return search.sectorCount;
+            }
+        }
+
+        return search.sectorCount;
+    }
+
+    u32 SearchSectors(SectorSearch& search, u32 start, const SectorSearchLimits& limits) {
+        return RunSearch(search, start, 0xFFFFFFFFu, limits);
+    }
+
+    s32 FindSectorDistance(SectorSearch& search, u32 from, u32 to, const SectorSearchLimits& limits) {
+        u32 count = RunSearch(search, from, to, limits);
+        if (count == 0 || to >= search.adjacency->sectorCount || !IsSectorReached(search, to)) return -1;
+        return static_cast<s32>(search.depths[count - 1]);
+    }
+
+}
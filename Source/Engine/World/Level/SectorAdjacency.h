@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+}
+
+namespace Hx {
+
+    // Which sectors share a two-sided line segment. The neighbours of sector i
+    // are neighbours[neighbourStart[i] .. neighbourStart[i + 1]], each listed
+    // once however many segments the two share.
+    struct SectorAdjacency {
+        u32 sectorCount;
+        u32* neighbourStart;
+        u32* neighbours;
+        usize neighbourCount;
+    };
+
+    bool BuildSectorAdjacency(SectorAdjacency& adjacency, const MapData& map, Hx::ArenaAllocator& arena);
+
+    inline const u32* GetSectorNeighbours(const SectorAdjacency& adjacency, u32 sector, u32& outCount) {
+        outCount = adjacency.neighbourStart[sector + 1] - adjacency.neighbourStart[sector];
+        return adjacency.neighbours + adjacency.neighbourStart[sector];
+    }
+
+    // Decides whether a search may step from one sector into a neighbour
+    using SectorEntryFn = bool (*)(u32 from, u32 to, void* userData);
+
+    // Passes when the opening between the two sectors has any height, so
+    // closed doors stop sound and alerts. userData is the MapData.
+    bool IsSectorOpeningClear(u32 from, u32 to, void* userData);
+
+    struct SectorSearchLimits {
+        u32 maxDepth = 0xFFFFFFFFu;   // Steps away from the start sector
+        u32 maxSectors = 0xFFFFFFFFu; // Including the start sector
+        SectorEntryFn canEnter = nullptr;
+        void* userData = nullptr;
+    };
+
+    // State for one search at a time, sized for every sector up front. A
+    // search leaves what it reached in sectors, in breadth first order with
+    // the steps from the start in depths, and as one bit per sector in
+    // reachedBits. The bits are cleared through the previous result, so a
+    // small search on a large map touches only what it reaches.
+    struct SectorSearch {
+        const SectorAdjacency* adjacency;
+
+        u8* reachedBits;
+        u32* sectors;
+        u32* depths;
+        u32 sectorCount;
+    };
+
+    bool InitSectorSearch(SectorSearch& search, const SectorAdjacency& adjacency, Hx::ArenaAllocator& arena);
+
+    // Breadth first flood fill from start within the limits, returns how many sectors were reached
+    u32 SearchSectors(SectorSearch& search, u32 start, const SectorSearchLimits& limits = {});
+
+    // Fewest steps from one sector to another, stopping as soon as it is
+    // reached. -1 when the limits or canEnter keep it out of reach.
+    s32 FindSectorDistance(SectorSearch& search, u32 from, u32 to, const SectorSearchLimits& limits = {});
+
+    inline bool IsSectorReached(const SectorSearch& search, u32 sector) {
+        return (search.reachedBits[sector >> 3] & (1u << (sector & 7))) != 0;
+    }
+
+}
@@ -0,0 +1,324 @@
+#include "Engine/World/Level/WorldMesh.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+namespace Hx {
+
+    // Sectors are small, a handful per chunk keeps the scheduling overhead down
+    constexpr usize SectorBuildGrain = 16;
+
+    static inline bool IsDynamicSector(const WorldMeshSettings& settings, s32 sector) {
+        return settings.dynamicSectors && (settings.dynamicSectors[sector >> 3] & (1u << (sector & 7)));
+    }
+
+    // Writes the geometry of one sector. With null outputs it only counts, so the
+    // same code sizes the buffers and fills them.
+    struct SectorGeometryWriter {
+        const MapData* map = nullptr;
+        const WorldMeshSettings* settings = nullptr;
+
+        Vertex* vertices = nullptr;
+        u32* indices = nullptr;
+
+        u32 vertexCount = 0;
+        u32 indexCount = 0;
+        u32 wallQuadCount = 0;
+
+        // When set, only the walls facing this sector are written, and each run of them is recorded
+        s32 towards = -1;
+        bool writing = true;
+        WorldMeshRange* ranges = nullptr;
+        u32 rangeCount = 0;
+        u32 maxRanges = 0;
+
+        void AddVertex(const Vector3& position, const Vector3& normal, f32 u, f32 v, f32 light) {
+            if (vertices && writing) {
+                Vertex& vertex = vertices[vertexCount];
+                vertex.position = position;
+                vertex.normal = normal;
+                vertex.texCoord = Vector2{ u, v };
+                vertex.light = light;
+            }
+            ++vertexCount;
+        }
+
+        void AddTriangle(u32 a, u32 b, u32 c) {
+            if (indices) {
+                indices[indexCount] = a;
+                indices[indexCount + 1] = b;
+                indices[indexCount + 2] = c;
+            }
+            indexCount += 3;
+        }
+
+        void RecordRange(u32 first, u32 count) {
+            if (rangeCount > 0 && ranges[rangeCount - 1].firstVertex + ranges[rangeCount - 1].vertexCount == first) {
+                ranges[rangeCount - 1].vertexCount += count;
+            } else if (rangeCount < maxRanges) {
+                ranges[rangeCount++] = WorldMeshRange{ first, count };
+            }
+        }
+
+        // Baked light of an edge's wall at a height, blended between the sector's floor and ceiling
+        f32 GetWallLight(u32 edgeIndex, const MapSector& sector, u32 corner, s32 height) const {
+            if (!map->edgeLights) return 1.0f;
+
+            const MapEdgeLight& light = map->edgeLights[edgeIndex];
+            f32 t = 0.0f;
+            if (sector.ceilingHeight > sector.floorHeight) {
+                t = static_cast<f32>(height - sector.floorHeight) / static_cast<f32>(sector.ceilingHeight - sector.floorHeight);
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            }
+            return (light.wallBottom[corner] + (light.wallTop[corner] - light.wallBottom[corner]) * t) * MapLightScale;
+        }
+
+        // Quad facing the sector the edge belongs to, from bottom to top height.
+        // Walls that may open up later are kept at zero height.
+        void AddWall(u32 edgeIndex, const MapSector& sector, const s32* start, const s32* end, s32 bottom, s32 top, bool keepEmpty) {
+            if (top <= bottom) {
+                if (!keepEmpty) return;
+                top = bottom;
+            }
+
+            f32 dx = static_cast<f32>(end[0] - start[0]);
+            f32 dy = static_cast<f32>(end[1] - start[1]);
+            f32 length = Hx::Sqrt(dx * dx + dy * dy);
+            if (length <= 0.0f) return;
+
+            // The sector lies to the left of the edge
+            Vector3 normal(-dy / length, 0.0f, -dx / length);
+
+            f32 scale = settings->texCoordScale;
+            Vector2 a = { static_cast<f32>(start[0]), static_cast<f32>(start[1]) };
+            Vector2 b = { static_cast<f32>(end[0]), static_cast<f32>(end[1]) };
+
+            u32 base = vertexCount;
+            AddVertex(MapToWorld(a, static_cast<f32>(bottom)), normal, 0.0f, bottom * scale, GetWallLight(edgeIndex, sector, 0, bottom));
+            AddVertex(MapToWorld(b, static_cast<f32>(bottom)), normal, length * scale, bottom * scale, GetWallLight(edgeIndex, sector, 1, bottom));
+            AddVertex(MapToWorld(b, static_cast<f32>(top)), normal, length * scale, top * scale, GetWallLight(edgeIndex, sector, 1, top));
+            AddVertex(MapToWorld(a, static_cast<f32>(top)), normal, 0.0f, top * scale, GetWallLight(edgeIndex, sector, 0, top));
+
+            AddTriangle(base, base + 3, base + 2);
+            AddTriangle(base, base + 2, base + 1);
+            ++wallQuadCount;
+
+            if (towards >= 0 && writing) {
+                RecordRange(base, 4);
+            }
+        }
+
+        void AddSubsector(const MapSubsector& subsector, u32 sectorIndex) {
+            const MapSector& sector = map->sectors[sectorIndex];
+            bool dynamic = IsDynamicSector(*settings, static_cast<s32>(sectorIndex));
+            f32 scale = settings->texCoordScale;
+            f32 floorHeight = static_cast<f32>(sector.floorHeight);
+            f32 ceilingHeight = static_cast<f32>(sector.ceilingHeight);
+
+            // Subsectors are convex and wound counter clockwise, so a fan covers them
+            writing = towards < 0;
+            u32 floorBase = vertexCount;
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map->edges[subsector.firstEdge + e];
+                const MapLineSegment& seg = map->lineSegments[edge.lineSeg];
+                const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                Vector2 point = { static_cast<f32>(start[0]), static_cast<f32>(start[1]) };
+
+                f32 light = map->edgeLights ? map->edgeLights[subsector.firstEdge + e].floor * MapLightScale : 1.0f;
+                AddVertex(MapToWorld(point, floorHeight), Vector3(0.0f, 1.0f, 0.0f), point.x * scale, point.y * scale, light);
+            }
+
+            u32 ceilingBase = vertexCount;
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map->edges[subsector.firstEdge + e];
+                const MapLineSegment& seg = map->lineSegments[edge.lineSeg];
+                const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                Vector2 point = { static_cast<f32>(start[0]), static_cast<f32>(start[1]) };
+
+                f32 light = map->edgeLights ? map->edgeLights[subsector.firstEdge + e].ceiling * MapLightScale : 1.0f;
+                AddVertex(MapToWorld(point, ceilingHeight), Vector3(0.0f, -1.0f, 0.0f), point.x * scale, point.y * scale, light);
+            }
+
+            for (u32 i = 2; i < subsector.edgeCount; ++i) {
+                AddTriangle(floorBase, floorBase + i - 1, floorBase + i);
+                AddTriangle(ceilingBase, ceilingBase + i, ceilingBase + i - 1);
+            }
+
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map->edges[subsector.firstEdge + e];
+                const MapLineSegment& seg = map->lineSegments[edge.lineSeg];
+                const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                const s32* end = edge.reversed ? seg.v1 : seg.v2;
+                s32 otherIndex = edge.reversed ? seg.frontSector : seg.backSector;
+                writing = towards < 0 || otherIndex == towards;
+
+                if (otherIndex < 0) {
+                    AddWall(subsector.firstEdge + e, sector, start, end, sector.floorHeight, sector.ceilingHeight, dynamic);
+                    continue;
+                }
+
+                // The neighbour builds the steps facing into it, so only the ones visible from here
+                const MapSector& other = map->sectors[otherIndex];
+                s32 lowerTop = other.floorHeight < sector.ceilingHeight ? other.floorHeight : sector.ceilingHeight;
+                s32 upperBottom = other.ceilingHeight > sector.floorHeight ? other.ceilingHeight : sector.floorHeight;
+                bool keepEmpty = dynamic || IsDynamicSector(*settings, otherIndex);
+                AddWall(subsector.firstEdge + e, sector, start, end, sector.floorHeight, lowerTop, keepEmpty);
+                AddWall(subsector.firstEdge + e, sector, start, end, upperBottom, sector.ceilingHeight, keepEmpty);
+            }
+        }
+
+        void AddSector(u32 sectorIndex) {
+            const MapSector& sector = map->sectors[sectorIndex];
+            for (u32 i = 0; i < sector.groupCount; ++i) {
+                AddSubsector(map->subsectors[sector.firstGroup + i], sectorIndex);
+            }
+            writing = true;
+        }
+    };
+
+    WorldMesh* BuildWorldMesh(const MapData& map, const WorldMeshSettings& settings, Hx::JobSystem* jobs,
+                              Hx::ArenaAllocator& arena, WorldMeshStats* outStats) {
+        f64 startTime = Hx::GetTimeSeconds();
+
+        WorldMesh* worldMesh = Hx::AllocOne<WorldMesh>(&arena.base, Hx::AllocFlags::ZeroInit);
+        if (!worldMesh) return nullptr;
+
+        worldMesh->sectionCount = map.sectorCount;
+        worldMesh->sections = Hx::AllocArray<WorldMeshSection>(&arena.base, map.sectorCount, Hx::AllocFlags::ZeroInit);
+        if (map.sectorCount > 0 && !worldMesh->sections) return nullptr;
+
+        auto forEachSector = [&](auto&& fn) {
+            if (jobs) {
+                jobs->ParallelFor(map.sectorCount, SectorBuildGrain, fn);
+            } else {
+                fn(static_cast<usize>(0), map.sectorCount);
+            }
+        };
+
+        // Size every sector first so each one knows where its geometry goes
+        forEachSector([&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                SectorGeometryWriter writer = { &map, &settings };
+                writer.AddSector(static_cast<u32>(i));
+
+                worldMesh->sections[i].vertexCount = writer.vertexCount;
+                worldMesh->sections[i].indexCount = writer.indexCount;
+            }
+        });
+
+        // Pack sectors into batches in order, so neighbouring sector indices tend to share buffers
+        u32 batchCount = 0;
+        u32 batchVertices = 0;
+        u32 batchIndices = 0;
+        for (usize i = 0; i < map.sectorCount; ++i) {
+            WorldMeshSection& section = worldMesh->sections[i];
+            if (batchCount == 0 || (batchVertices > 0 && batchVertices + section.vertexCount > settings.maxBatchVertices)) {
+                ++batchCount;
+                batchVertices = 0;
+                batchIndices = 0;
+            }
+
+            section.batch = batchCount - 1;
+            section.firstVertex = batchVertices;
+            section.firstIndex = batchIndices;
+            batchVertices += section.vertexCount;
+            batchIndices += section.indexCount;
+        }
+
+        worldMesh->batchCount = batchCount;
+        worldMesh->batches = Hx::AllocArray<WorldMeshBatch>(&arena.base, batchCount, Hx::AllocFlags::ZeroInit);
+        if (batchCount > 0 && !worldMesh->batches) return nullptr;
+
+        for (usize i = 0; i < map.sectorCount; ++i) {
+            const WorldMeshSection& section = worldMesh->sections[i];
+            WorldMeshBatch& batch = worldMesh->batches[section.batch];
+            batch.vertexCount += section.vertexCount;
+            batch.indexCount += section.indexCount;
+        }
+
+        for (u32 i = 0; i < batchCount; ++i) {
+            WorldMeshBatch& batch = worldMesh->batches[i];
+            batch.vertices = Hx::AllocArray<Vertex>(&arena.base, batch.vertexCount);
+            batch.indices = Hx::AllocArray<u32>(&arena.base, batch.indexCount);
+            if ((batch.vertexCount > 0 && !batch.vertices) || (batch.indexCount > 0 && !batch.indices)) {
+                return nullptr;
+            }
+        }
+
+        std::atomic<u32> wallQuadCount{ 0 };
+
+        forEachSector([&](usize begin, usize end) {
+            u32 localWallQuads = 0;
+            for (usize i = begin; i < end; ++i) {
+                const WorldMeshSection& section = worldMesh->sections[i];
+                WorldMeshBatch& batch = worldMesh->batches[section.batch];
+
+                SectorGeometryWriter writer = { &map, &settings };
+                writer.vertices = batch.vertices + section.firstVertex;
+                writer.indices = batch.indices + section.firstIndex;
+                writer.AddSector(static_cast<u32>(i));
+
+                // The writer indexes from the start of the sector; rebase onto the batch
+                for (u32 k = 0; k < writer.indexCount; ++k) {
+                    writer.indices[k] += section.firstVertex;
+                }
+
+                localWallQuads += writer.wallQuadCount;
+            }
+            wallQuadCount.fetch_add(localWallQuads, std::memory_order_relaxed);
+        });
+
+        if (outStats) {
+            *outStats = {};
+            outStats->buildSeconds = Hx::GetTimeSeconds() - startTime;
+            outStats->batchCount = batchCount;
+            outStats->wallQuadCount = wallQuadCount.load();
+            for (u32 i = 0; i < batchCount; ++i) {
+                outStats->vertexCount += worldMesh->batches[i].vertexCount;
+                outStats->indexCount += worldMesh->batches[i].indexCount;
+            }
+        }
+
+        return worldMesh;
+    }
+
+    WorldMeshSection BuildSectorGeometry(const MapData& map, const WorldMeshSettings& settings, u32 sector,
+                                         Vertex* outVertices, u32* outIndices) {
+        SectorGeometryWriter writer = { &map, &settings, outVertices, outIndices };
+        writer.AddSector(sector);
+
+        WorldMeshSection section = {};
+        section.vertexCount = writer.vertexCount;
+        section.indexCount = writer.indexCount;
+        return section;
+    }
+
+    u32 BuildSectorWallsTowards(const MapData& map, const WorldMeshSettings& settings, u32 sector, u32 towards,
+                                Vertex* outVertices, WorldMeshRange* outRanges, u32 maxRanges) {
+        SectorGeometryWriter writer = { &map, &settings, outVertices, nullptr };
+        writer.towards = static_cast<s32>(towards);
+        writer.ranges = outRanges;
+        writer.maxRanges = maxRanges;
+        writer.AddSector(sector);
+        return writer.rangeCount;
+    }
+
+    void UploadWorldMesh(WorldMesh& worldMesh, Hx::RenderSystem& renderSystem) {
+        for (u32 i = 0; i < worldMesh.batchCount; ++i) {
+            WorldMeshBatch& batch = worldMesh.batches[i];
+            batch.mesh = renderSystem.CreateMesh(batch.vertices, batch.vertexCount, batch.indices, batch.indexCount);
+        }
+    }
+
+    void ReleaseWorldMesh(WorldMesh& worldMesh, Hx::RenderSystem& renderSystem) {
+        for (u32 i = 0; i < worldMesh.batchCount; ++i) {
+            WorldMeshBatch& batch = worldMesh.batches[i];
+            if (batch.mesh) {
+                renderSystem.DestroyMesh(batch.mesh);
+                batch.mesh = MeshHandle{};
+            }
+        }
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Renderer/RenderSystem.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+    class JobSystem;
+}
+
+namespace Hx {
+
+    struct WorldMeshSettings {
+        // Texture coordinates per map unit, floors are planar mapped and walls follow the segment
+        f32 texCoordScale = 1.0f / 64.0f;
+        // Sectors are packed into one batch until it would exceed this many vertices
+        u32 maxBatchVertices = 1u << 20;
+        // One bit per sector, set for sectors whose heights change at runtime.
+        // Walls touching them are emitted even while they have no height, so
+        // moving them never changes the vertex layout. Null when nothing moves.
+        const u8* dynamicSectors = nullptr;
+    };
+
+    // A run of vertices within one sector's geometry
+    struct WorldMeshRange {
+        u32 firstVertex;
+        u32 vertexCount;
+    };
+
+    // One vertex and index buffer pair. Indices are relative to the batch.
+    struct WorldMeshBatch {
+        Vertex* vertices;
+        u32 vertexCount;
+        u32* indices;
+        u32 indexCount;
+
+        // Set by UploadWorldMesh
+        MeshHandle mesh;
+    };
+
+    // The geometry of one sector, contiguous within its batch
+    struct WorldMeshSection {
+        u32 batch;
+        u32 firstVertex;
+        u32 vertexCount;
+        u32 firstIndex;
+        u32 indexCount;
+    };
+
+    struct WorldMesh {
+        WorldMeshBatch* batches;
+        u32 batchCount;
+
+        // Indexed by sector
+        WorldMeshSection* sections;
+        usize sectionCount;
+    };
+
+    struct WorldMeshStats {
+        f64 buildSeconds;
+        u32 batchCount;
+        u32 vertexCount;
+        u32 indexCount;
+        u32 wallQuadCount;
+    };
+
+    // Triangulates every subsector into a floor and a ceiling and extrudes the
+    // walls each sector can see: full height for one-sided segments, and the
+    // lower and upper steps towards the neighbouring sector otherwise. Sectors
+    // are built in parallel when a job system is given. The result lives in
+    // the arena; nothing is uploaded until UploadWorldMesh.
+    WorldMesh* BuildWorldMesh(const MapData& map, const WorldMeshSettings& settings, Hx::JobSystem* jobs,
+                              Hx::ArenaAllocator& arena, WorldMeshStats* outStats = nullptr);
+
+    // The geometry of a single sector, with indices relative to its first vertex.
+    // With null outputs only the counts are filled in, so callers can size their
+    // buffers first. Safe to call from any thread.
+    WorldMeshSection BuildSectorGeometry(const MapData& map, const WorldMeshSettings& settings, u32 sector,
+                                         Vertex* outVertices, u32* outIndices);
+
+    // Rewrites only the walls of sector that face towards, at the places
+    // BuildSectorGeometry put them, and leaves every other vertex alone. Both
+    // must have been given the same settings. Returns how many runs of
+    // rewritten vertices were stored in outRanges, at most maxRanges.
+    u32 BuildSectorWallsTowards(const MapData& map, const WorldMeshSettings& settings, u32 sector, u32 towards,
+                                Vertex* outVertices, WorldMeshRange* outRanges, u32 maxRanges);
+
+    void UploadWorldMesh(WorldMesh& worldMesh, Hx::RenderSystem& renderSystem);
+    void ReleaseWorldMesh(WorldMesh& worldMesh, Hx::RenderSystem& renderSystem);
+
+}
@@ -0,0 +1,1009 @@
+#include "Engine/World/Level/WorldStreaming.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize SectorSizeGrain = 64;
+
+    enum class ClusterState : u8 {
+        Unloaded,
+        Loading,  // Queued, being built or waiting for upload; its pool space is already reserved
+        Resident,
+        TooLarge  // Does not fit the budget even with everything else evicted
+    };
+
+    // Offsets are relative to the sector's cluster
+    struct StreamedSector {
+        u32 cluster;
+        u32 firstVertex;
+        u32 vertexCount;
+        u32 firstIndex;
+        u32 indexCount;
+    };
+
+    struct StreamedCluster {
+        f32 minX;
+        f32 minY;
+        f32 maxX;
+        f32 maxY;
+
+        // Into clusterSectors
+        u32 firstSector;
+        u32 sectorCount;
+
+        u32 vertexCount;
+        u32 indexCount;
+
+        // In elements, valid while loading or resident
+        u32 vertexOffset;
+        u32 indexOffset;
+
+        ClusterState state;
+        bool cancelled; // Left range while the loader had it, its result is thrown away
+        f32 distance;   // From this frame's position
+        f64 requestTime;
+    };
+
+    // Rewritten vertices of moved sectors, at their place in the pool and in the frame's scratch
+    struct DirtyVertexRange {
+        u32 poolVertex;
+        u32 vertexCount;
+        u32 scratchVertex;
+    };
+
+    // A moved sector's heights on their way to the loader thread
+    struct SectorHeights {
+        u32 sector;
+        s32 floorHeight;
+        s32 ceilingHeight;
+    };
+
+    // A cluster's geometry on its way to the GPU, vertices followed by indices in one allocation
+    struct ClusterLoad {
+        u32 cluster;
+        Vertex* vertices;
+        u32* indices;
+    };
+
+    struct PoolRange {
+        u32 offset;
+        u32 size;
+    };
+
+    // First fit over a free list kept sorted by offset, so neighbours merge on free
+    struct PoolAllocator {
+        std::vector<PoolRange> freeRanges;
+        u32 capacity = 0;
+        u32 used = 0;
+
+        void Init(u32 inCapacity) {
+            capacity = inCapacity;
+            used = 0;
+            freeRanges.clear();
+            if (capacity > 0) {
+                freeRanges.push_back(PoolRange{ 0, capacity });
+            }
+        }
+
+        bool Allocate(u32 size, u32& outOffset) {
+            outOffset = 0;
+            if (size == 0) return true;
+
+            for (usize i = 0; i < freeRanges.size(); ++i) {
+                PoolRange& range = freeRanges[i];
+                if (range.size < size) continue;
+
+                outOffset = range.offset;
+                range.offset += size;
+                range.size -= size;
+                if (range.size == 0) {
+                    freeRanges.erase(freeRanges.begin() + i);
+                }
+                used += size;
+                return true;
+            }
+            return false;
+        }
+
+        void Free(u32 offset, u32 size) {
+            if (size == 0) return;
+            used -= size;
+
+            auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+                                         [](const PoolRange& range, u32 value) { return range.offset < value; });
+            next = freeRanges.insert(next, PoolRange{ offset, size });
+
+            if (next + 1 != freeRanges.end() && next->offset + next->size == (next + 1)->offset) {
+                next->size += (next + 1)->size;
+                freeRanges.erase(next + 1);
+            }
+            if (next != freeRanges.begin() && (next - 1)->offset + (next - 1)->size == next->offset) {
+                (next - 1)->size += next->size;
+                freeRanges.erase(next);
+            }
+        }
+    };
+
+    struct WorldStreamerImpl {
+        const MapData* map;
+        // The map as the loader thread sees it, with sector heights of its own.
+        // The main thread moves sectors in the real map while clusters build.
+        MapData loaderMap;
+        // Null keeps the pools in system memory instead
+        Hx::RenderSystem* renderSystem;
+        WorldStreamingSettings settings;
+
+        StreamedSector* sectors;
+        StreamedCluster* clusters;
+        u32 clusterCount;
+        u32* clusterSectors;
+
+        // Created by the first Update, so the streamer can be built off the render thread
+        MeshHandle pool;
+        bool poolCreated = false;
+        PoolAllocator vertexPool;
+        PoolAllocator indexPool;
+        std::vector<Vertex> memoryVertices;
+        std::vector<u32> memoryIndices;
+
+        // One bit per sector, the same as settings.mesh.dynamicSectors
+        const u8* dynamicSectors;
+        // Non-zero while the sector waits in movedSectors
+        u8* movedFlags;
+        std::vector<u32> movedSectors;
+        std::vector<u32> deferredSectors;
+        std::vector<u32> neighbours;
+        std::vector<Vertex> rewriteScratch;
+        std::vector<Vertex> uploadScratch;
+        std::vector<WorldMeshRange> rangeScratch;
+        std::vector<DirtyVertexRange> dirtyRanges;
+        // Static sectors moved since the last Update, their clusters are laid out again
+        std::vector<u32> relayoutSectors;
+        std::vector<u32> relayoutClusters;
+
+        // Main thread only
+        std::vector<ClusterLoad> staged;
+        std::vector<u32> candidates;
+        u32 pendingCount = 0;
+        Vector2 lastPosition = {};
+        bool hasPosition = false;
+        f64 totalLatencySeconds = 0.0;
+
+        std::thread loader;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<u32> requests;
+        std::vector<ClusterLoad> finished;
+        // Applied to loaderMap by the loader before its next cluster
+        std::vector<SectorHeights> heightChanges;
+        bool busy = false;
+        bool quit = false;
+
+        WorldStreamingStats stats = {};
+    };
+
+    static inline usize GetClusterBytes(const StreamedCluster& cluster) {
+        return cluster.vertexCount * sizeof(Vertex) + cluster.indexCount * sizeof(u32);
+    }
+
+    static inline f32 GetDistanceToCluster(const StreamedCluster& cluster, Vector2 point) {
+        f32 dx = point.x < cluster.minX ? cluster.minX - point.x : (point.x > cluster.maxX ? point.x - cluster.maxX : 0.0f);
+        f32 dy = point.y < cluster.minY ? cluster.minY - point.y : (point.y > cluster.maxY ? point.y - cluster.maxY : 0.0f);
+        return Hx::Sqrt(dx * dx + dy * dy);
+    }
+
+    static void WritePoolVertices(WorldStreamerImpl* impl, const Vertex* vertices, u32 count, u32 offset) {
+        if (impl->renderSystem) {
+            impl->renderSystem->UpdateMeshVertices(impl->pool, vertices, count, offset);
+        } else if (count > 0) {
+            memcpy(impl->memoryVertices.data() + offset, vertices, count * sizeof(Vertex));
+        }
+    }
+
+    static void WritePoolIndices(WorldStreamerImpl* impl, const u32* indices, u32 count, u32 offset) {
+        if (impl->renderSystem) {
+            impl->renderSystem->UpdateMeshIndices(impl->pool, indices, count, offset);
+        } else if (count > 0) {
+            memcpy(impl->memoryIndices.data() + offset, indices, count * sizeof(u32));
+        }
+    }
+
+    static ClusterLoad BuildCluster(const WorldStreamerImpl* impl, u32 clusterIndex) {
+        const StreamedCluster& cluster = impl->clusters[clusterIndex];
+
+        ClusterLoad load = { clusterIndex, nullptr, nullptr };
+        usize bytes = GetClusterBytes(cluster);
+        if (bytes == 0) return load;
+
+        load.vertices = static_cast<Vertex*>(malloc(bytes));
+        if (!load.vertices) return load;
+        load.indices = reinterpret_cast<u32*>(load.vertices + cluster.vertexCount);
+
+        for (u32 i = 0; i < cluster.sectorCount; ++i) {
+            u32 sectorIndex = impl->clusterSectors[cluster.firstSector + i];
+            const StreamedSector& sector = impl->sectors[sectorIndex];
+
+            u32* indices = load.indices + sector.firstIndex;
+            BuildSectorGeometry(impl->loaderMap, impl->settings.mesh, sectorIndex, load.vertices + sector.firstVertex, indices);
+
+            // Rebase onto the cluster, the pool offset is applied as the base vertex when drawing
+            for (u32 k = 0; k < sector.indexCount; ++k) {
+                indices[k] += sector.firstVertex;
+            }
+        }
+
+        return load;
+    }
+
+    static void LoaderMain(WorldStreamerImpl* impl) {
+        std::unique_lock<std::mutex> lock(impl->mutex);
+        for (;;) {
+            impl->wake.wait(lock, [impl] { return impl->quit || !impl->requests.empty(); });
+            if (impl->quit) return;
+
+            u32 cluster = impl->requests.front();
+            impl->requests.pop_front();
+            impl->busy = true;
+
+            for (const SectorHeights& change : impl->heightChanges) {
+                impl->loaderMap.sectors[change.sector].floorHeight = change.floorHeight;
+                impl->loaderMap.sectors[change.sector].ceilingHeight = change.ceilingHeight;
+            }
+            impl->heightChanges.clear();
+
+            lock.unlock();
+            ClusterLoad load = BuildCluster(impl, cluster);
+            lock.lock();
+
+            impl->finished.push_back(load);
+            impl->busy = false;
+            impl->idle.notify_all();
+        }
+    }
+
+    static void ReleaseClusterSpace(WorldStreamerImpl* impl, StreamedCluster& cluster) {
+        impl->vertexPool.Free(cluster.vertexOffset, cluster.vertexCount);
+        impl->indexPool.Free(cluster.indexOffset, cluster.indexCount);
+        cluster.state = ClusterState::Unloaded;
+        cluster.cancelled = false;
+    }
+
+    static void Evict(WorldStreamerImpl* impl, StreamedCluster& cluster) {
+        ReleaseClusterSpace(impl, cluster);
+        impl->stats.bytesResident -= GetClusterBytes(cluster);
+        impl->stats.evictionCount++;
+    }
+
+    static void CancelLoad(WorldStreamerImpl* impl, u32 clusterIndex) {
+        StreamedCluster& cluster = impl->clusters[clusterIndex];
+
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            auto queued = std::find(impl->requests.begin(), impl->requests.end(), clusterIndex);
+            if (queued == impl->requests.end()) {
+                // Already with the loader or staged, dropped when it comes back
+                cluster.cancelled = true;
+                return;
+            }
+            impl->requests.erase(queued);
+        }
+
+        ReleaseClusterSpace(impl, cluster);
+        impl->pendingCount--;
+    }
+
+    // Takes over what the loader finished since the last call
+    static void CollectFinished(WorldStreamerImpl* impl) {
+        std::vector<ClusterLoad> finished;
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            finished.swap(impl->finished);
+        }
+
+        for (const ClusterLoad& load : finished) {
+            impl->staged.push_back(load);
+        }
+    }
+
+    static void UploadStaged(WorldStreamerImpl* impl, usize byteLimit) {
+        usize consumed = 0;
+        for (; consumed < impl->staged.size(); ++consumed) {
+            const ClusterLoad& load = impl->staged[consumed];
+            StreamedCluster& cluster = impl->clusters[load.cluster];
+            usize bytes = GetClusterBytes(cluster);
+
+            if (cluster.cancelled) {
+                free(load.vertices);
+                ReleaseClusterSpace(impl, cluster);
+                impl->pendingCount--;
+                continue;
+            }
+
+            if (impl->stats.bytesUploaded > 0 && impl->stats.bytesUploaded + bytes > byteLimit) {
+                break;
+            }
+
+            if (bytes > 0 && !load.vertices) {
+                // TODO: Replace with engine logging system
+                printf("Out of memory staging world cluster %u\n", load.cluster);
+                ReleaseClusterSpace(impl, cluster);
+                impl->pendingCount--;
+                continue;
+            }
+
+            WritePoolVertices(impl, load.vertices, cluster.vertexCount, cluster.vertexOffset);
+            WritePoolIndices(impl, load.indices, cluster.indexCount, cluster.indexOffset);
+            free(load.vertices);
+
+            cluster.state = ClusterState::Resident;
+            impl->pendingCount--;
+
+            f64 latency = Hx::GetTimeSeconds() - cluster.requestTime;
+            impl->totalLatencySeconds += latency;
+            impl->stats.loadCount++;
+            impl->stats.lastLatencySeconds = latency;
+            impl->stats.averageLatencySeconds = impl->totalLatencySeconds / static_cast<f64>(impl->stats.loadCount);
+            impl->stats.maxLatencySeconds = latency > impl->stats.maxLatencySeconds ? latency : impl->stats.maxLatencySeconds;
+            impl->stats.bytesResident += bytes;
+            impl->stats.bytesUploaded += bytes;
+        }
+
+        impl->staged.erase(impl->staged.begin(), impl->staged.begin() + consumed);
+    }
+
+    static inline bool IsClusterLoading(const WorldStreamerImpl* impl, u32 sector) {
+        return impl->clusters[impl->sectors[sector].cluster].state == ClusterState::Loading;
+    }
+
+    static inline bool IsClusterResident(const WorldStreamerImpl* impl, u32 sector) {
+        return impl->clusters[impl->sectors[sector].cluster].state == ClusterState::Resident;
+    }
+
+    // Sectors on the other side of the sector's two-sided edges, each once
+    static void GatherNeighbours(WorldStreamerImpl* impl, u32 sectorIndex) {
+        const MapData& map = *impl->map;
+        const MapSector& sector = map.sectors[sectorIndex];
+
+        impl->neighbours.clear();
+        for (u32 g = 0; g < sector.groupCount; ++g) {
+            const MapSubsector& subsector = map.subsectors[sector.firstGroup + g];
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map.edges[subsector.firstEdge + e];
+                const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+                s32 other = edge.reversed ? seg.frontSector : seg.backSector;
+
+                if (other < 0 || static_cast<u32>(other) == sectorIndex) continue;
+                if (std::find(impl->neighbours.begin(), impl->neighbours.end(), static_cast<u32>(other)) == impl->neighbours.end()) {
+                    impl->neighbours.push_back(static_cast<u32>(other));
+                }
+            }
+        }
+    }
+
+    static void RewriteSector(WorldStreamerImpl* impl, u32 sectorIndex) {
+        const StreamedSector& sector = impl->sectors[sectorIndex];
+        const StreamedCluster& cluster = impl->clusters[sector.cluster];
+        if (sector.vertexCount == 0) return;
+
+        u32 scratch = static_cast<u32>(impl->rewriteScratch.size());
+        impl->rewriteScratch.resize(scratch + sector.vertexCount);
+        BuildSectorGeometry(*impl->map, impl->settings.mesh, sectorIndex, impl->rewriteScratch.data() + scratch, nullptr);
+
+        impl->dirtyRanges.push_back(DirtyVertexRange{ cluster.vertexOffset + sector.firstVertex, sector.vertexCount, scratch });
+    }
+
+    static void RewriteWallsTowards(WorldStreamerImpl* impl, u32 sectorIndex, u32 towards) {
+        const StreamedSector& sector = impl->sectors[sectorIndex];
+        const StreamedCluster& cluster = impl->clusters[sector.cluster];
+        if (sector.vertexCount == 0) return;
+
+        u32 scratch = static_cast<u32>(impl->rewriteScratch.size());
+        impl->rewriteScratch.resize(scratch + sector.vertexCount);
+        impl->rangeScratch.resize(sector.vertexCount / 4 + 1);
+
+        u32 rangeCount = BuildSectorWallsTowards(*impl->map, impl->settings.mesh, sectorIndex, towards,
+                                                 impl->rewriteScratch.data() + scratch, impl->rangeScratch.data(),
+                                                 static_cast<u32>(impl->rangeScratch.size()));
+
+        for (u32 i = 0; i < rangeCount; ++i) {
+            const WorldMeshRange& range = impl->rangeScratch[i];
+            impl->dirtyRanges.push_back(DirtyVertexRange{ cluster.vertexOffset + sector.firstVertex + range.firstVertex,
+                                                          range.vertexCount, scratch + range.firstVertex });
+        }
+    }
+
+    // Hands the heights of the sectors moved since the last Update to the
+    // loader, so clusters requested from here on are built with them
+    static void SendMovedHeights(WorldStreamerImpl* impl) {
+        if (impl->movedSectors.empty() && impl->relayoutSectors.empty()) return;
+
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        for (const std::vector<u32>* moved : { &impl->movedSectors, &impl->relayoutSectors }) {
+            for (u32 sectorIndex : *moved) {
+                const MapSector& sector = impl->map->sectors[sectorIndex];
+                impl->heightChanges.push_back(SectorHeights{ sectorIndex, sector.floorHeight, sector.ceilingHeight });
+            }
+        }
+    }
+
+    // Sizes the cluster's sectors again from the map as it is now. The cluster
+    // gives up its pool space first, it streams back in with the new layout.
+    static void RelayoutCluster(WorldStreamerImpl* impl, u32 clusterIndex) {
+        StreamedCluster& cluster = impl->clusters[clusterIndex];
+        if (cluster.state == ClusterState::Resident) {
+            Evict(impl, cluster);
+        }
+        cluster.state = ClusterState::Unloaded;
+        cluster.vertexCount = 0;
+        cluster.indexCount = 0;
+
+        for (u32 i = 0; i < cluster.sectorCount; ++i) {
+            u32 sectorIndex = impl->clusterSectors[cluster.firstSector + i];
+            StreamedSector& sector = impl->sectors[sectorIndex];
+            WorldMeshSection section = BuildSectorGeometry(*impl->map, impl->settings.mesh, sectorIndex, nullptr, nullptr);
+
+            sector.firstVertex = cluster.vertexCount;
+            sector.firstIndex = cluster.indexCount;
+            sector.vertexCount = section.vertexCount;
+            sector.indexCount = section.indexCount;
+            cluster.vertexCount += section.vertexCount;
+            cluster.indexCount += section.indexCount;
+        }
+
+        impl->stats.rebuiltClusterCount++;
+    }
+
+    // A static sector's walls, and those its neighbours face it with, come and
+    // go with its heights, so its cluster and its neighbours' clusters are laid
+    // out again. Ones the loader has are left until they come back.
+    static void UpdateRelayoutSectors(WorldStreamerImpl* impl) {
+        impl->stats.rebuiltClusterCount = 0;
+        if (impl->relayoutSectors.empty()) return;
+
+        impl->deferredSectors.clear();
+        for (u32 sectorIndex : impl->relayoutSectors) {
+            GatherNeighbours(impl, sectorIndex);
+            impl->neighbours.push_back(sectorIndex);
+
+            impl->relayoutClusters.clear();
+            bool loading = false;
+            for (u32 affected : impl->neighbours) {
+                u32 clusterIndex = impl->sectors[affected].cluster;
+                loading = loading || impl->clusters[clusterIndex].state == ClusterState::Loading;
+                if (std::find(impl->relayoutClusters.begin(), impl->relayoutClusters.end(), clusterIndex) == impl->relayoutClusters.end()) {
+                    impl->relayoutClusters.push_back(clusterIndex);
+                }
+            }
+            if (loading) {
+                impl->deferredSectors.push_back(sectorIndex);
+                continue;
+            }
+
+            for (u32 clusterIndex : impl->relayoutClusters) {
+                RelayoutCluster(impl, clusterIndex);
+            }
+        }
+        impl->relayoutSectors.swap(impl->deferredSectors);
+    }
+
+    static void UpdateMovedSectors(WorldStreamerImpl* impl) {
+        impl->stats.movedSectorCount = 0;
+        impl->stats.dynamicUploadCount = 0;
+        impl->stats.dynamicBytesUploaded = 0;
+        if (impl->movedSectors.empty()) return;
+
+        impl->rewriteScratch.clear();
+        impl->dirtyRanges.clear();
+        impl->deferredSectors.clear();
+
+        for (u32 sectorIndex : impl->movedSectors) {
+            GatherNeighbours(impl, sectorIndex);
+
+            // Whatever the loader built may predate the move, so wait until it is resident
+            bool loading = IsClusterLoading(impl, sectorIndex);
+            for (u32 neighbour : impl->neighbours) {
+                loading = loading || IsClusterLoading(impl, neighbour);
+            }
+            if (loading) {
+                impl->deferredSectors.push_back(sectorIndex);
+                continue;
+            }
+
+            if (IsClusterResident(impl, sectorIndex)) {
+                RewriteSector(impl, sectorIndex);
+                impl->stats.movedSectorCount++;
+            }
+
+            // Moved neighbours are rewritten whole, walls and all
+            for (u32 neighbour : impl->neighbours) {
+                if (!impl->movedFlags[neighbour] && IsClusterResident(impl, neighbour)) {
+                    RewriteWallsTowards(impl, neighbour, sectorIndex);
+                }
+            }
+        }
+
+        for (u32 sectorIndex : impl->movedSectors) {
+            impl->movedFlags[sectorIndex] = 0;
+        }
+        for (u32 sectorIndex : impl->deferredSectors) {
+            impl->movedFlags[sectorIndex] = 1;
+        }
+        impl->movedSectors.swap(impl->deferredSectors);
+
+        // Ranges that meet in the pool go up as one update
+        std::sort(impl->dirtyRanges.begin(), impl->dirtyRanges.end(), [](const DirtyVertexRange& a, const DirtyVertexRange& b) {
+            return a.poolVertex < b.poolVertex;
+        });
+
+        for (usize first = 0; first < impl->dirtyRanges.size();) {
+            const DirtyVertexRange& start = impl->dirtyRanges[first];
+            u32 end = start.poolVertex + start.vertexCount;
+
+            usize last = first;
+            while (last + 1 < impl->dirtyRanges.size() && impl->dirtyRanges[last + 1].poolVertex == end) {
+                ++last;
+                end += impl->dirtyRanges[last].vertexCount;
+            }
+
+            const Vertex* data = impl->rewriteScratch.data() + start.scratchVertex;
+            if (last > first) {
+                impl->uploadScratch.clear();
+                for (usize i = first; i <= last; ++i) {
+                    const DirtyVertexRange& range = impl->dirtyRanges[i];
+                    const Vertex* source = impl->rewriteScratch.data() + range.scratchVertex;
+                    impl->uploadScratch.insert(impl->uploadScratch.end(), source, source + range.vertexCount);
+                }
+                data = impl->uploadScratch.data();
+            }
+
+            u32 vertexCount = end - start.poolVertex;
+            WritePoolVertices(impl, data, vertexCount, start.poolVertex);
+            impl->stats.dynamicUploadCount++;
+            impl->stats.dynamicBytesUploaded += vertexCount * sizeof(Vertex);
+
+            first = last + 1;
+        }
+    }
+
+    // Frees pool space for the cluster by evicting resident clusters further away than it, furthest first
+    static bool ReserveClusterSpace(WorldStreamerImpl* impl, StreamedCluster& cluster) {
+        for (;;) {
+            u32 vertexOffset = 0;
+            u32 indexOffset = 0;
+            if (impl->vertexPool.Allocate(cluster.vertexCount, vertexOffset)) {
+                if (impl->indexPool.Allocate(cluster.indexCount, indexOffset)) {
+                    cluster.vertexOffset = vertexOffset;
+                    cluster.indexOffset = indexOffset;
+                    return true;
+                }
+                impl->vertexPool.Free(vertexOffset, cluster.vertexCount);
+            }
+
+            StreamedCluster* victim = nullptr;
+            for (u32 i = 0; i < impl->clusterCount; ++i) {
+                StreamedCluster& candidate = impl->clusters[i];
+                if (candidate.state != ClusterState::Resident || candidate.distance <= cluster.distance) continue;
+                if (!victim || candidate.distance > victim->distance) {
+                    victim = &candidate;
+                }
+            }
+
+            if (!victim) return false;
+            Evict(impl, *victim);
+        }
+    }
+
+    static bool BuildClusters(WorldStreamerImpl* impl, Hx::JobSystem* jobs, Hx::ArenaAllocator& arena) {
+        const MapData& map = *impl->map;
+        const WorldStreamingSettings& settings = impl->settings;
+        u32 sectorCount = static_cast<u32>(map.sectorCount);
+
+        impl->sectors = Hx::AllocArray<StreamedSector>(&arena.base, sectorCount, Hx::AllocFlags::ZeroInit);
+        impl->clusterSectors = Hx::AllocArray<u32>(&arena.base, sectorCount);
+        impl->movedFlags = Hx::AllocArray<u8>(&arena.base, sectorCount, Hx::AllocFlags::ZeroInit);
+        MapSector* loaderSectors = Hx::AllocArray<MapSector>(&arena.base, sectorCount);
+        if (sectorCount > 0 && (!impl->sectors || !impl->clusterSectors || !impl->movedFlags || !loaderSectors)) return false;
+
+        if (sectorCount > 0) {
+            memcpy(loaderSectors, map.sectors, sizeof(MapSector) * sectorCount);
+        }
+        impl->loaderMap = map;
+        impl->loaderMap.sectors = loaderSectors;
+
+        if (settings.isDynamicSector) {
+            u8* dynamicSectors = Hx::AllocArray<u8>(&arena.base, (sectorCount + 7) / 8, Hx::AllocFlags::ZeroInit);
+            if (sectorCount > 0 && !dynamicSectors) return false;
+
+            for (u32 s = 0; s < sectorCount; ++s) {
+                if (settings.isDynamicSector(map, s, settings.dynamicSectorUserData)) {
+                    dynamicSectors[s >> 3] |= static_cast<u8>(1u << (s & 7));
+                }
+            }
+            impl->settings.mesh.dynamicSectors = dynamicSectors;
+        }
+        impl->dynamicSectors = settings.mesh.dynamicSectors;
+
+        if (impl->dynamicSectors) {
+            for (u32 s = 0; s < sectorCount; ++s) {
+                impl->stats.dynamicSectorCount += (impl->dynamicSectors[s >> 3] >> (s & 7)) & 1;
+            }
+        }
+
+        auto sizeSectors = [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                WorldMeshSection section = BuildSectorGeometry(map, settings.mesh, static_cast<u32>(i), nullptr, nullptr);
+                impl->sectors[i].vertexCount = section.vertexCount;
+                impl->sectors[i].indexCount = section.indexCount;
+            }
+        };
+
+        if (jobs) {
+            jobs->ParallelFor(sectorCount, SectorSizeGrain, sizeSectors);
+        } else {
+            sizeSectors(0, sectorCount);
+        }
+
+        // Sector bounds from the corners of their subsectors
+        std::vector<f32> bounds(static_cast<usize>(sectorCount) * 4);
+        f32 mapMinX = 0.0f;
+        f32 mapMinY = 0.0f;
+        f32 mapMaxX = 0.0f;
+        f32 mapMaxY = 0.0f;
+        bool anyBounds = false;
+
+        for (u32 s = 0; s < sectorCount; ++s) {
+            const MapSector& sector = map.sectors[s];
+            f32* box = &bounds[s * 4];
+            bool found = false;
+
+            for (u32 g = 0; g < sector.groupCount; ++g) {
+                const MapSubsector& subsector = map.subsectors[sector.firstGroup + g];
+                for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                    const MapEdge& edge = map.edges[subsector.firstEdge + e];
+                    const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+                    const s32* point = edge.reversed ? seg.v2 : seg.v1;
+                    f32 x = static_cast<f32>(point[0]);
+                    f32 y = static_cast<f32>(point[1]);
+
+                    if (!found) {
+                        box[0] = box[2] = x;
+                        box[1] = box[3] = y;
+                        found = true;
+                    } else {
+                        box[0] = x < box[0] ? x : box[0];
+                        box[1] = y < box[1] ? y : box[1];
+                        box[2] = x > box[2] ? x : box[2];
+                        box[3] = y > box[3] ? y : box[3];
+                    }
+                }
+            }
+
+            if (!found) {
+                box[0] = box[1] = box[2] = box[3] = 0.0f;
+            }
+
+            if (!anyBounds) {
+                mapMinX = box[0];
+                mapMinY = box[1];
+                mapMaxX = box[2];
+                mapMaxY = box[3];
+                anyBounds = true;
+            } else {
+                mapMinX = box[0] < mapMinX ? box[0] : mapMinX;
+                mapMinY = box[1] < mapMinY ? box[1] : mapMinY;
+                mapMaxX = box[2] > mapMaxX ? box[2] : mapMaxX;
+                mapMaxY = box[3] > mapMaxY ? box[3] : mapMaxY;
+            }
+        }
+
+        // Bucket the sectors by the cell of their centre, keeping sector order within a cell
+        f32 clusterSize = settings.clusterSize > 1.0f ? settings.clusterSize : 1.0f;
+        u32 gridWidth = static_cast<u32>((mapMaxX - mapMinX) / clusterSize) + 1;
+        u32 gridHeight = static_cast<u32>((mapMaxY - mapMinY) / clusterSize) + 1;
+
+        std::vector<u32> sectorCells(sectorCount);
+        std::vector<u32> cellStart(static_cast<usize>(gridWidth) * gridHeight + 1, 0);
+        for (u32 s = 0; s < sectorCount; ++s) {
+            const f32* box = &bounds[s * 4];
+            u32 x = static_cast<u32>(((box[0] + box[2]) * 0.5f - mapMinX) / clusterSize);
+            u32 y = static_cast<u32>(((box[1] + box[3]) * 0.5f - mapMinY) / clusterSize);
+            x = x < gridWidth ? x : gridWidth - 1;
+            y = y < gridHeight ? y : gridHeight - 1;
+
+            sectorCells[s] = y * gridWidth + x;
+            ++cellStart[sectorCells[s] + 1];
+        }
+
+        u32 clusterCount = 0;
+        for (usize c = 0; c + 1 < cellStart.size(); ++c) {
+            clusterCount += cellStart[c + 1] > 0 ? 1 : 0;
+            cellStart[c + 1] += cellStart[c];
+        }
+
+        impl->clusterCount = clusterCount;
+        impl->clusters = Hx::AllocArray<StreamedCluster>(&arena.base, clusterCount, Hx::AllocFlags::ZeroInit);
+        if (clusterCount > 0 && !impl->clusters) return false;
+
+        // Clusters are numbered in cell order, cellClusters maps a cell to its cluster
+        std::vector<u32> cellClusters(cellStart.size() - 1);
+        u32 nextCluster = 0;
+        for (usize c = 0; c + 1 < cellStart.size(); ++c) {
+            if (cellStart[c + 1] == cellStart[c]) continue;
+
+            StreamedCluster& cluster = impl->clusters[nextCluster];
+            cluster.firstSector = cellStart[c];
+            cellClusters[c] = nextCluster++;
+        }
+
+        for (u32 s = 0; s < sectorCount; ++s) {
+            u32 clusterIndex = cellClusters[sectorCells[s]];
+            StreamedCluster& cluster = impl->clusters[clusterIndex];
+            StreamedSector& sector = impl->sectors[s];
+            const f32* box = &bounds[s * 4];
+
+            if (cluster.sectorCount == 0) {
+                cluster.minX = box[0];
+                cluster.minY = box[1];
+                cluster.maxX = box[2];
+                cluster.maxY = box[3];
+            } else {
+                cluster.minX = box[0] < cluster.minX ? box[0] : cluster.minX;
+                cluster.minY = box[1] < cluster.minY ? box[1] : cluster.minY;
+                cluster.maxX = box[2] > cluster.maxX ? box[2] : cluster.maxX;
+                cluster.maxY = box[3] > cluster.maxY ? box[3] : cluster.maxY;
+            }
+
+            sector.cluster = clusterIndex;
+            sector.firstVertex = cluster.vertexCount;
+            sector.firstIndex = cluster.indexCount;
+            cluster.vertexCount += sector.vertexCount;
+            cluster.indexCount += sector.indexCount;
+            impl->clusterSectors[cluster.firstSector + cluster.sectorCount++] = s;
+        }
+
+        return true;
+    }
+
+    WorldStreamer::WorldStreamer(const MapData& inMap, Hx::RenderSystem* inRenderSystem, Hx::JobSystem* jobs,
+                                 Hx::ArenaAllocator& arena, const WorldStreamingSettings& inSettings) {
+        Impl = new WorldStreamerImpl();
+        Impl->map = &inMap;
+        Impl->renderSystem = inRenderSystem;
+        Impl->settings = inSettings;
+
+        if (!BuildClusters(Impl, jobs, arena)) {
+            // TODO: Replace with engine logging system
+            printf("Out of memory building world clusters, nothing will be streamed\n");
+            Impl->clusterCount = 0;
+            Impl->sectors = nullptr;
+            Impl->movedFlags = nullptr;
+        }
+
+        usize totalVertices = 0;
+        usize totalIndices = 0;
+        for (u32 i = 0; i < Impl->clusterCount; ++i) {
+            totalVertices += Impl->clusters[i].vertexCount;
+            totalIndices += Impl->clusters[i].indexCount;
+        }
+
+        // Split the budget the way the map splits its geometry, and never reserve more than the whole map
+        usize totalBytes = totalVertices * sizeof(Vertex) + totalIndices * sizeof(u32);
+        usize vertexCapacity = totalVertices;
+        usize indexCapacity = totalIndices;
+        if (totalBytes > Impl->settings.memoryBudget) {
+            f64 vertexShare = static_cast<f64>(totalVertices * sizeof(Vertex)) / static_cast<f64>(totalBytes);
+            vertexCapacity = static_cast<usize>(Impl->settings.memoryBudget * vertexShare) / sizeof(Vertex);
+            indexCapacity = (Impl->settings.memoryBudget - vertexCapacity * sizeof(Vertex)) / sizeof(u32);
+        }
+
+        Impl->vertexPool.Init(static_cast<u32>(vertexCapacity));
+        Impl->indexPool.Init(static_cast<u32>(indexCapacity));
+
+        Impl->stats.clusterCount = Impl->clusterCount;
+        Impl->stats.memoryBudget = Impl->settings.memoryBudget;
+
+        Impl->loader = std::thread(LoaderMain, Impl);
+    }
+
+    WorldStreamer::~WorldStreamer() {
+        {
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->quit = true;
+        }
+        Impl->wake.notify_all();
+        Impl->loader.join();
+
+        CollectFinished(Impl);
+        for (const ClusterLoad& load : Impl->staged) {
+            free(load.vertices);
+        }
+
+        if (Impl->pool && Impl->renderSystem) {
+            Impl->renderSystem->DestroyMesh(Impl->pool);
+        }
+
+        delete Impl;
+    }
+
+    void WorldStreamer::Update(Vector2 position) {
+        const WorldStreamingSettings& settings = Impl->settings;
+        Impl->stats.bytesUploaded = 0;
+        Impl->stats.waitingClusterCount = 0;
+        Impl->lastPosition = position;
+        Impl->hasPosition = true;
+
+        if (!Impl->poolCreated) {
+            if (!Impl->renderSystem) {
+                Impl->memoryVertices.resize(Impl->vertexPool.capacity);
+                Impl->memoryIndices.resize(Impl->indexPool.capacity);
+            } else if (Impl->vertexPool.capacity > 0 && Impl->indexPool.capacity > 0) {
+                Impl->pool = Impl->renderSystem->CreateDynamicMesh(Impl->vertexPool.capacity, Impl->indexPool.capacity);
+            }
+            Impl->poolCreated = true;
+        }
+
+        CollectFinished(Impl);
+
+        // Before any request, so new clusters are built with the heights as they are now
+        SendMovedHeights(Impl);
+        UpdateRelayoutSectors(Impl);
+
+        Impl->candidates.clear();
+        for (u32 i = 0; i < Impl->clusterCount; ++i) {
+            StreamedCluster& cluster = Impl->clusters[i];
+            cluster.distance = GetDistanceToCluster(cluster, position);
+
+            switch (cluster.state) {
+                case ClusterState::Unloaded:
+                    if (cluster.distance <= settings.loadRadius) {
+                        Impl->candidates.push_back(i);
+                    }
+                    break;
+                case ClusterState::Loading:
+                    if (cluster.distance > settings.unloadRadius && !cluster.cancelled) {
+                        CancelLoad(Impl, i);
+                    } else if (cluster.distance <= settings.unloadRadius) {
+                        cluster.cancelled = false;
+                    }
+                    break;
+                case ClusterState::Resident:
+                    if (cluster.distance > settings.unloadRadius) {
+                        Evict(Impl, cluster);
+                    }
+                    break;
+                case ClusterState::TooLarge:
+                    break;
+            }
+        }
+
+        // Nearest first, so the pools fill from the camera outwards
+        std::sort(Impl->candidates.begin(), Impl->candidates.end(), [&](u32 a, u32 b) {
+            return Impl->clusters[a].distance < Impl->clusters[b].distance;
+        });
+
+        f64 now = Hx::GetTimeSeconds();
+        bool requested = false;
+        for (usize i = 0; i < Impl->candidates.size(); ++i) {
+            u32 clusterIndex = Impl->candidates[i];
+            if (Impl->pendingCount >= settings.maxPendingLoads) {
+                Impl->stats.waitingClusterCount = static_cast<u32>(Impl->candidates.size() - i);
+                break;
+            }
+
+            StreamedCluster& cluster = Impl->clusters[clusterIndex];
+            if (cluster.vertexCount > Impl->vertexPool.capacity || cluster.indexCount > Impl->indexPool.capacity) {
+                // TODO: Replace with engine logging system
+                printf("World cluster %u needs %zu bytes and does not fit the streaming budget\n", clusterIndex, GetClusterBytes(cluster));
+                cluster.state = ClusterState::TooLarge;
+                continue;
+            }
+
+            // Whatever is left is further away still, it waits for the camera to come closer
+            if (!ReserveClusterSpace(Impl, cluster)) break;
+
+            cluster.state = ClusterState::Loading;
+            cluster.cancelled = false;
+            cluster.requestTime = now;
+            Impl->pendingCount++;
+
+            std::lock_guard<std::mutex> lock(Impl->mutex);
+            Impl->requests.push_back(clusterIndex);
+            requested = true;
+        }
+
+        if (requested) {
+            Impl->wake.notify_one();
+        }
+
+        UploadStaged(Impl, settings.uploadBytesPerFrame);
+        UpdateMovedSectors(Impl);
+    }
+
+    void WorldStreamer::MarkSectorMoved(u32 sector) {
+        // Without clusters the per sector tables may never have been allocated
+        if (Impl->clusterCount == 0 || sector >= Impl->map->sectorCount || Impl->movedFlags[sector]) return;
+
+        bool dynamic = Impl->dynamicSectors && (Impl->dynamicSectors[sector >> 3] & (1u << (sector & 7)));
+        if (!dynamic) {
+            if (std::find(Impl->relayoutSectors.begin(), Impl->relayoutSectors.end(), sector) == Impl->relayoutSectors.end()) {
+                Impl->relayoutSectors.push_back(sector);
+            }
+            return;
+        }
+
+        Impl->movedFlags[sector] = 1;
+        Impl->movedSectors.push_back(sector);
+    }
+
+    void WorldStreamer::FinishPending() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(Impl->mutex);
+                Impl->idle.wait(lock, [this] { return Impl->requests.empty() && !Impl->busy; });
+            }
+
+            CollectFinished(Impl);
+            UploadStaged(Impl, ~usize(0));
+
+            // One Update requests at most maxPendingLoads clusters, so keep
+            // going until it stops holding any back
+            if (!Impl->hasPosition || Impl->stats.waitingClusterCount == 0) break;
+
+            Update(Impl->lastPosition);
+            if (Impl->pendingCount == 0) break;
+        }
+    }
+
+    bool WorldStreamer::GetSectorDraw(u32 sector, StreamedSectorDraw& outDraw) const {
+        if (Impl->clusterCount == 0 || sector >= Impl->map->sectorCount) return false;
+
+        const StreamedSector& streamedSector = Impl->sectors[sector];
+        const StreamedCluster& cluster = Impl->clusters[streamedSector.cluster];
+        if (cluster.state != ClusterState::Resident) return false;
+
+        outDraw.mesh = Impl->pool;
+        outDraw.firstIndex = cluster.indexOffset + streamedSector.firstIndex;
+        outDraw.indexCount = streamedSector.indexCount;
+        outDraw.baseVertex = static_cast<s32>(cluster.vertexOffset);
+        return true;
+    }
+
+    const Vertex* WorldStreamer::GetPoolVertices() const {
+        return Impl->renderSystem ? nullptr : Impl->memoryVertices.data();
+    }
+
+    const u32* WorldStreamer::GetPoolIndices() const {
+        return Impl->renderSystem ? nullptr : Impl->memoryIndices.data();
+    }
+
+    WorldStreamingStats WorldStreamer::GetStats() const {
+        WorldStreamingStats stats = Impl->stats;
+
+        stats.residentClusterCount = 0;
+        stats.bytesStaged = 0;
+        for (u32 i = 0; i < Impl->clusterCount; ++i) {
+            stats.residentClusterCount += Impl->clusters[i].state == ClusterState::Resident ? 1 : 0;
+        }
+        for (const ClusterLoad& load : Impl->staged) {
+            stats.bytesStaged += GetClusterBytes(Impl->clusters[load.cluster]);
+        }
+
+        stats.pendingClusterCount = Impl->pendingCount;
+        stats.bytesReserved = Impl->vertexPool.used * sizeof(Vertex) + Impl->indexPool.used * sizeof(u32);
+        return stats;
+    }
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/Memory/Allocator.h"
+#include "Engine/Renderer/RenderSystem.h"
+#include "Engine/World/Level/MapData.h"
+#include "Engine/World/Level/WorldMesh.h"
+
+namespace Hx {
+    struct ArenaAllocator;
+    class JobSystem;
+}
+
+namespace Hx {
+
+    struct WorldStreamingSettings {
+        WorldMeshSettings mesh;
+
+        // Sectors are grouped by the grid cell their centre falls in, in map units
+        f32 clusterSize = 2048.0f;
+        // Clusters closer than loadRadius are streamed in, those further than
+        // unloadRadius are dropped; in between they stay if they are resident
+        f32 loadRadius = 4096.0f;
+        f32 unloadRadius = 6144.0f;
+
+        // GPU geometry of every resident and loading cluster, vertices and indices together
+        usize memoryBudget = Hx::Megabytes(64);
+        // Caps the buffer updates of one frame; at least one cluster goes up per frame regardless
+        usize uploadBytesPerFrame = Hx::Megabytes(2);
+        // Clusters being built or waiting for upload, which bounds the CPU side copies
+        u32 maxPendingLoads = 8;
+
+        // Picks the sectors that may move, see WorldMeshSettings::dynamicSectors.
+        // Called once per sector on construction; when null mesh.dynamicSectors is used as is.
+        bool (*isDynamicSector)(const MapData& map, u32 sector, void* userData) = nullptr;
+        void* dynamicSectorUserData = nullptr;
+    };
+
+    struct WorldStreamingStats {
+        u32 clusterCount;
+        u32 residentClusterCount;
+        u32 pendingClusterCount;   // Requested but not drawable yet
+        u32 waitingClusterCount;   // In load range but held back by maxPendingLoads in the last Update
+        usize memoryBudget;
+        usize bytesResident;       // GPU geometry of the resident clusters
+        usize bytesReserved;       // Also counts the pool space held by pending clusters
+        usize bytesStaged;         // Built on the loader thread and waiting for upload
+        usize bytesUploaded;       // By the last Update
+        u64 loadCount;
+        u64 evictionCount;
+        u32 dynamicSectorCount;
+        // Moved sectors rewritten by the last Update, and the buffer updates they were coalesced into
+        u32 movedSectorCount;
+        u32 dynamicUploadCount;
+        usize dynamicBytesUploaded;
+        // Dropped by the last Update to stream back in with a moved static sector's new layout
+        u32 rebuiltClusterCount;
+        // From request to resident
+        f64 lastLatencySeconds;
+        f64 averageLatencySeconds;
+        f64 maxLatencySeconds;
+    };
+
+    // Where a resident sector's geometry sits in the shared pool mesh
+    struct StreamedSectorDraw {
+        MeshHandle mesh;
+        u32 firstIndex;
+        u32 indexCount;
+        s32 baseVertex;
+    };
+
+    // Streams the world mesh in around a point instead of building and
+    // uploading all of it up front. Sectors are grouped into clusters on a
+    // grid; a loader thread triangulates the clusters near the camera and the
+    // main thread copies them into one vertex and one index pool, suballocated
+    // per cluster and sized to the memory budget. Clusters that drift out of
+    // range, or are the furthest away when the pools run out, give their space
+    // back. Uploads are spread over frames so nothing stalls the render loop.
+    //
+    // Nothing is read from disk here: the map is loaded whole beforehand and
+    // what streams is the geometry built from it, which is several times its
+    // size and all of what goes to the GPU. The map must outlive the streamer.
+    // It may be constructed on any thread, everything after that runs on the
+    // render thread; the pools are created by the first Update. Without a
+    // render system the pools are kept in system memory, for tools and tests.
+    class WorldStreamer {
+    public:
+        // Sizes every sector up front, in parallel when a job system is given.
+        // Per sector and per cluster bookkeeping lives in the arena.
+        WorldStreamer(const MapData& inMap, Hx::RenderSystem* inRenderSystem, Hx::JobSystem* jobs,
+                      Hx::ArenaAllocator& arena, const WorldStreamingSettings& inSettings);
+        ~WorldStreamer();
+
+        WorldStreamer(const WorldStreamer&) = delete;
+        WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+        // Once per frame with the camera's map position: evicts, requests and uploads
+        void Update(Vector2 position);
+
+        // Call after changing a dynamic sector's floor or ceiling height. The
+        // next Update rewrites the sector's vertices and the walls its
+        // neighbours face it with, and uploads them as a few contiguous ranges;
+        // indices never change. Sectors in clusters that are not resident are
+        // built with the new heights when they stream in, and ones still loading
+        // are rewritten once resident in case the loader saw them mid move.
+        // The loader thread builds from its own copy of the heights, which
+        // Update brings up to date, so sectors may move while it works.
+        // Static sectors may move too, at a higher price: their walls come and
+        // go, so the clusters holding them and their neighbours are dropped and
+        // streamed back in.
+        void MarkSectorMoved(u32 sector);
+
+        // Blocks until every cluster in load range of the last Update position
+        // is resident, or as many as the memory budget holds, ignoring the
+        // pending and upload caps. For level loads, where a stall beats a
+        // frame of missing walls.
+        void FinishPending();
+
+        // False while the sector's cluster is not resident
+        bool GetSectorDraw(u32 sector, StreamedSectorDraw& outDraw) const;
+
+        // The pools as drawn from, null when they live on the GPU
+        const Vertex* GetPoolVertices() const;
+        const u32* GetPoolIndices() const;
+
+        WorldStreamingStats GetStats() const;
+
+    private:
+        struct WorldStreamerImpl* Impl;
+    };
+
+}
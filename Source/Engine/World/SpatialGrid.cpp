@@ -0,0 +1,459 @@
+#include "Engine/World/SpatialGrid.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize SpatialRebuildGrain = 4096;
+    constexpr usize SpatialCellGrain = 4096;
+    constexpr usize SpatialQueryGrain = 64;
+    constexpr usize SpatialPairGrain = 1024;
+
+    // Runs shorter than this are put back in item order by insertion sort
+    constexpr u32 SpatialInsertionSortLimit = 32;
+
+    struct SpatialQuery {
+        Vector2 min;  // The centre for a radius query
+        Vector2 max;
+        f32 radius;
+        bool box;
+    };
+
+    struct SpatialWork {
+        u32 scratch;
+        u32 first;
+        u32 count;
+    };
+
+    // Pairs found by one ParallelFor range, stitched together in range order afterwards
+    struct SpatialPairRun {
+        usize begin;
+        u32 scratch;
+        u32 first;
+        u32 count;
+    };
+
+    struct SpatialScratch {
+        std::vector<u32> items;
+        std::vector<SpatialPair> pairs;
+        u64 itemsTested = 0;
+    };
+
+    struct SpatialGridImpl {
+        Hx::JobSystem* jobs;
+        SpatialGridSettings settings;
+
+        bool hasBounds = false;
+        Vector2 boundsMin = {};
+        Vector2 boundsMax = {};
+
+        // Layout as of the last Rebuild. Cell (x, y) holds items[cellStart[c] .. cellStart[c + 1]], c = y * width + x.
+        f32 originX = 0.0f;
+        f32 originY = 0.0f;
+        f32 cellSize = 1.0f;
+        f32 inverseCellSize = 1.0f;
+        u32 width = 0;
+        u32 height = 0;
+        f32 maxRadius = 0.0f;
+
+        std::vector<u32> cellStart;
+        std::vector<std::atomic<u32>> cellCounts;
+        std::vector<u32> itemCells;  // By input index
+        std::vector<u32> itemSlots;  // Position within the cell, by input index
+        std::vector<SpatialGridItem> items;
+
+        std::vector<SpatialQuery> queries;
+        std::vector<SpatialWork> work;
+        std::vector<SpatialQueryResult> results;
+
+        std::vector<SpatialPairRun> pairRuns;
+        std::vector<SpatialPair> pairs;
+        std::mutex pairRunMutex;
+
+        std::vector<SpatialScratch*> scratches;
+        std::vector<u32> freeScratches;
+        std::mutex scratchMutex;
+
+        SpatialGridStats stats = {};
+    };
+
+    static u32 AcquireScratch(SpatialGridImpl* impl, SpatialScratch*& outScratch) {
+        std::lock_guard<std::mutex> lock(impl->scratchMutex);
+        if (impl->freeScratches.empty()) {
+            impl->freeScratches.push_back(static_cast<u32>(impl->scratches.size()));
+            impl->scratches.push_back(new SpatialScratch());
+        }
+
+        u32 index = impl->freeScratches.back();
+        impl->freeScratches.pop_back();
+        outScratch = impl->scratches[index];
+        return index;
+    }
+
+    static void ReleaseScratch(SpatialGridImpl* impl, u32 index) {
+        std::lock_guard<std::mutex> lock(impl->scratchMutex);
+        impl->freeScratches.push_back(index);
+    }
+
+    template <typename Fn>
+    static void RunParallel(SpatialGridImpl* impl, usize count, usize grain, Fn&& fn) {
+        if (impl->jobs) {
+            impl->jobs->ParallelFor(count, grain, fn);
+        } else if (count > 0) {
+            fn(static_cast<usize>(0), count);
+        }
+    }
+
+    static inline u32 GetCellX(const SpatialGridImpl* impl, f32 x) {
+        f32 cell = (x - impl->originX) * impl->inverseCellSize;
+        if (!(cell > 0.0f)) return 0;
+        return cell < static_cast<f32>(impl->width) ? static_cast<u32>(cell) : impl->width - 1;
+    }
+
+    static inline u32 GetCellY(const SpatialGridImpl* impl, f32 y) {
+        f32 cell = (y - impl->originY) * impl->inverseCellSize;
+        if (!(cell > 0.0f)) return 0;
+        return cell < static_cast<f32>(impl->height) ? static_cast<u32>(cell) : impl->height - 1;
+    }
+
+    static void LayOutCells(SpatialGridImpl* impl, const Vector2* positions, usize count) {
+        Vector2 min = impl->boundsMin;
+        Vector2 max = impl->boundsMax;
+
+        // Without bounds the grid covers this frame's items
+        if (!impl->hasBounds) {
+            min = count > 0 ? positions[0] : Vector2{};
+            max = min;
+            for (usize i = 1; i < count; ++i) {
+                min.x = positions[i].x < min.x ? positions[i].x : min.x;
+                min.y = positions[i].y < min.y ? positions[i].y : min.y;
+                max.x = positions[i].x > max.x ? positions[i].x : max.x;
+                max.y = positions[i].y > max.y ? positions[i].y : max.y;
+            }
+        }
+
+        f32 cellSize = impl->settings.cellSize > 0.0f ? impl->settings.cellSize : 128.0f;
+        u32 maxCells = impl->settings.maxCells > 0 ? impl->settings.maxCells : 1;
+        u32 width;
+        u32 height;
+        for (;;) {
+            width = static_cast<u32>((max.x - min.x) / cellSize) + 1;
+            height = static_cast<u32>((max.y - min.y) / cellSize) + 1;
+            if (static_cast<u64>(width) * height <= maxCells) break;
+            cellSize *= 2.0f;
+        }
+
+        impl->originX = min.x;
+        impl->originY = min.y;
+        impl->cellSize = cellSize;
+        impl->inverseCellSize = 1.0f / cellSize;
+        impl->width = width;
+        impl->height = height;
+
+        usize cellCount = static_cast<usize>(width) * height;
+        if (impl->cellCounts.size() != cellCount) {
+            std::vector<std::atomic<u32>>(cellCount).swap(impl->cellCounts);
+        }
+        impl->cellStart.resize(cellCount + 1);
+    }
+
+    SpatialGrid::SpatialGrid(Hx::JobSystem* inJobs, const SpatialGridSettings& inSettings)
+        : Impl(new SpatialGridImpl) {
+        Impl->jobs = inJobs;
+        Impl->settings = inSettings;
+    }
+
+    SpatialGrid::~SpatialGrid() {
+        for (SpatialScratch* scratch : Impl->scratches) {
+            delete scratch;
+        }
+        delete Impl;
+    }
+
+    void SpatialGrid::SetBounds(Vector2 min, Vector2 max) {
+        Impl->hasBounds = true;
+        Impl->boundsMin = min;
+        Impl->boundsMax = max;
+    }
+
+    void SpatialGrid::Rebuild(const Vector2* positions, const f32* radii, usize count) {
+        f64 startTime = Hx::GetTimeSeconds();
+        SpatialGridImpl* impl = Impl;
+
+        Clear();
+        impl->pairs.clear();
+        LayOutCells(impl, positions, count);
+
+        usize cellCount = impl->cellCounts.size();
+        impl->itemCells.resize(count);
+        impl->itemSlots.resize(count);
+        impl->items.resize(count);
+
+        RunParallel(impl, cellCount, SpatialCellGrain, [impl](usize begin, usize end) {
+            for (usize c = begin; c < end; ++c) {
+                impl->cellCounts[c].store(0, std::memory_order_relaxed);
+            }
+        });
+
+        // Count each cell, each item taking the next slot in its cell as it goes. Negative
+        // radii count as zero, so the largest radius can be found by comparing bit patterns.
+        std::atomic<u32> maxRadiusBits{ 0 };
+        RunParallel(impl, count, SpatialRebuildGrain, [&](usize begin, usize end) {
+            f32 maxRadius = 0.0f;
+            for (usize i = begin; i < end; ++i) {
+                u32 cell = GetCellY(impl, positions[i].y) * impl->width + GetCellX(impl, positions[i].x);
+                impl->itemCells[i] = cell;
+                impl->itemSlots[i] = impl->cellCounts[cell].fetch_add(1, std::memory_order_relaxed);
+
+                f32 radius = radii && radii[i] > 0.0f ? radii[i] : 0.0f;
+                maxRadius = radius > maxRadius ? radius : maxRadius;
+            }
+
+            u32 bits;
+            memcpy(&bits, &maxRadius, sizeof(bits));
+            u32 seen = maxRadiusBits.load(std::memory_order_relaxed);
+            while (bits > seen && !maxRadiusBits.compare_exchange_weak(seen, bits, std::memory_order_relaxed)) {
+            }
+        });
+
+        u32 maxRadiusBitsValue = maxRadiusBits.load();
+        memcpy(&impl->maxRadius, &maxRadiusBitsValue, sizeof(impl->maxRadius));
+
+        u32 offset = 0;
+        for (usize c = 0; c < cellCount; ++c) {
+            impl->cellStart[c] = offset;
+            offset += impl->cellCounts[c].load(std::memory_order_relaxed);
+        }
+        impl->cellStart[cellCount] = offset;
+
+        RunParallel(impl, count, SpatialRebuildGrain, [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                u32 slot = impl->cellStart[impl->itemCells[i]] + impl->itemSlots[i];
+                f32 radius = radii && radii[i] > 0.0f ? radii[i] : 0.0f;
+                impl->items[slot] = SpatialGridItem{ positions[i].x, positions[i].y, radius, static_cast<u32>(i) };
+            }
+        });
+
+        // Slots were handed out in whatever order the threads ran, so put each cell back in item order
+        if (impl->jobs && impl->jobs->GetThreadCount() > 1) {
+            RunParallel(impl, cellCount, SpatialCellGrain, [impl](usize begin, usize end) {
+                auto byItem = [](const SpatialGridItem& a, const SpatialGridItem& b) { return a.item < b.item; };
+                for (usize c = begin; c < end; ++c) {
+                    SpatialGridItem* first = impl->items.data() + impl->cellStart[c];
+                    u32 runLength = impl->cellStart[c + 1] - impl->cellStart[c];
+                    if (runLength > SpatialInsertionSortLimit) {
+                        std::sort(first, first + runLength, byItem);
+                        continue;
+                    }
+
+                    for (u32 i = 1; i < runLength; ++i) {
+                        SpatialGridItem item = first[i];
+                        u32 j = i;
+                        for (; j > 0 && first[j - 1].item > item.item; --j) {
+                            first[j] = first[j - 1];
+                        }
+                        first[j] = item;
+                    }
+                }
+            });
+        }
+
+        impl->stats.itemCount = static_cast<u32>(count);
+        impl->stats.cellCount = static_cast<u32>(cellCount);
+        impl->stats.cellSize = impl->cellSize;
+        impl->stats.maxRadius = impl->maxRadius;
+        impl->stats.rebuildSeconds = Hx::GetTimeSeconds() - startTime;
+    }
+
+    // Calls fn with every item whose cell overlaps the box, one contiguous run per row of cells
+    template <typename Fn>
+    static inline void VisitCells(const SpatialGridImpl* impl, f32 minX, f32 minY, f32 maxX, f32 maxY, Fn&& fn) {
+        u32 x0 = GetCellX(impl, minX);
+        u32 x1 = GetCellX(impl, maxX);
+        u32 y0 = GetCellY(impl, minY);
+        u32 y1 = GetCellY(impl, maxY);
+
+        for (u32 y = y0; y <= y1; ++y) {
+            u32 row = y * impl->width;
+            u32 end = impl->cellStart[row + x1 + 1];
+            for (u32 p = impl->cellStart[row + x0]; p < end; ++p) {
+                fn(impl->items[p]);
+            }
+        }
+    }
+
+    static void ExecuteRange(SpatialGridImpl* impl, usize begin, usize end) {
+        SpatialScratch* scratchPointer = nullptr;
+        u32 scratchIndex = AcquireScratch(impl, scratchPointer);
+        SpatialScratch& scratch = *scratchPointer;
+
+        for (usize i = begin; i < end; ++i) {
+            const SpatialQuery& query = impl->queries[i];
+            SpatialWork& work = impl->work[i];
+            work.scratch = scratchIndex;
+            work.first = static_cast<u32>(scratch.items.size());
+
+            // Items sit in the cell of their centre, so the search reaches out by the largest radius
+            f32 reach = query.radius + impl->maxRadius;
+            u64 tested = 0;
+            if (query.box) {
+                VisitCells(impl, query.min.x - reach, query.min.y - reach, query.max.x + reach, query.max.y + reach,
+                           [&](const SpatialGridItem& item) {
+                    f32 nearestX = item.x < query.min.x ? query.min.x : (item.x > query.max.x ? query.max.x : item.x);
+                    f32 nearestY = item.y < query.min.y ? query.min.y : (item.y > query.max.y ? query.max.y : item.y);
+                    f32 dx = item.x - nearestX;
+                    f32 dy = item.y - nearestY;
+                    if (dx * dx + dy * dy <= item.radius * item.radius) {
+                        scratch.items.push_back(item.item);
+                    }
+                    ++tested;
+                });
+            } else {
+                VisitCells(impl, query.min.x - reach, query.min.y - reach, query.min.x + reach, query.min.y + reach,
+                           [&](const SpatialGridItem& item) {
+                    f32 dx = item.x - query.min.x;
+                    f32 dy = item.y - query.min.y;
+                    f32 touching = query.radius + item.radius;
+                    if (dx * dx + dy * dy <= touching * touching) {
+                        scratch.items.push_back(item.item);
+                    }
+                    ++tested;
+                });
+            }
+
+            work.count = static_cast<u32>(scratch.items.size()) - work.first;
+            scratch.itemsTested += tested;
+        }
+
+        ReleaseScratch(impl, scratchIndex);
+    }
+
+    u32 SpatialGrid::SubmitRadius(Vector2 center, f32 radius) {
+        Impl->queries.push_back(SpatialQuery{ center, center, radius > 0.0f ? radius : 0.0f, false });
+        return static_cast<u32>(Impl->queries.size() - 1);
+    }
+
+    u32 SpatialGrid::SubmitBox(Vector2 min, Vector2 max) {
+        Impl->queries.push_back(SpatialQuery{ min, max, 0.0f, true });
+        return static_cast<u32>(Impl->queries.size() - 1);
+    }
+
+    void SpatialGrid::Execute() {
+        f64 startTime = Hx::GetTimeSeconds();
+        usize count = Impl->queries.size();
+        Impl->work.resize(count);
+        Impl->results.resize(count);
+        for (SpatialScratch* scratch : Impl->scratches) {
+            scratch->items.clear();
+            scratch->itemsTested = 0;
+        }
+
+        if (Impl->width > 0) {
+            RunParallel(Impl, count, SpatialQueryGrain, [this](usize begin, usize end) { ExecuteRange(Impl, begin, end); });
+        } else {
+            std::fill(Impl->work.begin(), Impl->work.end(), SpatialWork{});
+        }
+
+        // Scratch buffers stop growing once every range is done, so results can point straight into them
+        for (usize i = 0; i < count; ++i) {
+            const SpatialWork& work = Impl->work[i];
+            const u32* items = work.count > 0 ? Impl->scratches[work.scratch]->items.data() + work.first : nullptr;
+            Impl->results[i] = SpatialQueryResult{ items, work.count };
+        }
+
+        Impl->stats.queryCount = static_cast<u32>(count);
+        Impl->stats.itemsTested = 0;
+        for (const SpatialScratch* scratch : Impl->scratches) {
+            Impl->stats.itemsTested += scratch->itemsTested;
+        }
+        Impl->stats.executeSeconds = Hx::GetTimeSeconds() - startTime;
+    }
+
+    void SpatialGrid::Clear() {
+        Impl->queries.clear();
+        Impl->results.clear();
+    }
+
+    SpatialQueryResult SpatialGrid::GetResult(u32 ticket) const {
+        return Impl->results[ticket];
+    }
+
+    usize SpatialGrid::GetQueryCount() const {
+        return Impl->queries.size();
+    }
+
+    usize SpatialGrid::FindOverlappingPairs() {
+        SpatialGridImpl* impl = Impl;
+        impl->pairs.clear();
+        impl->pairRuns.clear();
+        for (SpatialScratch* scratch : impl->scratches) {
+            scratch->pairs.clear();
+        }
+
+        // Each item looks only forward in cell order: the rest of its own row
+        // of cells, then the rows above. Anything earlier finds it instead.
+        RunParallel(impl, impl->items.size(), SpatialPairGrain, [impl](usize begin, usize end) {
+            SpatialScratch* scratchPointer = nullptr;
+            u32 scratchIndex = AcquireScratch(impl, scratchPointer);
+            SpatialScratch& scratch = *scratchPointer;
+            SpatialPairRun run = { begin, scratchIndex, static_cast<u32>(scratch.pairs.size()), 0 };
+
+            for (usize p = begin; p < end; ++p) {
+                const SpatialGridItem& a = impl->items[p];
+                f32 reach = a.radius + impl->maxRadius;
+                u32 x0 = GetCellX(impl, a.x - reach);
+                u32 x1 = GetCellX(impl, a.x + reach);
+                u32 y0 = impl->itemCells[a.item] / impl->width;
+                u32 y1 = GetCellY(impl, a.y + reach);
+
+                for (u32 y = y0; y <= y1; ++y) {
+                    u32 row = y * impl->width;
+                    u32 first = y == y0 ? static_cast<u32>(p + 1) : impl->cellStart[row + x0];
+                    u32 last = impl->cellStart[row + x1 + 1];
+                    for (u32 q = first; q < last; ++q) {
+                        const SpatialGridItem& b = impl->items[q];
+                        f32 dx = b.x - a.x;
+                        f32 dy = b.y - a.y;
+                        f32 touching = a.radius + b.radius;
+                        if (dx * dx + dy * dy <= touching * touching) {
+                            scratch.pairs.push_back(a.item < b.item ? SpatialPair{ a.item, b.item } : SpatialPair{ b.item, a.item });
+                        }
+                    }
+                }
+            }
+
+            run.count = static_cast<u32>(scratch.pairs.size()) - run.first;
+            ReleaseScratch(impl, scratchIndex);
+
+            std::lock_guard<std::mutex> lock(impl->pairRunMutex);
+            impl->pairRuns.push_back(run);
+        });
+
+        std::sort(impl->pairRuns.begin(), impl->pairRuns.end(),
+                  [](const SpatialPairRun& a, const SpatialPairRun& b) { return a.begin < b.begin; });
+        for (const SpatialPairRun& run : impl->pairRuns) {
+            const SpatialPair* pairs = impl->scratches[run.scratch]->pairs.data() + run.first;
+            impl->pairs.insert(impl->pairs.end(), pairs, pairs + run.count);
+        }
+        return impl->pairs.size();
+    }
+
+    const SpatialPair* SpatialGrid::GetPairs() const {
+        return Impl->pairs.data();
+    }
+
+    const SpatialGridItem* SpatialGrid::GetItems() const {
+        return Impl->items.data();
+    }
+
+    const SpatialGridStats& SpatialGrid::GetStats() const {
+        return Impl->stats;
+    }
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+
+namespace Hx {
+    class JobSystem;
+}
+
+namespace Hx {
+
+    struct SpatialGridSettings {
+        f32 cellSize = 128.0f;
+        // Bounds too large for this many cells at cellSize get larger cells instead
+        u32 maxCells = 1u << 20;
+    };
+
+    // Items are the positions passed to Rebuild and are referred to by their
+    // index in that array, so gameplay can keep entity handles, or anything
+    // else, alongside in the same order.
+    struct SpatialGridItem {
+        f32 x;
+        f32 y;
+        f32 radius;
+        u32 item;
+    };
+
+    // Items of one query, valid until the next Execute, Clear or Rebuild
+    struct SpatialQueryResult {
+        const u32* items;
+        u32 count;
+    };
+
+    // Two items whose circles overlap, first < second
+    struct SpatialPair {
+        u32 first;
+        u32 second;
+    };
+
+    struct SpatialGridStats {
+        u32 itemCount;
+        u32 cellCount;
+        u32 queryCount;   // In the last Execute
+        u64 itemsTested;  // By the last Execute
+        f32 cellSize;
+        f32 maxRadius;
+        f64 rebuildSeconds;
+        f64 executeSeconds;
+    };
+
+    // Loose uniform grid over the map's bounds for "what is near here"
+    // queries between moving entities. Every item goes in the one cell its
+    // centre falls in, whatever its radius, and queries are grown by the
+    // largest radius instead, so a rebuild is a parallel counting sort with
+    // no per-item cell ranges. Items outside the bounds share the border cells.
+    //
+    // Rebuild once a frame after movement, then Submit queries and Execute
+    // them as one batch spread over the job system. Within a result items
+    // come in cell order, and by index within a cell, so results do not
+    // depend on the thread count.
+    class SpatialGrid {
+    public:
+        explicit SpatialGrid(Hx::JobSystem* inJobs, const SpatialGridSettings& inSettings = {});
+        ~SpatialGrid();
+
+        SpatialGrid(const SpatialGrid&) = delete;
+        SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+        // Usually the blockmap's extent. Takes effect at the next Rebuild.
+        void SetBounds(Vector2 min, Vector2 max);
+
+        // radii may be null for points. Clears any submitted queries.
+        void Rebuild(const Vector2* positions, const f32* radii, usize count);
+
+        // Items whose circle touches the query circle or box
+        u32 SubmitRadius(Vector2 center, f32 radius);
+        u32 SubmitBox(Vector2 min, Vector2 max);
+        void Execute();
+        void Clear();
+
+        SpatialQueryResult GetResult(u32 ticket) const;
+        usize GetQueryCount() const;
+
+        // Every pair of items whose circles overlap, in parallel. Returns the pair count.
+        usize FindOverlappingPairs();
+        const SpatialPair* GetPairs() const;
+
+        // Items sorted by cell, the same storage queries read
+        const SpatialGridItem* GetItems() const;
+        const SpatialGridStats& GetStats() const;
+
+    private:
+        struct SpatialGridImpl* Impl;
+    };
+
+}
@@ -0,0 +1,334 @@
+#include "Engine/World/Transform.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/ResourceTable.h"
+
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <xmmintrin.h>
+    #define HX_TRANSFORM_SSE 1
+#endif
+
+namespace Hx {
+
+    constexpr u32 TransformNoParent = 0xFFFFFFFFu;
+    constexpr u32 TransformDepthUnknown = 0xFFFFFFFFu;
+
+    // Dirty flags. New nodes have no older matrix to blend from.
+    constexpr u8 TransformDirty = 1;
+    constexpr u8 TransformDirtyNew = 2;
+
+    struct TransformHierarchyImpl {
+        // Each handle's record is its node's current slot
+        ResourceTable<TransformTag, u32> slots;
+
+        // One entry per node. Parents come before their children whenever
+        // orderDirty is clear, and parentSlots is only current then.
+        std::vector<TransformHandle> handles;
+        std::vector<TransformHandle> parents;
+        std::vector<u32> parentSlots;
+        std::vector<LocalTransform> locals;
+        std::vector<Matrix4> worlds;
+        // As of the Update before the last, only current where moved is set;
+        // everywhere else it equals worlds
+        std::vector<Matrix4> previousWorlds;
+        std::vector<u8> moved;
+        std::vector<u8> dirty;
+        bool orderDirty = false;
+
+        // Scratch for Update
+        std::vector<u32> depths;
+        std::vector<u32> order;
+        std::vector<u32> depthStart;
+        std::vector<u32> walk;
+        std::vector<u32> dirtySlots;
+
+        TransformStats stats = {};
+    };
+
+    static const Matrix4 IdentityMatrix = Matrix4::Identity();
+
+    static inline u32 FindSlot(const TransformHierarchyImpl* impl, TransformHandle transform) {
+        const u32* slot = impl->slots.TryGet(transform);
+        return slot ? *slot : TransformNoParent;
+    }
+
+    static inline void MultiplyInto(const Matrix4& a, const Matrix4& b, Matrix4& out) {
+#if HX_TRANSFORM_SSE
+        __m128 column0 = _mm_loadu_ps(a.m);
+        __m128 column1 = _mm_loadu_ps(a.m + 4);
+        __m128 column2 = _mm_loadu_ps(a.m + 8);
+        __m128 column3 = _mm_loadu_ps(a.m + 12);
+
+        // Each result column is a's columns weighted by one column of b
+        for (u32 column = 0; column < 4; ++column) {
+            const f32* weights = b.m + column * 4;
+            __m128 result = _mm_mul_ps(column0, _mm_set1_ps(weights[0]));
+            result = _mm_add_ps(result, _mm_mul_ps(column1, _mm_set1_ps(weights[1])));
+            result = _mm_add_ps(result, _mm_mul_ps(column2, _mm_set1_ps(weights[2])));
+            result = _mm_add_ps(result, _mm_mul_ps(column3, _mm_set1_ps(weights[3])));
+            _mm_storeu_ps(out.m + column * 4, result);
+        }
+#else
+        out = Multiply(a, b);
+#endif
+    }
+
+    // Sorts the nodes by depth, keeping their relative order within a level
+    static void RebuildOrder(TransformHierarchyImpl* impl) {
+        usize count = impl->handles.size();
+
+        impl->parentSlots.resize(count);
+        for (usize i = 0; i < count; ++i) {
+            u32 parent = FindSlot(impl, impl->parents[i]);
+            if (parent == TransformNoParent && impl->parents[i]) {
+                // The parent was destroyed, the node is a root from now on
+                impl->parents[i] = TransformHandle{};
+                impl->dirty[i] = impl->dirty[i] ? impl->dirty[i] : TransformDirty;
+            }
+            impl->parentSlots[i] = parent;
+        }
+
+        u32 maxDepth = 0;
+        impl->depths.assign(count, TransformDepthUnknown);
+        for (usize i = 0; i < count; ++i) {
+            // Climb to the first ancestor with a known depth, then number the way back down
+            u32 node = static_cast<u32>(i);
+            impl->walk.clear();
+            while (node != TransformNoParent && impl->depths[node] == TransformDepthUnknown) {
+                impl->walk.push_back(node);
+                node = impl->parentSlots[node];
+            }
+
+            u32 depth = node == TransformNoParent ? 0 : impl->depths[node] + 1;
+            for (usize w = impl->walk.size(); w-- > 0;) {
+                impl->depths[impl->walk[w]] = depth++;
+            }
+            maxDepth = depth > maxDepth ? depth : maxDepth;
+        }
+
+        impl->depthStart.assign(maxDepth + 1, 0);
+        for (usize i = 0; i < count; ++i) {
+            ++impl->depthStart[impl->depths[i] + 1];
+        }
+        for (u32 d = 0; d < maxDepth; ++d) {
+            impl->depthStart[d + 1] += impl->depthStart[d];
+        }
+
+        // order[new slot] = old slot, and depths is reused to map old slots to new ones
+        impl->order.resize(count);
+        for (usize i = 0; i < count; ++i) {
+            u32 slot = impl->depthStart[impl->depths[i]]++;
+            impl->order[slot] = static_cast<u32>(i);
+            impl->depths[i] = slot;
+        }
+
+        auto permute = [&](auto& values) {
+            std::remove_reference_t<decltype(values)> sorted(count);
+            for (usize i = 0; i < count; ++i) {
+                sorted[i] = values[impl->order[i]];
+            }
+            values.swap(sorted);
+        };
+
+        permute(impl->handles);
+        permute(impl->parents);
+        permute(impl->locals);
+        permute(impl->worlds);
+        permute(impl->previousWorlds);
+        permute(impl->moved);
+        permute(impl->dirty);
+
+        std::vector<u32> parentSlots(count);
+        for (usize i = 0; i < count; ++i) {
+            u32 oldParent = impl->parentSlots[impl->order[i]];
+            parentSlots[i] = oldParent == TransformNoParent ? TransformNoParent : impl->depths[oldParent];
+            *impl->slots.TryGet(impl->handles[i]) = static_cast<u32>(i);
+        }
+        impl->parentSlots.swap(parentSlots);
+
+        impl->orderDirty = false;
+        impl->stats.reorderCount++;
+    }
+
+    TransformHierarchy::TransformHierarchy()
+        : Impl(new TransformHierarchyImpl) {
+    }
+
+    TransformHierarchy::~TransformHierarchy() {
+        delete Impl;
+    }
+
+    TransformHandle TransformHierarchy::Create(const LocalTransform& local, TransformHandle parent) {
+        u32 slot = static_cast<u32>(Impl->handles.size());
+        u32 parentSlot = FindSlot(Impl, parent);
+
+        TransformHandle transform = Impl->slots.Create([&](u32& record) { record = slot; });
+
+        // Appending keeps parents ahead of their children, so the order stays valid
+        Impl->handles.push_back(transform);
+        Impl->parents.push_back(parentSlot == TransformNoParent ? TransformHandle{} : parent);
+        Impl->parentSlots.push_back(parentSlot);
+        Impl->locals.push_back(local);
+        Impl->worlds.push_back(IdentityMatrix);
+        Impl->previousWorlds.push_back(IdentityMatrix);
+        Impl->moved.push_back(0);
+        Impl->dirty.push_back(TransformDirtyNew);
+        return transform;
+    }
+
+    void TransformHierarchy::Destroy(TransformHandle transform) {
+        u32 slot = FindSlot(Impl, transform);
+        if (slot == TransformNoParent) return;
+
+        Impl->slots.Destroy(transform, [](u32&) {});
+
+        // Swap the last node into the hole; it may now sit ahead of its parent
+        u32 last = static_cast<u32>(Impl->handles.size() - 1);
+        if (slot != last) {
+            Impl->handles[slot] = Impl->handles[last];
+            Impl->parents[slot] = Impl->parents[last];
+            Impl->locals[slot] = Impl->locals[last];
+            Impl->worlds[slot] = Impl->worlds[last];
+            Impl->previousWorlds[slot] = Impl->previousWorlds[last];
+            Impl->moved[slot] = Impl->moved[last];
+            Impl->dirty[slot] = Impl->dirty[last];
+            *Impl->slots.TryGet(Impl->handles[slot]) = slot;
+        }
+
+        Impl->handles.pop_back();
+        Impl->parents.pop_back();
+        Impl->parentSlots.pop_back();
+        Impl->locals.pop_back();
+        Impl->worlds.pop_back();
+        Impl->previousWorlds.pop_back();
+        Impl->moved.pop_back();
+        Impl->dirty.pop_back();
+        Impl->orderDirty = true;
+    }
+
+    bool TransformHierarchy::IsValid(TransformHandle transform) const {
+        return Impl->slots.IsValid(transform);
+    }
+
+    void TransformHierarchy::SetLocal(TransformHandle transform, const LocalTransform& local) {
+        u32 slot = FindSlot(Impl, transform);
+        if (slot == TransformNoParent) return;
+
+        Impl->locals[slot] = local;
+        Impl->dirty[slot] = Impl->dirty[slot] ? Impl->dirty[slot] : TransformDirty;
+    }
+
+    const LocalTransform* TransformHierarchy::GetLocal(TransformHandle transform) const {
+        u32 slot = FindSlot(Impl, transform);
+        return slot == TransformNoParent ? nullptr : &Impl->locals[slot];
+    }
+
+    bool TransformHierarchy::SetParent(TransformHandle transform, TransformHandle parent) {
+        u32 slot = FindSlot(Impl, transform);
+        if (slot == TransformNoParent) return false;
+
+        // Walking up from the new parent must not reach the node itself
+        for (u32 ancestor = FindSlot(Impl, parent); ancestor != TransformNoParent;
+             ancestor = FindSlot(Impl, Impl->parents[ancestor])) {
+            if (ancestor == slot) return false;
+        }
+
+        Impl->parents[slot] = IsValid(parent) ? parent : TransformHandle{};
+        Impl->dirty[slot] = Impl->dirty[slot] ? Impl->dirty[slot] : TransformDirty;
+        Impl->orderDirty = true;
+        return true;
+    }
+
+    TransformHandle TransformHierarchy::GetParent(TransformHandle transform) const {
+        u32 slot = FindSlot(Impl, transform);
+        if (slot == TransformNoParent) return TransformHandle{};
+
+        TransformHandle parent = Impl->parents[slot];
+        return IsValid(parent) ? parent : TransformHandle{};
+    }
+
+    const Matrix4& TransformHierarchy::GetWorldMatrix(TransformHandle transform) const {
+        u32 slot = FindSlot(Impl, transform);
+        return slot == TransformNoParent ? IdentityMatrix : Impl->worlds[slot];
+    }
+
+    Matrix4 TransformHierarchy::GetInterpolatedWorldMatrix(TransformHandle transform, f32 alpha) const {
+        u32 slot = FindSlot(Impl, transform);
+        if (slot == TransformNoParent) return IdentityMatrix;
+        if (!Impl->moved[slot]) return Impl->worlds[slot];
+
+        const Matrix4& from = Impl->previousWorlds[slot];
+        const Matrix4& to = Impl->worlds[slot];
+        Matrix4 result;
+        for (u32 i = 0; i < 16; ++i) {
+            result.m[i] = from.m[i] + (to.m[i] - from.m[i]) * alpha;
+        }
+        return result;
+    }
+
+    void TransformHierarchy::Update() {
+        f64 start = Hx::GetTimeSeconds();
+
+        if (Impl->orderDirty) {
+            RebuildOrder(Impl);
+        }
+
+        // Parents come first, so a dirty flag has reached a node's parent before the node is visited
+        usize count = Impl->handles.size();
+        u32 rootCount = 0;
+        Impl->dirtySlots.clear();
+        for (usize i = 0; i < count; ++i) {
+            u32 parent = Impl->parentSlots[i];
+            if (parent != TransformNoParent && Impl->dirty[parent]) {
+                Impl->dirty[i] = Impl->dirty[i] ? Impl->dirty[i] : TransformDirty;
+            } else if (Impl->dirty[i]) {
+                ++rootCount;
+            }
+
+            // What this Update replaces becomes the matrix to blend from, and
+            // nodes that moved last time but not now catch up
+            if (Impl->dirty[i] || Impl->moved[i]) {
+                Impl->previousWorlds[i] = Impl->worlds[i];
+            }
+            Impl->moved[i] = Impl->dirty[i] ? 1 : 0;
+
+            if (Impl->dirty[i]) {
+                Impl->dirtySlots.push_back(static_cast<u32>(i));
+            }
+        }
+
+        for (u32 slot : Impl->dirtySlots) {
+            const LocalTransform& local = Impl->locals[slot];
+            Matrix4 localMatrix = ComposeTransform(local.position, local.rotation, local.scale);
+
+            u32 parent = Impl->parentSlots[slot];
+            if (parent == TransformNoParent) {
+                Impl->worlds[slot] = localMatrix;
+            } else {
+                MultiplyInto(Impl->worlds[parent], localMatrix, Impl->worlds[slot]);
+            }
+
+            // Appears where it was created instead of sliding in from the origin
+            if (Impl->dirty[slot] == TransformDirtyNew) {
+                Impl->previousWorlds[slot] = Impl->worlds[slot];
+                Impl->moved[slot] = 0;
+            }
+        }
+
+        for (u32 slot : Impl->dirtySlots) {
+            Impl->dirty[slot] = 0;
+        }
+
+        Impl->stats.transformCount = static_cast<u32>(count);
+        Impl->stats.updatedCount = static_cast<u32>(Impl->dirtySlots.size());
+        Impl->stats.dirtyRootCount = rootCount;
+        Impl->stats.updateSeconds = Hx::GetTimeSeconds() - start;
+    }
+
+    const TransformStats& TransformHierarchy::GetStats() const {
+        return Impl->stats;
+    }
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Engine/Core/Handle.h"
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+
+namespace Hx {
+
+    struct TransformTag {};
+
+    using TransformHandle = Handle<TransformTag>;
+
+    struct LocalTransform {
+        Vector3 position;
+        Quaternion rotation = Quaternion::Identity();
+        Vector3 scale = Vector3(1.0f);
+    };
+
+    struct TransformStats {
+        u32 transformCount;
+        u32 updatedCount;   // World matrices recomputed by the last Update
+        u32 dirtyRootCount; // Changed subtrees those matrices came from
+        u32 reorderCount;   // Updates that had to rebuild the breadth first order
+        f64 updateSeconds;
+    };
+
+    // Parent/child transforms with lazily computed world matrices. Nodes are
+    // kept in breadth first order, so parents always come before their
+    // children and one forward pass over the arrays pushes changes down each
+    // subtree. Only nodes whose local transform, or an ancestor's, changed
+    // since the last Update are recomputed.
+    //
+    // Creating, destroying and reparenting only mark the order stale; Update
+    // rebuilds it before its pass. Not thread safe.
+    //
+    // Each Update keeps the matrices it replaced, so a renderer running ahead
+    // of a fixed simulation step can draw between the last two steps.
+    class TransformHierarchy {
+    public:
+        TransformHierarchy();
+        ~TransformHierarchy();
+
+        TransformHierarchy(const TransformHierarchy&) = delete;
+        TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+        TransformHandle Create(const LocalTransform& local, TransformHandle parent = {});
+        // The node's children become roots
+        void Destroy(TransformHandle transform);
+        bool IsValid(TransformHandle transform) const;
+
+        void SetLocal(TransformHandle transform, const LocalTransform& local);
+        const LocalTransform* GetLocal(TransformHandle transform) const;
+
+        // Fails when parent is the node itself or one of its descendants. An invalid parent makes the node a root.
+        bool SetParent(TransformHandle transform, TransformHandle parent);
+        TransformHandle GetParent(TransformHandle transform) const;
+
+        // As of the last Update; identity for invalid handles
+        const Matrix4& GetWorldMatrix(TransformHandle transform) const;
+        // Between the world matrix before the last Update and the one after it,
+        // alpha 0 being the older. Blended per element, which is exact for
+        // translation and scale and close enough for the turn of one step.
+        // Nodes created by the last Update do not blend.
+        Matrix4 GetInterpolatedWorldMatrix(TransformHandle transform, f32 alpha) const;
+
+        // Recomputes the world matrices of everything that changed, once per
+        // simulation step when drawing interpolated, otherwise once per frame
+        void Update();
+
+        const TransformStats& GetStats() const;
+
+    private:
+        struct TransformHierarchyImpl* Impl;
+    };
+
+}
@@ -0,0 +1,633 @@
+#include "Engine/World/World.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Hx {
+
+    // Entity records are allocated in pages so existing records never move
+    constexpr u32 EntityPageShift = 14;
+    constexpr u32 EntityPageSize = 1u << EntityPageShift;
+    constexpr u32 MaxEntityPages = 1024;
+
+    constexpr u32 ArchetypeNone = 0xFFFFFFFFu;
+    constexpr usize ChunkAlignment = 64;
+    constexpr u32 ColumnAlignment = 16;
+
+    // Describes the world section of a snapshot; everything in it is an offset
+    // from the start of the section
+    struct WorldSnapshotSection {
+        u32 componentTypeCount;
+        u32 archetypeCount;
+        u32 recordCount;
+        u32 firstFree;
+        u64 entityCount;
+        u64 chunkCount;
+        u64 recordOffset;
+        u64 chunkOffset; // A multiple of DirectIOAlignment
+        u64 size;
+    };
+
+    struct WorldSnapshotArchetype {
+        ComponentMask mask;
+        u64 entityCount;
+        u32 chunkCount;
+        u32 capacity; // Differs when a component's layout changed since the save
+    };
+
+    static ComponentInfo ComponentInfos[MaxComponentTypes];
+    static std::atomic<u32> ComponentTypeCount{ 0 };
+
+    ComponentId RegisterComponentType(u32 size, u32 alignment) {
+        u32 id = ComponentTypeCount.fetch_add(1);
+        if (id >= MaxComponentTypes) {
+            // Masks hold one bit per type, so another type cannot be told apart
+            // from the ones before it. Handing out a shared id would let two
+            // components overwrite each other, so stop here in every build.
+            // TODO: Replace with engine logging system
+            printf("World: more than %u component types registered\n", MaxComponentTypes);
+            fflush(stdout);
+            abort();
+        }
+
+        ComponentInfos[id] = ComponentInfo{ size, alignment };
+        return id;
+    }
+
+    const ComponentInfo& GetComponentInfo(ComponentId id) {
+        return ComponentInfos[id];
+    }
+
+    // A dead record's row links to the next free index
+    struct EntityRecord {
+        u32 archetype;
+        u32 chunk;
+        u32 row;
+        u32 generation;
+    };
+
+    struct ArchetypeChunk {
+        u8* data;
+        u32 count;
+    };
+
+    struct Archetype {
+        ComponentMask mask;
+        u32 capacity;
+        u32 componentCount;
+        ComponentId components[MaxComponentTypes];
+        u32 columnOffsets[MaxComponentTypes];
+
+        // Archetype reached by adding or removing each component, filled in as they are used
+        u32 addEdges[MaxComponentTypes];
+        u32 removeEdges[MaxComponentTypes];
+
+        std::vector<ArchetypeChunk> chunks;
+        usize entityCount = 0;
+    };
+
+    struct WorldImpl {
+        Hx::ArenaAllocator* arena;
+
+        EntityRecord* pages[MaxEntityPages] = {};
+        u32 pageCount = 0;
+        u32 recordCount = 1; // Index 0 is never handed out
+        u32 firstFree = 0;   // 0 when no record is free
+        usize entityCount = 0;
+
+        std::vector<Archetype*> archetypes;
+        std::vector<u8*> freeChunks;
+        usize chunkCount = 0;
+        usize bytesReserved = 0;
+
+        TransformHierarchy transforms;
+    };
+
+    static inline EntityRecord& GetRecord(WorldImpl* impl, u32 index) {
+        return impl->pages[index >> EntityPageShift][index & (EntityPageSize - 1)];
+    }
+
+    static inline EntityHandle* GetChunkEntities(const ArchetypeChunk& chunk) {
+        return reinterpret_cast<EntityHandle*>(chunk.data);
+    }
+
+    static EntityRecord* FindRecord(WorldImpl* impl, EntityHandle entity) {
+        if (entity.Index == 0 || entity.Index >= impl->recordCount) return nullptr;
+        EntityRecord& record = GetRecord(impl, entity.Index);
+        if (record.generation != entity.Gen || record.archetype == ArchetypeNone) return nullptr;
+        return &record;
+    }
+
+    static u32 FindOrCreateArchetype(WorldImpl* impl, ComponentMask mask) {
+        for (usize i = 0; i < impl->archetypes.size(); ++i) {
+            if (impl->archetypes[i]->mask == mask) return static_cast<u32>(i);
+        }
+
+        Archetype* archetype = new Archetype;
+        archetype->mask = mask;
+        archetype->componentCount = 0;
+
+        // Lay out as many rows as fit, allowing for each column's alignment padding
+        usize rowSize = sizeof(EntityHandle);
+        usize padding = ColumnAlignment;
+        for (u32 id = 0; id < MaxComponentTypes; ++id) {
+            archetype->columnOffsets[id] = ArchetypeNoColumn;
+            archetype->addEdges[id] = ArchetypeNone;
+            archetype->removeEdges[id] = ArchetypeNone;
+
+            if (mask & (ComponentMask(1) << id)) {
+                const ComponentInfo& info = ComponentInfos[id];
+                archetype->components[archetype->componentCount++] = id;
+                rowSize += info.size;
+                padding += info.alignment > ColumnAlignment ? info.alignment : ColumnAlignment;
+            }
+        }
+
+        archetype->capacity = static_cast<u32>((WorldChunkSize - padding) / rowSize);
+        assert(archetype->capacity > 0 && "Components too large for one chunk");
+
+        usize offset = sizeof(EntityHandle) * archetype->capacity;
+        for (u32 c = 0; c < archetype->componentCount; ++c) {
+            ComponentId id = archetype->components[c];
+            const ComponentInfo& info = ComponentInfos[id];
+            usize alignment = info.alignment > ColumnAlignment ? info.alignment : ColumnAlignment;
+
+            offset = (offset + alignment - 1) & ~(alignment - 1);
+            archetype->columnOffsets[id] = static_cast<u32>(offset);
+            offset += static_cast<usize>(info.size) * archetype->capacity;
+        }
+
+        impl->archetypes.push_back(archetype);
+        return static_cast<u32>(impl->archetypes.size() - 1);
+    }
+
+    static u8* AcquireChunk(WorldImpl* impl) {
+        if (!impl->freeChunks.empty()) {
+            u8* data = impl->freeChunks.back();
+            impl->freeChunks.pop_back();
+            return data;
+        }
+
+        u8* data = static_cast<u8*>(Hx::Alloc(&impl->arena->base, WorldChunkSize, ChunkAlignment));
+        if (data) {
+            impl->chunkCount++;
+            impl->bytesReserved += WorldChunkSize;
+        }
+        return data;
+    }
+
+    // Appends a zeroed row to the archetype's last chunk, starting a new chunk when it is full
+    static bool AllocateRow(WorldImpl* impl, Archetype& archetype, u32& outChunk, u32& outRow) {
+        if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+            u8* data = AcquireChunk(impl);
+            if (!data) return false;
+            archetype.chunks.push_back(ArchetypeChunk{ data, 0 });
+        }
+
+        ArchetypeChunk& chunk = archetype.chunks.back();
+        outChunk = static_cast<u32>(archetype.chunks.size() - 1);
+        outRow = chunk.count++;
+        archetype.entityCount++;
+
+        for (u32 c = 0; c < archetype.componentCount; ++c) {
+            ComponentId id = archetype.components[c];
+            u32 size = ComponentInfos[id].size;
+            memset(chunk.data + archetype.columnOffsets[id] + static_cast<usize>(size) * outRow, 0, size);
+        }
+        return true;
+    }
+
+    // Fills the hole with the archetype's last row so chunks stay packed
+    static void RemoveRow(WorldImpl* impl, Archetype& archetype, u32 chunkIndex, u32 row) {
+        ArchetypeChunk& last = archetype.chunks.back();
+        u32 lastChunkIndex = static_cast<u32>(archetype.chunks.size() - 1);
+        u32 lastRow = last.count - 1;
+
+        if (chunkIndex != lastChunkIndex || row != lastRow) {
+            ArchetypeChunk& chunk = archetype.chunks[chunkIndex];
+            EntityHandle moved = GetChunkEntities(last)[lastRow];
+            GetChunkEntities(chunk)[row] = moved;
+
+            for (u32 c = 0; c < archetype.componentCount; ++c) {
+                ComponentId id = archetype.components[c];
+                usize size = ComponentInfos[id].size;
+                u32 offset = archetype.columnOffsets[id];
+                memcpy(chunk.data + offset + size * row, last.data + offset + size * lastRow, size);
+            }
+
+            EntityRecord& record = GetRecord(impl, moved.Index);
+            record.chunk = chunkIndex;
+            record.row = row;
+        }
+
+        last.count--;
+        archetype.entityCount--;
+        if (last.count == 0) {
+            impl->freeChunks.push_back(last.data);
+            archetype.chunks.pop_back();
+        }
+    }
+
+    static u32 AllocateRecord(WorldImpl* impl) {
+        if (impl->firstFree != 0) {
+            u32 index = impl->firstFree;
+            impl->firstFree = GetRecord(impl, index).row;
+            return index;
+        }
+
+        u32 index = impl->recordCount;
+        u32 page = index >> EntityPageShift;
+        if (page >= impl->pageCount) {
+            if (page >= MaxEntityPages) return 0;
+
+            EntityRecord* records = Hx::AllocArray<EntityRecord>(&impl->arena->base, EntityPageSize, Hx::AllocFlags::ZeroInit);
+            if (!records) return 0;
+
+            impl->pages[impl->pageCount++] = records;
+            impl->bytesReserved += sizeof(EntityRecord) * EntityPageSize;
+        }
+
+        impl->recordCount++;
+        return index;
+    }
+
+    static void FreeRecord(WorldImpl* impl, u32 index) {
+        EntityRecord& record = GetRecord(impl, index);
+        record.archetype = ArchetypeNone;
+        record.generation++;
+        record.row = impl->firstFree;
+        impl->firstFree = index;
+    }
+
+    // Moves an entity's row to another archetype, keeping the components both share
+    static bool MoveEntity(WorldImpl* impl, EntityHandle entity, EntityRecord& record, u32 targetIndex) {
+        Archetype& source = *impl->archetypes[record.archetype];
+        Archetype& target = *impl->archetypes[targetIndex];
+
+        u32 chunkIndex;
+        u32 row;
+        if (!AllocateRow(impl, target, chunkIndex, row)) return false;
+
+        ArchetypeChunk& from = source.chunks[record.chunk];
+        ArchetypeChunk& to = target.chunks[chunkIndex];
+        GetChunkEntities(to)[row] = entity;
+
+        for (u32 c = 0; c < target.componentCount; ++c) {
+            ComponentId id = target.components[c];
+            if (source.columnOffsets[id] == ArchetypeNoColumn) continue;
+
+            usize size = ComponentInfos[id].size;
+            memcpy(to.data + target.columnOffsets[id] + size * row, from.data + source.columnOffsets[id] + size * record.row, size);
+        }
+
+        RemoveRow(impl, source, record.chunk, record.row);
+
+        record.archetype = targetIndex;
+        record.chunk = chunkIndex;
+        record.row = row;
+        return true;
+    }
+
+    World::World(Hx::ArenaAllocator& inArena)
+        : Impl(new WorldImpl) {
+        Impl->arena = &inArena;
+    }
+
+    World::~World() {
+        for (Archetype* archetype : Impl->archetypes) {
+            delete archetype;
+        }
+        delete Impl;
+    }
+
+    EntityHandle World::CreateEntity(ComponentMask mask) {
+        EntityHandle entity = {};
+        CreateEntities(mask, 1, &entity);
+        return entity;
+    }
+
+    usize World::CreateEntities(ComponentMask mask, usize count, EntityHandle* outEntities) {
+        u32 archetypeIndex = FindOrCreateArchetype(Impl, mask);
+        Archetype& archetype = *Impl->archetypes[archetypeIndex];
+
+        for (usize i = 0; i < count; ++i) {
+            u32 index = AllocateRecord(Impl);
+            u32 chunkIndex;
+            u32 row;
+            if (index == 0) return i;
+            if (!AllocateRow(Impl, archetype, chunkIndex, row)) {
+                FreeRecord(Impl, index);
+                return i;
+            }
+
+            EntityRecord& record = GetRecord(Impl, index);
+            record.archetype = archetypeIndex;
+            record.chunk = chunkIndex;
+            record.row = row;
+
+            EntityHandle entity = { index, record.generation };
+            GetChunkEntities(archetype.chunks[chunkIndex])[row] = entity;
+            Impl->entityCount++;
+
+            if (outEntities) {
+                outEntities[i] = entity;
+            }
+        }
+
+        return count;
+    }
+
+    void World::DestroyEntity(EntityHandle entity) {
+        EntityRecord* record = FindRecord(Impl, entity);
+        if (!record) return;
+
+        RemoveRow(Impl, *Impl->archetypes[record->archetype], record->chunk, record->row);
+        FreeRecord(Impl, entity.Index);
+        Impl->entityCount--;
+    }
+
+    bool World::IsAlive(EntityHandle entity) const {
+        return FindRecord(Impl, entity) != nullptr;
+    }
+
+    ComponentMask World::GetComponentMask(EntityHandle entity) const {
+        EntityRecord* record = FindRecord(Impl, entity);
+        return record ? Impl->archetypes[record->archetype]->mask : 0;
+    }
+
+    void* World::GetComponent(EntityHandle entity, ComponentId id) {
+        EntityRecord* record = FindRecord(Impl, entity);
+        if (!record) return nullptr;
+
+        const Archetype& archetype = *Impl->archetypes[record->archetype];
+        u32 offset = archetype.columnOffsets[id];
+        if (offset == ArchetypeNoColumn) return nullptr;
+
+        return archetype.chunks[record->chunk].data + offset + static_cast<usize>(ComponentInfos[id].size) * record->row;
+    }
+
+    void* World::AddComponent(EntityHandle entity, ComponentId id) {
+        EntityRecord* record = FindRecord(Impl, entity);
+        if (!record) return nullptr;
+
+        Archetype& archetype = *Impl->archetypes[record->archetype];
+        if (archetype.columnOffsets[id] == ArchetypeNoColumn) {
+            if (archetype.addEdges[id] == ArchetypeNone) {
+                archetype.addEdges[id] = FindOrCreateArchetype(Impl, archetype.mask | (ComponentMask(1) << id));
+            }
+
+            if (!MoveEntity(Impl, entity, *record, archetype.addEdges[id])) {
+                return nullptr;
+            }
+        }
+
+        return GetComponent(entity, id);
+    }
+
+    void World::RemoveComponent(EntityHandle entity, ComponentId id) {
+        EntityRecord* record = FindRecord(Impl, entity);
+        if (!record) return;
+
+        Archetype& archetype = *Impl->archetypes[record->archetype];
+        if (archetype.columnOffsets[id] == ArchetypeNoColumn) return;
+
+        if (archetype.removeEdges[id] == ArchetypeNone) {
+            archetype.removeEdges[id] = FindOrCreateArchetype(Impl, archetype.mask & ~(ComponentMask(1) << id));
+        }
+
+        MoveEntity(Impl, entity, *record, archetype.removeEdges[id]);
+    }
+
+    void World::GatherChunks(const WorldQuery& query, std::vector<ChunkView>& outChunks) const {
+        for (const Archetype* archetype : Impl->archetypes) {
+            if ((archetype->mask & query.include) != query.include || (archetype->mask & query.exclude) != 0) continue;
+
+            for (const ArchetypeChunk& chunk : archetype->chunks) {
+                outChunks.push_back(ChunkView{ chunk.data, chunk.count, archetype->columnOffsets });
+            }
+        }
+    }
+
+    void World::VisitChunks(const WorldQuery& query, void (*fn)(const ChunkView& chunk, void* userData), void* userData) const {
+        for (const Archetype* archetype : Impl->archetypes) {
+            if ((archetype->mask & query.include) != query.include || (archetype->mask & query.exclude) != 0) continue;
+
+            for (const ArchetypeChunk& chunk : archetype->chunks) {
+                fn(ChunkView{ chunk.data, chunk.count, archetype->columnOffsets }, userData);
+            }
+        }
+    }
+
+    usize World::GetEntityCount() const {
+        return Impl->entityCount;
+    }
+
+    WorldStats World::GetStats() const {
+        WorldStats stats;
+        stats.entityCount = Impl->entityCount;
+        stats.archetypeCount = Impl->archetypes.size();
+        stats.chunkCount = Impl->chunkCount;
+        stats.freeChunkCount = Impl->freeChunks.size();
+        stats.bytesReserved = Impl->bytesReserved;
+        return stats;
+    }
+
+    TransformHierarchy& World::GetTransforms() {
+        return Impl->transforms;
+    }
+
+    static WorldSnapshotSection GetSnapshotLayout(const WorldImpl* impl) {
+        WorldSnapshotSection section = {};
+        u32 typeCount = ComponentTypeCount.load();
+        section.componentTypeCount = typeCount < MaxComponentTypes ? typeCount : MaxComponentTypes;
+        section.archetypeCount = static_cast<u32>(impl->archetypes.size());
+        section.recordCount = impl->recordCount;
+        section.firstFree = impl->firstFree;
+        section.entityCount = impl->entityCount;
+
+        for (const Archetype* archetype : impl->archetypes) {
+            section.chunkCount += archetype->chunks.size();
+        }
+
+        section.recordOffset = sizeof(WorldSnapshotSection) + sizeof(ComponentInfo) * section.componentTypeCount +
+                               sizeof(WorldSnapshotArchetype) * section.archetypeCount;
+        section.chunkOffset = AlignDirectSize(section.recordOffset + sizeof(EntityRecord) * section.recordCount);
+        section.size = section.chunkOffset + WorldChunkSize * section.chunkCount;
+        return section;
+    }
+
+    // Hands every chunk back to the free list and forgets every entity, keeping the record pages
+    static void ClearWorld(WorldImpl* impl) {
+        for (Archetype* archetype : impl->archetypes) {
+            for (const ArchetypeChunk& chunk : archetype->chunks) {
+                impl->freeChunks.push_back(chunk.data);
+            }
+            delete archetype;
+        }
+
+        impl->archetypes.clear();
+        impl->recordCount = 1;
+        impl->firstFree = 0;
+        impl->entityCount = 0;
+    }
+
+    usize World::GetSnapshotSize() const {
+        return static_cast<usize>(GetSnapshotLayout(Impl).size);
+    }
+
+    void World::WriteSnapshot(u8* dst) const {
+        WorldSnapshotSection section = GetSnapshotLayout(Impl);
+        memcpy(dst, &section, sizeof(section));
+
+        u8* cursor = dst + sizeof(section);
+        memcpy(cursor, ComponentInfos, sizeof(ComponentInfo) * section.componentTypeCount);
+        cursor += sizeof(ComponentInfo) * section.componentTypeCount;
+
+        for (const Archetype* archetype : Impl->archetypes) {
+            WorldSnapshotArchetype entry = {};
+            entry.mask = archetype->mask;
+            entry.entityCount = archetype->entityCount;
+            entry.chunkCount = static_cast<u32>(archetype->chunks.size());
+            entry.capacity = archetype->capacity;
+            memcpy(cursor, &entry, sizeof(entry));
+            cursor += sizeof(entry);
+        }
+
+        // Records hold only indices, so pages go out as they are
+        for (u32 first = 0; first < section.recordCount; first += EntityPageSize) {
+            u32 count = section.recordCount - first < EntityPageSize ? section.recordCount - first : EntityPageSize;
+            memcpy(cursor, Impl->pages[first >> EntityPageShift], sizeof(EntityRecord) * count);
+            cursor += sizeof(EntityRecord) * count;
+        }
+        memset(cursor, 0, static_cast<usize>(dst + section.chunkOffset - cursor));
+
+        // As do chunks: column offsets come from the archetype's mask, not from the chunk
+        cursor = dst + section.chunkOffset;
+        for (const Archetype* archetype : Impl->archetypes) {
+            for (const ArchetypeChunk& chunk : archetype->chunks) {
+                memcpy(cursor, chunk.data, WorldChunkSize);
+                cursor += WorldChunkSize;
+            }
+        }
+    }
+
+    bool World::ReadSnapshot(Hx::FileHandle& file, usize offset, usize size) {
+        WorldSnapshotSection section;
+        if (size < sizeof(section) || !file.ReadAt(&section, sizeof(section), offset)) return false;
+
+        bool valid = section.size == size && section.componentTypeCount <= MaxComponentTypes &&
+                     section.recordCount >= 1 && section.recordCount <= MaxEntityPages * EntityPageSize &&
+                     section.recordOffset == sizeof(section) + sizeof(ComponentInfo) * section.componentTypeCount +
+                                             sizeof(WorldSnapshotArchetype) * section.archetypeCount &&
+                     section.chunkOffset == AlignDirectSize(section.recordOffset + sizeof(EntityRecord) * section.recordCount) &&
+                     section.chunkOffset + WorldChunkSize * section.chunkCount == section.size;
+        if (!valid) return false;
+
+        std::vector<u8> tables(section.recordOffset - sizeof(section));
+        if (!file.ReadAt(tables.data(), tables.size(), offset + sizeof(section))) return false;
+
+        const ComponentInfo* savedInfos = reinterpret_cast<const ComponentInfo*>(tables.data());
+        std::vector<WorldSnapshotArchetype> savedArchetypes(section.archetypeCount);
+        memcpy(savedArchetypes.data(), savedInfos + section.componentTypeCount, sizeof(WorldSnapshotArchetype) * section.archetypeCount);
+
+        // Ids are handed out in the order a module first uses each type, so
+        // every type the snapshot stores must already be registered here
+        // under the same id, with the same size and alignment
+        u32 registeredCount = ComponentTypeCount.load();
+        ComponentMask used = 0;
+        u64 chunkTotal = 0;
+        for (const WorldSnapshotArchetype& archetype : savedArchetypes) {
+            used |= archetype.mask;
+            chunkTotal += archetype.chunkCount;
+        }
+
+        for (u32 id = 0; id < MaxComponentTypes; ++id) {
+            if (!(used & (ComponentMask(1) << id))) continue;
+            if (id >= section.componentTypeCount || id >= registeredCount) return false;
+            if (savedInfos[id].size != ComponentInfos[id].size || savedInfos[id].alignment != ComponentInfos[id].alignment) return false;
+        }
+        if (chunkTotal != section.chunkCount) return false;
+
+        ClearWorld(Impl);
+
+        // Build the archetypes in their saved order, since records refer to them by index
+        std::vector<FileReadRange> ranges;
+        usize recordPages = (section.recordCount + EntityPageSize - 1) >> EntityPageShift;
+        ranges.reserve(recordPages + section.chunkCount);
+
+        bool complete = true;
+        for (const WorldSnapshotArchetype& saved : savedArchetypes) {
+            u32 index = FindOrCreateArchetype(Impl, saved.mask);
+            Archetype& archetype = *Impl->archetypes[index];
+
+            u64 capacity = archetype.capacity;
+            bool fits = index == Impl->archetypes.size() - 1 && archetype.capacity == saved.capacity &&
+                        saved.entityCount <= capacity * saved.chunkCount &&
+                        saved.entityCount + capacity > capacity * saved.chunkCount;
+            if (!fits) {
+                complete = false;
+                break;
+            }
+
+            archetype.chunks.reserve(saved.chunkCount);
+            for (u32 c = 0; c < saved.chunkCount; ++c) {
+                u8* data = AcquireChunk(Impl);
+                if (!data) {
+                    complete = false;
+                    break;
+                }
+
+                u32 count = c + 1 < saved.chunkCount ? archetype.capacity : static_cast<u32>(saved.entityCount - capacity * c);
+                archetype.chunks.push_back(ArchetypeChunk{ data, count });
+            }
+            archetype.entityCount = saved.entityCount;
+        }
+
+        while (complete && Impl->pageCount < recordPages) {
+            EntityRecord* records = Hx::AllocArray<EntityRecord>(&Impl->arena->base, EntityPageSize, Hx::AllocFlags::ZeroInit);
+            if (!records) {
+                complete = false;
+                break;
+            }
+
+            Impl->pages[Impl->pageCount++] = records;
+            Impl->bytesReserved += sizeof(EntityRecord) * EntityPageSize;
+        }
+
+        if (complete) {
+            // Sorted by file offset, so records and runs of consecutively allocated chunks each become one read
+            usize recordStart = offset + section.recordOffset;
+            for (u32 first = 0; first < section.recordCount; first += EntityPageSize) {
+                u32 count = section.recordCount - first < EntityPageSize ? section.recordCount - first : EntityPageSize;
+                ranges.push_back(FileReadRange{ recordStart + sizeof(EntityRecord) * first, sizeof(EntityRecord) * count,
+                                                Impl->pages[first >> EntityPageShift] });
+            }
+
+            usize chunkStart = offset + section.chunkOffset;
+            for (const Archetype* archetype : Impl->archetypes) {
+                for (const ArchetypeChunk& chunk : archetype->chunks) {
+                    ranges.push_back(FileReadRange{ chunkStart, WorldChunkSize, chunk.data });
+                    chunkStart += WorldChunkSize;
+                }
+            }
+
+            complete = file.ReadV(ranges.data(), ranges.size());
+        }
+
+        if (!complete) {
+            ClearWorld(Impl);
+            return false;
+        }
+
+        Impl->recordCount = section.recordCount;
+        Impl->firstFree = section.firstFree;
+        Impl->entityCount = static_cast<usize>(section.entityCount);
+        return true;
+    }
+
+}
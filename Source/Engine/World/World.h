@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Engine/Core/Handle.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Core/Types.h"
+#include "Engine/World/Transform.h"
+
+#include <type_traits>
+#include <vector>
+
+namespace Hx {
+    struct ArenaAllocator;
+    class FileHandle;
+}
+
+namespace Hx {
+
+    struct EntityTag {};
+
+    using EntityHandle = Handle<EntityTag>;
+
+    using ComponentId = u32;
+    using ComponentMask = u64;
+
+    constexpr u32 MaxComponentTypes = 64;
+    constexpr usize WorldChunkSize = 16 * 1024;
+
+    struct ComponentInfo {
+        u32 size;
+        u32 alignment;
+    };
+
+    // Component types are numbered on first use, so ids are only meaningful
+    // within one run of one module. Components are plain data: they are
+    // zero-initialised on creation and moved between chunks with memcpy.
+    // Registering more than MaxComponentTypes aborts.
+    ComponentId RegisterComponentType(u32 size, u32 alignment);
+    const ComponentInfo& GetComponentInfo(ComponentId id);
+
+    template <typename T>
+    ComponentId GetComponentId() {
+        static_assert(std::is_trivially_copyable_v<T>, "Components are moved with memcpy");
+        static const ComponentId id = RegisterComponentType(static_cast<u32>(sizeof(T)), static_cast<u32>(alignof(T)));
+        return id;
+    }
+
+    template <typename... Ts>
+    ComponentMask MakeComponentMask() {
+        return (ComponentMask(0) | ... | (ComponentMask(1) << GetComponentId<Ts>()));
+    }
+
+    constexpr u32 ArchetypeNoColumn = 0xFFFFFFFFu;
+
+    // A run of entities that share an archetype: their handles followed by one
+    // column per component. Column offsets are indexed by component id.
+    struct ChunkView {
+        u8* data;
+        u32 count;
+        const u32* columnOffsets;
+
+        EntityHandle* GetEntities() const {
+            return reinterpret_cast<EntityHandle*>(data);
+        }
+
+        // nullptr when the archetype does not have the component
+        template <typename T>
+        T* Get() const {
+            u32 offset = columnOffsets[GetComponentId<T>()];
+            return offset == ArchetypeNoColumn ? nullptr : reinterpret_cast<T*>(data + offset);
+        }
+    };
+
+    // Matches archetypes with every component in include and none in exclude
+    struct WorldQuery {
+        ComponentMask include;
+        ComponentMask exclude;
+    };
+
+    template <typename... Ts>
+    WorldQuery MakeQuery(ComponentMask exclude = 0) {
+        return WorldQuery{ MakeComponentMask<Ts...>(), exclude };
+    }
+
+    struct WorldStats {
+        usize entityCount;
+        usize archetypeCount;
+        usize chunkCount;
+        usize freeChunkCount;
+        usize bytesReserved; // Chunks and entity records taken from the arena
+    };
+
+    // Archetype based entity storage. Entities with the same set of components
+    // live together in fixed size chunks, one column per component, and every
+    // chunk but an archetype's last is full, so queries stream through memory.
+    // Destroying an entity moves the archetype's last entity into its place.
+    //
+    // Chunks and entity records are carved from the arena, which must outlive
+    // the world; empty chunks are kept for reuse rather than given back.
+    // Nothing here is thread safe, and entities must not be created, destroyed
+    // or change components while a query runs.
+    class World {
+    public:
+        explicit World(Hx::ArenaAllocator& inArena);
+        ~World();
+
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+
+        // New components are zeroed. Returns an invalid handle when the arena is full.
+        EntityHandle CreateEntity(ComponentMask mask);
+        // outEntities may be null. Returns how many were created.
+        usize CreateEntities(ComponentMask mask, usize count, EntityHandle* outEntities);
+        void DestroyEntity(EntityHandle entity);
+        bool IsAlive(EntityHandle entity) const;
+
+        ComponentMask GetComponentMask(EntityHandle entity) const;
+        // nullptr when the entity is dead or does not have the component
+        void* GetComponent(EntityHandle entity, ComponentId id);
+        // Returns the component, zeroed if the entity did not have it before
+        void* AddComponent(EntityHandle entity, ComponentId id);
+        void RemoveComponent(EntityHandle entity, ComponentId id);
+
+        // Appends every non-empty chunk the query matches
+        void GatherChunks(const WorldQuery& query, std::vector<ChunkView>& outChunks) const;
+        // Calls fn for the same chunks in the same order, without collecting them first
+        void VisitChunks(const WorldQuery& query, void (*fn)(const ChunkView& chunk, void* userData), void* userData) const;
+
+        usize GetEntityCount() const;
+        WorldStats GetStats() const;
+
+        // Entities that need a place in the scene keep a TransformHandle component
+        TransformHierarchy& GetTransforms();
+
+        // The world's part of a snapshot, see WorldSnapshot.h. It is a flat
+        // image of the archetype table, entity records and chunks, with the
+        // chunks starting on a DirectIOAlignment boundary of the section.
+        usize GetSnapshotSize() const;
+        // dst must hold GetSnapshotSize() bytes
+        void WriteSnapshot(u8* dst) const;
+        // Replaces every entity with the section at offset in the file. Fails
+        // without touching the world when the section does not match this
+        // module's component types; a read error part way leaves it empty.
+        bool ReadSnapshot(Hx::FileHandle& file, usize offset, usize size);
+
+        template <typename... Ts>
+        EntityHandle Create(const Ts&... components);
+
+        template <typename T>
+        T* Get(EntityHandle entity) {
+            return static_cast<T*>(GetComponent(entity, GetComponentId<T>()));
+        }
+
+        template <typename T>
+        T* Add(EntityHandle entity, const T& value);
+
+        template <typename T>
+        void Remove(EntityHandle entity) {
+            RemoveComponent(entity, GetComponentId<T>());
+        }
+
+        // fn(const ChunkView&) for every matching chunk. Allocates nothing, so
+        // Each can run every tick without touching the heap.
+        template <typename Fn>
+        void ForEachChunk(const WorldQuery& query, Fn&& fn);
+
+        // fn(Ts&...) for every entity that has all of Ts
+        template <typename... Ts, typename Fn>
+        void Each(Fn&& fn);
+
+        // Same as Each, with the matching chunks split over the job system.
+        // The chunks are gathered into a vector first to be split.
+        template <typename... Ts, typename Fn>
+        void ParallelEach(Hx::JobSystem& jobs, Fn&& fn);
+
+    private:
+        struct WorldImpl* Impl;
+    };
+
+    template <typename Fn, typename... Ts>
+    inline void RunChunkRows(u32 count, Fn& fn, Ts*... columns) {
+        for (u32 row = 0; row < count; ++row) {
+            fn(columns[row]...);
+        }
+    }
+
+    template <typename... Ts>
+    EntityHandle World::Create(const Ts&... components) {
+        EntityHandle entity = CreateEntity(MakeComponentMask<Ts...>());
+        if (entity) {
+            ((*static_cast<Ts*>(GetComponent(entity, GetComponentId<Ts>())) = components), ...);
+        }
+        return entity;
+    }
+
+    template <typename T>
+    T* World::Add(EntityHandle entity, const T& value) {
+        T* component = static_cast<T*>(AddComponent(entity, GetComponentId<T>()));
+        if (component) {
+            *component = value;
+        }
+        return component;
+    }
+
+    template <typename Fn>
+    void World::ForEachChunk(const WorldQuery& query, Fn&& fn) {
+        using FnType = std::remove_reference_t<Fn>;
+        VisitChunks(query, [](const ChunkView& chunk, void* userData) {
+            (*static_cast<FnType*>(userData))(chunk);
+        }, const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    template <typename... Ts, typename Fn>
+    void World::Each(Fn&& fn) {
+        ForEachChunk(MakeQuery<Ts...>(), [&](const ChunkView& chunk) {
+            RunChunkRows(chunk.count, fn, chunk.Get<Ts>()...);
+        });
+    }
+
+    template <typename... Ts, typename Fn>
+    void World::ParallelEach(Hx::JobSystem& jobs, Fn&& fn) {
+        std::vector<ChunkView> chunks;
+        GatherChunks(MakeQuery<Ts...>(), chunks);
+
+        jobs.ParallelFor(chunks.size(), 1, [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                RunChunkRows(chunks[i].count, fn, chunks[i].Get<Ts>()...);
+            }
+        });
+    }
+
+}
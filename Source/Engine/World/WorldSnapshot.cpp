@@ -0,0 +1,104 @@
+#include "Engine/World/WorldSnapshot.h"
+#include "Engine/IO/AsyncFileWriter.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/World/Level/MapData.h"
+#include "Engine/World/Level/WorldStreaming.h"
+#include "Engine/World/World.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace Hx {
+
+    bool SaveWorldSnapshot(const char* filename, const World& world, const MapData* map, Hx::AsyncFileWriter& writer) {
+        WorldSnapshotHeader header = {};
+        memcpy(header.identifier, WorldSnapshotIdentifier, sizeof(header.identifier));
+        header.version = WorldSnapshotVersion;
+        header.sectorCount = map ? static_cast<u32>(map->sectorCount) : 0;
+        header.sectorOffset = sizeof(WorldSnapshotHeader);
+        header.worldOffset = AlignDirectSize(header.sectorOffset + sizeof(s32) * 2 * header.sectorCount);
+        header.worldSize = world.GetSnapshotSize();
+
+        usize size = static_cast<usize>(header.worldOffset + header.worldSize);
+        u8* data = static_cast<u8*>(malloc(size));
+        if (!data) {
+            // TODO: Replace with engine logging system
+            printf("WorldSnapshot: failed to allocate %zu bytes for %s\n", size, filename);
+            return false;
+        }
+
+        memcpy(data, &header, sizeof(header));
+
+        s32* heights = reinterpret_cast<s32*>(data + header.sectorOffset);
+        for (u32 i = 0; i < header.sectorCount; ++i) {
+            heights[i * 2 + 0] = map->sectors[i].floorHeight;
+            heights[i * 2 + 1] = map->sectors[i].ceilingHeight;
+        }
+
+        u8* sectorEnd = data + header.sectorOffset + sizeof(s32) * 2 * header.sectorCount;
+        memset(sectorEnd, 0, static_cast<usize>(data + header.worldOffset - sectorEnd));
+        world.WriteSnapshot(data + header.worldOffset);
+
+        AsyncWriteDesc desc = {};
+        desc.filename = filename;
+        desc.data = data;
+        desc.size = size;
+        desc.mode = AsyncWriteMode::AtomicReplace;
+        writer.Write(desc);
+        return true;
+    }
+
+    bool LoadWorldSnapshot(const char* filename, World& world, MapData* map, Hx::FileSystem& fileSystem,
+                           Hx::WorldStreamer* streamer) {
+        Hx::FileHandle* file = fileSystem.OpenFileRead(filename, Hx::FileAccessHint::Sequential);
+        if (!file) {
+            return false;
+        }
+
+        WorldSnapshotHeader header;
+        bool valid = file->ReadAt(&header, sizeof(header), 0) &&
+                     memcmp(header.identifier, WorldSnapshotIdentifier, sizeof(header.identifier)) == 0 &&
+                     header.version == WorldSnapshotVersion && header.sectorOffset == sizeof(WorldSnapshotHeader) &&
+                     header.worldOffset == AlignDirectSize(header.sectorOffset + sizeof(s32) * 2 * header.sectorCount) &&
+                     header.worldOffset + header.worldSize == file->GetSize();
+
+        // Heights from another map would land on the wrong sectors
+        if (valid && map && header.sectorCount != map->sectorCount) {
+            // TODO: Replace with engine logging system
+            printf("WorldSnapshot: %s was saved on a map with %u sectors, this one has %zu\n", filename, header.sectorCount, map->sectorCount);
+            valid = false;
+        }
+
+        std::vector<s32> heights;
+        if (valid && map && header.sectorCount > 0) {
+            heights.resize(static_cast<usize>(header.sectorCount) * 2);
+            valid = file->ReadAt(heights.data(), sizeof(s32) * heights.size(), header.sectorOffset);
+        }
+
+        if (valid) {
+            valid = world.ReadSnapshot(*file, static_cast<usize>(header.worldOffset), static_cast<usize>(header.worldSize));
+        }
+        fileSystem.CloseFile(file);
+
+        if (!valid) {
+            // TODO: Replace with engine logging system
+            printf("WorldSnapshot: failed to load %s\n", filename);
+            return false;
+        }
+
+        for (usize i = 0; i < heights.size() / 2; ++i) {
+            MapSector& sector = map->sectors[i];
+            if (sector.floorHeight == heights[i * 2 + 0] && sector.ceilingHeight == heights[i * 2 + 1]) continue;
+
+            sector.floorHeight = heights[i * 2 + 0];
+            sector.ceilingHeight = heights[i * 2 + 1];
+            if (streamer) {
+                streamer->MarkSectorMoved(static_cast<u32>(i));
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+
+namespace Hx {
+    class AsyncFileWriter;
+    class FileSystem;
+    class World;
+    class WorldStreamer;
+    struct MapData;
+}
+
+namespace Hx {
+
+    constexpr char WorldSnapshotIdentifier[4] = { 'H', 'W', 'S', 'N' };
+    constexpr u32 WorldSnapshotVersion = 1;
+
+    // The header is followed by each sector's floor and ceiling height, then
+    // the world's section on a DirectIOAlignment boundary. Nothing in the file
+    // is a pointer, so loading is a few reads straight into place.
+    struct WorldSnapshotHeader {
+        char identifier[4];
+        u32 version;
+        u32 sectorCount; // Zero when saved without a map
+        u32 sectorOffset;
+        u64 worldOffset;
+        u64 worldSize;
+    };
+
+    // Copies the world and the map's sector heights into one buffer on the
+    // calling thread and queues it on the writer, which frees it once it is
+    // on disk. The file is replaced atomically, so a save that never finishes
+    // leaves the previous snapshot. map may be null.
+    //
+    // Component ids are numbered per module, so a snapshot is only readable by
+    // the module that wrote it, and only once that module has registered the
+    // same component types in the same order. The transform hierarchy is not
+    // included.
+    bool SaveWorldSnapshot(const char* filename, const World& world, const MapData* map, Hx::AsyncFileWriter& writer);
+
+    // Replaces every entity in the world, and the sector heights when map is
+    // given, with the snapshot's. Returns false without touching either when
+    // the file is not a snapshot this module can read or was saved on a map
+    // with a different sector count; a read error part way leaves the world
+    // empty. Sectors whose heights changed are passed to the streamer's
+    // MarkSectorMoved when one is given; static ones get their clusters rebuilt.
+    bool LoadWorldSnapshot(const char* filename, World& world, MapData* map, Hx::FileSystem& fileSystem,
+                           Hx::WorldStreamer* streamer = nullptr);
+
+}
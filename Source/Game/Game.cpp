@@ -1,6 +1,36 @@
 #include "Game.h"
 #include "Engine/Engine.h"
-#include <iostream>
+#include "Engine/World/World.h"
+#include "Engine/World/Level/Collision.h"
+#include "Engine/World/Level/LevelManager.h"
+#include "Engine/World/Level/MapQuery.h"
+#include <cstdio>
+#include <cstring>
+
+// Walks in a straight line and turns away from whatever it bumps into
+struct Wanderer {
+    Hx::Vector2 position;
+    Hx::Vector2 direction;
+    f32 z;
+    u32 random;
+};
+
+constexpr u32 WandererCount = 256;
+constexpr f32 WandererSpeed = 160.0f;
+constexpr f32 WandererRadius = 16.0f;
+constexpr f32 WandererHeight = 56.0f;
+constexpr f32 WandererStepHeight = 24.0f;
+
+static u32 NextRandom(u32& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static f32 NextAngle(u32& state) {
+    return static_cast<f32>(NextRandom(state) >> 8) * (2.0f * Hx::Pi32 / 16777216.0f);
+}
 
 class Game {
 public:
@@ -11,29 +41,113 @@ public:
     void Tick(float deltaTime);
 
 private:
+    void PlaceWanderers(const Hx::Level& level);
+    void MoveWanderers(const Hx::Level& level, f32 deltaTime);
+
     Hx::Context* engine;
+    Hx::World* world;
+    const Hx::MapData* placedOn;
 };
 
 Game::Game(Hx::Context* inEngineContext) {
     engine = inEngineContext;
+    world = nullptr;
+    placedOn = nullptr;
 }
 
 void Game::Initialize() {
-    std::cout << "Initialize Game" << std::endl;
-
-    auto fileSystem = engine->fileSystem;
-    auto fileHandle = fileSystem->OpenFileWrite("Test.txt");
-    const char* message = "Hello from Game Module!\n";
-    usize messageSizeInBytes = strlen(message);
-    fileHandle->Write(message, messageSizeInBytes);
-    fileSystem->CloseFile(fileHandle);
+    if (auto fileWriter = engine->fileWriter) {
+        const char* message = "Hello from Game Module!\n";
+        usize messageSizeInBytes = strlen(message);
+        fileWriter->WriteCopy("Test.txt", message, messageSizeInBytes, Hx::AsyncWriteMode::AtomicReplace);
+    }
+
+    void* worldMemory = Hx::Alloc(&engine->mainArena->base, sizeof(Hx::World), alignof(Hx::World));
+    if (!worldMemory) {
+        // TODO: Replace with engine logging system
+        printf("Out of memory for the game world\n");
+        return;
+    }
+
+    world = new (worldMemory) Hx::World(*engine->mainArena);
+    world->CreateEntities(Hx::MakeComponentMask<Wanderer>(), WandererCount, nullptr);
 }
 
 void Game::Shutdown() {
-    std::cout << "Shutdown Game" << std::endl;
+    // The memory goes with the arena
+    if (world) {
+        world->~World();
+        world = nullptr;
+    }
 }
 
 void Game::Tick(float deltaTime) {
+    const Hx::Level* level = engine->level;
+    if (!world || !level || !level->map || !level->hasBlockmap) return;
+
+    if (placedOn != level->map) {
+        PlaceWanderers(*level);
+        placedOn = level->map;
+    }
+
+    MoveWanderers(*level, deltaTime);
+}
+
+void Game::PlaceWanderers(const Hx::Level& level) {
+    const Hx::MapData& map = *level.map;
+    // Each instance scatters its wanderers differently, the same way every run
+    u32 seed = 0x9E3779B9u ^ (engine->instanceIndex * 0x85EBCA6Bu);
+    seed = seed ? seed : 1u;
+
+    world->Each<Wanderer>([&](Wanderer& wanderer) {
+        wanderer.random = NextRandom(seed) | 1u;
+
+        // Somewhere with room to stand, falling back to the spawn
+        wanderer.position = level.spawnPosition;
+        for (u32 attempt = 0; attempt < 16 && map.subsectorCount > 0; ++attempt) {
+            u32 subsector = NextRandom(wanderer.random) % static_cast<u32>(map.subsectorCount);
+            s32 sector = map.subsectorSectors[subsector];
+            if (sector >= 0 && static_cast<f32>(map.sectors[sector].ceilingHeight - map.sectors[sector].floorHeight) >= WandererHeight) {
+                wanderer.position = Hx::GetSubsectorCenter(map, subsector);
+                break;
+            }
+        }
+
+        s32 sector = Hx::FindSector(map, wanderer.position);
+        wanderer.z = sector >= 0 ? static_cast<f32>(map.sectors[sector].floorHeight) : 0.0f;
+
+        f32 angle = NextAngle(wanderer.random);
+        wanderer.direction = Hx::Vector2{ Hx::Cos(angle), Hx::Sin(angle) };
+    });
+}
+
+void Game::MoveWanderers(const Hx::Level& level, f32 deltaTime) {
+    world->Each<Wanderer>([&](Wanderer& wanderer) {
+        Hx::CollisionBody body = {};
+        body.position = wanderer.position;
+        body.z = wanderer.z;
+        body.radius = WandererRadius;
+        body.height = WandererHeight;
+        body.stepHeight = WandererStepHeight;
+
+        Hx::Vector2 delta = { wanderer.direction.x * WandererSpeed * deltaTime, wanderer.direction.y * WandererSpeed * deltaTime };
+        Hx::MoveResult move = Hx::MoveAndSlide(*level.map, level.blockmap, body, delta);
+
+        wanderer.position = move.position;
+        wanderer.z = move.floorHeight;
+
+        // Bounce off the wall, then wobble so nobody gets stuck in a corner
+        if (move.hitCount > 0) {
+            f32 along = wanderer.direction.x * move.hitNormal.x + wanderer.direction.y * move.hitNormal.y;
+            f32 x = wanderer.direction.x - 2.0f * along * move.hitNormal.x;
+            f32 y = wanderer.direction.y - 2.0f * along * move.hitNormal.y;
+
+            f32 wobble = (NextAngle(wanderer.random) - Hx::Pi32) * 0.25f;
+            f32 c = Hx::Cos(wobble);
+            f32 s = Hx::Sin(wobble);
+            wanderer.direction = Hx::Vector2{ x * c - y * s, x * s + y * c };
+        }
+    });
 }
 
 static Game* gGameInstance = nullptr;
@@ -63,4 +177,21 @@ extern "C" {
         }
     }
 
-}
\ No newline at end of file
+    GAME_API Game* GameCreateInstance(Hx::Context* engineContext) {
+        Game* instance = new Game(engineContext);
+        instance->Initialize();
+        return instance;
+    }
+
+    GAME_API void GameDestroyInstance(Game* instance) {
+        if (instance) {
+            instance->Shutdown();
+            delete instance;
+        }
+    }
+
+    GAME_API void GameTickInstance(Game* instance, float deltaTime) {
+        instance->Tick(deltaTime);
+    }
+
+}
@@ -4,6 +4,8 @@ namespace Hx {
     struct Context;
 };
 
+class Game;
+
 #ifdef GAME_EXPORTS
     #define GAME_API __declspec(dllexport)
 #else
@@ -16,4 +18,11 @@ extern "C" {
     GAME_API void GameShutdown();
     GAME_API void GameTick(float deltaTime);
 
+    // Independent games for hosts that run many in one process. Instances
+    // share nothing but what their contexts point at, so different instances
+    // may be ticked on different threads at the same time.
+    GAME_API Game* GameCreateInstance(Hx::Context* engineContext);
+    GAME_API void GameDestroyInstance(Game* instance);
+    GAME_API void GameTickInstance(Game* instance, float deltaTime);
+
 }
\ No newline at end of file
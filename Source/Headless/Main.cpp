@@ -0,0 +1,235 @@
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/LevelManager.h"
+#include "Engine/World/Level/MapData.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/Engine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+class Game;
+
+typedef Game*(*GameCreateInstanceFn)(Hx::Context* context);
+typedef void(*GameDestroyInstanceFn)(Game* instance);
+typedef void(*GameTickInstanceFn)(Game* instance, float deltaTime);
+
+// One independent game. Its world's chunks and entity records come from its
+// own block, and ticking through Each allocates nothing, so instances only go
+// to the shared heap while new archetypes are set up. Once the game has shut
+// down the block goes with one free.
+struct SimulationInstance {
+    void* memory;
+    Hx::ArenaAllocator mainArena;
+    Hx::ArenaAllocator transientArena;
+    Hx::Context context;
+    Game* game;
+};
+
+struct HeadlessSettings {
+    const char* mapFilename = "Maps/TestMap.map";
+    u32 instanceCount = 0;   // Zero picks four per thread
+    u32 threadCount = 0;     // Zero picks one per core
+    f32 tickRate = 35.0f;
+    f32 seconds = 10.0f;     // Zero runs until killed
+    usize arenaSize = Hx::Megabytes(4);
+    bool unthrottled = false;
+};
+
+static void PrintUsage() {
+    printf("Usage: Headless [options]\n");
+    printf("  --map <file>       Level every instance runs on (default Maps/TestMap.map)\n");
+    printf("  --instances <n>    Independent worlds, 0 picks four per thread (default 0)\n");
+    printf("  --threads <n>      Worker threads, 0 picks one per core (default 0)\n");
+    printf("  --rate <hz>        Ticks per second (default 35)\n");
+    printf("  --seconds <s>      How long to run, 0 runs until killed (default 10)\n");
+    printf("  --arena <mb>       Main arena of each instance (default 4)\n");
+    printf("  --unthrottled      Tick back to back instead of at the tick rate, to measure throughput\n");
+}
+
+static bool ParseArguments(int argCount, char** argValues, HeadlessSettings& settings) {
+    for (int i = 1; i < argCount; ++i) {
+        bool hasValue = i + 1 < argCount;
+        if (strcmp(argValues[i], "--map") == 0 && hasValue) {
+            settings.mapFilename = argValues[++i];
+        } else if (strcmp(argValues[i], "--instances") == 0 && hasValue) {
+            settings.instanceCount = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--threads") == 0 && hasValue) {
+            settings.threadCount = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--rate") == 0 && hasValue) {
+            settings.tickRate = static_cast<f32>(atof(argValues[++i]));
+        } else if (strcmp(argValues[i], "--seconds") == 0 && hasValue) {
+            settings.seconds = static_cast<f32>(atof(argValues[++i]));
+        } else if (strcmp(argValues[i], "--arena") == 0 && hasValue) {
+            settings.arenaSize = Hx::Megabytes(static_cast<usize>(atoi(argValues[++i])));
+        } else if (strcmp(argValues[i], "--unthrottled") == 0) {
+            settings.unthrottled = true;
+        } else {
+            return false;
+        }
+    }
+
+    return settings.tickRate > 0.0f && settings.arenaSize > 0;
+}
+
+// Runs many independent game worlds in one process without a window, GL or
+// SDL. Every instance shares the read-only level and ticks its own world at a
+// fixed rate; each tick the instances are spread over the job system, one
+// instance per job, so throughput scales with cores rather than with how
+// well a single world splits up.
+int main(int argCount, char** argValues) {
+    HeadlessSettings settings;
+    if (!ParseArguments(argCount, argValues, settings)) {
+        PrintUsage();
+        return 1;
+    }
+
+    HMODULE gameDLL = LoadLibraryA("Game.dll");
+    if (!gameDLL) {
+        printf("Failed to load Game.dll\n");
+        return 1;
+    }
+
+    GameCreateInstanceFn gameCreateInstance = (GameCreateInstanceFn)GetProcAddress(gameDLL, "GameCreateInstance");
+    GameDestroyInstanceFn gameDestroyInstance = (GameDestroyInstanceFn)GetProcAddress(gameDLL, "GameDestroyInstance");
+    GameTickInstanceFn gameTickInstance = (GameTickInstanceFn)GetProcAddress(gameDLL, "GameTickInstance");
+
+    if (!gameCreateInstance || !gameDestroyInstance || !gameTickInstance) {
+        printf("Failed to get the instance functions from Game.dll\n");
+        FreeLibrary(gameDLL);
+        return 1;
+    }
+
+    Hx::JobSystem jobSystem(settings.threadCount);
+    Hx::FileSystem fileSystem;
+    u32 threadCount = jobSystem.GetThreadCount();
+    u32 instanceCount = settings.instanceCount > 0 ? settings.instanceCount : threadCount * 4;
+
+    // The level every instance plays on; nothing draws, so there is no streamer or visibility
+    void* levelMemory = malloc(Hx::Megabytes(64));
+    Hx::ArenaAllocator levelArena = {};
+    Hx::InitArena(levelArena, levelMemory, levelMemory ? Hx::Megabytes(64) : 0);
+
+    Hx::Level level = {};
+    snprintf(level.filename, sizeof(level.filename), "%s", settings.mapFilename);
+    level.map = Hx::LoadMapFromFile(settings.mapFilename, fileSystem, levelArena);
+    if (!level.map) {
+        printf("Failed to load %s\n", settings.mapFilename);
+        free(levelMemory);
+        FreeLibrary(gameDLL);
+        return 1;
+    }
+
+    level.hasBlockmap = Hx::BuildBlockmap(level.blockmap, *level.map, levelArena);
+    if (level.map->subsectorCount > 0) {
+        level.spawnPosition = Hx::GetSubsectorCenter(*level.map, 0);
+    }
+
+    std::vector<SimulationInstance> instances(instanceCount);
+    usize transientSize = settings.arenaSize / 4;
+    u32 createdCount = 0;
+    for (SimulationInstance& instance : instances) {
+        instance.memory = malloc(settings.arenaSize + transientSize);
+        if (!instance.memory) break;
+
+        Hx::InitArena(instance.mainArena, instance.memory, settings.arenaSize);
+        Hx::InitArena(instance.transientArena, static_cast<u8*>(instance.memory) + settings.arenaSize, transientSize);
+
+        // Instances get no job system or file access of their own, they already run on a worker
+        instance.context = {};
+        instance.context.mainArena = &instance.mainArena;
+        instance.context.transientArena = &instance.transientArena;
+        instance.context.fileSystem = &fileSystem;
+        instance.context.level = &level;
+        instance.context.instanceIndex = createdCount;
+
+        instance.game = gameCreateInstance(&instance.context);
+        ++createdCount;
+    }
+    instances.resize(createdCount);
+
+    printf("%s: %zu sectors, %u instances on %u threads at %.0f Hz%s\n", settings.mapFilename, level.map->sectorCount,
+           createdCount, threadCount, settings.tickRate, settings.unthrottled ? ", unthrottled" : "");
+
+    f64 tickSeconds = 1.0 / settings.tickRate;
+    f64 startTime = Hx::GetTimeSeconds();
+    f64 nextTick = startTime;
+    f64 reportTime = startTime;
+
+    u64 totalTicks = 0;
+    f64 totalBusy = 0.0;
+    u64 intervalTicks = 0;
+    f64 intervalBusy = 0.0;
+    f64 intervalWorst = 0.0;
+
+    for (;;) {
+        f64 tickStart = Hx::GetTimeSeconds();
+        if (settings.seconds > 0.0f && tickStart - startTime >= settings.seconds) break;
+
+        jobSystem.ParallelFor(instances.size(), 1, [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                gameTickInstance(instances[i].game, static_cast<f32>(tickSeconds));
+            }
+        });
+
+        f64 tickEnd = Hx::GetTimeSeconds();
+        f64 busy = tickEnd - tickStart;
+        ++intervalTicks;
+        intervalBusy += busy;
+        intervalWorst = busy > intervalWorst ? busy : intervalWorst;
+
+        if (tickEnd - reportTime >= 1.0) {
+            // Per core is measured against time spent ticking, so it holds whether or not the loop is throttled
+            f64 instanceTicks = static_cast<f64>(intervalTicks) * instances.size();
+            printf("%llu ticks, %.0f instance-ticks/s, %.0f per core, %.1f%% busy, worst tick %.2f ms\n",
+                   static_cast<unsigned long long>(intervalTicks), instanceTicks / (tickEnd - reportTime),
+                   instanceTicks / intervalBusy / threadCount, 100.0 * intervalBusy / (tickEnd - reportTime),
+                   intervalWorst * 1000.0);
+
+            totalTicks += intervalTicks;
+            totalBusy += intervalBusy;
+            intervalTicks = 0;
+            intervalBusy = 0.0;
+            intervalWorst = 0.0;
+            reportTime = tickEnd;
+        }
+
+        if (!settings.unthrottled) {
+            nextTick += tickSeconds;
+
+            // A server that fell behind drops the backlog rather than bursting to catch up
+            if (nextTick < tickEnd - tickSeconds) {
+                nextTick = tickEnd;
+            } else if (nextTick > tickEnd) {
+                std::this_thread::sleep_for(std::chrono::duration<f64>(nextTick - tickEnd));
+            }
+        }
+    }
+
+    totalTicks += intervalTicks;
+    totalBusy += intervalBusy;
+    if (totalTicks > 0 && totalBusy > 0.0) {
+        f64 instanceTicks = static_cast<f64>(totalTicks) * instances.size();
+        printf("Total: %llu ticks, %.0f instance-ticks/s per core, %.3f ms per instance tick\n",
+               static_cast<unsigned long long>(totalTicks), instanceTicks / totalBusy / threadCount,
+               totalBusy * threadCount * 1000.0 / instanceTicks);
+    }
+
+    for (SimulationInstance& instance : instances) {
+        gameDestroyInstance(instance.game);
+        free(instance.memory);
+    }
+
+    free(levelMemory);
+    FreeLibrary(gameDLL);
+    return 0;
+}
@@ -1,17 +1,29 @@
 #include <SDL3/SDL.h>
 
 #include "Engine/IO/FileSystem.h"
+#include "Engine/IO/FileCache.h"
+#include "Engine/IO/AsyncFileWriter.h"
+#include "Engine/IO/FileWatcher.h"
 #include "Engine/RenderCore/RenderDevice.h"
 #include "Engine/Renderer/RenderSystem.h"
 #include "Engine/Renderer/Camera.h"
 #include "Engine/Math/Math.h"
 
+#include "Engine/Core/JobSystem.h"
 #include "Engine/Memory/ArenaAllocator.h"
 #include "Engine/World/Level/MapData.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/Collision.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/World/Level/MapVisibility.h"
+#include "Engine/World/Level/PortalVisibility.h"
+#include "Engine/World/Level/LevelManager.h"
 #include "Engine/Engine.h"
 
 #include <memory>
 #include <array>
+#include <cstdio>
+#include <cstring>
 
 #include <windows.h>
 
@@ -19,29 +31,84 @@ typedef void(*GameInitFn)(Hx::Context* context);
 typedef void(*GameShutdownFn)();
 typedef void(*GameTickFn)(float deltaTime);
 
+// The simulation advances in fixed steps whatever the frame rate, and frames
+// draw the camera interpolated between the last two steps
+constexpr f32 SimulationStep = 1.0f / 60.0f;
+// Time beyond this many steps in one frame is dropped instead of caught up,
+// so a long stall cannot snowball into ever longer frames
+constexpr u32 MaxSimulationSteps = 5;
+
 class CameraController {
 public:
     CameraController(Hx::Camera* inCamera);
 
-    void Tick(f32 deltaTime);
+    // With a level the camera walks on the map's floors and stops at its walls, without one it flies freely
+    void SetLevel(const Hx::MapData* inMap, const Hx::Blockmap* inBlockmap);
+
+    // Mouse look, every frame so aiming never waits for a step
+    void Look();
+    // Movement, once per simulation step
+    void Step(f32 deltaTime);
+    // Puts the camera between the last two steps, alpha 0 being the older one
+    void Interpolate(f32 alpha);
+    // Moves without interpolating from the old position
+    void Teleport(const Hx::Vector3& inPosition);
 
 private:
+    void Walk(f32 deltaTime);
+
     Hx::Camera* camera;
+    Hx::Vector3 position;
+    Hx::Vector3 previousPosition;
     Hx::Vector3 velocity;
     f32 mouseSensitivity;
     f32 friction;
     f32 speed;
+
+    const Hx::MapData* map;
+    const Hx::Blockmap* blockmap;
+    Hx::CollisionBody body;
+    f32 eyeHeight;
+    f32 gravity;
+    f32 fallSpeed;
 };
 
 CameraController::CameraController(Hx::Camera* inCamera) {
     camera = inCamera;
+    position = camera->position;
+    previousPosition = position;
     velocity = Hx::Vector3::Zero();
     mouseSensitivity = 0.1f;
     friction = 0.9f;
-    speed = 32.0f;
+    speed = 1024.0f;
+
+    map = nullptr;
+    blockmap = nullptr;
+    body = {};
+    body.radius = 16.0f;
+    body.height = 56.0f;
+    body.stepHeight = 24.0f;
+    eyeHeight = 41.0f;
+    gravity = 800.0f;
+    fallSpeed = 0.0f;
+}
+
+void CameraController::SetLevel(const Hx::MapData* inMap, const Hx::Blockmap* inBlockmap) {
+    map = inMap;
+    blockmap = inBlockmap;
+}
+
+void CameraController::Look() {
+    f32 mouseDX, mouseDY;
+    Uint32 mouseState = SDL_GetRelativeMouseState(&mouseDX, &mouseDY);
+    
+    camera->rotation.x -= mouseDY * mouseSensitivity;
+    camera->rotation.y += mouseDX * mouseSensitivity;
 }
 
-void CameraController::Tick(f32 deltaTime) {
+void CameraController::Step(f32 deltaTime) {
+    previousPosition = position;
+
     Hx::Vector3 camForward = camera->GetForwardVector();
     Hx::Vector3 camRight = camera->GetRightVector();
 
@@ -63,28 +130,96 @@ void CameraController::Tick(f32 deltaTime) {
         velocity -= camForward * speed * deltaTime;
     }
 
-    if (keyboard[SDL_SCANCODE_Q]) {
-        velocity.y -= speed * deltaTime;
-    }
+    if (map && blockmap) {
+        Walk(deltaTime);
+    } else {
+        if (keyboard[SDL_SCANCODE_Q]) {
+            velocity.y -= speed * deltaTime;
+        }
 
-    if (keyboard[SDL_SCANCODE_E]) {
-        velocity.y += speed * deltaTime;
+        if (keyboard[SDL_SCANCODE_E]) {
+            velocity.y += speed * deltaTime;
+        }
+
+        position += velocity * deltaTime;
     }
 
-    camera->position += velocity * deltaTime;
     velocity *= friction;
 
     if (Hx::Abs(velocity.x) < 1e-3f) velocity.x = 0.0f;
     if (Hx::Abs(velocity.y) < 1e-3f) velocity.y = 0.0f;
+}
 
-    f32 mouseDX, mouseDY;
-    Uint32 mouseState = SDL_GetRelativeMouseState(&mouseDX, &mouseDY);
-    
-    camera->rotation.x -= mouseDY * mouseSensitivity;
-    camera->rotation.y += mouseDX * mouseSensitivity;
+void CameraController::Interpolate(f32 alpha) {
+    camera->position = previousPosition + (position - previousPosition) * alpha;
+}
+
+void CameraController::Teleport(const Hx::Vector3& inPosition) {
+    position = inPosition;
+    previousPosition = inPosition;
+    camera->position = inPosition;
+}
+
+void CameraController::Walk(f32 deltaTime) {
+    // Walking stays on the ground, height only comes from floors and falling
+    velocity.y = 0.0f;
+
+    body.position = Hx::WorldToMap(position);
+    body.z = position.y - eyeHeight;
+
+    Hx::Vector2 delta = Hx::WorldToMap(velocity * deltaTime);
+    Hx::MoveResult move = Hx::MoveAndSlide(*map, *blockmap, body, delta);
+
+    // Steps up snap to the new floor, drops are fallen down
+    f32 feet = body.z;
+    if (feet <= move.floorHeight) {
+        feet = move.floorHeight;
+        fallSpeed = 0.0f;
+    } else {
+        fallSpeed += gravity * deltaTime;
+        feet -= fallSpeed * deltaTime;
+        if (feet <= move.floorHeight) {
+            feet = move.floorHeight;
+            fallSpeed = 0.0f;
+        }
+    }
+
+    if (feet + body.height > move.ceilingHeight) {
+        feet = move.ceilingHeight - body.height > move.floorHeight ? move.ceilingHeight - body.height : move.floorHeight;
+    }
+
+    position = Hx::MapToWorld(move.position, feet + eyeHeight);
+}
+
+struct LevelReloadContext {
+    Hx::LevelManager* levels;
+    const Hx::Camera* camera;
+};
+
+static void ReloadMap(const char* filename, void* userData) {
+    LevelReloadContext* context = static_cast<LevelReloadContext*>(userData);
+
+    // The edited map is built next to the running one and streamed in around the player, so nothing pops on the swap
+    Hx::Vector2 origin = Hx::WorldToMap(context->camera->position);
+    context->levels->RequestLevel(filename, &origin);
+}
+
+// Nothing in the map format marks doors yet. Sectors closed off at load,
+// ceiling down on the floor, are where they sit, so those are the ones allowed to move.
+static bool IsDoorSector(const Hx::MapData& map, u32 sector, void* userData) {
+    const Hx::MapSector& mapSector = map.sectors[sector];
+    return mapSector.ceilingHeight <= mapSector.floorHeight;
 }
 
 int main(int argCount, char** argValues) {
+    // The simulation no longer follows the frame rate, so vsync only decides tearing against latency
+    bool vSync = true;
+    for (int i = 1; i < argCount; ++i) {
+        if (strcmp(argValues[i], "--no-vsync") == 0) {
+            vSync = false;
+        }
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
 
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
@@ -95,7 +230,7 @@ int main(int argCount, char** argValues) {
     SDL_GLContext glContext = SDL_GL_CreateContext(window);
     SDL_GL_MakeCurrent(window, glContext);
 
-    SDL_GL_SetSwapInterval(1);
+    SDL_GL_SetSwapInterval(vSync ? 1 : 0);
     SDL_SetWindowRelativeMouseMode(window, true);
 
     // Load Game DLL
@@ -125,13 +260,20 @@ int main(int argCount, char** argValues) {
     Hx::ArenaAllocator transientArena = {};
     Hx::InitArena(transientArena, transientMemory, Hx::Megabytes(8));
 
+    Hx::JobSystem jobSystem;
     Hx::FileSystem fileSystem;
+    Hx::FileCache fileCache(&fileSystem, Hx::Megabytes(4));
+    Hx::AsyncFileWriter fileWriter(&fileSystem);
+
+    Hx::FileWatcher fileWatcher;
+    fileWatcher.WatchDirectory("Shaders");
+    fileWatcher.WatchDirectory("Maps");
     
     // Initialize the render device
     Hx::RenderDeviceDesc renderDeviceDesc = {};
     renderDeviceDesc.width = 800;
     renderDeviceDesc.height = 600;
-    renderDeviceDesc.vSync = true;
+    renderDeviceDesc.vSync = vSync;
     renderDeviceDesc.debugLayer = true;
 
     void* renderDeviceMemory = Hx::Alloc(
@@ -151,10 +293,14 @@ int main(int argCount, char** argValues) {
             Hx::AllocFlags::ZeroInit
     );
     
-    Hx::RenderSystem* renderSystem = new (renderSystemMemory) Hx::RenderSystem(renderDevice);
+    Hx::RenderSystem* renderSystem = new (renderSystemMemory) Hx::RenderSystem(renderDevice, &fileCache);
 
     Hx::Context engineContext = {};
+    engineContext.jobSystem = &jobSystem;
     engineContext.fileSystem = &fileSystem;
+    engineContext.fileCache = &fileCache;
+    engineContext.fileWriter = &fileWriter;
+    engineContext.fileWatcher = &fileWatcher;
     engineContext.mainArena = &mainArena;
     engineContext.transientArena = &transientArena;
 
@@ -173,12 +319,38 @@ int main(int argCount, char** argValues) {
     Hx::MaterialHandle material = renderSystem->CreateMaterial(Hx::MaterialType::Opaque);
 
     Hx::Camera camera;
-    camera.SetPerspective(70.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    camera.SetPerspective(70.0f, 800.0f / 600.0f, 0.1f, 4096.0f);
     camera.position = Hx::Vector3(0.0f, 0.0f, 3.0f);
 
     CameraController camController(&camera);
 
-    Hx::MapData* map = Hx::LoadMapFromFile("Maps/TestMap.map", fileSystem, transientArena);
+    // Torn down by hand before the GL context goes away, since levels own GPU buffers
+    Hx::LevelManagerSettings levelSettings;
+    levelSettings.streaming.isDynamicSector = IsDoorSector;
+    void* levelManagerMemory = Hx::Alloc(
+            &mainArena.base,
+            sizeof(Hx::LevelManager),
+            alignof(Hx::LevelManager),
+            Hx::AllocFlags::ZeroInit
+    );
+
+    Hx::LevelManager& levelManager = *new (levelManagerMemory) Hx::LevelManager(fileSystem, *renderSystem, &jobSystem, levelSettings);
+
+    // Nothing to show before the first level, so that one is waited for
+    levelManager.RequestLevel("Maps/TestMap.map");
+    if (levelManager.FinishPending()) {
+        camController.Teleport(Hx::MapToWorld(levelManager.GetCurrentLevel()->spawnPosition, 0.0f));
+    }
+
+    LevelReloadContext reloadContext = { &levelManager, &camera };
+    fileWatcher.Subscribe("Maps/TestMap.map", ReloadMap, &reloadContext);
+
+    Hx::PortalVisibilityStats visibilityStats = {};
+    f32 statsTimer = 0.0f;
+    f32 simulationTime = 0.0f;
+    u32 droppedStalls = 0;
+    u32 frameCount = 0;
+    renderSystem->WatchShaderSources(&fileWatcher);
 
     bool running = true;
     while (running) {
@@ -189,14 +361,42 @@ int main(int argCount, char** argValues) {
             }
         }
 
+        fileWatcher.Poll();
+
         static Uint64 lastTime = SDL_GetPerformanceCounter();
         Uint64 currentTime = SDL_GetPerformanceCounter();
         f32 deltaTime = static_cast<f32>(currentTime - lastTime) / static_cast<f32>(SDL_GetPerformanceFrequency());
         lastTime = currentTime;
 
-        gameTick(deltaTime);
+        // Swapping replaces the level, so the game and the controller are handed the current one every frame
+        if (levelManager.Update()) {
+            const Hx::LevelManagerStats& levelStats = levelManager.GetStats();
+            // TODO: Replace with engine logging system
+            printf("Switched to %s: loaded in %.2f ms, streamed in %.2f ms, swapped in %.3f ms\n", levelManager.GetCurrentLevel()->filename,
+                   levelStats.lastLoadSeconds * 1000.0, levelStats.lastStreamSeconds * 1000.0, levelStats.lastSwapSeconds * 1000.0);
+        }
+
+        Hx::Level* level = levelManager.GetCurrentLevel();
+        engineContext.level = level;
+        camController.SetLevel(level ? level->map : nullptr, level && level->hasBlockmap ? &level->blockmap : nullptr);
+        camController.Look();
+
+        // Whole steps for the time that passed, what is left over carries into the next frame
+        simulationTime += deltaTime;
+        u32 steps = 0;
+        while (simulationTime >= SimulationStep && steps < MaxSimulationSteps) {
+            gameTick(SimulationStep);
+            camController.Step(SimulationStep);
+            simulationTime -= SimulationStep;
+            ++steps;
+        }
+
+        if (steps == MaxSimulationSteps && simulationTime >= SimulationStep) {
+            simulationTime = 0.0f;
+            ++droppedStalls;
+        }
 
-        camController.Tick(deltaTime);
+        camController.Interpolate(simulationTime / SimulationStep);
 
         Hx::Matrix4 projectionMatrix = camera.GetProjectionMatrix();
         Hx::Matrix4 viewMatrix = camera.GetViewMatrix();
@@ -204,11 +404,59 @@ int main(int argCount, char** argValues) {
 
         renderSystem->BeginFrame(viewMatrix, projectionMatrix);
         renderSystem->Submit(mesh, material, modelMatrix);
+
+        if (level) {
+            level->streamer->Update(Hx::WorldToMap(camera.position));
+
+            // The PVS bounds what the camera's subsector could ever see, the portal walk narrows that to the view
+            u32 cameraSubsector = Hx::FindSubsector(*level->map, Hx::WorldToMap(camera.position));
+            Hx::VisibleSet visibleSet = Hx::GetVisibleSet(level->visibility, cameraSubsector);
+
+            auto submitSector = [&](u32 sector) {
+                Hx::StreamedSectorDraw draw;
+                if (level->streamer->GetSectorDraw(sector, draw)) {
+                    renderSystem->Submit(draw.mesh, material, modelMatrix, draw.firstIndex, draw.indexCount, draw.baseVertex);
+                }
+            };
+
+            if (level->hasPortalVisibility) {
+                Hx::PortalView view = Hx::MakePortalView(camera.position, camera.GetForwardVector(), Hx::Radians(70.0f), 800.0f / 600.0f, 0.1f);
+                Hx::ComputePortalVisibility(level->portalVisibility, view, visibleSet.sectors, &visibilityStats);
+
+                for (u32 i = 0; i < level->portalVisibility.visibleSectorCount; ++i) {
+                    submitSector(level->portalVisibility.visibleSectors[i]);
+                }
+            } else {
+                for (usize i = 0; i < level->map->sectorCount; ++i) {
+                    if (visibleSet.sectors && !Hx::IsVisible(visibleSet.sectors, i)) continue;
+                    submitSector(static_cast<u32>(i));
+                }
+            }
+        }
         renderSystem->EndFrame();
 
+        statsTimer += deltaTime;
+        ++frameCount;
+        if (statsTimer >= 1.0f) {
+            Hx::WorldStreamingStats streamingStats = level ? level->streamer->GetStats() : Hx::WorldStreamingStats{};
+
+            char title[320];
+            snprintf(title, sizeof(title), "HARM - %.0f fps, %u stalls dropped, %u sectors visible, %u/%u portals passed, %u/%u clusters, %.1f/%.1f MB, %.1f ms stream latency",
+                     frameCount / statsTimer, droppedStalls, visibilityStats.visibleSectorCount, visibilityStats.portalsPassed, visibilityStats.portalsVisited,
+                     streamingStats.residentClusterCount, streamingStats.clusterCount,
+                     streamingStats.bytesResident / (1024.0 * 1024.0), streamingStats.memoryBudget / (1024.0 * 1024.0),
+                     streamingStats.averageLatencySeconds * 1000.0);
+            SDL_SetWindowTitle(window, title);
+
+            statsTimer = 0.0f;
+            frameCount = 0;
+        }
+
         SDL_GL_SwapWindow(window);
     }
 
+    levelManager.~LevelManager();
+
     gameShutdown();
     if (gameDLL) {
         FreeLibrary(gameDLL);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+namespace Hx {
+    class JobSystem;
+    struct ArenaAllocator;
+}
+
+namespace Hx {
+
+    struct BenchmarkContext {
+        Hx::JobSystem* jobs;
+        Hx::ArenaAllocator* arena; // Reset between benchmarks
+        const MapData* map;
+        u32 scale;                 // Multiplies each benchmark's default workload
+        bool verify;               // Also check results against a slow reference where there is one
+        u32 failures;              // Verification failures so far, any fails the run
+    };
+
+    using BenchmarkFn = void (*)(BenchmarkContext& context);
+
+    struct BenchmarkEntry {
+        const char* name;
+        BenchmarkFn fn;
+    };
+
+    // Small deterministic generator so runs are repeatable across machines
+    struct BenchmarkRandom {
+        u64 state;
+
+        u32 Next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return static_cast<u32>(state >> 32);
+        }
+
+        f32 NextFloat() {
+            return static_cast<f32>(Next() >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    // Fastest of repeats runs of fn, so one slow run from a page fault or a
+    // preempted thread does not skew the result
+    template <typename Fn>
+    f64 TimeBest(u32 repeats, Fn&& fn) {
+        f64 best = 0.0;
+        for (u32 repeat = 0; repeat < repeats; ++repeat) {
+            f64 start = Hx::GetTimeSeconds();
+            fn();
+            f64 seconds = Hx::GetTimeSeconds() - start;
+            best = repeat == 0 || seconds < best ? seconds : best;
+        }
+        return best;
+    }
+
+    // As above with untimed setup before every run, for work that has to be undone or redone between runs
+    template <typename Fn, typename SetupFn>
+    f64 TimeBest(u32 repeats, Fn&& fn, SetupFn&& setup) {
+        f64 best = 0.0;
+        for (u32 repeat = 0; repeat < repeats; ++repeat) {
+            setup();
+            f64 start = Hx::GetTimeSeconds();
+            fn();
+            f64 seconds = Hx::GetTimeSeconds() - start;
+            best = repeat == 0 || seconds < best ? seconds : best;
+        }
+        return best;
+    }
+
+    // A size x size grid of square rooms, each its own sector, sharing two-sided
+    // walls. Roughly solidChance of the rooms are closed off (ceiling at the floor)
+    // and a few are raised, so queries see both walls and steps. Includes BSP nodes.
+    MapData* GenerateGridMap(Hx::ArenaAllocator& arena, u32 size, f32 solidChance, u32 seed);
+
+    constexpr s32 GridMapCellSize = 64;
+
+    void RunRaycastBenchmark(BenchmarkContext& context);
+    void RunWorldBenchmark(BenchmarkContext& context);
+    void RunTransformBenchmark(BenchmarkContext& context);
+    void RunPathBenchmark(BenchmarkContext& context);
+    void RunSnapshotBenchmark(BenchmarkContext& context);
+    void RunSpatialBenchmark(BenchmarkContext& context);
+    void RunStreamingBenchmark(BenchmarkContext& context);
+
+}
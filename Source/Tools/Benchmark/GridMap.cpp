@@ -0,0 +1,153 @@
+#include "Benchmark.h"
+
+#include "Engine/Memory/ArenaAllocator.h"
+
+namespace Hx {
+
+    constexpr s32 GridMapCeiling = 128;
+    constexpr s32 GridMapRaisedFloor = 24;
+    constexpr f32 GridMapRaisedChance = 0.1f;
+
+    struct GridMapBuilder {
+        MapData* map;
+        u32 size;
+        usize nodeCount;
+    };
+
+    static u32 GetCell(u32 size, u32 x, u32 y) {
+        return y * size + x;
+    }
+
+    static void AddSegment(MapData& map, s32 ax, s32 ay, s32 bx, s32 by, s32 front, s32 back) {
+        MapLineSegment& seg = map.lineSegments[map.lineSegmentCount++];
+        seg.v1[0] = ax;
+        seg.v1[1] = ay;
+        seg.v2[0] = bx;
+        seg.v2[1] = by;
+        seg.frontSector = front;
+        seg.backSector = back;
+    }
+
+    // Splits the cell rectangle [x0, x1) x [y0, y1) down the middle of its longer side
+    static u32 BuildGridNodes(GridMapBuilder& builder, u32 x0, u32 y0, u32 x1, u32 y1) {
+        if (x1 - x0 == 1 && y1 - y0 == 1) {
+            return GetCell(builder.size, x0, y0) | MapNodeLeafBit;
+        }
+
+        u32 index = static_cast<u32>(builder.nodeCount++);
+        MapNode node;
+        u32 front;
+        u32 back;
+
+        if (x1 - x0 >= y1 - y0) {
+            u32 mid = (x0 + x1) / 2;
+            node.plane[0] = 1.0f;
+            node.plane[1] = 0.0f;
+            node.plane[2] = static_cast<f32>(mid * GridMapCellSize);
+            front = BuildGridNodes(builder, mid, y0, x1, y1);
+            back = BuildGridNodes(builder, x0, y0, mid, y1);
+        } else {
+            u32 mid = (y0 + y1) / 2;
+            node.plane[0] = 0.0f;
+            node.plane[1] = 1.0f;
+            node.plane[2] = static_cast<f32>(mid * GridMapCellSize);
+            front = BuildGridNodes(builder, x0, mid, x1, y1);
+            back = BuildGridNodes(builder, x0, y0, x1, mid);
+        }
+
+        node.children[0] = front;
+        node.children[1] = back;
+        builder.map->nodes[index] = node;
+        return index;
+    }
+
+    MapData* GenerateGridMap(Hx::ArenaAllocator& arena, u32 size, f32 solidChance, u32 seed) {
+        if (size == 0) return nullptr;
+
+        usize cellCount = static_cast<usize>(size) * size;
+        usize segmentCount = static_cast<usize>(size) * (size + 1) * 2;
+
+        MapData* map = Hx::AllocOne<MapData>(&arena.base, Hx::AllocFlags::ZeroInit);
+        if (!map) return nullptr;
+
+        map->sectors = Hx::AllocArray<MapSector>(&arena.base, cellCount);
+        map->subsectors = Hx::AllocArray<MapSubsector>(&arena.base, cellCount);
+        map->subsectorSectors = Hx::AllocArray<s32>(&arena.base, cellCount);
+        map->edges = Hx::AllocArray<MapEdge>(&arena.base, cellCount * 4);
+        map->lineSegments = Hx::AllocArray<MapLineSegment>(&arena.base, segmentCount);
+        map->nodes = cellCount > 1 ? Hx::AllocArray<MapNode>(&arena.base, cellCount - 1) : nullptr;
+        if (!map->sectors || !map->subsectors || !map->subsectorSectors || !map->edges || !map->lineSegments ||
+            (cellCount > 1 && !map->nodes)) {
+            return nullptr;
+        }
+
+        s32 n = static_cast<s32>(size);
+        s32 s = GridMapCellSize;
+        auto cell = [&](s32 x, s32 y) { return static_cast<s32>(GetCell(size, static_cast<u32>(x), static_cast<u32>(y))); };
+
+        // Horizontal walls at y = j * s run +x with the room above them in front,
+        // except the top border, which runs -x so the room below is in front
+        u32* horizontal = Hx::AllocArray<u32>(&arena.base, static_cast<usize>(size) * (size + 1));
+        u32* vertical = Hx::AllocArray<u32>(&arena.base, static_cast<usize>(size) * (size + 1));
+        if (!horizontal || !vertical) return nullptr;
+
+        for (s32 j = 0; j <= n; ++j) {
+            for (s32 i = 0; i < n; ++i) {
+                horizontal[j * n + i] = static_cast<u32>(map->lineSegmentCount);
+                if (j == n) {
+                    AddSegment(*map, (i + 1) * s, j * s, i * s, j * s, cell(i, j - 1), -1);
+                } else {
+                    AddSegment(*map, i * s, j * s, (i + 1) * s, j * s, cell(i, j), j > 0 ? cell(i, j - 1) : -1);
+                }
+            }
+        }
+
+        // Vertical walls at x = i * s run -y with the room to their right in front,
+        // except the right border, which runs +y so the room to the left is in front
+        for (s32 i = 0; i <= n; ++i) {
+            for (s32 j = 0; j < n; ++j) {
+                vertical[i * n + j] = static_cast<u32>(map->lineSegmentCount);
+                if (i == n) {
+                    AddSegment(*map, i * s, j * s, i * s, (j + 1) * s, cell(i - 1, j), -1);
+                } else {
+                    AddSegment(*map, i * s, (j + 1) * s, i * s, j * s, cell(i, j), i > 0 ? cell(i - 1, j) : -1);
+                }
+            }
+        }
+
+        BenchmarkRandom random = { 0x9E3779B97F4A7C15ull ^ seed };
+
+        for (s32 j = 0; j < n; ++j) {
+            for (s32 i = 0; i < n; ++i) {
+                u32 index = static_cast<u32>(cell(i, j));
+                u32 firstEdge = static_cast<u32>(map->edgeCount);
+
+                // Counter clockwise: bottom, right, top, left
+                map->edges[map->edgeCount++] = MapEdge{ horizontal[j * n + i], 0 };
+                map->edges[map->edgeCount++] = MapEdge{ vertical[(i + 1) * n + j], i + 1 == n ? 0u : 1u };
+                map->edges[map->edgeCount++] = MapEdge{ horizontal[(j + 1) * n + i], j + 1 == n ? 0u : 1u };
+                map->edges[map->edgeCount++] = MapEdge{ vertical[i * n + j], 0 };
+
+                map->subsectors[index] = MapSubsector{ firstEdge, 4 };
+                map->subsectorSectors[index] = static_cast<s32>(index);
+
+                f32 roll = random.NextFloat();
+                s32 floor = roll >= 1.0f - GridMapRaisedChance ? GridMapRaisedFloor : 0;
+                s32 ceiling = roll < solidChance ? floor : GridMapCeiling;
+                map->sectors[index] = MapSector{ index, 1, floor, ceiling };
+            }
+        }
+
+        map->sectorCount = cellCount;
+        map->subsectorCount = cellCount;
+
+        if (cellCount > 1) {
+            GridMapBuilder builder = { map, size, 0 };
+            BuildGridNodes(builder, 0, 0, size, size);
+            map->nodeCount = builder.nodeCount;
+        }
+
+        return map;
+    }
+
+}
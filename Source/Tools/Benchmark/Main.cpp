@@ -0,0 +1,135 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/JobSystem.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/MapData.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const Hx::BenchmarkEntry Benchmarks[] = {
+    { "raycast", Hx::RunRaycastBenchmark },
+    { "world", Hx::RunWorldBenchmark },
+    { "transform", Hx::RunTransformBenchmark },
+    { "path", Hx::RunPathBenchmark },
+    { "snapshot", Hx::RunSnapshotBenchmark },
+    { "spatial", Hx::RunSpatialBenchmark },
+    { "streaming", Hx::RunStreamingBenchmark },
+};
+
+static void PrintUsage() {
+    printf("Usage: Benchmark [names...] [options]\n");
+    printf("  --threads <n>  Worker threads, 0 picks one per core (default 0)\n");
+    printf("  --map <file>   Run against a map file instead of a generated grid\n");
+    printf("  --grid <n>     Rooms per side of the generated grid (default 256)\n");
+    printf("  --scale <n>    Multiplies every benchmark's workload (default 1)\n");
+    printf("  --verify       Check results against brute force references, failing the run on a mismatch\n");
+    printf("Benchmarks:");
+    for (const Hx::BenchmarkEntry& entry : Benchmarks) {
+        printf(" %s", entry.name);
+    }
+    printf("\n");
+}
+
+static const Hx::BenchmarkEntry* FindBenchmark(const char* name) {
+    for (const Hx::BenchmarkEntry& entry : Benchmarks) {
+        if (strcmp(entry.name, name) == 0) return &entry;
+    }
+    return nullptr;
+}
+
+int main(int argCount, char** argValues) {
+    constexpr usize MaxSelected = sizeof(Benchmarks) / sizeof(Benchmarks[0]);
+    const Hx::BenchmarkEntry* selected[MaxSelected];
+    usize selectedCount = 0;
+
+    u32 threadCount = 0;
+    u32 gridSize = 256;
+    u32 scale = 1;
+    bool verify = false;
+    const char* mapFilename = nullptr;
+
+    for (int i = 1; i < argCount; ++i) {
+        if (strcmp(argValues[i], "--threads") == 0 && i + 1 < argCount) {
+            threadCount = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--map") == 0 && i + 1 < argCount) {
+            mapFilename = argValues[++i];
+        } else if (strcmp(argValues[i], "--grid") == 0 && i + 1 < argCount) {
+            gridSize = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--scale") == 0 && i + 1 < argCount) {
+            scale = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--verify") == 0) {
+            verify = true;
+        } else if (const Hx::BenchmarkEntry* entry = FindBenchmark(argValues[i])) {
+            if (selectedCount < MaxSelected) selected[selectedCount++] = entry;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (selectedCount == 0) {
+        for (const Hx::BenchmarkEntry& entry : Benchmarks) {
+            selected[selectedCount++] = &entry;
+        }
+    }
+
+    // The map lives at the bottom of the arena, each benchmark's allocations above it
+    usize arenaSize = Hx::Megabytes(1024);
+    void* arenaMemory = malloc(arenaSize);
+    if (!arenaMemory) {
+        printf("Failed to allocate %zu bytes\n", arenaSize);
+        return 1;
+    }
+
+    Hx::ArenaAllocator arena = {};
+    Hx::InitArena(arena, arenaMemory, arenaSize);
+
+    Hx::FileSystem fileSystem;
+    Hx::MapData* map = nullptr;
+    if (mapFilename) {
+        map = Hx::LoadMapFromFile(mapFilename, fileSystem, arena);
+        if (!map) {
+            printf("Failed to load %s\n", mapFilename);
+            return 1;
+        }
+        printf("%s: ", mapFilename);
+    } else {
+        map = Hx::GenerateGridMap(arena, gridSize, 0.3f, 1);
+        if (!map) {
+            printf("Failed to generate a %ux%u grid\n", gridSize, gridSize);
+            return 1;
+        }
+        printf("Grid %ux%u: ", gridSize, gridSize);
+    }
+    printf("%zu sectors, %zu subsectors, %zu line segments\n", map->sectorCount, map->subsectorCount, map->lineSegmentCount);
+
+    Hx::JobSystem jobs(threadCount);
+    printf("%u threads\n", jobs.GetThreadCount());
+
+    Hx::ArenaMarker mapTop = Hx::GetArenaMarker(arena);
+
+    Hx::BenchmarkContext context;
+    context.jobs = &jobs;
+    context.arena = &arena;
+    context.map = map;
+    context.scale = scale > 0 ? scale : 1;
+    context.verify = verify;
+    context.failures = 0;
+
+    for (usize i = 0; i < selectedCount; ++i) {
+        printf("\n[%s]\n", selected[i]->name);
+        selected[i]->fn(context);
+
+        Hx::RestoreArena(arena, mapTop);
+    }
+
+    if (verify) {
+        printf("\n%s\n", context.failures == 0 ? "Verification passed" : "Verification FAILED");
+    }
+
+    free(arenaMemory);
+    return context.failures == 0 ? 0 : 1;
+}
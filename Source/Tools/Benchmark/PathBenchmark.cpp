@@ -0,0 +1,126 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/World/Level/Navigation.h"
+
+#include <cstdio>
+
+namespace Hx {
+
+    constexpr usize PathBenchmarkQueries = 1 << 14;
+    // Queries per Execute, about what a busy frame of AI would submit
+    constexpr usize PathBenchmarkBatch = 512;
+
+    struct PathRun {
+        f64 seconds;
+        usize found;
+        usize points;
+        f64 length;
+        u32 cacheHits;
+        u64 nodesExpanded;
+    };
+
+    static PathRun RunPaths(PathfindingService& service, const PathQuery* queries, usize count) {
+        PathRun run = {};
+        f64 start = Hx::GetTimeSeconds();
+
+        for (usize first = 0; first < count; first += PathBenchmarkBatch) {
+            usize batch = count - first < PathBenchmarkBatch ? count - first : PathBenchmarkBatch;
+            service.Clear();
+            for (usize i = 0; i < batch; ++i) {
+                service.Submit(queries[first + i]);
+            }
+            service.Execute();
+
+            for (u32 i = 0; i < batch; ++i) {
+                const PathResult& result = service.GetResult(i);
+                if (result.status != PathStatus::Found) continue;
+                run.found++;
+                run.points += result.pointCount;
+                run.length += result.length;
+            }
+            run.cacheHits += service.GetStats().cacheHits;
+            run.nodesExpanded += service.GetStats().nodesExpanded;
+        }
+
+        run.seconds = Hx::GetTimeSeconds() - start;
+        return run;
+    }
+
+    static void PrintPathRun(const char* label, const PathRun& run, usize count) {
+        printf("%-22s %8.2f ms, %9.0f paths/s, %5.1f%% cached, %6.0f nodes/search\n", label, run.seconds * 1000.0,
+               count / run.seconds, 100.0 * run.cacheHits / count,
+               count > run.cacheHits ? static_cast<f64>(run.nodesExpanded) / (count - run.cacheHits) : 0.0);
+    }
+
+    void RunPathBenchmark(BenchmarkContext& context) {
+        const MapData& map = *context.map;
+        Hx::ArenaAllocator& arena = *context.arena;
+
+        f64 buildStart = Hx::GetTimeSeconds();
+        NavGraph graph;
+        if (!BuildNavGraph(graph, map, arena)) {
+            printf("Failed to build the navigation graph\n");
+            return;
+        }
+        printf("Nav graph: %u nodes, %zu links, %.2f ms\n", graph.nodeCount, graph.linkCount,
+               (Hx::GetTimeSeconds() - buildStart) * 1000.0);
+
+        PathfindingSettings settings;
+        settings.cacheSlots = 1u << 16;
+        settings.cacheLinkCapacity = 1u << 22;
+
+        // Endpoints are the centres of subsectors an agent fits in
+        u32* open = Hx::AllocArray<u32>(&arena.base, graph.nodeCount);
+        usize count = PathBenchmarkQueries * context.scale;
+        PathQuery* queries = Hx::AllocArray<PathQuery>(&arena.base, count);
+        if (!open || !queries) {
+            printf("Out of memory for %zu queries\n", count);
+            return;
+        }
+
+        u32 openCount = 0;
+        for (u32 node = 0; node < graph.nodeCount; ++node) {
+            s32 sector = map.subsectorSectors[node];
+            if (sector < 0) continue;
+            s32 height = map.sectors[sector].ceilingHeight - map.sectors[sector].floorHeight;
+            if (static_cast<f32>(height) >= settings.agentHeight) open[openCount++] = node;
+        }
+        if (openCount == 0) {
+            printf("No subsector is tall enough for an agent\n");
+            return;
+        }
+
+        BenchmarkRandom random = { 0x9E3779B97F4A7C15ull };
+        for (usize i = 0; i < count; ++i) {
+            queries[i].start = graph.nodeCenters[open[random.Next() % openCount]];
+            queries[i].goal = graph.nodeCenters[open[random.Next() % openCount]];
+        }
+
+        PathfindingService single(nullptr, settings);
+        PathfindingService parallel(context.jobs, settings);
+        single.SetLevel(&map, &graph);
+        parallel.SetLevel(&map, &graph);
+
+        PathRun singleRun = RunPaths(single, queries, count);
+        PathRun parallelRun = RunPaths(parallel, queries, count);
+        // Same queries again, now answered from the corridor cache
+        PathRun cachedRun = RunPaths(parallel, queries, count);
+
+        printf("%zu queries in batches of %zu, %.1f%% found, %.1f points and %.0f units per path\n", count,
+               PathBenchmarkBatch, 100.0 * parallelRun.found / count,
+               parallelRun.found ? static_cast<f64>(parallelRun.points) / parallelRun.found : 0.0,
+               parallelRun.found ? parallelRun.length / parallelRun.found : 0.0);
+
+        char label[32];
+        PrintPathRun("1 thread:", singleRun, count);
+        snprintf(label, sizeof(label), "%u threads:", context.jobs->GetThreadCount());
+        PrintPathRun(label, parallelRun, count);
+        snprintf(label, sizeof(label), "%u threads, repeated:", context.jobs->GetThreadCount());
+        PrintPathRun(label, cachedRun, count);
+    }
+
+}
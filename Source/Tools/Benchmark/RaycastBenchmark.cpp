@@ -0,0 +1,157 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/World/Level/Raycast.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace Hx {
+
+    constexpr usize RaycastBenchmarkRays = 1 << 20;
+    constexpr u32 RaycastBenchmarkRepeats = 3;
+    constexpr f32 RaycastEyeHeight = 41.0f;
+    constexpr f32 RaycastMinLength = 64.0f;
+    constexpr f32 RaycastMaxLength = 2048.0f;
+    // Every line against every ray is slow, so verification checks this many evenly spread rays
+    constexpr usize RaycastVerifyRays = 4096;
+    constexpr f32 RaycastVerifyTolerance = 1e-4f;
+
+    // Tests the ray against every line segment in the map, with the same
+    // blocking rules as CastRay but none of the blockmap walk
+    static RayHit CastRayBruteForce(const MapData& map, const RayQuery& query) {
+        f32 dx = query.end.x - query.origin.x;
+        f32 dy = query.end.y - query.origin.y;
+        f32 dz = query.endZ - query.originZ;
+
+        RayHit hit = { 1.0f, 0.0f, -1, -1 };
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            f32 ex = static_cast<f32>(seg.v2[0] - seg.v1[0]);
+            f32 ey = static_cast<f32>(seg.v2[1] - seg.v1[1]);
+            f32 fx = static_cast<f32>(seg.v1[0]) - query.origin.x;
+            f32 fy = static_cast<f32>(seg.v1[1]) - query.origin.y;
+
+            f32 denominator = dx * ey - dy * ex;
+            if (denominator == 0.0f) continue;
+            f32 t = (fx * ey - fy * ex) / denominator;
+            f32 u = (fx * dy - fy * dx) / denominator;
+            if (t < 0.0f || t >= hit.fraction || u < 0.0f || u > 1.0f) continue;
+
+            if (seg.backSector >= 0) {
+                const MapSector& front = map.sectors[seg.frontSector];
+                const MapSector& back = map.sectors[seg.backSector];
+                s32 floor = front.floorHeight > back.floorHeight ? front.floorHeight : back.floorHeight;
+                s32 ceiling = front.ceilingHeight < back.ceilingHeight ? front.ceilingHeight : back.ceilingHeight;
+                f32 z = query.originZ + dz * t;
+                if (z >= static_cast<f32>(floor) && z <= static_cast<f32>(ceiling)) continue;
+            }
+
+            hit.fraction = t;
+            hit.lineSeg = static_cast<s32>(i);
+        }
+        return hit;
+    }
+
+    // Lines meeting at a vertex are hit at the same fraction, so only whether and where a ray stops is compared
+    static void VerifyRaycasts(BenchmarkContext& context, const RayQuery* queries, const RayHit* hits, usize count) {
+        const MapData& map = *context.map;
+        usize step = count > RaycastVerifyRays ? count / RaycastVerifyRays : 1;
+
+        usize checked = 0;
+        usize mismatches = 0;
+        for (usize i = 0; i < count; i += step) {
+            RayHit expected = CastRayBruteForce(map, queries[i]);
+            bool sameHit = (expected.lineSeg >= 0) == (hits[i].lineSeg >= 0);
+            if (!sameHit || std::fabs(expected.fraction - hits[i].fraction) > RaycastVerifyTolerance) {
+                if (mismatches < 8) {
+                    printf("Ray %zu: line %d at %.6f, brute force line %d at %.6f\n", i, hits[i].lineSeg, hits[i].fraction,
+                           expected.lineSeg, expected.fraction);
+                }
+                ++mismatches;
+            }
+            ++checked;
+        }
+
+        printf("Verify: %zu of %zu rays differ from brute force\n", mismatches, checked);
+        if (mismatches > 0) {
+            ++context.failures;
+        }
+    }
+
+    void RunRaycastBenchmark(BenchmarkContext& context) {
+        const MapData& map = *context.map;
+        Hx::ArenaAllocator& arena = *context.arena;
+
+        f64 buildStart = Hx::GetTimeSeconds();
+        Blockmap blockmap;
+        if (!BuildBlockmap(blockmap, map, arena)) {
+            printf("Failed to build the blockmap\n");
+            return;
+        }
+        printf("Blockmap: %ux%u cells, %zu line references, %.2f ms\n", blockmap.width, blockmap.height, blockmap.lineCount,
+               (Hx::GetTimeSeconds() - buildStart) * 1000.0);
+
+        usize count = RaycastBenchmarkRays * context.scale;
+        RayQuery* queries = Hx::AllocArray<RayQuery>(&arena.base, count);
+        RayHit* hits = Hx::AllocArray<RayHit>(&arena.base, count);
+        if (!queries || !hits) {
+            printf("Out of memory for %zu rays\n", count);
+            return;
+        }
+
+        // Rays start at eye height somewhere in an open sector and head off in any direction
+        BenchmarkRandom random = { 0x2545F4914F6CDD1Dull };
+        f32 minX = blockmap.originX;
+        f32 minY = blockmap.originY;
+        f32 spanX = blockmap.cellSize * static_cast<f32>(blockmap.width);
+        f32 spanY = blockmap.cellSize * static_cast<f32>(blockmap.height);
+
+        for (usize i = 0; i < count; ++i) {
+            Vector2 origin;
+            s32 sector = -1;
+            for (u32 attempt = 0; attempt < 64; ++attempt) {
+                origin = Vector2{ minX + random.NextFloat() * spanX, minY + random.NextFloat() * spanY };
+                sector = FindSector(map, origin);
+                if (sector >= 0 && map.sectors[sector].ceilingHeight > map.sectors[sector].floorHeight) break;
+            }
+
+            f32 floor = sector >= 0 ? static_cast<f32>(map.sectors[sector].floorHeight) : 0.0f;
+            f32 angle = random.NextFloat() * 6.2831853f;
+            f32 length = RaycastMinLength + random.NextFloat() * (RaycastMaxLength - RaycastMinLength);
+
+            RayQuery& query = queries[i];
+            query.origin = origin;
+            query.end = Vector2{ origin.x + std::cos(angle) * length, origin.y + std::sin(angle) * length };
+            query.originZ = floor + RaycastEyeHeight;
+            query.endZ = query.originZ + (random.NextFloat() - 0.5f) * 64.0f;
+        }
+
+        f64 singleSeconds = TimeBest(RaycastBenchmarkRepeats, [&]() { CastRays(map, blockmap, queries, hits, count, nullptr); });
+        f64 parallelSeconds = TimeBest(RaycastBenchmarkRepeats, [&]() { CastRays(map, blockmap, queries, hits, count, context.jobs); });
+
+        usize hitCount = 0;
+        f64 distanceSum = 0.0;
+        for (usize i = 0; i < count; ++i) {
+            if (hits[i].lineSeg >= 0) {
+                ++hitCount;
+                distanceSum += hits[i].distance;
+            }
+        }
+
+        printf("%zu rays, %.1f%% hit, %.1f average hit distance\n", count, 100.0 * hitCount / count,
+               hitCount ? distanceSum / hitCount : 0.0);
+        printf("1 thread:   %8.2f ms, %7.2f Mrays/s\n", singleSeconds * 1000.0, count / singleSeconds / 1e6);
+        printf("%u threads: %8.2f ms, %7.2f Mrays/s\n", context.jobs->GetThreadCount(), parallelSeconds * 1000.0,
+               count / parallelSeconds / 1e6);
+
+        if (context.verify) {
+            VerifyRaycasts(context, queries, hits, count);
+        }
+    }
+
+}
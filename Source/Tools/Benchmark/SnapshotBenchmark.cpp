@@ -0,0 +1,119 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/IO/AsyncFileWriter.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/World.h"
+#include "Engine/World/WorldSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize SnapshotBenchmarkEntities = 100000;
+    constexpr u32 SnapshotBenchmarkRepeats = 5;
+    constexpr const char* SnapshotBenchmarkFile = "SnapshotBenchmark.snap";
+
+    struct SnapshotPosition {
+        f32 x;
+        f32 y;
+        f32 z;
+    };
+
+    struct SnapshotVelocity {
+        f32 x;
+        f32 y;
+        f32 z;
+    };
+
+    struct SnapshotHealth {
+        f32 value;
+        u32 flags;
+    };
+
+    // Every saved handle has to come back alive with the same components and values
+    static void VerifySnapshot(BenchmarkContext& context, World& saved, World& loaded, const std::vector<EntityHandle>& entities) {
+        usize mismatches = 0;
+        for (EntityHandle entity : entities) {
+            bool same = loaded.IsAlive(entity) && loaded.GetComponentMask(entity) == saved.GetComponentMask(entity);
+            if (same) {
+                SnapshotHealth* health = saved.Get<SnapshotHealth>(entity);
+                SnapshotHealth* loadedHealth = loaded.Get<SnapshotHealth>(entity);
+                same = memcmp(saved.Get<SnapshotPosition>(entity), loaded.Get<SnapshotPosition>(entity), sizeof(SnapshotPosition)) == 0 &&
+                       memcmp(saved.Get<SnapshotVelocity>(entity), loaded.Get<SnapshotVelocity>(entity), sizeof(SnapshotVelocity)) == 0 &&
+                       (!health || memcmp(health, loadedHealth, sizeof(SnapshotHealth)) == 0);
+            }
+            mismatches += same ? 0 : 1;
+        }
+
+        bool sameCount = loaded.GetEntityCount() == saved.GetEntityCount();
+        printf("Verify: %zu of %zu entities differ after the round trip%s\n", mismatches, entities.size(),
+               sameCount ? "" : ", entity counts differ");
+        if (mismatches > 0 || !sameCount) {
+            ++context.failures;
+        }
+    }
+
+    void RunSnapshotBenchmark(BenchmarkContext& context) {
+        usize count = SnapshotBenchmarkEntities * context.scale;
+        Hx::ArenaAllocator& arena = *context.arena;
+
+        World world(arena);
+        std::vector<EntityHandle> entities(count);
+        for (usize i = 0; i < count; ++i) {
+            entities[i] = world.Create(SnapshotPosition{ static_cast<f32>(i), 0.0f, 0.0f }, SnapshotVelocity{ 1.0f, 0.5f, 0.25f });
+            if ((i & 3) == 0) {
+                world.Add(entities[i], SnapshotHealth{ 100.0f, static_cast<u32>(i) });
+            }
+        }
+
+        // Loading writes sector heights, so it gets a copy of the map's sectors
+        MapData map = *context.map;
+        map.sectors = Hx::AllocArray<MapSector>(&arena.base, map.sectorCount);
+        if (!map.sectors) {
+            printf("Out of memory for %zu sectors\n", map.sectorCount);
+            return;
+        }
+        memcpy(map.sectors, context.map->sectors, sizeof(MapSector) * map.sectorCount);
+
+        Hx::FileSystem fileSystem;
+        Hx::AsyncFileWriter writer(&fileSystem);
+
+        // The main thread only pays for the copy; the write is timed separately through Flush
+        bool saved = true;
+        auto save = [&]() { saved = SaveWorldSnapshot(SnapshotBenchmarkFile, world, &map, writer) && saved; };
+        auto flush = [&]() { writer.Flush(); };
+        f64 saveSeconds = TimeBest(SnapshotBenchmarkRepeats, save, flush);
+        f64 flushSeconds = TimeBest(SnapshotBenchmarkRepeats, flush, save);
+        if (!saved) {
+            printf("Failed to save %s\n", SnapshotBenchmarkFile);
+            return;
+        }
+
+        World loaded(arena);
+        bool loadedAll = true;
+        f64 loadSeconds = TimeBest(SnapshotBenchmarkRepeats, [&]() {
+            loadedAll = LoadWorldSnapshot(SnapshotBenchmarkFile, loaded, &map, fileSystem) && loadedAll;
+        });
+        if (!loadedAll) {
+            printf("Failed to load %s\n", SnapshotBenchmarkFile);
+            return;
+        }
+
+        usize size = world.GetSnapshotSize();
+        printf("%-32s %8.2f ms\n", "Save (main thread)", saveSeconds * 1000.0);
+        printf("%-32s %8.2f ms, %7.1f MB/s\n", "Write (writer thread)", flushSeconds * 1000.0, size / flushSeconds / (1024.0 * 1024.0));
+        printf("%-32s %8.2f ms, %7.1f MB/s\n", "Load", loadSeconds * 1000.0, size / loadSeconds / (1024.0 * 1024.0));
+        printf("%zu entities, %zu loaded, %.1f MB snapshot\n", world.GetEntityCount(), loaded.GetEntityCount(), size / (1024.0 * 1024.0));
+
+        if (context.verify) {
+            VerifySnapshot(context, world, loaded, entities);
+        }
+
+        remove(SnapshotBenchmarkFile);
+    }
+
+}
@@ -0,0 +1,176 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/World/SpatialGrid.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize SpatialBenchmarkCounts[] = { 10000, 100000, 1000000 };
+    constexpr u32 SpatialBenchmarkRepeats = 3;
+    // One query per this many entities each frame, as if a tenth of them looked around
+    constexpr usize SpatialBenchmarkQueryRatio = 10;
+    constexpr f32 SpatialBenchmarkQueryRadius = 256.0f;
+    constexpr f32 SpatialBenchmarkEntityRadius = 16.0f;
+    // Brute force tests every entity per query, so verification checks this many evenly spread queries
+    constexpr usize SpatialVerifyQueries = 256;
+    // and only looks for every overlapping pair at up to this many entities
+    constexpr usize SpatialVerifyPairEntities = 20000;
+
+    // Runs a sample of radius queries and, for small counts, the pair search
+    // again by testing every entity, the same touching test the grid uses
+    static void VerifySpatial(BenchmarkContext& context, SpatialGrid& grid, const std::vector<Vector2>& positions,
+                              const std::vector<f32>& radii, const std::vector<Vector2>& centers) {
+        usize count = positions.size();
+        usize step = centers.size() > SpatialVerifyQueries ? centers.size() / SpatialVerifyQueries : 1;
+
+        grid.Clear();
+        std::vector<usize> sampled;
+        for (usize i = 0; i < centers.size(); i += step) {
+            grid.SubmitRadius(centers[i], SpatialBenchmarkQueryRadius);
+            sampled.push_back(i);
+        }
+        grid.Execute();
+
+        usize mismatches = 0;
+        std::vector<u32> found;
+        std::vector<u32> expected;
+        for (u32 ticket = 0; ticket < sampled.size(); ++ticket) {
+            const Vector2& center = centers[sampled[ticket]];
+            expected.clear();
+            for (usize i = 0; i < count; ++i) {
+                f32 dx = positions[i].x - center.x;
+                f32 dy = positions[i].y - center.y;
+                f32 touching = SpatialBenchmarkQueryRadius + radii[i];
+                if (dx * dx + dy * dy <= touching * touching) {
+                    expected.push_back(static_cast<u32>(i));
+                }
+            }
+
+            SpatialQueryResult result = grid.GetResult(ticket);
+            found.assign(result.items, result.items + result.count);
+            std::sort(found.begin(), found.end());
+            if (found != expected) {
+                ++mismatches;
+            }
+        }
+        printf("Verify: %zu of %zu radius queries differ from brute force\n", mismatches, sampled.size());
+
+        if (count <= SpatialVerifyPairEntities) {
+            std::vector<u64> pairs;
+            for (usize a = 0; a < count; ++a) {
+                for (usize b = a + 1; b < count; ++b) {
+                    f32 dx = positions[b].x - positions[a].x;
+                    f32 dy = positions[b].y - positions[a].y;
+                    f32 touching = radii[a] + radii[b];
+                    if (dx * dx + dy * dy <= touching * touching) {
+                        pairs.push_back(static_cast<u64>(a) << 32 | b);
+                    }
+                }
+            }
+
+            std::vector<u64> gridPairs(grid.FindOverlappingPairs());
+            for (usize i = 0; i < gridPairs.size(); ++i) {
+                gridPairs[i] = static_cast<u64>(grid.GetPairs()[i].first) << 32 | grid.GetPairs()[i].second;
+            }
+            std::sort(gridPairs.begin(), gridPairs.end());
+
+            bool pairsMatch = gridPairs == pairs;
+            printf("Verify: %zu pairs, %s brute force\n", gridPairs.size(), pairsMatch ? "matching" : "NOT matching");
+            mismatches += pairsMatch ? 0 : 1;
+        }
+
+        if (mismatches > 0) {
+            ++context.failures;
+        }
+    }
+
+    void RunSpatialBenchmark(BenchmarkContext& context) {
+        const MapData& map = *context.map;
+        if (map.lineSegmentCount == 0) {
+            printf("Map has no line segments\n");
+            return;
+        }
+
+        Vector2 min = { static_cast<f32>(map.lineSegments[0].v1[0]), static_cast<f32>(map.lineSegments[0].v1[1]) };
+        Vector2 max = min;
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const s32* vertices[2] = { map.lineSegments[i].v1, map.lineSegments[i].v2 };
+            for (const s32* v : vertices) {
+                min.x = v[0] < min.x ? static_cast<f32>(v[0]) : min.x;
+                min.y = v[1] < min.y ? static_cast<f32>(v[1]) : min.y;
+                max.x = v[0] > max.x ? static_cast<f32>(v[0]) : max.x;
+                max.y = v[1] > max.y ? static_cast<f32>(v[1]) : max.y;
+            }
+        }
+
+        printf("%-10s %10s %10s %12s %12s %10s %10s\n", "entities", "rebuild", "radius", "radius/s", "box/s", "pairs", "pair pass");
+
+        for (usize baseCount : SpatialBenchmarkCounts) {
+            usize count = baseCount * context.scale;
+            BenchmarkRandom random = { 0x5EED5EED12345678ull ^ count };
+
+            std::vector<Vector2> positions(count);
+            std::vector<f32> radii(count, SpatialBenchmarkEntityRadius);
+            for (Vector2& position : positions) {
+                position.x = min.x + random.NextFloat() * (max.x - min.x);
+                position.y = min.y + random.NextFloat() * (max.y - min.y);
+            }
+
+            usize queryCount = count / SpatialBenchmarkQueryRatio;
+            std::vector<Vector2> centers(queryCount);
+            for (Vector2& center : centers) {
+                center = positions[random.Next() % count];
+            }
+
+            SpatialGrid grid(context.jobs);
+            grid.SetBounds(min, max);
+
+            f64 rebuildSeconds = TimeBest(SpatialBenchmarkRepeats, [&]() { grid.Rebuild(positions.data(), radii.data(), count); });
+
+            usize found = 0;
+            f64 radiusSeconds = TimeBest(SpatialBenchmarkRepeats, [&]() {
+                grid.Clear();
+                for (const Vector2& center : centers) {
+                    grid.SubmitRadius(center, SpatialBenchmarkQueryRadius);
+                }
+                grid.Execute();
+
+                found = 0;
+                for (u32 i = 0; i < queryCount; ++i) {
+                    found += grid.GetResult(i).count;
+                }
+            });
+
+            f64 boxSeconds = TimeBest(SpatialBenchmarkRepeats, [&]() {
+                grid.Clear();
+                for (const Vector2& center : centers) {
+                    Vector2 boxMin = { center.x - SpatialBenchmarkQueryRadius, center.y - SpatialBenchmarkQueryRadius };
+                    Vector2 boxMax = { center.x + SpatialBenchmarkQueryRadius, center.y + SpatialBenchmarkQueryRadius };
+                    grid.SubmitBox(boxMin, boxMax);
+                }
+                grid.Execute();
+            });
+
+            usize pairs = 0;
+            f64 pairSeconds = TimeBest(SpatialBenchmarkRepeats, [&]() { pairs = grid.FindOverlappingPairs(); });
+
+            printf("%-10zu %7.2f ms %7.2f ms %10.2f M %10.2f M %10zu %7.2f ms\n", count, rebuildSeconds * 1000.0,
+                   radiusSeconds * 1000.0, queryCount / radiusSeconds / 1e6, queryCount / boxSeconds / 1e6, pairs,
+                   pairSeconds * 1000.0);
+
+            const SpatialGridStats& stats = grid.GetStats();
+            printf("%-10s %u cells of %.0f, %.1f found per radius query\n", "", stats.cellCount, stats.cellSize,
+                   queryCount > 0 ? static_cast<f64>(found) / queryCount : 0.0);
+
+            if (context.verify) {
+                VerifySpatial(context, grid, positions, radii, centers);
+            }
+        }
+    }
+
+}
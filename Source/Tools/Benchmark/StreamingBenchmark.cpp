@@ -0,0 +1,193 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/MapQuery.h"
+#include "Engine/World/Level/WorldStreaming.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Hx {
+
+    constexpr u32 StreamingBenchmarkFrames = 600;
+    // Sectors moved near the camera each frame, like doors and lifts being used
+    constexpr u32 StreamingBenchmarkMovesPerFrame = 8;
+    // Every so many frames a sector that was not marked dynamic moves as well
+    constexpr u32 StreamingBenchmarkStaticMoveInterval = 20;
+    // Moved sectors open to between zero and two of these above their floor
+    constexpr s32 StreamingBenchmarkHeightStep = 64;
+    // Pools are checked against a fresh build this often while the camera travels
+    constexpr u32 StreamingVerifyInterval = 100;
+
+    // One sector in three may move, the rest only change through a relayout
+    static bool IsBenchmarkDynamicSector(const MapData& map, u32 sector, void* userData) {
+        return sector % 3 == 0;
+    }
+
+    // Lets every requested cluster and every deferred move land, so the pools
+    // should hold exactly what the map builds to now
+    static void SettleStreamer(WorldStreamer& streamer, Vector2 position) {
+        for (u32 i = 0; i < 2; ++i) {
+            streamer.FinishPending();
+            streamer.Update(position);
+        }
+    }
+
+    // Compares every resident sector's triangles in the pools with the same
+    // sector built from the map as it is now, vertex for vertex
+    static void VerifyStreamer(BenchmarkContext& context, const WorldStreamer& streamer, const MapData& map,
+                               const WorldMeshSettings& meshSettings) {
+        const Vertex* poolVertices = streamer.GetPoolVertices();
+        const u32* poolIndices = streamer.GetPoolIndices();
+
+        std::vector<Vertex> vertices;
+        std::vector<u32> indices;
+        usize checked = 0;
+        usize mismatches = 0;
+
+        for (u32 s = 0; s < map.sectorCount; ++s) {
+            StreamedSectorDraw draw;
+            if (!streamer.GetSectorDraw(s, draw)) continue;
+            ++checked;
+
+            WorldMeshSection section = BuildSectorGeometry(map, meshSettings, s, nullptr, nullptr);
+            vertices.resize(section.vertexCount);
+            indices.resize(section.indexCount);
+            BuildSectorGeometry(map, meshSettings, s, vertices.data(), indices.data());
+
+            bool same = draw.indexCount == section.indexCount;
+            for (u32 k = 0; same && k < section.indexCount; ++k) {
+                const Vertex& pooled = poolVertices[draw.baseVertex + poolIndices[draw.firstIndex + k]];
+                same = memcmp(&pooled, &vertices[indices[k]], sizeof(Vertex)) == 0;
+            }
+            mismatches += same ? 0 : 1;
+        }
+
+        printf("Verify: %zu of %zu resident sectors differ from a fresh build\n", mismatches, checked);
+        if (mismatches > 0 || checked == 0) {
+            context.failures++;
+        }
+    }
+
+    void RunStreamingBenchmark(BenchmarkContext& context) {
+        Hx::ArenaAllocator& arena = *context.arena;
+        u32 frameCount = StreamingBenchmarkFrames * context.scale;
+
+        // Sectors move, so the benchmark gets heights of its own
+        MapData map = *context.map;
+        map.sectors = Hx::AllocArray<MapSector>(&arena.base, map.sectorCount);
+        if (map.sectorCount > 0 && !map.sectors) {
+            printf("Out of memory copying %zu sectors\n", map.sectorCount);
+            context.failures++;
+            return;
+        }
+        memcpy(map.sectors, context.map->sectors, sizeof(MapSector) * map.sectorCount);
+
+        f32 minX = 0.0f;
+        f32 minY = 0.0f;
+        f32 maxX = 0.0f;
+        f32 maxY = 0.0f;
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            for (const s32* point : { map.lineSegments[i].v1, map.lineSegments[i].v2 }) {
+                f32 x = static_cast<f32>(point[0]);
+                f32 y = static_cast<f32>(point[1]);
+                minX = i == 0 || x < minX ? x : minX;
+                minY = i == 0 || y < minY ? y : minY;
+                maxX = i == 0 || x > maxX ? x : maxX;
+                maxY = i == 0 || y > maxY ? y : maxY;
+            }
+        }
+
+        // Small clusters and a tight budget, so the pools churn as the camera crosses the map
+        WorldStreamingSettings settings;
+        settings.clusterSize = 512.0f;
+        settings.loadRadius = 1024.0f;
+        settings.unloadRadius = 1536.0f;
+        settings.memoryBudget = Hx::Megabytes(16);
+        settings.isDynamicSector = IsBenchmarkDynamicSector;
+
+        // The same sectors as the streamer picks, for the reference builds
+        std::vector<u8> dynamicSectors((map.sectorCount + 7) / 8, 0);
+        for (u32 s = 0; s < map.sectorCount; ++s) {
+            if (IsBenchmarkDynamicSector(map, s, nullptr)) {
+                dynamicSectors[s >> 3] |= static_cast<u8>(1u << (s & 7));
+            }
+        }
+        WorldMeshSettings referenceSettings = settings.mesh;
+        referenceSettings.dynamicSectors = dynamicSectors.data();
+
+        f64 start = Hx::GetTimeSeconds();
+        WorldStreamer streamer(map, nullptr, context.jobs, arena, settings);
+        printf("%-32s %8.2f ms\n", "Size sectors and clusters", (Hx::GetTimeSeconds() - start) * 1000.0);
+
+        Vector2 position = { minX, minY };
+        streamer.Update(position);
+        start = Hx::GetTimeSeconds();
+        streamer.FinishPending();
+        printf("%-32s %8.2f ms\n", "First load around the camera", (Hx::GetTimeSeconds() - start) * 1000.0);
+
+        BenchmarkRandom random = { 0x5EC7025EC7025EC7ull };
+        f64 updateSeconds = 0.0;
+        f64 maxUpdateSeconds = 0.0;
+        u64 movedSectors = 0;
+        u64 dynamicUploads = 0;
+        u64 rebuiltClusters = 0;
+
+        for (u32 frame = 0; frame < frameCount; ++frame) {
+            // Corner to corner and back again
+            f32 t = static_cast<f32>(frame) / static_cast<f32>(frameCount) * 2.0f;
+            t = t > 1.0f ? 2.0f - t : t;
+            position = Vector2{ minX + (maxX - minX) * t, minY + (maxY - minY) * t };
+
+            u32 moves = StreamingBenchmarkMovesPerFrame + (frame % StreamingBenchmarkStaticMoveInterval == 0 ? 1 : 0);
+            for (u32 i = 0; i < moves; ++i) {
+                f32 angle = random.NextFloat() * 6.2831853f;
+                f32 distance = random.NextFloat() * settings.loadRadius;
+                s32 sector = FindSector(map, Vector2{ position.x + Hx::Cos(angle) * distance, position.y + Hx::Sin(angle) * distance });
+                if (sector < 0) continue;
+
+                bool dynamic = IsBenchmarkDynamicSector(map, static_cast<u32>(sector), nullptr);
+                if (i < StreamingBenchmarkMovesPerFrame && !dynamic) continue;
+
+                MapSector& moved = map.sectors[sector];
+                moved.ceilingHeight = moved.floorHeight + static_cast<s32>(random.Next() % 3) * StreamingBenchmarkHeightStep;
+                streamer.MarkSectorMoved(static_cast<u32>(sector));
+            }
+
+            start = Hx::GetTimeSeconds();
+            streamer.Update(position);
+            f64 seconds = Hx::GetTimeSeconds() - start;
+            updateSeconds += seconds;
+            maxUpdateSeconds = seconds > maxUpdateSeconds ? seconds : maxUpdateSeconds;
+
+            WorldStreamingStats stats = streamer.GetStats();
+            movedSectors += stats.movedSectorCount;
+            dynamicUploads += stats.dynamicUploadCount;
+            rebuiltClusters += stats.rebuiltClusterCount;
+
+            if (context.verify && (frame + 1) % StreamingVerifyInterval == 0) {
+                SettleStreamer(streamer, position);
+                VerifyStreamer(context, streamer, map, referenceSettings);
+            }
+        }
+
+        printf("%-32s %8.3f ms average, %.3f ms worst over %u frames\n", "Update", updateSeconds * 1000.0 / frameCount,
+               maxUpdateSeconds * 1000.0, frameCount);
+
+        WorldStreamingStats stats = streamer.GetStats();
+        printf("%u clusters, %u dynamic sectors, %llu loads, %llu evictions, %.2f ms average latency\n", stats.clusterCount,
+               stats.dynamicSectorCount, static_cast<unsigned long long>(stats.loadCount),
+               static_cast<unsigned long long>(stats.evictionCount), stats.averageLatencySeconds * 1000.0);
+        printf("%llu moved sectors rewritten in %llu uploads, %llu clusters rebuilt for static moves\n",
+               static_cast<unsigned long long>(movedSectors), static_cast<unsigned long long>(dynamicUploads),
+               static_cast<unsigned long long>(rebuiltClusters));
+
+        if (context.verify) {
+            SettleStreamer(streamer, position);
+            VerifyStreamer(context, streamer, map, referenceSettings);
+        }
+    }
+
+}
@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/World/Transform.h"
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize TransformBenchmarkNodes = 262144;
+    constexpr u32 TransformBenchmarkFanout = 4;
+    constexpr u32 TransformBenchmarkDepth = 5;
+    constexpr u32 TransformBenchmarkFrames = 60;
+    constexpr u32 TransformBenchmarkRepeats = 3;
+    // Interpolated matrices may be off by rounding at alpha 1
+    constexpr f32 TransformVerifyTolerance = 1e-4f;
+
+    // Keeps the timed reads from being optimised away
+    static volatile f32 TransformBenchmarkSink;
+
+    static bool NearlyEqual(const Matrix4& a, const Matrix4& b) {
+        for (u32 i = 0; i < 16; ++i) {
+            f32 difference = a.m[i] - b.m[i];
+            f32 magnitude = b.m[i] < 0.0f ? -b.m[i] : b.m[i];
+            if (difference * difference > TransformVerifyTolerance * TransformVerifyTolerance * (magnitude > 1.0f ? magnitude * magnitude : 1.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static LocalTransform MakeBenchLocal(BenchmarkRandom& random) {
+        LocalTransform local;
+        local.position = Vector3(random.NextFloat() * 8.0f, random.NextFloat() * 8.0f, random.NextFloat() * 8.0f);
+        local.rotation = FromAxisAngle(Vector3(0.0f, 1.0f, 0.0f), random.NextFloat() * 6.2831853f);
+        return local;
+    }
+
+    static void RunFrames(TransformHierarchy& transforms, const std::vector<TransformHandle>& nodes, usize changesPerFrame,
+                          BenchmarkRandom& random, const char* label) {
+        f64 seconds = 0.0;
+        u64 updated = 0;
+        u64 roots = 0;
+        for (u32 frame = 0; frame < TransformBenchmarkFrames; ++frame) {
+            for (usize i = 0; i < changesPerFrame; ++i) {
+                TransformHandle node = nodes[random.Next() % nodes.size()];
+                transforms.SetLocal(node, MakeBenchLocal(random));
+            }
+
+            transforms.Update();
+            const TransformStats& stats = transforms.GetStats();
+            seconds += stats.updateSeconds;
+            updated += stats.updatedCount;
+            roots += stats.dirtyRootCount;
+        }
+
+        printf("%-28s %8.3f ms/frame, %9.1f matrices/frame from %7.1f changed subtrees\n", label,
+               seconds * 1000.0 / TransformBenchmarkFrames, static_cast<f64>(updated) / TransformBenchmarkFrames,
+               static_cast<f64>(roots) / TransformBenchmarkFrames);
+    }
+
+    void RunTransformBenchmark(BenchmarkContext& context) {
+        usize count = TransformBenchmarkNodes * context.scale;
+        BenchmarkRandom random = { 0xD1B54A32D192ED03ull };
+
+        // Complete trees of the given fanout and depth, each created depth first
+        TransformHierarchy transforms;
+        std::vector<TransformHandle> nodes;
+        nodes.reserve(count);
+
+        std::vector<std::pair<TransformHandle, u32>> stack;
+        while (nodes.size() < count) {
+            stack.push_back({ TransformHandle{}, 0 });
+            while (!stack.empty() && nodes.size() < count) {
+                auto [parent, depth] = stack.back();
+                stack.pop_back();
+
+                TransformHandle node = transforms.Create(MakeBenchLocal(random), parent);
+                nodes.push_back(node);
+                if (depth + 1 < TransformBenchmarkDepth) {
+                    for (u32 c = 0; c < TransformBenchmarkFanout; ++c) {
+                        stack.push_back({ node, depth + 1 });
+                    }
+                }
+            }
+            stack.clear();
+        }
+
+        // Move every 64th node under a random earlier one, which forces a breadth first rebuild
+        for (usize i = 64; i < nodes.size(); i += 64) {
+            transforms.SetParent(nodes[i], nodes[random.Next() % i]);
+        }
+
+        f64 start = Hx::GetTimeSeconds();
+        transforms.Update();
+        const TransformStats& stats = transforms.GetStats();
+        printf("%u transforms, first update with reorder %.2f ms (%u matrices)\n", stats.transformCount,
+               (Hx::GetTimeSeconds() - start) * 1000.0, stats.updatedCount);
+
+        RunFrames(transforms, nodes, 0, random, "Nothing changed");
+        RunFrames(transforms, nodes, 100, random, "100 changes per frame");
+        RunFrames(transforms, nodes, count / 100, random, "1% changed per frame");
+        RunFrames(transforms, nodes, count, random, "Everything changed");
+
+        // Half the nodes move in one more step, then every node is read between the two as a frame would
+        std::vector<Matrix4> before(count);
+        for (usize i = 0; i < count; ++i) {
+            before[i] = transforms.GetWorldMatrix(nodes[i]);
+        }
+        for (usize i = 0; i < count; i += 2) {
+            transforms.SetLocal(nodes[i], MakeBenchLocal(random));
+        }
+        transforms.Update();
+
+        f64 seconds = TimeBest(TransformBenchmarkRepeats, [&]() {
+            f32 sum = 0.0f;
+            for (TransformHandle node : nodes) {
+                sum += transforms.GetInterpolatedWorldMatrix(node, 0.5f).m[12];
+            }
+            TransformBenchmarkSink = sum;
+        });
+        printf("%-28s %8.3f ms for %zu matrices\n", "Interpolated read", seconds * 1000.0, count);
+
+        if (context.verify) {
+            usize mismatches = 0;
+            for (usize i = 0; i < count; ++i) {
+                bool same = NearlyEqual(transforms.GetInterpolatedWorldMatrix(nodes[i], 0.0f), before[i]) &&
+                            NearlyEqual(transforms.GetInterpolatedWorldMatrix(nodes[i], 1.0f), transforms.GetWorldMatrix(nodes[i]));
+                mismatches += same ? 0 : 1;
+            }
+
+            printf("Verify: %zu of %zu interpolated matrices differ from the last two updates at their ends\n", mismatches, count);
+            if (mismatches > 0) {
+                context.failures++;
+            }
+        }
+    }
+
+}
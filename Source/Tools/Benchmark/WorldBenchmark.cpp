@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/World.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace Hx {
+
+    constexpr usize WorldBenchmarkEntities = 1000000;
+    constexpr u32 WorldBenchmarkRepeats = 3;
+
+    struct BenchPosition {
+        f32 x;
+        f32 y;
+        f32 z;
+    };
+
+    struct BenchVelocity {
+        f32 x;
+        f32 y;
+        f32 z;
+    };
+
+    struct BenchHealth {
+        f32 value;
+    };
+
+    static void PrintRate(const char* label, usize count, f64 seconds) {
+        printf("%-32s %8.2f ms, %7.2f M/s\n", label, seconds * 1000.0, count / seconds / 1e6);
+    }
+
+    void RunWorldBenchmark(BenchmarkContext& context) {
+        usize count = WorldBenchmarkEntities * context.scale;
+        Hx::ArenaAllocator& arena = *context.arena;
+        Hx::JobSystem& jobs = *context.jobs;
+
+        World world(arena);
+        std::vector<EntityHandle> entities(count);
+
+        // The first round takes chunks and records from the arena, later rounds reuse them
+        f64 start = Hx::GetTimeSeconds();
+        for (usize i = 0; i < count; ++i) {
+            entities[i] = world.Create(BenchPosition{ static_cast<f32>(i), 0.0f, 0.0f }, BenchVelocity{ 1.0f, 0.5f, 0.25f });
+        }
+        PrintRate("Create (first, one at a time)", count, Hx::GetTimeSeconds() - start);
+
+        start = Hx::GetTimeSeconds();
+        for (usize i = 0; i < count; ++i) {
+            world.DestroyEntity(entities[i]);
+        }
+        PrintRate("Destroy (in creation order)", count, Hx::GetTimeSeconds() - start);
+
+        auto createAll = [&]() {
+            for (usize i = 0; i < count; ++i) {
+                entities[i] = world.Create(BenchPosition{ static_cast<f32>(i), 0.0f, 0.0f }, BenchVelocity{ 1.0f, 0.5f, 0.25f });
+            }
+        };
+
+        // Reverse order always removes the last row, the best case for swap removal
+        auto destroyAll = [&]() {
+            for (usize i = count; i-- > 0;) {
+                world.DestroyEntity(entities[i]);
+            }
+        };
+
+        f64 createSeconds = TimeBest(WorldBenchmarkRepeats, createAll, [&]() { if (world.GetEntityCount() > 0) destroyAll(); });
+        f64 destroySeconds = TimeBest(WorldBenchmarkRepeats, destroyAll, [&]() { if (world.GetEntityCount() == 0) createAll(); });
+        PrintRate("Create (recycled, one at a time)", count, createSeconds);
+        PrintRate("Destroy (reverse order)", count, destroySeconds);
+
+        ComponentMask mask = MakeComponentMask<BenchPosition, BenchVelocity>();
+        f64 bulkSeconds = TimeBest(WorldBenchmarkRepeats, [&]() {
+            world.CreateEntities(mask, count, entities.data());
+            for (usize i = 0; i < count; ++i) {
+                world.DestroyEntity(entities[i]);
+            }
+        });
+        PrintRate("Bulk create + destroy", count, bulkSeconds);
+
+        // A quarter of the entities also carry health, splitting them over two archetypes
+        for (usize i = 0; i < count; ++i) {
+            entities[i] = world.Create(BenchPosition{ static_cast<f32>(i), 0.0f, 0.0f }, BenchVelocity{ 1.0f, 0.5f, 0.25f });
+            if ((i & 3) == 0) {
+                world.Add(entities[i], BenchHealth{ 100.0f });
+            }
+        }
+
+        constexpr f32 deltaTime = 1.0f / 60.0f;
+        auto integrate = [](BenchPosition& position, const BenchVelocity& velocity) {
+            position.x += velocity.x * deltaTime;
+            position.y += velocity.y * deltaTime;
+            position.z += velocity.z * deltaTime;
+        };
+
+        f64 eachSeconds = TimeBest(WorldBenchmarkRepeats, [&]() { world.Each<BenchPosition, BenchVelocity>(integrate); });
+        f64 parallelSeconds = TimeBest(WorldBenchmarkRepeats, [&]() { world.ParallelEach<BenchPosition, BenchVelocity>(jobs, integrate); });
+
+        PrintRate("Position += velocity", count, eachSeconds);
+        char label[64];
+        snprintf(label, sizeof(label), "Position += velocity (%u threads)", jobs.GetThreadCount());
+        PrintRate(label, count, parallelSeconds);
+
+        WorldStats stats = world.GetStats();
+        printf("%zu entities, %zu archetypes, %zu chunks (%zu free), %.1f MB reserved\n", stats.entityCount,
+               stats.archetypeCount, stats.chunkCount, stats.freeChunkCount, stats.bytesReserved / (1024.0 * 1024.0));
+    }
+
+}
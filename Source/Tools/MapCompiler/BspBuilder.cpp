@@ -0,0 +1,347 @@
+#include "BspBuilder.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+
+namespace Hx {
+
+    constexpr f64 BspEpsilon = 1e-4;
+    constexpr u32 NoPartitionLine = ~0u;
+
+    struct BspPoint {
+        f64 x;
+        f64 y;
+    };
+
+    // A convex piece of a subsector. lines[i] is the line segment the edge
+    // from points[i] to points[i + 1] lies on, or NoPartitionLine for edges
+    // created by cutting the piece.
+    struct BspPolygon {
+        u32 subsector;
+        std::vector<BspPoint> points;
+        std::vector<u32> lines;
+    };
+
+    // A point is in front when nx * x + ny * y - d >= 0
+    struct BspLine {
+        f64 nx;
+        f64 ny;
+        f64 d;
+    };
+
+    struct BspTreeNode {
+        BspLine line;
+        BspTreeNode* children[2];
+        u32 leafSubsector;
+    };
+
+    struct BspBuildContext {
+        const MapData* map;
+        const BspBuildSettings* settings;
+        JobSystem* jobs;
+
+        std::atomic<u32> nodeCount{ 0 };
+        std::atomic<u32> leafCount{ 0 };
+        std::atomic<u32> splitCount{ 0 };
+        std::atomic<u32> maxDepth{ 0 };
+        std::atomic<u64> leafDepthSum{ 0 };
+        std::atomic<u32> unresolvedCount{ 0 };
+    };
+
+    static BspLine GetSegmentLine(const MapLineSegment& seg) {
+        f64 dx = static_cast<f64>(seg.v2[0] - seg.v1[0]);
+        f64 dy = static_cast<f64>(seg.v2[1] - seg.v1[1]);
+        f64 length = std::sqrt(dx * dx + dy * dy);
+
+        // Left of the segment's direction is the front, which is the inside of a counter clockwise subsector
+        BspLine line;
+        line.nx = length > 0.0 ? -dy / length : 0.0;
+        line.ny = length > 0.0 ? dx / length : 0.0;
+        line.d = line.nx * seg.v1[0] + line.ny * seg.v1[1];
+        return line;
+    }
+
+    static inline f64 DistanceToLine(const BspLine& line, const BspPoint& p) {
+        return line.nx * p.x + line.ny * p.y - line.d;
+    }
+
+    enum class BspSide : u8 {
+        Front,
+        Back,
+        Split
+    };
+
+    static BspSide ClassifyPolygon(const BspPolygon& poly, const BspLine& line) {
+        bool front = false;
+        bool back = false;
+        for (const BspPoint& p : poly.points) {
+            f64 dist = DistanceToLine(line, p);
+            if (dist > BspEpsilon) front = true;
+            else if (dist < -BspEpsilon) back = true;
+        }
+
+        if (front && back) return BspSide::Split;
+        return back ? BspSide::Back : BspSide::Front;
+    }
+
+    // Keeps the part of poly on the given side (+1 front, -1 back) of the line
+    static void ClipPolygon(const BspPolygon& poly, const BspLine& line, f64 sign, BspPolygon& out) {
+        out.subsector = poly.subsector;
+        out.points.clear();
+        out.lines.clear();
+
+        usize count = poly.points.size();
+        for (usize i = 0; i < count; ++i) {
+            const BspPoint& a = poly.points[i];
+            const BspPoint& b = poly.points[(i + 1) % count];
+            f64 da = DistanceToLine(line, a) * sign;
+            f64 db = DistanceToLine(line, b) * sign;
+            bool insideA = da >= -BspEpsilon;
+            bool insideB = db >= -BspEpsilon;
+
+            if (insideA) {
+                out.points.push_back(a);
+                out.lines.push_back(insideB ? poly.lines[i] : NoPartitionLine);
+
+                if (!insideB && da > BspEpsilon) {
+                    // Leaving through the partition: the original edge runs up to the crossing
+                    f64 t = da / (da - db);
+                    out.lines.back() = poly.lines[i];
+                    out.points.push_back(BspPoint{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t });
+                    out.lines.push_back(NoPartitionLine);
+                }
+            } else if (insideB && db > BspEpsilon) {
+                // Entering: the crossing continues along the original edge
+                f64 t = da / (da - db);
+                out.points.push_back(BspPoint{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t });
+                out.lines.push_back(poly.lines[i]);
+            }
+        }
+    }
+
+    static bool ChoosePartition(BspBuildContext& ctx, const std::vector<BspPolygon>& polys, BspLine& outLine) {
+        std::vector<u32> candidates;
+        for (const BspPolygon& poly : polys) {
+            for (u32 line : poly.lines) {
+                if (line != NoPartitionLine) candidates.push_back(line);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        usize maxCandidates = ctx.settings->maxCandidates > 0 ? ctx.settings->maxCandidates : 1;
+        usize stride = (candidates.size() + maxCandidates - 1) / maxCandidates;
+        if (stride == 0) stride = 1;
+
+        bool found = false;
+        u64 bestCost = ~0ull;
+
+        // Sampling can skip every useful line (say, all walls parallel to the
+        // one that matters), so fall back to a full scan before giving up
+        for (;;) {
+            for (usize c = 0; c < candidates.size(); c += stride) {
+                BspLine line = GetSegmentLine(ctx.map->lineSegments[candidates[c]]);
+
+                u64 front = 0, back = 0, split = 0;
+                for (const BspPolygon& poly : polys) {
+                    switch (ClassifyPolygon(poly, line)) {
+                        case BspSide::Front: front++; break;
+                        case BspSide::Back: back++; break;
+                        case BspSide::Split: split++; break;
+                    }
+                }
+
+                // A partition with everything on one side makes no progress
+                if (split == 0 && (front == 0 || back == 0)) continue;
+
+                u64 imbalance = front > back ? front - back : back - front;
+                u64 cost = split * ctx.settings->splitWeight + imbalance;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    outLine = line;
+                    found = true;
+                }
+            }
+
+            if (found || stride == 1) break;
+            stride = 1;
+        }
+
+        return found;
+    }
+
+    static BspTreeNode* MakeLeaf(BspBuildContext& ctx, u32 subsector, u32 depth) {
+        BspTreeNode* node = new BspTreeNode{};
+        node->leafSubsector = subsector;
+
+        ctx.leafCount.fetch_add(1, std::memory_order_relaxed);
+        ctx.leafDepthSum.fetch_add(depth, std::memory_order_relaxed);
+
+        u32 currentMax = ctx.maxDepth.load(std::memory_order_relaxed);
+        while (depth > currentMax && !ctx.maxDepth.compare_exchange_weak(currentMax, depth)) {}
+
+        return node;
+    }
+
+    static BspTreeNode* BuildNode(BspBuildContext& ctx, std::vector<BspPolygon>&& polys, u32 depth);
+
+    struct BspBuildTask {
+        BspBuildContext* ctx;
+        std::vector<BspPolygon> polys;
+        u32 depth;
+        BspTreeNode* result;
+    };
+
+    static void BuildNodeJob(void* data) {
+        BspBuildTask* task = static_cast<BspBuildTask*>(data);
+        task->result = BuildNode(*task->ctx, std::move(task->polys), task->depth);
+    }
+
+    static BspTreeNode* BuildNode(BspBuildContext& ctx, std::vector<BspPolygon>&& polys, u32 depth) {
+        bool singleSubsector = std::all_of(polys.begin(), polys.end(), [&](const BspPolygon& poly) {
+            return poly.subsector == polys[0].subsector;
+        });
+
+        // Pieces of one convex subsector together still form that subsector
+        if (singleSubsector) {
+            return MakeLeaf(ctx, polys[0].subsector, depth);
+        }
+
+        BspLine line;
+        if (!ChoosePartition(ctx, polys, line)) {
+            // Only happens with overlapping subsectors, which the editor should never produce
+            ctx.unresolvedCount.fetch_add(1, std::memory_order_relaxed);
+            return MakeLeaf(ctx, polys[0].subsector, depth);
+        }
+
+        std::vector<BspPolygon> sides[2];
+        for (BspPolygon& poly : polys) {
+            switch (ClassifyPolygon(poly, line)) {
+                case BspSide::Front: sides[0].push_back(std::move(poly)); break;
+                case BspSide::Back: sides[1].push_back(std::move(poly)); break;
+                case BspSide::Split: {
+                    BspPolygon front, back;
+                    ClipPolygon(poly, line, 1.0, front);
+                    ClipPolygon(poly, line, -1.0, back);
+                    if (front.points.size() >= 3) sides[0].push_back(std::move(front));
+                    if (back.points.size() >= 3) sides[1].push_back(std::move(back));
+                    ctx.splitCount.fetch_add(1, std::memory_order_relaxed);
+                } break;
+            }
+        }
+        polys.clear();
+        polys.shrink_to_fit();
+
+        BspTreeNode* node = new BspTreeNode{};
+        node->line = line;
+        ctx.nodeCount.fetch_add(1, std::memory_order_relaxed);
+
+        if (ctx.jobs && sides[0].size() + sides[1].size() >= ctx.settings->parallelThreshold) {
+            BspBuildTask frontTask = { &ctx, std::move(sides[0]), depth + 1, nullptr };
+
+            JobCounter counter;
+            ctx.jobs->Submit(counter, BuildNodeJob, &frontTask);
+            node->children[1] = BuildNode(ctx, std::move(sides[1]), depth + 1);
+            ctx.jobs->Wait(counter);
+
+            node->children[0] = frontTask.result;
+        } else {
+            node->children[0] = BuildNode(ctx, std::move(sides[0]), depth + 1);
+            node->children[1] = BuildNode(ctx, std::move(sides[1]), depth + 1);
+        }
+
+        return node;
+    }
+
+    static void FreeTree(BspTreeNode* node) {
+        if (!node) return;
+        FreeTree(node->children[0]);
+        FreeTree(node->children[1]);
+        delete node;
+    }
+
+    static inline bool IsLeaf(const BspTreeNode* node) {
+        return node->children[0] == nullptr;
+    }
+
+    // Depth first, so every child is stored after its parent and subtrees stay contiguous
+    static u32 FlattenTree(const BspTreeNode* node, std::vector<MapNode>& outNodes) {
+        if (IsLeaf(node)) {
+            return MapNodeLeafBit | node->leafSubsector;
+        }
+
+        u32 index = static_cast<u32>(outNodes.size());
+        outNodes.push_back(MapNode{});
+
+        MapNode flat;
+        flat.plane[0] = static_cast<f32>(node->line.nx);
+        flat.plane[1] = static_cast<f32>(node->line.ny);
+        flat.plane[2] = static_cast<f32>(node->line.d);
+        flat.children[0] = FlattenTree(node->children[0], outNodes);
+        flat.children[1] = FlattenTree(node->children[1], outNodes);
+
+        outNodes[index] = flat;
+        return index;
+    }
+
+    bool BuildBspNodes(const MapData& map, const BspBuildSettings& settings, JobSystem* jobs,
+                       std::vector<MapNode>& outNodes, BspBuildStats& outStats) {
+        outNodes.clear();
+        outStats = {};
+
+        if (map.subsectorCount == 0) {
+            return false;
+        }
+
+        f64 startTime = GetTimeSeconds();
+
+        std::vector<BspPolygon> polys(map.subsectorCount);
+        for (usize s = 0; s < map.subsectorCount; ++s) {
+            const MapSubsector& subsector = map.subsectors[s];
+            BspPolygon& poly = polys[s];
+            poly.subsector = static_cast<u32>(s);
+
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map.edges[subsector.firstEdge + e];
+                const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+                const s32* start = edge.reversed ? seg.v2 : seg.v1;
+                poly.points.push_back(BspPoint{ static_cast<f64>(start[0]), static_cast<f64>(start[1]) });
+                poly.lines.push_back(edge.lineSeg);
+            }
+        }
+
+        BspBuildContext ctx;
+        ctx.map = &map;
+        ctx.settings = &settings;
+        ctx.jobs = jobs;
+
+        BspTreeNode* root = BuildNode(ctx, std::move(polys), 0);
+
+        // A single subsector needs no nodes at all; runtime lookups fall back to subsector 0
+        if (!IsLeaf(root)) {
+            outNodes.reserve(ctx.nodeCount.load());
+            FlattenTree(root, outNodes);
+        }
+        FreeTree(root);
+
+        outStats.buildSeconds = GetTimeSeconds() - startTime;
+        outStats.nodeCount = static_cast<u32>(outNodes.size());
+        outStats.leafCount = ctx.leafCount.load();
+        outStats.splitCount = ctx.splitCount.load();
+        outStats.maxDepth = ctx.maxDepth.load();
+        outStats.averageLeafDepth = outStats.leafCount ? static_cast<f64>(ctx.leafDepthSum.load()) / outStats.leafCount : 0.0;
+
+        u32 unresolved = ctx.unresolvedCount.load();
+        if (unresolved > 0) {
+            printf("Warning: %u node(s) had overlapping subsectors that no partition could separate\n", unresolved);
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+#include <vector>
+
+namespace Hx {
+    class JobSystem;
+}
+
+namespace Hx {
+
+    struct BspBuildSettings {
+        // Cost of cutting a subsector piece in two, relative to one piece of imbalance
+        u32 splitWeight = 8;
+        // Partition lines evaluated per node; larger sets are sampled evenly
+        u32 maxCandidates = 128;
+        // Sets smaller than this are built on the current thread
+        u32 parallelThreshold = 512;
+    };
+
+    struct BspBuildStats {
+        f64 buildSeconds;
+        u32 nodeCount;
+        u32 leafCount;
+        u32 splitCount;
+        u32 maxDepth;
+        f64 averageLeafDepth;
+    };
+
+    // Builds a BSP whose leaves are convex pieces of the map's subsectors. The
+    // partitions are taken from the subsectors' line segments; a subsector a
+    // partition cuts through ends up in several leaves.
+    bool BuildBspNodes(const Hx::MapData& map, const BspBuildSettings& settings, Hx::JobSystem* jobs,
+                       std::vector<Hx::MapNode>& outNodes, BspBuildStats& outStats);
+
+}
@@ -0,0 +1,408 @@
+#include "LightBuilder.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/Blockmap.h"
+#include "Engine/World/Level/Raycast.h"
+#include "Engine/World/Level/SectorAdjacency.h"
+#include "Engine/World/SpatialGrid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+namespace Hx {
+
+    // Samples sit this far off their surface so shadow rays end inside the sector
+    constexpr f32 LightSurfaceOffset = 1.0f;
+    // and this far in from the corner they stand for, so they are not right on another line
+    constexpr f32 LightCornerInset = 2.0f;
+    // Lights adding less than this are not worth a shadow ray
+    constexpr f32 LightMinContribution = 1.0f / 512.0f;
+
+    enum LightSample : u32 {
+        LightFloor,
+        LightCeiling,
+        LightWallBottomStart,
+        LightWallBottomEnd,
+        LightWallTopStart,
+        LightWallTopEnd,
+        LightSamplesPerEdge
+    };
+
+    struct LightPoint {
+        f32 x;
+        f32 y;
+        f32 z;
+        f32 normal[3];
+    };
+
+    static inline const s32* GetEdgeStart(const MapData& map, const MapEdge& edge) {
+        const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+        return edge.reversed ? seg.v2 : seg.v1;
+    }
+
+    static inline const s32* GetEdgeEnd(const MapData& map, const MapEdge& edge) {
+        const MapLineSegment& seg = map.lineSegments[edge.lineSeg];
+        return edge.reversed ? seg.v1 : seg.v2;
+    }
+
+    // Average of the corners, inside since subsectors are convex
+    static Vector2 GetSubsectorCenter(const MapData& map, const MapSubsector& subsector) {
+        Vector2 center = { 0.0f, 0.0f };
+        for (u32 e = 0; e < subsector.edgeCount; ++e) {
+            const s32* start = GetEdgeStart(map, map.edges[subsector.firstEdge + e]);
+            center.x += static_cast<f32>(start[0]);
+            center.y += static_cast<f32>(start[1]);
+        }
+        if (subsector.edgeCount > 0) {
+            center.x /= static_cast<f32>(subsector.edgeCount);
+            center.y /= static_cast<f32>(subsector.edgeCount);
+        }
+        return center;
+    }
+
+    static f32 GetSubsectorArea(const MapData& map, const MapSubsector& subsector) {
+        f64 area = 0.0;
+        for (u32 e = 0; e < subsector.edgeCount; ++e) {
+            const MapEdge& edge = map.edges[subsector.firstEdge + e];
+            const s32* a = GetEdgeStart(map, edge);
+            const s32* b = GetEdgeEnd(map, edge);
+            area += static_cast<f64>(a[0]) * b[1] - static_cast<f64>(b[0]) * a[1];
+        }
+        return static_cast<f32>(std::fabs(area) * 0.5);
+    }
+
+    void PlaceSectorLights(const MapData& map, const LightBuildSettings& settings, std::vector<LightSource>& outLights) {
+        std::vector<s32> largest(map.sectorCount, -1);
+        std::vector<f32> largestArea(map.sectorCount, 0.0f);
+
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            s32 sector = map.subsectorSectors[i];
+            if (sector < 0) continue;
+
+            f32 area = GetSubsectorArea(map, map.subsectors[i]);
+            if (largest[sector] < 0 || area > largestArea[sector]) {
+                largest[sector] = static_cast<s32>(i);
+                largestArea[sector] = area;
+            }
+        }
+
+        for (usize s = 0; s < map.sectorCount; ++s) {
+            const MapSector& sector = map.sectors[s];
+            if (largest[s] < 0 || sector.ceilingHeight <= sector.floorHeight) continue;
+
+            // Low sectors get their light halfway up instead
+            f32 floor = static_cast<f32>(sector.floorHeight);
+            f32 ceiling = static_cast<f32>(sector.ceilingHeight);
+            f32 z = ceiling - settings.ceilingOffset;
+            if (z <= floor + settings.ceilingOffset) {
+                z = (floor + ceiling) * 0.5f;
+            }
+
+            f32 radius = settings.radiusPerUnit * std::sqrt(largestArea[s]);
+            radius = std::min(std::max(radius, settings.minRadius), settings.maxRadius);
+
+            LightSource light;
+            light.position = GetSubsectorCenter(map, map.subsectors[largest[s]]);
+            light.z = z;
+            light.intensity = settings.intensity;
+            light.radius = radius;
+            outLights.push_back(light);
+        }
+    }
+
+    bool LoadLightSources(const char* filename, FileSystem& fileSystem, std::vector<LightSource>& outLights) {
+        FileHandle* file = fileSystem.OpenFileRead(filename, FileAccessHint::Sequential);
+        if (!file) {
+            return false;
+        }
+
+        std::vector<char> text(file->GetSize() + 1, '\0');
+        bool read = file->ReadAt(text.data(), text.size() - 1, 0);
+        fileSystem.CloseFile(file);
+        if (!read) {
+            return false;
+        }
+
+        char* line = text.data();
+        while (*line) {
+            char* next = line;
+            while (*next && *next != '\n') ++next;
+            if (*next) *next++ = '\0';
+
+            while (*line == ' ' || *line == '\t') ++line;
+            if (*line && *line != '#' && *line != '\r') {
+                f32 values[5];
+                char* cursor = line;
+                for (f32& value : values) {
+                    char* parsed = cursor;
+                    value = strtof(cursor, &parsed);
+                    if (parsed == cursor) return false;
+                    cursor = parsed;
+                }
+
+                LightSource light;
+                light.position = { values[0], values[1] };
+                light.z = values[2];
+                light.intensity = values[3];
+                light.radius = values[4];
+                if (light.radius > 0.0f) {
+                    outLights.push_back(light);
+                }
+            }
+
+            line = next;
+        }
+
+        return true;
+    }
+
+    // Where the samples of one edge sit. Floor and ceiling samples are at the
+    // edge's start, pulled towards the middle of the subsector; wall samples
+    // stand just off the wall at either end, at the floor and at the ceiling.
+    static void GetEdgeSamplePoints(const MapData& map, const MapEdge& edge, const MapSector& sector, Vector2 center,
+                                    LightPoint* outPoints) {
+        const s32* start = GetEdgeStart(map, edge);
+        const s32* end = GetEdgeEnd(map, edge);
+        f32 ax = static_cast<f32>(start[0]);
+        f32 ay = static_cast<f32>(start[1]);
+        f32 dx = static_cast<f32>(end[0]) - ax;
+        f32 dy = static_cast<f32>(end[1]) - ay;
+        f32 length = std::sqrt(dx * dx + dy * dy);
+
+        f32 floor = static_cast<f32>(sector.floorHeight) + LightSurfaceOffset;
+        f32 ceiling = static_cast<f32>(sector.ceilingHeight) - LightSurfaceOffset;
+        if (ceiling < floor) {
+            floor = ceiling = (sector.floorHeight + sector.ceilingHeight) * 0.5f;
+        }
+
+        f32 tx = center.x - ax;
+        f32 ty = center.y - ay;
+        f32 toCenter = std::sqrt(tx * tx + ty * ty);
+        f32 pull = toCenter > 0.0f ? std::min(LightCornerInset, toCenter * 0.5f) / toCenter : 0.0f;
+        f32 fx = ax + tx * pull;
+        f32 fy = ay + ty * pull;
+
+        outPoints[LightFloor] = LightPoint{ fx, fy, floor, { 0.0f, 0.0f, 1.0f } };
+        outPoints[LightCeiling] = LightPoint{ fx, fy, ceiling, { 0.0f, 0.0f, -1.0f } };
+
+        // The sector lies to the left of the edge, the way the wall faces
+        f32 nx = 0.0f;
+        f32 ny = 0.0f;
+        f32 inset = 0.0f;
+        if (length > 0.0f) {
+            nx = -dy / length;
+            ny = dx / length;
+            inset = std::min(LightCornerInset, length * 0.25f) / length;
+        }
+
+        f32 sx = ax + dx * inset + nx * LightSurfaceOffset;
+        f32 sy = ay + dy * inset + ny * LightSurfaceOffset;
+        f32 ex = ax + dx * (1.0f - inset) + nx * LightSurfaceOffset;
+        f32 ey = ay + dy * (1.0f - inset) + ny * LightSurfaceOffset;
+
+        outPoints[LightWallBottomStart] = LightPoint{ sx, sy, floor, { nx, ny, 0.0f } };
+        outPoints[LightWallBottomEnd] = LightPoint{ ex, ey, floor, { nx, ny, 0.0f } };
+        outPoints[LightWallTopStart] = LightPoint{ sx, sy, ceiling, { nx, ny, 0.0f } };
+        outPoints[LightWallTopEnd] = LightPoint{ ex, ey, ceiling, { nx, ny, 0.0f } };
+    }
+
+    static inline u8 ToStoredLight(f32 value) {
+        value = std::min(std::max(value, 0.0f), 1.0f);
+        return static_cast<u8>(value * 255.0f + 0.5f);
+    }
+
+    bool BuildLighting(const MapData& map, const LightBuildSettings& settings, const LightSource* lights,
+                       usize lightCount, JobSystem* jobs, ArenaAllocator& arena,
+                       std::vector<MapEdgeLight>& outLights, LightBuildStats& outStats) {
+        outStats = {};
+        f64 startTime = Hx::GetTimeSeconds();
+
+        Blockmap blockmap = {};
+        SectorAdjacency adjacency = {};
+        if (!BuildBlockmap(blockmap, map, arena) || !BuildSectorAdjacency(adjacency, map, arena)) {
+            return false;
+        }
+
+        // Lights in reach of each subsector, found by one batch of radius
+        // queries around the subsectors' centres
+        std::vector<Vector2> lightPositions(lightCount);
+        std::vector<f32> lightRadii(lightCount);
+        for (usize i = 0; i < lightCount; ++i) {
+            lightPositions[i] = lights[i].position;
+            lightRadii[i] = lights[i].radius;
+        }
+
+        SpatialGrid grid(jobs);
+        grid.SetBounds(Vector2{ blockmap.originX, blockmap.originY },
+                       Vector2{ blockmap.originX + blockmap.width * blockmap.cellSize,
+                                blockmap.originY + blockmap.height * blockmap.cellSize });
+        grid.Rebuild(lightPositions.data(), lightRadii.data(), lightCount);
+
+        std::vector<Vector2> centers(map.subsectorCount);
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            const MapSubsector& subsector = map.subsectors[i];
+            centers[i] = GetSubsectorCenter(map, subsector);
+
+            f32 reach = 0.0f;
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const s32* start = GetEdgeStart(map, map.edges[subsector.firstEdge + e]);
+                f32 dx = static_cast<f32>(start[0]) - centers[i].x;
+                f32 dy = static_cast<f32>(start[1]) - centers[i].y;
+                reach = std::max(reach, dx * dx + dy * dy);
+            }
+            grid.SubmitRadius(centers[i], std::sqrt(reach) + LightSurfaceOffset);
+        }
+        grid.Execute();
+
+        // Direct light at every sample
+        std::vector<f32> direct(map.edgeCount * LightSamplesPerEdge, 0.0f);
+        std::atomic<u64> shadowRays{ 0 };
+        std::atomic<u64> shadowRaysBlocked{ 0 };
+
+        auto gatherDirect = [&](usize begin, usize end) {
+            u64 localRays = 0;
+            u64 localBlocked = 0;
+            LightPoint points[LightSamplesPerEdge];
+
+            for (usize i = begin; i < end; ++i) {
+                s32 sectorIndex = map.subsectorSectors[i];
+                if (sectorIndex < 0) continue;
+
+                const MapSubsector& subsector = map.subsectors[i];
+                const MapSector& sector = map.sectors[sectorIndex];
+                SpatialQueryResult nearby = grid.GetResult(static_cast<u32>(i));
+
+                for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                    usize edgeIndex = subsector.firstEdge + e;
+                    GetEdgeSamplePoints(map, map.edges[edgeIndex], sector, centers[i], points);
+
+                    for (u32 s = 0; s < LightSamplesPerEdge; ++s) {
+                        const LightPoint& point = points[s];
+                        f32 sum = 0.0f;
+
+                        for (u32 n = 0; n < nearby.count; ++n) {
+                            const LightSource& light = lights[nearby.items[n]];
+                            f32 lx = light.position.x - point.x;
+                            f32 ly = light.position.y - point.y;
+                            f32 lz = light.z - point.z;
+                            f32 distance = std::sqrt(lx * lx + ly * ly + lz * lz);
+                            if (distance >= light.radius) continue;
+
+                            f32 facing = 1.0f;
+                            if (distance > 0.0f) {
+                                facing = (lx * point.normal[0] + ly * point.normal[1] + lz * point.normal[2]) / distance;
+                            }
+                            f32 falloff = 1.0f - distance / light.radius;
+                            f32 contribution = light.intensity * facing * falloff * falloff;
+                            if (contribution < LightMinContribution) continue;
+
+                            RayQuery ray = { light.position, Vector2{ point.x, point.y }, light.z, point.z };
+                            ++localRays;
+                            if (!HasLineOfSight(map, blockmap, ray)) {
+                                ++localBlocked;
+                                continue;
+                            }
+                            sum += contribution;
+                        }
+
+                        direct[edgeIndex * LightSamplesPerEdge + s] = sum;
+                    }
+                }
+            }
+
+            shadowRays.fetch_add(localRays, std::memory_order_relaxed);
+            shadowRaysBlocked.fetch_add(localBlocked, std::memory_order_relaxed);
+        };
+
+        if (jobs) {
+            jobs->ParallelFor(map.subsectorCount, 16, gatherDirect);
+        } else {
+            gatherDirect(0, map.subsectorCount);
+        }
+
+        // One bounce between whole sectors: each passes on a share of the
+        // light its surfaces took in, to itself and through its openings
+        std::vector<f64> sectorSum(map.sectorCount, 0.0);
+        std::vector<u32> sectorSamples(map.sectorCount, 0);
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            s32 sector = map.subsectorSectors[i];
+            if (sector < 0) continue;
+
+            const MapSubsector& subsector = map.subsectors[i];
+            for (usize s = subsector.firstEdge * LightSamplesPerEdge; s < (subsector.firstEdge + subsector.edgeCount) * LightSamplesPerEdge; ++s) {
+                sectorSum[sector] += direct[s];
+            }
+            sectorSamples[sector] += subsector.edgeCount * LightSamplesPerEdge;
+        }
+
+        std::vector<f32> average(map.sectorCount, 0.0f);
+        for (usize s = 0; s < map.sectorCount; ++s) {
+            average[s] = sectorSamples[s] > 0 ? static_cast<f32>(sectorSum[s] / sectorSamples[s]) : 0.0f;
+        }
+
+        std::vector<f32> bounce(map.sectorCount, 0.0f);
+        for (u32 s = 0; s < map.sectorCount; ++s) {
+            const MapSector& sector = map.sectors[s];
+            f32 height = static_cast<f32>(sector.ceilingHeight - sector.floorHeight);
+            f32 gathered = average[s];
+            f32 weight = 1.0f;
+
+            u32 neighbourCount = 0;
+            const u32* neighbours = GetSectorNeighbours(adjacency, s, neighbourCount);
+            for (u32 n = 0; n < neighbourCount && height > 0.0f; ++n) {
+                const MapSector& other = map.sectors[neighbours[n]];
+                s32 floor = std::max(sector.floorHeight, other.floorHeight);
+                s32 ceiling = std::min(sector.ceilingHeight, other.ceilingHeight);
+                f32 opening = std::min(std::max(static_cast<f32>(ceiling - floor) / height, 0.0f), 1.0f);
+
+                gathered += average[neighbours[n]] * opening;
+                weight += opening;
+            }
+
+            bounce[s] = settings.albedo * gathered / weight;
+        }
+
+        outLights.assign(map.edgeCount, MapEdgeLight{});
+        f64 lightSum = 0.0;
+        u32 sampleCount = 0;
+
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            s32 sector = map.subsectorSectors[i];
+            if (sector < 0) continue;
+
+            const MapSubsector& subsector = map.subsectors[i];
+            f32 indirect = settings.ambient + bounce[sector];
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                usize edgeIndex = subsector.firstEdge + e;
+                const f32* samples = &direct[edgeIndex * LightSamplesPerEdge];
+                u8 stored[LightSamplesPerEdge];
+                for (u32 s = 0; s < LightSamplesPerEdge; ++s) {
+                    stored[s] = ToStoredLight(indirect + samples[s]);
+                    lightSum += stored[s] * MapLightScale;
+                }
+
+                MapEdgeLight& out = outLights[edgeIndex];
+                out.floor = stored[LightFloor];
+                out.ceiling = stored[LightCeiling];
+                out.wallBottom[0] = stored[LightWallBottomStart];
+                out.wallBottom[1] = stored[LightWallBottomEnd];
+                out.wallTop[0] = stored[LightWallTopStart];
+                out.wallTop[1] = stored[LightWallTopEnd];
+                sampleCount += LightSamplesPerEdge;
+            }
+        }
+
+        outStats.buildSeconds = Hx::GetTimeSeconds() - startTime;
+        outStats.lightCount = static_cast<u32>(lightCount);
+        outStats.sampleCount = sampleCount;
+        outStats.shadowRays = shadowRays.load();
+        outStats.shadowRaysBlocked = shadowRaysBlocked.load();
+        outStats.averageLight = sampleCount > 0 ? lightSum / sampleCount : 0.0;
+        return true;
+    }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/Math/Math.h"
+#include "Engine/World/Level/MapData.h"
+
+#include <vector>
+
+namespace Hx {
+    struct ArenaAllocator;
+    class FileSystem;
+    class JobSystem;
+}
+
+namespace Hx {
+
+    // A point light in map space, z being the height
+    struct LightSource {
+        Vector2 position;
+        f32 z;
+        f32 intensity; // Brightness right next to the light, 1 is full
+        f32 radius;    // Falls off to nothing here
+    };
+
+    struct LightBuildSettings {
+        // Light every surface gets however dark its surroundings
+        f32 ambient = 0.12f;
+        // Share of the light reaching a sector that its surfaces pass on through the openings around it
+        f32 albedo = 0.4f;
+
+        // Automatic lights: one per sector, hung below the ceiling of its
+        // largest subsector, reaching further in larger sectors
+        f32 ceilingOffset = 16.0f;
+        f32 intensity = 1.0f;
+        f32 radiusPerUnit = 2.5f;  // Times the square root of the subsector's area
+        f32 minRadius = 128.0f;
+        f32 maxRadius = 1024.0f;
+    };
+
+    struct LightBuildStats {
+        f64 buildSeconds;
+        u32 lightCount;
+        u32 sampleCount;
+        u64 shadowRays;
+        u64 shadowRaysBlocked;
+        f64 averageLight;
+    };
+
+    // One light near the ceiling of every sector with any height
+    void PlaceSectorLights(const Hx::MapData& map, const LightBuildSettings& settings, std::vector<LightSource>& outLights);
+
+    // Reads "x y z intensity radius" per line, skipping blank lines and lines starting with #
+    bool LoadLightSources(const char* filename, Hx::FileSystem& fileSystem, std::vector<LightSource>& outLights);
+
+    // Bakes the light at the corners the world mesh puts on every edge. Direct
+    // light is gathered from the lights in reach of each corner, with a shadow
+    // ray cast through the map to each. One bounce follows at sector level:
+    // each sector passes albedo times the average direct light on its surfaces
+    // to itself and, in proportion to the opening between them, to its
+    // neighbours. Subsectors are spread over the job system.
+    bool BuildLighting(const Hx::MapData& map, const LightBuildSettings& settings, const LightSource* lights,
+                       usize lightCount, Hx::JobSystem* jobs, Hx::ArenaAllocator& arena,
+                       std::vector<Hx::MapEdgeLight>& outLights, LightBuildStats& outStats);
+
+}
@@ -0,0 +1,154 @@
+#include "BspBuilder.h"
+#include "LightBuilder.h"
+#include "PvsBuilder.h"
+
+#include "Engine/Core/JobSystem.h"
+#include "Engine/IO/FileSystem.h"
+#include "Engine/Memory/ArenaAllocator.h"
+#include "Engine/World/Level/MapData.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() {
+    printf("Usage: MapCompiler <input.map> <output.map> [options]\n");
+    printf("  --threads <n>       Worker threads, 0 picks one per core (default 0)\n");
+    printf("  --split-weight <n>  Cost of a split relative to imbalance (default 8)\n");
+    printf("  --no-vis            Skip the potentially visible set pass\n");
+    printf("  --no-light          Skip the light pass, leaving the map at full brightness\n");
+    printf("  --lights <file>     Lights as \"x y z intensity radius\" lines instead of one per sector\n");
+}
+
+int main(int argCount, char** argValues) {
+    if (argCount < 3) {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* inputFilename = argValues[1];
+    const char* outputFilename = argValues[2];
+
+    u32 threadCount = 0;
+    bool buildVis = true;
+    bool buildLight = true;
+    const char* lightsFilename = nullptr;
+    Hx::BspBuildSettings bspSettings;
+
+    for (int i = 3; i < argCount; ++i) {
+        if (strcmp(argValues[i], "--threads") == 0 && i + 1 < argCount) {
+            threadCount = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--split-weight") == 0 && i + 1 < argCount) {
+            bspSettings.splitWeight = static_cast<u32>(atoi(argValues[++i]));
+        } else if (strcmp(argValues[i], "--no-vis") == 0) {
+            buildVis = false;
+        } else if (strcmp(argValues[i], "--no-light") == 0) {
+            buildLight = false;
+        } else if (strcmp(argValues[i], "--lights") == 0 && i + 1 < argCount) {
+            lightsFilename = argValues[++i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Legacy maps are copied into the arena, so size it for large maps
+    usize arenaSize = Hx::Megabytes(512);
+    void* arenaMemory = malloc(arenaSize);
+    Hx::ArenaAllocator arena = {};
+    Hx::InitArena(arena, arenaMemory, arenaSize);
+
+    Hx::FileSystem fileSystem;
+
+    Hx::MapData* map = Hx::LoadMapFromFile(inputFilename, fileSystem, arena);
+    if (!map) {
+        printf("Failed to load %s\n", inputFilename);
+        return 1;
+    }
+
+    printf("%s: %zu sectors, %zu subsectors, %zu line segments\n",
+           inputFilename, map->sectorCount, map->subsectorCount, map->lineSegmentCount);
+
+    Hx::JobSystem jobs(threadCount);
+
+    std::vector<Hx::MapNode> nodes;
+    Hx::BspBuildStats bspStats;
+    if (!Hx::BuildBspNodes(*map, bspSettings, &jobs, nodes, bspStats)) {
+        printf("Failed to build BSP nodes\n");
+        return 1;
+    }
+
+    printf("BSP: %.2f ms on %u threads, %u nodes, %u leaves, %u splits, depth %u max / %.1f average\n",
+           bspStats.buildSeconds * 1000.0, jobs.GetThreadCount(), bspStats.nodeCount, bspStats.leafCount,
+           bspStats.splitCount, bspStats.maxDepth, bspStats.averageLeafDepth);
+
+    Hx::MapData output = *map;
+    output.nodes = nodes.data();
+    output.nodeCount = nodes.size();
+
+    std::vector<u32> visOffsets;
+    std::vector<u8> visData;
+    output.visOffsets = nullptr;
+    output.visOffsetCount = 0;
+    output.visData = nullptr;
+    output.visDataSize = 0;
+
+    if (buildVis) {
+        Hx::PvsBuildStats pvsStats;
+        if (!Hx::BuildPvs(*map, &jobs, visOffsets, visData, pvsStats)) {
+            printf("Failed to build the potentially visible set\n");
+            return 1;
+        }
+
+        printf("PVS: %.2f ms, %u portals, %.1f subsectors visible on average, %u unique rows, %zu bytes (%zu uncompressed)\n",
+               pvsStats.buildSeconds * 1000.0, pvsStats.portalCount, pvsStats.averageVisible,
+               pvsStats.uniqueRowCount, pvsStats.compressedSize, pvsStats.uncompressedSize);
+
+        output.visOffsets = visOffsets.data();
+        output.visOffsetCount = visOffsets.size();
+        output.visData = visData.data();
+        output.visDataSize = visData.size();
+    }
+
+    std::vector<Hx::MapEdgeLight> edgeLights;
+    output.edgeLights = nullptr;
+    output.edgeLightCount = 0;
+
+    if (buildLight) {
+        Hx::LightBuildSettings lightSettings;
+        std::vector<Hx::LightSource> lights;
+        if (lightsFilename) {
+            if (!Hx::LoadLightSources(lightsFilename, fileSystem, lights)) {
+                printf("Failed to load lights from %s\n", lightsFilename);
+                return 1;
+            }
+        } else {
+            Hx::PlaceSectorLights(*map, lightSettings, lights);
+        }
+
+        Hx::LightBuildStats lightStats;
+        if (!Hx::BuildLighting(*map, lightSettings, lights.data(), lights.size(), &jobs, arena, edgeLights, lightStats)) {
+            printf("Failed to build lighting\n");
+            return 1;
+        }
+
+        printf("Light: %.2f ms, %u lights, %u samples, %llu shadow rays (%llu blocked), %.2f average brightness\n",
+               lightStats.buildSeconds * 1000.0, lightStats.lightCount, lightStats.sampleCount,
+               static_cast<unsigned long long>(lightStats.shadowRays),
+               static_cast<unsigned long long>(lightStats.shadowRaysBlocked), lightStats.averageLight);
+
+        output.edgeLights = edgeLights.data();
+        output.edgeLightCount = edgeLights.size();
+    }
+
+    if (!Hx::WriteMapToFile(outputFilename, output, fileSystem)) {
+        printf("Failed to write %s\n", outputFilename);
+        return 1;
+    }
+
+    free(arenaMemory);
+
+    printf("Wrote %s\n", outputFilename);
+    return 0;
+}
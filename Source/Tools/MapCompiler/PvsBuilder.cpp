@@ -0,0 +1,421 @@
+#include "PvsBuilder.h"
+#include "Engine/Core/Clock.h"
+#include "Engine/Core/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace Hx {
+
+    constexpr f64 PvsEpsilon = 1e-3;
+    constexpr u32 NoSubsector = ~0u;
+
+    // A flow phase holds a sixteenth as many portals as all phases before it,
+    // and at least this many. Short phases keep results finishing early enough
+    // for later portals to lean on, without starving the job system.
+    constexpr usize PvsMinPhaseSize = 64;
+
+    struct PvsPoint {
+        f64 x;
+        f64 y;
+    };
+
+    // A portal is the stretch of a line segment light can pass through. It is
+    // stored once per direction, oriented so the subsector it leaves is on the
+    // left of a -> b and the one it enters is on the right.
+    struct PvsWinding {
+        PvsPoint a;
+        PvsPoint b;
+    };
+
+    struct PvsPortal {
+        PvsWinding winding;
+        u32 fromLeaf;
+        u32 toLeaf;
+
+        // Leaves a cheap flood says might be visible through the portal, then the result of the full flow
+        std::vector<u64> mightSee;
+        std::vector<u64> visible;
+        u32 mightSeeCount;
+        u32 phase; // Flowed after every portal of an earlier phase
+    };
+
+    struct PvsLeaf {
+        std::vector<u32> portals; // Portals leaving the leaf
+    };
+
+    struct PvsContext {
+        const MapData* map;
+        std::vector<PvsPortal> portals;
+        std::vector<PvsLeaf> leaves;
+        usize leafWords;
+    };
+
+    static inline bool TestBit(const std::vector<u64>& bits, u32 index) {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+
+    static inline void SetBit(std::vector<u64>& bits, u32 index) {
+        bits[index >> 6] |= 1ull << (index & 63);
+    }
+
+    static u32 CountBits(const std::vector<u64>& bits) {
+        u32 count = 0;
+        for (u64 word : bits) {
+            while (word) {
+                word &= word - 1;
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    // Positive on the right of a -> b, the side a directed portal leads into
+    static inline f64 SideOfLine(const PvsPoint& a, const PvsPoint& b, const PvsPoint& p) {
+        f64 dx = b.x - a.x;
+        f64 dy = b.y - a.y;
+        f64 length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0) return 0.0;
+        return ((p.x - a.x) * dy - (p.y - a.y) * dx) / length;
+    }
+
+    // Keeps the part of the winding where sign * SideOfLine(a, b, p) >= 0
+    static bool ClipWinding(PvsWinding& winding, const PvsPoint& a, const PvsPoint& b, f64 sign) {
+        f64 da = SideOfLine(a, b, winding.a) * sign;
+        f64 db = SideOfLine(a, b, winding.b) * sign;
+
+        if (da < -PvsEpsilon && db < -PvsEpsilon) return false;
+        if (da >= -PvsEpsilon && db >= -PvsEpsilon) return true;
+
+        f64 t = da / (da - db);
+        PvsPoint crossing = { winding.a.x + (winding.b.x - winding.a.x) * t, winding.a.y + (winding.b.y - winding.a.y) * t };
+        if (da < 0.0) {
+            winding.a = crossing;
+        } else {
+            winding.b = crossing;
+        }
+        return true;
+    }
+
+    // Clips target to the region lines through both source and pass can reach.
+    // That region is bounded by the lines through one end of each which have
+    // the source and the pass on opposite sides.
+    static bool ClipToSeparators(const PvsWinding& source, const PvsWinding& pass, PvsWinding& target) {
+        const PvsPoint sourcePoints[2] = { source.a, source.b };
+        const PvsPoint passPoints[2] = { pass.a, pass.b };
+
+        for (u32 i = 0; i < 2; ++i) {
+            for (u32 j = 0; j < 2; ++j) {
+                const PvsPoint& s = sourcePoints[i];
+                const PvsPoint& p = passPoints[j];
+                if (std::fabs(s.x - p.x) + std::fabs(s.y - p.y) < PvsEpsilon) continue;
+
+                f64 sourceSide = SideOfLine(s, p, sourcePoints[i ^ 1]);
+                f64 passSide = SideOfLine(s, p, passPoints[j ^ 1]);
+                if (std::fabs(sourceSide) < PvsEpsilon || std::fabs(passSide) < PvsEpsilon) continue;
+                if ((sourceSide > 0.0) == (passSide > 0.0)) continue;
+
+                if (!ClipWinding(target, s, p, passSide > 0.0 ? 1.0 : -1.0)) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static void BuildPortals(PvsContext& ctx) {
+        const MapData& map = *ctx.map;
+
+        // Which subsector uses each segment on its front and on its back
+        std::vector<u32> frontLeaf(map.lineSegmentCount, NoSubsector);
+        std::vector<u32> backLeaf(map.lineSegmentCount, NoSubsector);
+        for (usize i = 0; i < map.subsectorCount; ++i) {
+            const MapSubsector& subsector = map.subsectors[i];
+            for (u32 e = 0; e < subsector.edgeCount; ++e) {
+                const MapEdge& edge = map.edges[subsector.firstEdge + e];
+                (edge.reversed ? backLeaf : frontLeaf)[edge.lineSeg] = static_cast<u32>(i);
+            }
+        }
+
+        usize portalCount = 0;
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            if (map.lineSegments[i].backSector >= 0 && frontLeaf[i] != NoSubsector && backLeaf[i] != NoSubsector) {
+                portalCount += 2;
+            }
+        }
+
+        ctx.portals = std::vector<PvsPortal>(portalCount);
+        ctx.leaves.resize(map.subsectorCount);
+
+        usize next = 0;
+        for (usize i = 0; i < map.lineSegmentCount; ++i) {
+            const MapLineSegment& seg = map.lineSegments[i];
+            if (seg.backSector < 0 || frontLeaf[i] == NoSubsector || backLeaf[i] == NoSubsector) continue;
+
+            // The front subsector is on the left of v1 -> v2, so that direction leaves it
+            PvsPoint v1 = { static_cast<f64>(seg.v1[0]), static_cast<f64>(seg.v1[1]) };
+            PvsPoint v2 = { static_cast<f64>(seg.v2[0]), static_cast<f64>(seg.v2[1]) };
+
+            PvsPortal& out = ctx.portals[next];
+            out.winding = PvsWinding{ v1, v2 };
+            out.fromLeaf = frontLeaf[i];
+            out.toLeaf = backLeaf[i];
+
+            PvsPortal& in = ctx.portals[next + 1];
+            in.winding = PvsWinding{ v2, v1 };
+            in.fromLeaf = backLeaf[i];
+            in.toLeaf = frontLeaf[i];
+
+            next += 2;
+        }
+
+        for (u32 i = 0; i < ctx.portals.size(); ++i) {
+            ctx.leaves[ctx.portals[i].fromLeaf].portals.push_back(i);
+        }
+    }
+
+    // Whether anything passing through from can go on through to: part of to
+    // lies ahead of from, and part of from lies behind to
+    static bool CanPortalLeadTo(const PvsPortal& from, const PvsPortal& to) {
+        const PvsWinding& f = from.winding;
+        const PvsWinding& t = to.winding;
+
+        bool ahead = SideOfLine(f.a, f.b, t.a) > PvsEpsilon || SideOfLine(f.a, f.b, t.b) > PvsEpsilon;
+        bool behind = SideOfLine(t.a, t.b, f.a) < -PvsEpsilon || SideOfLine(t.a, t.b, f.b) < -PvsEpsilon;
+        return ahead && behind;
+    }
+
+    static void FloodMightSee(PvsContext& ctx, PvsPortal& portal) {
+        portal.mightSee.assign(ctx.leafWords, 0);
+
+        std::vector<u32> stack;
+        stack.push_back(portal.toLeaf);
+        SetBit(portal.mightSee, portal.toLeaf);
+
+        while (!stack.empty()) {
+            u32 leaf = stack.back();
+            stack.pop_back();
+
+            for (u32 next : ctx.leaves[leaf].portals) {
+                const PvsPortal& candidate = ctx.portals[next];
+                if (TestBit(portal.mightSee, candidate.toLeaf) || !CanPortalLeadTo(portal, candidate)) continue;
+
+                SetBit(portal.mightSee, candidate.toLeaf);
+                stack.push_back(candidate.toLeaf);
+            }
+        }
+
+        portal.mightSeeCount = CountBits(portal.mightSee);
+    }
+
+    struct PvsFlowState {
+        PvsContext* ctx;
+        PvsPortal* portal;
+        u32 phase;
+
+        // One might see set per recursion depth, reused between siblings
+        std::vector<std::vector<u64>> mightStack;
+        std::vector<u64> inPath;
+    };
+
+    static void RecursiveFlow(PvsFlowState& state, u32 leaf, const PvsWinding& source, const PvsWinding* pass, u32 depth) {
+        PvsContext& ctx = *state.ctx;
+        PvsPortal& portal = *state.portal;
+
+        SetBit(portal.visible, leaf);
+        SetBit(state.inPath, leaf);
+
+        if (state.mightStack.size() <= depth + 1) {
+            state.mightStack.resize(depth + 2);
+        }
+        state.mightStack[depth + 1].resize(ctx.leafWords);
+
+        for (u32 next : ctx.leaves[leaf].portals) {
+            PvsPortal& candidate = ctx.portals[next];
+            if (TestBit(state.inPath, candidate.toLeaf)) continue;
+
+            const std::vector<u64>& might = state.mightStack[depth];
+            if (!TestBit(might, candidate.toLeaf)) continue;
+
+            // Portals flowed in an earlier phase narrow the search much better than
+            // their flood estimate. Ones in the same phase may still be flowing on
+            // another thread, and reading them would make the result depend on timing.
+            const std::vector<u64>& candidateSees = candidate.phase < state.phase ? candidate.visible : candidate.mightSee;
+
+            std::vector<u64>& nextMight = state.mightStack[depth + 1];
+            bool more = false;
+            for (usize w = 0; w < ctx.leafWords; ++w) {
+                nextMight[w] = might[w] & candidateSees[w];
+                if (nextMight[w] & ~portal.visible[w]) more = true;
+            }
+
+            if (!more && TestBit(portal.visible, candidate.toLeaf)) continue;
+
+            PvsWinding target = candidate.winding;
+            PvsWinding narrowedSource = source;
+
+            if (!pass) {
+                // Straight out of the first leaf, which is convex, so only degenerate cases clip here
+                if (!ClipWinding(target, source.a, source.b, 1.0)) continue;
+                if (!ClipWinding(narrowedSource, target.a, target.b, -1.0)) continue;
+            } else {
+                if (!ClipToSeparators(source, *pass, target)) continue;
+                // And the part of the source that can see what is left of the target
+                if (!ClipToSeparators(target, *pass, narrowedSource)) continue;
+            }
+
+            RecursiveFlow(state, candidate.toLeaf, narrowedSource, &target, depth + 1);
+        }
+
+        state.inPath[leaf >> 6] &= ~(1ull << (leaf & 63));
+    }
+
+    static void FlowPortal(PvsContext& ctx, PvsPortal& portal) {
+        PvsFlowState state;
+        state.ctx = &ctx;
+        state.portal = &portal;
+        state.phase = portal.phase;
+        state.inPath.assign(ctx.leafWords, 0);
+        state.mightStack.resize(1);
+        state.mightStack[0] = portal.mightSee;
+
+        portal.visible.assign(ctx.leafWords, 0);
+
+        // The leaf the portal came from must not count as reached through it
+        SetBit(state.inPath, portal.fromLeaf);
+        RecursiveFlow(state, portal.toLeaf, portal.winding, nullptr, 0);
+    }
+
+    static void CompressRow(const std::vector<u64>& bits, usize rowSize, std::string& out) {
+        out.clear();
+
+        usize i = 0;
+        while (i < rowSize) {
+            u8 value = static_cast<u8>(bits[i >> 3] >> ((i & 7) * 8));
+            if (value) {
+                out.push_back(static_cast<char>(value));
+                ++i;
+                continue;
+            }
+
+            usize run = 0;
+            while (i < rowSize && run < 255 && static_cast<u8>(bits[i >> 3] >> ((i & 7) * 8)) == 0) {
+                ++run;
+                ++i;
+            }
+            out.push_back(0);
+            out.push_back(static_cast<char>(run));
+        }
+    }
+
+    bool BuildPvs(const Hx::MapData& map, Hx::JobSystem* jobs, std::vector<u32>& outOffsets,
+                  std::vector<u8>& outData, PvsBuildStats& outStats) {
+        f64 startTime = Hx::GetTimeSeconds();
+        outStats = {};
+
+        if (map.subsectorCount == 0) {
+            return false;
+        }
+
+        PvsContext ctx;
+        ctx.map = &map;
+        ctx.leafWords = (map.subsectorCount + 63) / 64;
+
+        // The heights baked into the map are only where sectors start out, doors
+        // and lifts move them at runtime. Every two-sided portal is left open
+        // and the runtime portal pass culls what the current heights close.
+        BuildPortals(ctx);
+
+        auto forEach = [&](usize count, auto&& fn) {
+            if (jobs) {
+                jobs->ParallelFor(count, 16, fn);
+            } else {
+                fn(static_cast<usize>(0), count);
+            }
+        };
+
+        forEach(ctx.portals.size(), [&](usize begin, usize end) {
+            for (usize i = begin; i < end; ++i) {
+                FloodMightSee(ctx, ctx.portals[i]);
+            }
+        });
+
+        // Narrow portals first, so the wide ones can lean on their finished
+        // results. Ties go by index and phases end at fixed places, so the
+        // result is the same however many threads do the work.
+        std::vector<u32> order(ctx.portals.size());
+        for (u32 i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+            const PvsPortal& pa = ctx.portals[a];
+            const PvsPortal& pb = ctx.portals[b];
+            return pa.mightSeeCount != pb.mightSeeCount ? pa.mightSeeCount < pb.mightSeeCount : a < b;
+        });
+
+        std::vector<usize> phaseStarts;
+        for (usize i = 0; i < order.size(); ++i) {
+            if (i == 0 || i >= phaseStarts.back() + std::max(phaseStarts.back() / 16, PvsMinPhaseSize)) {
+                phaseStarts.push_back(i);
+            }
+            ctx.portals[order[i]].phase = static_cast<u32>(phaseStarts.size() - 1);
+        }
+        phaseStarts.push_back(order.size());
+
+        for (usize phase = 0; phase + 1 < phaseStarts.size(); ++phase) {
+            usize phaseBegin = phaseStarts[phase];
+            forEach(phaseStarts[phase + 1] - phaseBegin, [&](usize begin, usize end) {
+                for (usize i = begin; i < end; ++i) {
+                    FlowPortal(ctx, ctx.portals[order[phaseBegin + i]]);
+                }
+            });
+        }
+
+        // A leaf sees itself and whatever its portals see
+        usize rowSize = GetVisRowSize(map.subsectorCount);
+        std::vector<std::string> rows(map.subsectorCount);
+        std::atomic<u64> visibleSum{ 0 };
+
+        forEach(map.subsectorCount, [&](usize begin, usize end) {
+            std::vector<u64> bits(ctx.leafWords);
+            u64 localSum = 0;
+            for (usize leaf = begin; leaf < end; ++leaf) {
+                std::fill(bits.begin(), bits.end(), 0);
+                SetBit(bits, static_cast<u32>(leaf));
+                for (u32 p : ctx.leaves[leaf].portals) {
+                    const std::vector<u64>& visible = ctx.portals[p].visible;
+                    for (usize w = 0; w < ctx.leafWords; ++w) bits[w] |= visible[w];
+                }
+
+                localSum += CountBits(bits);
+                CompressRow(bits, rowSize, rows[leaf]);
+            }
+            visibleSum.fetch_add(localSum, std::memory_order_relaxed);
+        });
+
+        outOffsets.resize(map.subsectorCount);
+        outData.clear();
+
+        std::unordered_map<std::string, u32> uniqueRows;
+        for (usize leaf = 0; leaf < map.subsectorCount; ++leaf) {
+            auto inserted = uniqueRows.emplace(rows[leaf], static_cast<u32>(outData.size()));
+            if (inserted.second) {
+                outData.insert(outData.end(), rows[leaf].begin(), rows[leaf].end());
+            }
+            outOffsets[leaf] = inserted.first->second;
+        }
+
+        outStats.buildSeconds = Hx::GetTimeSeconds() - startTime;
+        outStats.portalCount = static_cast<u32>(ctx.portals.size());
+        outStats.averageVisible = static_cast<f64>(visibleSum.load()) / static_cast<f64>(map.subsectorCount);
+        outStats.uniqueRowCount = static_cast<u32>(uniqueRows.size());
+        outStats.uncompressedSize = rowSize * map.subsectorCount;
+        outStats.compressedSize = outData.size();
+        return true;
+    }
+
+}
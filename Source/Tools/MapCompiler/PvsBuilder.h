@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Engine/Core/Types.h"
+#include "Engine/World/Level/MapData.h"
+
+#include <vector>
+
+namespace Hx {
+    class JobSystem;
+}
+
+namespace Hx {
+
+    struct PvsBuildStats {
+        f64 buildSeconds;
+        u32 portalCount;
+        f64 averageVisible;
+        u32 uniqueRowCount;
+        usize uncompressedSize;
+        usize compressedSize;
+    };
+
+    // Computes which subsectors can see each other by flowing through the
+    // portals the two-sided line segments form between subsectors. Sector
+    // heights are ignored, since they change at runtime. The result is one
+    // run length encoded row per subsector, with identical rows stored once.
+    bool BuildPvs(const Hx::MapData& map, Hx::JobSystem* jobs, std::vector<u32>& outOffsets,
+                  std::vector<u8>& outData, PvsBuildStats& outStats);
+
+}